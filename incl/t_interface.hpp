@@ -42,6 +42,8 @@ namespace UI
     void execute_slice(std::string gds_path, std::string ldf_path, int x1, int y1, int x2, int y2);
     void execute_simple_append(int &argc, char *argv[]);
     void execute_simple_merge(int &argc, char *argv[]);
+    void execute_stack(int &argc, char *argv[]);
+    void execute_pipeline(int &argc, char *argv[]);
     void gather_merge_interactive();
     void execute_rotate(int &argc, char *argv[]);
     void gather_rotate_interactive();
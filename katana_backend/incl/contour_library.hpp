@@ -0,0 +1,54 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function declarations for the shared etch-contour library
+ */
+#ifndef contourlibrary
+#define contourlibrary
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace MODEL3D{
+
+  struct contour_point {
+    double x;
+    double y;
+    double z;
+  };
+
+  // Etch profile of one layer thickness. x runs from 0 to the contour width
+  // and z from 0 to the layer thickness.
+  class etch_contour
+  {
+  public:
+    std::vector<contour_point> points;
+    std::vector<std::string> script_lines;  // Contour list as written into the FreeCAD script
+    double      width() const { return points.back().x; }
+    double      height() const { return points.back().z; }
+    void        build_script_lines();
+    etch_contour resample(const size_t &point_count) const;
+  };
+
+  // Contours keyed by layer thickness. Each contour file is read once, no
+  // matter how many layers share its thickness, and resampled profiles are
+  // prepared up front so lookups during generation are read-only.
+  class contour_library
+  {
+  private:
+    std::map<std::pair<int, size_t>, etch_contour> contours; // (thickness, resolution), 0 = as loaded
+  public:
+    int         load(const std::string &directory, const int &thickness);
+    void        precompute(const size_t &point_count);
+    const etch_contour* find(const int &thickness, const size_t &point_count) const;
+    contour_library() {}
+    ~contour_library() {}
+  };
+
+  int   read_contour_file(const std::string &contour_path, etch_contour &contour);
+}
+#endif
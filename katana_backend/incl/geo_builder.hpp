@@ -0,0 +1,56 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function declarations for append-only Gmsh .geo model assembly
+ */
+#ifndef geobuilder
+#define geobuilder
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "geofile_operations.hpp"
+
+namespace GEO{
+
+  // Named group of volumes written as a Physical Volume.
+  struct physical_volume {
+    std::string name;
+    std::vector<int> volumes;
+  };
+
+  // Vector-backed .geo model that only ever grows. Entity IDs are the
+  // position in their table plus one, so they stay dense and global.
+  // Lines are shared between surfaces: asking for an existing edge returns
+  // its ID, negated when requested in the opposite direction.
+  class geo_builder
+  {
+  private:
+    std::vector<point> points;
+    std::vector<line> lines;
+    std::vector<std::vector<int>> curve_loops;
+    std::vector<std::vector<int>> plane_surfaces;   // outer curve loop first, then holes
+    std::vector<std::vector<int>> surface_loops;
+    std::vector<int> volumes;                       // surface loop of each volume
+    std::vector<physical_volume> physical_volumes;
+    std::unordered_map<uint64_t, int> line_lookup;  // point pair to line ID
+    uint64_t    line_key(const int &start, const int &end) const;
+  public:
+    int         add_point(const double &x, const double &y, const double &z);
+    int         add_line(const int &start, const int &end);
+    int         add_curve_loop(const std::vector<int> &loop_points);
+    int         add_plane_surface(const std::vector<int> &loops);
+    int         add_surface_loop(const std::vector<int> &surfaces);
+    int         add_volume(const int &surface_loop);
+    void        add_physical_volume(const std::string &name, const std::vector<int> &group);
+    void        append(const geo_builder &other);
+    int         export_geofile(const std::string &export_path) const;
+    size_t      volume_count() const { return volumes.size(); }
+    geo_builder() {}
+    ~geo_builder() {}
+  };
+}
+#endif
@@ -8,8 +8,11 @@
 #ifndef KATANA_GEOMETRY_OPERATIONS
 #define KATANA_GEOMETRY_OPERATIONS
 
+#include <algorithm>
 #include <map>
+#include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <chrono>
 
@@ -71,8 +74,208 @@ namespace GEO{
         }
     };
     int compare_line(const line &first, const line &second);
-    bool check_same_vec(const std::vector<int> &first, const std::vector<int> &second);
-    int compare_vector(const std::vector<int> &first, const std::vector<int> &second);
+    //------------------------ ENTITY TABLES ------------------------
+    // Entities of one kind stored densely by ID: slot i holds entity i and a
+    // flag marks the slots in use, so a lookup is one array access and
+    // iteration runs in ascending ID order. Erased IDs stay behind as
+    // tombstones until the table is renumbered. IDs start at 1.
+    template <typename Entity>
+    class entity_table
+    {
+    private:
+        std::vector<Entity> entities;       // ID -> entity
+        std::vector<char>   used;           // ID -> 1 if the slot holds an entity
+        size_t live = 0;
+        void move_entity(const int &from, const int &to)
+        {
+            if(from==to)
+                return;
+            entities[to] = std::move(entities[from]);
+            used[from] = 0;
+            used[to] = 1;
+        }
+    public:
+        bool   empty() const { return live==0; }
+        size_t size() const { return live; }
+        bool   contains(const int &id) const
+        {
+            return (id>0) && ((size_t)id<used.size()) && (used[id]==1);
+        }
+        Entity       &operator[](const int &id) { return entities[id]; }
+        const Entity &operator[](const int &id) const { return entities[id]; }
+        // Stores the entity under id unless the ID is taken, as std::map::insert.
+        bool insert(const int &id, const Entity &entity)
+        {
+            if( (id<=0) || (contains(id)==true) )
+                return false;
+            if((size_t)id>=used.size())
+            {
+                entities.resize(id+1);
+                used.resize(id+1, 0);
+            }
+            entities[id] = entity;
+            used[id] = 1;
+            live++;
+            return true;
+        }
+        void erase(const int &id)
+        {
+            if(contains(id)==true)
+            {
+                used[id] = 0;
+                live--;
+            }
+        }
+        void clear()
+        {
+            entities.clear();
+            used.clear();
+            live = 0;
+        }
+        // Next ID in use after id, 0 past the last one.
+        int next_id(int id) const
+        {
+            for (id++; (size_t)id < used.size(); id++)
+            {
+                if(used[id]==1)
+                    return id;
+            }
+            return 0;
+        }
+        int first_id() const { return next_id(0); }
+        int last_id() const
+        {
+            for (int id = (int)used.size()-1; id > 0; id--)
+            {
+                if(used[id]==1)
+                    return id;
+            }
+            return 0;
+        }
+        // New IDs that close the gaps while keeping the order of the
+        // entities: a running sum of the used flags, so the n-th ID in use
+        // becomes n. Unused IDs keep their number. Empty if there are no gaps.
+        std::vector<int> gapless_ids() const
+        {
+            std::vector<int> new_ids;
+            if((size_t)last_id()==live)
+                return new_ids;
+            new_ids.resize(used.size());
+            int rank = 0;
+            for (size_t id = 0; id < used.size(); id++)
+            {
+                rank += used[id];
+                new_ids[id] = (used[id]==1) ? rank : (int)id;
+            }
+            return new_ids;
+        }
+        // Moves entity id to new_ids[id]. new_ids must cover every ID in use
+        // and give them distinct positive values. A remap that keeps the
+        // order of the IDs and moves them all down (closing gaps) or all up
+        // (a merge shift) is applied in place; any other goes through a copy.
+        void renumber(const std::vector<int> &new_ids)
+        {
+            bool ordered = true;
+            bool down = true;
+            bool up = true;
+            int highest = 0;
+            for (int id = first_id(); id != 0; id = next_id(id))
+            {
+                ordered = ordered && (new_ids[id]>highest);
+                down = down && (new_ids[id]<=id);
+                up = up && (new_ids[id]>=id);
+                highest = new_ids[id];
+            }
+            if( (ordered==true) && (down==true) )
+            {
+                for (int id = first_id(); id != 0; id = next_id(id))
+                    move_entity(id, new_ids[id]);
+                entities.resize(highest+1);
+                used.resize(highest+1);
+            }
+            else if( (ordered==true) && (up==true) )
+            {
+                size_t old_extent = used.size();
+                entities.resize(std::max(old_extent, (size_t)highest+1));
+                used.resize(std::max(old_extent, (size_t)highest+1), 0);
+                for (int id = (int)old_extent-1; id > 0; id--)
+                {
+                    if(used[id]==1)
+                        move_entity(id, new_ids[id]);
+                }
+            }
+            else
+            {
+                entity_table moved;
+                moved.entities.reserve(used.size());
+                moved.used.reserve(used.size());
+                for (int id = first_id(); id != 0; id = next_id(id))
+                    moved.insert(new_ids[id], entities[id]);
+                *this = std::move(moved);
+            }
+        }
+        size_t memory_bytes() const
+        {
+            return entities.capacity()*sizeof(Entity) + used.capacity();
+        }
+    };
+
+    // Read-only view of the members of one loop.
+    struct member_span
+    {
+        const int *first;
+        size_t count;
+        const int *begin() const { return first; }
+        const int *end() const { return first+count; }
+        size_t size() const { return count; }
+    };
+
+    // Member lists of curve and surface loops in compressed sparse rows: the
+    // members of all loops sit in one array and each loop ID keeps the
+    // offset and length of its run. Erased runs are dropped by compact().
+    class loop_table
+    {
+    private:
+        struct member_run
+        {
+            size_t offset;
+            size_t count;
+        };
+        entity_table<member_run> runs;
+        std::vector<int> flat_members;
+        size_t live_members = 0;
+    public:
+        bool   empty() const { return runs.empty(); }
+        size_t size() const { return runs.size(); }
+        bool   contains(const int &id) const { return runs.contains(id); }
+        int    next_id(const int &id) const { return runs.next_id(id); }
+        int    first_id() const { return runs.first_id(); }
+        int    last_id() const { return runs.last_id(); }
+        std::vector<int> gapless_ids() const { return runs.gapless_ids(); }
+        member_span operator[](const int &id) const
+        {
+            return {flat_members.data()+runs[id].offset, runs[id].count};
+        }
+        // Members of every run, erased ones included, for redirecting
+        // references in one pass.
+        std::vector<int> &members() { return flat_members; }
+        bool insert(const int &id, const int *first, const size_t &count);
+        bool insert(const int &id, const std::vector<int> &loop_members)
+        {
+            return insert(id, loop_members.data(), loop_members.size());
+        }
+        void erase(const int &id);
+        // Drops the members whose ID (either sign) is flagged in removed
+        // from every loop, shortening the runs in place.
+        void remove_members(const std::vector<bool> &removed);
+        void clear();
+        void compact();
+        void renumber(const std::vector<int> &new_ids);
+        size_t memory_bytes() const;
+    };
+
+    bool check_same_vec(const member_span &first, const member_span &second);
+    int compare_vector(const member_span &first, const member_span &second);
     void remove_empty_strings(std::vector<std::string>& input_string);
     enum geo_argument
     {
@@ -97,6 +300,29 @@ namespace GEO{
     bool is_integer(std::string const& n) noexcept;
     bool is_e_notation(std::string const& n) noexcept;
     void trim_string_vector(std::vector<std::string> &invec);
+    // One ID per entity kind: the highest IDs of a file, or the offsets that
+    // move a file's IDs past those of other files.
+    struct id_extents
+    {
+        int points = 0;
+        int lines = 0;
+        int curve_loops = 0;
+        int plane_surfaces = 0;
+        int surface_loops = 0;
+        int volumes = 0;
+    };
+    // Boundary of one plane surface: its corners in curve loop order and the
+    // physical surface it belongs to (empty if none).
+    struct surface_outline
+    {
+        int surface;
+        std::string physical;
+        std::vector<point> corners;
+    };
+    struct affine_transform;            // geofile_transform.hpp
+    // Models with at least this many points, lines, curve loops and plane
+    // surfaces are exported with the file sections formatted in parallel.
+    constexpr size_t PARALLEL_EXPORT_ENTITIES = 100000;
     class geofile
     {
     public:
@@ -107,6 +333,9 @@ namespace GEO{
         int simplify_data();
         int merge_with(geofile &secondary_file);
         int quick_merge_with(geofile &secondary_file);
+        id_extents highest_ids() const;
+        void offset_ids(const id_extents &offsets);
+        void absorb(geofile &other);
         // noconflict merge TODO
         int translate_data( const double &delta_x,
                             const double &delta_y,
@@ -115,6 +344,7 @@ namespace GEO{
                           const double &o_z,       const double &theta_x,
                           const double &theta_y,   const double &theta_z);
         int scale_data(const double factor);
+        void transform_data(const affine_transform &transform);
         void make_coherent(const bool &detailed);
         //=========== coherence new ==============
         void pull_points(std::vector<GEO::point> &in_vector);
@@ -124,24 +354,29 @@ namespace GEO{
         int insert_plane_surfaces_map(const std::map<int, int> &in_plane_surfaces_map);
         int insert_surface_loops_map(const std::map<int, std::vector<int>> &in_surface_loops_map);
         int insert_volumes_map(const std::map<int, int> &in_volumes_map);
+        int insert_physical_volumes_map(const std::map<std::string, std::vector<int>> &in_physical_volumes_map);
+        int pull_surface_outlines(std::vector<surface_outline> &outlines) const;
         void switch_to_OpenCASCADE();
         void switch_off_OpenCASCADE();
         void disable_char_len();
         void enable_char_len();
         void enable_bool_diff_rest_from_first();
+        void set_weld_tolerance(const double &tolerance);
+        size_t memory_bytes() const;
     private:
         std::chrono::_V2::system_clock::time_point start_time;
         bool is_open_cascade = false;
         bool ignore_char_len = false;
         bool bool_diff_rest = false;
         double mesh_spacing;
+        double weld_tolerance = 0;
         // Elementary entities
-        std::map<int, point>            points_map;
-        std::map<int, line>             lines_map;
-        std::map<int, std::vector<int>> curve_loops_map;
-        std::map<int, int> plane_surfaces_map;
-        std::map<int, std::vector<int>> surface_loops_map;
-        std::map<int, int> volumes_map;
+        entity_table<point> points;
+        entity_table<line>  lines;
+        loop_table          curve_loops;
+        entity_table<int>   plane_surfaces;     // ID -> curve loop
+        loop_table          surface_loops;
+        entity_table<int>   volumes;            // ID -> surface loop
         // Physical entities
         std::map<std::string, std::vector<int>> physical_points_map;
         std::map<std::string, std::vector<int>> physical_curves_map;
@@ -151,68 +386,63 @@ namespace GEO{
         void start_timer();
         int get_microseconds();
         int simplify_element(int &current_status);
-        void perform_shift( std::set<int> &gaps,
-                            std::set<int> &numbers,
-                            std::map<int, int>  &changes);
-        int import_physical_entity( std::vector<std::string> &split_string_vector,
-                                    std::string &import_path,
-                                    int &line_number,
-                                    geo_argument &physical_type);
-
-        int import_point(   std::vector<std::string> &split_string_vector,
-                            std::string &import_path,
-                            int &line_number);
+        int import_physical_entity( const std::vector<std::string_view> &fields,
+                                    const std::string &import_path,
+                                    const int &line_number,
+                                    const geo_argument &physical_type);
+
+        int import_point(   const std::vector<std::string_view> &fields,
+                            const std::string &import_path,
+                            const int &line_number);
         int simplify_points();
-        int adjust_points(std::map<int,int> changes);
+        int adjust_points(const std::vector<int> &new_ids);
         int merge_points(geofile &secondary_file);
 
-        int import_line(   std::vector<std::string> &split_string_vector,
-                            std::string &import_path,
-                            int &line_number);
+        int import_line(   const std::vector<std::string_view> &fields,
+                            const std::string &import_path,
+                            const int &line_number);
         int simplify_lines();
-        int adjust_lines(std::map<int,int> changes);
+        int adjust_lines(const std::vector<int> &new_ids);
         int merge_lines(geofile &secondary_file);
 
-        int import_curve_loop(  std::vector<std::string> &split_string_vector,
-                                std::string &import_path,
-                                int &line_number);
+        int import_curve_loop(  const std::vector<std::string_view> &fields,
+                                const std::string &import_path,
+                                const int &line_number);
         int simplify_curve_loops();
-        int adjust_curve_loops(std::map<int,int> changes);
+        int adjust_curve_loops(const std::vector<int> &new_ids);
         int merge_curve_loops(geofile &secondary_file);
 
-        int import_plane_surface(  std::vector<std::string> &split_string_vector,
-                                std::string &import_path,
-                                int &line_number);
+        int import_plane_surface(  const std::vector<std::string_view> &fields,
+                                const std::string &import_path,
+                                const int &line_number);
         int simplify_plane_surfaces();
-        int adjust_plane_surfaces(std::map<int,int> changes);
+        int adjust_plane_surfaces(const std::vector<int> &new_ids);
         int merge_plane_surfaces(geofile &secondary_file);
 
-        int import_surface_loop(  std::vector<std::string> &split_string_vector,
-                                std::string &import_path,
-                                int &line_number);
+        int import_surface_loop(  const std::vector<std::string_view> &fields,
+                                const std::string &import_path,
+                                const int &line_number);
         int simplify_surface_loops();
-        int adjust_surface_loops(std::map<int,int> changes);
+        int adjust_surface_loops(const std::vector<int> &new_ids);
         int merge_surface_loops(geofile &secondary_file);
 
-        int import_volume(  std::vector<std::string> &split_string_vector,
-                                std::string &import_path,
-                                int &line_number);
+        int import_volume(  const std::vector<std::string_view> &fields,
+                                const std::string &import_path,
+                                const int &line_number);
 
-        int import_mesh_spacing(std::vector<std::string> &split_string_vector);
+        int import_mesh_spacing(const std::vector<std::string_view> &fields);
 
         int simplify_volumes();
         //---------------------------------------------------------
         void coherent_points();
-        void update_points( const std::map<point, int> &inv_point_map,
-                            const std::map<int, int> &point_adjustment_map);
-        void redirect_lines( const std::map<int, int> &point_adjustment_map);
-        void redirect_physical_points(const std::map<int, int> &point_adjustment_map);
+        void remove_collapsed_lines();
+        void redirect_lines(const std::vector<int> &point_redirects);
+        void redirect_physical_points(const std::vector<int> &point_redirects);
 
         void coherent_lines();
-        void update_lines( const std::map<int, int> &lines_adjustment_map);
-        void redirect_curve_loops(const std::map<int, int> &lines_adjustment_map);
+        void redirect_curve_loops(const std::vector<int> &line_redirects);
         // -----------------------------------------------------
-        int adjust_volumes(std::map<int,int> changes);
+        int adjust_volumes(const std::vector<int> &new_ids);
         int merge_volumes(geofile &secondary_file);
 
         int merge_physical_entities(geofile &secondary_file);
@@ -220,18 +450,9 @@ namespace GEO{
         int merge_physical_curves(geofile &secondary_file);
         int merge_physical_surfaces(geofile &secondary_file);
         int merge_physical_volumes(geofile &secondary_file);
-        void translate_point(point &point,
-                             const double &delta_x,
-                             const double &delta_y,
-                             const double &delta_z );
-        void rotate_point(const double &o_x,       const double &o_y,
-                          const double &o_z,       const double &theta_x,
-                          const double &theta_y,   const double &theta_z,
-                          point &subject);
-        void rotate_X(const double &theta, point &in_point);
-        void rotate_Y(const double &theta, point &in_point);
-        void rotate_Z(const double &theta, point &in_point);
-        void scale_point(point &in_point, const double factor);
+        void insert_entities(const geofile &other);
     };
+    int merge_geofiles(std::vector<geofile> &files);
+    int run_geofile_benchmarks();
 }
 #endif
\ No newline at end of file
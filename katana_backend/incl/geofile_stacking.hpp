@@ -0,0 +1,27 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function declarations for stacking 2D cross-sections into a 3D .geo model
+ */
+#ifndef geofilestacking
+#define geofilestacking
+
+#include <vector>
+#include "geofile_operations.hpp"
+
+namespace GEO{
+
+    // Places flat 2D cross-sections (as written by -slice) one above the
+    // other, slice i at z = i*spacing, and joins neighbouring slices with
+    // volumes. A region (plane surface) is lofted into the region of the
+    // next slice in the same physical group that it overlaps most, if that
+    // region overlaps it most in turn and has as many corners. Regions
+    // without such a partner are extruded to halfway between the slices.
+    // Volumes are grouped by the physical surface of their regions. The
+    // result is written into an empty geofile and is not yet coherent.
+    int stack_slices(const std::vector<geofile> &slices, const double &spacing,
+                     geofile &stacked);
+}
+#endif
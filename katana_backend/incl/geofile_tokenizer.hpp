@@ -0,0 +1,54 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function declarations for reading and tokenizing Gmsh .geo
+ *              files
+ */
+#ifndef geofiletokenizer
+#define geofiletokenizer
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "geofile_operations.hpp"
+
+namespace GEO{
+
+    // Read-only contents of a file, memory mapped where the system allows
+    // it and read into memory otherwise.
+    class mapped_file
+    {
+    private:
+        const char *mapping = nullptr;
+        size_t length = 0;
+        size_t released = 0;            // Start of the pages still mapped in
+        std::string buffer;             // Contents when the file is not mapped
+    public:
+        mapped_file() = default;
+        mapped_file(const mapped_file &) = delete;
+        mapped_file &operator=(const mapped_file &) = delete;
+        ~mapped_file();
+        int open(const std::string &path);
+        std::string_view contents() const;
+        // Lets the system drop the mapped pages before offset, for single
+        // pass readers. The contents stay valid and are read in again if
+        // accessed.
+        void release(const size_t &offset);
+    };
+
+    // Splits one line of a .geo file into fields at the separators ( ) , { }
+    // and =. Fields are views into the line with the surrounding whitespace
+    // removed; empty fields are dropped. fields is cleared first, so one
+    // vector can be reused for every line.
+    void split_geo_statement(const std::string_view &line, std::vector<std::string_view> &fields);
+    // Keyword of a statement through a perfect hash over the known keywords.
+    // eBlank_Space for an empty keyword, eDefault for an unknown one.
+    geo_argument keyword_code(const std::string_view &keyword);
+    // Whole-field conversions. A leading '+' is accepted.
+    bool parse_geo_integer(std::string_view field, int &value);
+    bool parse_geo_real(std::string_view field, double &value);
+}
+#endif
@@ -0,0 +1,72 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function declarations for affine transforms of .geo point data
+ */
+#ifndef geofiletransform
+#define geofiletransform
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "geofile_operations.hpp"
+
+namespace GEO{
+
+    // Affine map p -> M p + t, stored as the 3x4 matrix [M | t] by rows.
+    struct affine_transform
+    {
+        double m[3][4] = { {1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0} };
+    };
+    affine_transform translation(const double &delta_x, const double &delta_y, const double &delta_z);
+    // Rotation about the x, then y, then z axis through the origin o.
+    // Angles are in degrees.
+    affine_transform rotation(const double &o_x,     const double &o_y,     const double &o_z,
+                              const double &theta_x, const double &theta_y, const double &theta_z);
+    affine_transform scaling(const double &factor);
+    // The transform that applies first, then second.
+    affine_transform chain(const affine_transform &first, const affine_transform &second);
+
+    inline void transform_point(const affine_transform &transform, point &subject)
+    {
+        const double (&m)[3][4] = transform.m;
+        double x = subject.x, y = subject.y, z = subject.z;
+        subject.x = m[0][0]*x + m[0][1]*y + m[0][2]*z + m[0][3];
+        subject.y = m[1][0]*x + m[1][1]*y + m[1][2]*z + m[1][3];
+        subject.z = m[2][0]*x + m[2][1]*y + m[2][2]*z + m[2][3];
+    }
+    // Transforms count points held as separate x, y and z arrays.
+    void transform_points(const affine_transform &transform,
+                          double *x, double *y, double *z, const size_t &count);
+
+    // Copies a .geo file with every Point transformed, without importing
+    // it: Point coordinates are rewritten as the lines are read and every
+    // other character is copied unchanged. Memory use does not grow with
+    // the file size.
+    int stream_transform(const std::string &import_path, const std::string &export_path,
+                         const affine_transform &transform);
+
+    // One step of a transform pipeline: an affine transform of everything
+    // imported so far, or a file merged in.
+    struct pipeline_step
+    {
+        affine_transform transform;
+        std::string merge_path;         // Not empty for a merge step
+    };
+    // Steps from command line style arguments -t dx dy dz,
+    // -r ox oy oz theta_x theta_y theta_z, -scale factor and -m file, in
+    // any order and number.
+    int parse_pipeline(const std::vector<std::string> &arguments, std::vector<pipeline_step> &steps);
+    // Arguments of a pipeline file, separated by whitespace. // starts a
+    // comment that runs to the end of the line.
+    int read_pipeline_file(const std::string &pipeline_path, std::vector<std::string> &arguments);
+    // Runs the steps on the input file and exports the result. Each file is
+    // moved by the product of the transforms that follow it, in one pass
+    // over its points, and coherence and simplification run once at the
+    // end, after the files are merged.
+    int run_pipeline(const std::string &input_path, const std::vector<pipeline_step> &steps,
+                     const double &weld_tolerance, const std::string &export_path);
+}
+#endif
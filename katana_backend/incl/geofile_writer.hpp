@@ -0,0 +1,44 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function declarations for formatting Gmsh .geo file text
+ */
+#ifndef geofilewriter
+#define geofilewriter
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "geofile_operations.hpp"
+
+namespace GEO{
+
+    // Text of a .geo file built up in memory. Numbers are formatted with
+    // std::to_chars; reals in the shortest form that reads back to the same
+    // double, so an exported file re-imports bit-exact.
+    class geo_text
+    {
+    private:
+        std::string text;
+    public:
+        geo_text &operator<<(const std::string_view &piece)
+        {
+            text.append(piece);
+            return *this;
+        }
+        geo_text &operator<<(const int &number);
+        geo_text &operator<<(const double &number);
+        geo_text &operator<<(const member_span &members);       // "a, b, c"
+        geo_text &operator<<(const std::vector<int> &members);  // "a, b, c"
+        void reserve(const size_t &bytes) { text.reserve(bytes); }
+        size_t size() const { return text.size(); }
+        const std::string &str() const { return text; }
+    };
+    // Katana banner and creation date that open every exported .geo file,
+    // followed by SetFactory("OpenCASCADE") when open_cascade is set.
+    void write_geo_header(geo_text &text, const bool &open_cascade);
+}
+#endif
@@ -0,0 +1,51 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function declarations for polygon reduction kernels
+ */
+#ifndef geometrykernels
+#define geometrykernels
+
+#include <cstddef>
+#include <vector>
+#include "clipper.hpp"
+
+namespace MODEL3D{
+
+  struct point_bounds {
+    ClipperLib::cInt min_x;
+    ClipperLib::cInt min_y;
+    ClipperLib::cInt max_x;
+    ClipperLib::cInt max_y;
+  };
+
+  struct polygon_moments {
+    double signed_area = 0;   // Positive for counter-clockwise, as ClipperLib::Area
+    double centroid_x = 0;
+    double centroid_y = 0;
+  };
+
+  struct radial_spread {
+    double mean = 0;          // Mean distance of the points to the centre
+    double min = 0;
+    double max = 0;
+    double variance = 0;
+  };
+
+  // The kernels run over the IntPoint array of a path, a contiguous array of
+  // int64 x/y pairs, in a single branch-free pass each. count must be at
+  // least 1.
+  point_bounds    kernel_bounds(const ClipperLib::IntPoint *points, const size_t &count);
+  void            kernel_merge_bounds(point_bounds &target, const point_bounds &addition);
+  double          kernel_signed_area(const ClipperLib::IntPoint *points, const size_t &count);
+  polygon_moments kernel_moments(const ClipperLib::IntPoint *points, const size_t &count);
+  radial_spread   kernel_radial_spread(const ClipperLib::IntPoint *points, const size_t &count,
+                                       const double &centre_x, const double &centre_y);
+  // Splits boxes into groups connected by overlapping or touching boxes.
+  // Groups are ordered by their first member, members in ascending order.
+  std::vector<std::vector<size_t>> overlap_groups(const std::vector<point_bounds> &boxes);
+  int             run_kernel_benchmarks();
+}
+#endif
@@ -0,0 +1,53 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function declarations for the per-layer model fragment cache
+ */
+#ifndef layercache
+#define layercache
+
+#include <cstdint>
+#include <string>
+
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+namespace MODEL3D{
+
+  // 64-bit FNV-1a hash built up from the inputs of a layer.
+  class content_hash
+  {
+  private:
+    uint64_t value = FNV_OFFSET_BASIS;
+  public:
+    void        add(const void *data, const size_t &size);
+    void        add(const int64_t &number) { add(&number, sizeof(number)); }
+    void        add(const double &number) { add(&number, sizeof(number)); }
+    void        add(const std::string &text);
+    std::string hex() const;
+  };
+
+  // Directory of generated fragments, one sub-directory per layer. Fragment
+  // names start with the hash of the inputs that produced them, so a layer
+  // whose inputs are unchanged can be replayed instead of regenerated.
+  class layer_cache
+  {
+  private:
+    std::string cache_dir;
+    bool enabled = false;
+    std::string layer_dir(const int &layer_number) const;
+  public:
+    int         open(const std::string &directory);
+    bool        is_enabled() const { return enabled; }
+    bool        fetch(const int &layer_number, const std::string &fragment_name, std::string &contents) const;
+    int         store(const int &layer_number, const std::string &fragment_name, const std::string &contents) const;
+    bool        fetch_file(const int &layer_number, const std::string &fragment_name, const std::string &target_path) const;
+    int         store_file(const int &layer_number, const std::string &fragment_name, const std::string &source_path) const;
+    void        prune(const int &layer_number, const std::string &current_hash) const;
+    layer_cache() {}
+    ~layer_cache() {}
+  };
+}
+#endif
@@ -9,6 +9,7 @@
 #define ldfprocess
 
 #include "section.hpp"
+#include "process_table.hpp"
 #include <string>
 #include <vector>
 
@@ -16,13 +17,12 @@ class ldf
 {
 private:
   double database_unit;
-  std::map<int, layer_data> layer_definition; // key = layer number
-  void process_params(std::fstream &my_ldf, std::string &my_filebuffer);
-  void process_layer(std::fstream &my_ldf, std::string &my_filebuffer);
+  MODEL3D::process_table<layer_data> layer_definition; // dense, by layer number
 
 public:
   int read_ldf(const std::string &path);
   int pull_layer_data(std::map<int, layer_data> &target_destination);
+  const MODEL3D::process_table<layer_data> &layers() const { return layer_definition; }
   void print();
   ldf()
   {
@@ -30,8 +30,4 @@ public:
   }
   ~ldf() {}
 };
-
-std::vector<std::string> split(const std::string &target_string,
-                               char delimiter);
-static void Initialize();
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,30 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function declarations for polygon vertex decimation
+ */
+#ifndef pathdecimation
+#define pathdecimation
+
+#include <string>
+#include "clipper.hpp"
+
+namespace MODEL3D{
+
+  enum decimation_mode {
+    eRadial,          // Drop points closer than the tolerance to the last kept point
+    eDouglasPeucker,  // Drop points within the tolerance of the simplified outline
+    eVisvalingam      // Drop points whose triangle with their neighbours is smallest
+  };
+
+  // All modes compact the path in place through a write index, so a dropped
+  // point costs no shifting of the points after it.
+  void  decimate_path(ClipperLib::Path &path, const double &tolerance, const decimation_mode &mode);
+  void  radial_decimate(ClipperLib::Path &path, const double &tolerance);
+  void  douglas_peucker_decimate(ClipperLib::Path &path, const double &tolerance);
+  void  visvalingam_decimate(ClipperLib::Path &path, const double &tolerance);
+  bool  parse_decimation_mode(const std::string &mode_name, decimation_mode &mode);
+}
+#endif
@@ -0,0 +1,113 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function declarations for process information and layer
+ *              definition file parsing
+ */
+#ifndef processtable
+#define processtable
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "section.hpp"
+
+namespace MODEL3D{
+
+  struct Layer_prop {
+    std::string name;
+    int mask_type;
+    int z_start;
+    int thickness;
+    std::string material;
+  };
+
+  // One "Key = Value" line of a block.
+  struct process_entry {
+    std::string key;
+    std::string value;
+    int line_number;
+  };
+
+  // A "$Type ... $End" block of a .pf or .ldf file.
+  struct process_block {
+    std::string type;                     // Block name without the '$'
+    int line_number;
+    std::vector<process_entry> entries;
+  };
+
+  // Layer records stored contiguously in ascending layer number order. The
+  // position of a record is its dense ID; layer numbers map to dense IDs
+  // through a direct index, so a lookup costs one array access.
+  template <typename Record>
+  class process_table
+  {
+  private:
+    std::vector<int> layer_numbers;       // Dense ID -> layer number
+    std::vector<Record> records;          // Dense ID -> record
+    std::vector<int> dense_ids;           // Layer number -> dense ID, -1 if absent
+  public:
+    size_t size() const { return records.size(); }
+    bool   empty() const { return records.empty(); }
+    int    number(const size_t &id) const { return layer_numbers[id]; }
+    const Record &operator[](const size_t &id) const { return records[id]; }
+    // Returns the dense ID of a layer, or -1 if the layer is not in the table.
+    int find(const int &layer_number) const
+    {
+      if( (layer_number<0) || ((size_t)layer_number>=dense_ids.size()) )
+        return -1;
+      return dense_ids[layer_number];
+    }
+    bool contains(const int &layer_number) const { return find(layer_number)>=0; }
+    const Record &at(const int &layer_number) const
+    {
+      int id = find(layer_number);
+      if(id<0)
+        throw std::out_of_range("process_table: layer " + std::to_string(layer_number) + " not defined");
+      return records[id];
+    }
+    // Replaces the table with the numbered records. Layer numbers must not
+    // be negative. Of repeated layer numbers the first is kept, or the last
+    // if keep_last is set.
+    void assign(std::vector<std::pair<int, Record>> numbered, const bool &keep_last)
+    {
+      if(keep_last==true)
+        std::reverse(numbered.begin(), numbered.end());
+      std::stable_sort(numbered.begin(), numbered.end(),
+                       [](const std::pair<int, Record> &a, const std::pair<int, Record> &b)
+                       { return a.first < b.first; });
+      layer_numbers.clear();
+      records.clear();
+      dense_ids.clear();
+      for (auto numbered_it = numbered.begin(); numbered_it != numbered.end(); numbered_it++)
+      {
+        if( (!layer_numbers.empty()) && (layer_numbers.back()==numbered_it->first) )
+          continue;
+        layer_numbers.push_back(numbered_it->first);
+        records.push_back(std::move(numbered_it->second));
+      }
+      if(!layer_numbers.empty())
+        dense_ids.assign(layer_numbers.back()+1, -1);
+      for (size_t id = 0; id < layer_numbers.size(); id++)
+        dense_ids[layer_numbers[id]] = (int)id;
+    }
+  };
+
+  constexpr int MAX_LAYER_NUMBER = 65535;    // GDSII layer numbers are 16 bit
+
+  int  tokenize_process_text( const std::string &text,
+                              const std::string &source_name,
+                              std::vector<process_block> &blocks);
+  int  read_process_file(const std::string &path, std::vector<process_block> &blocks);
+  int  build_pif_table( const std::vector<process_block> &blocks,
+                        process_table<Layer_prop> &table);
+  int  build_ldf_table( const std::vector<process_block> &blocks,
+                        process_table<layer_data> &table,
+                        double &database_unit);
+  int  load_pif_table(const std::string &path, process_table<Layer_prop> &table);
+}
+#endif
@@ -0,0 +1,52 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function declarations for the buffered script emitter
+ */
+#ifndef scriptemitter
+#define scriptemitter
+
+#include <fstream>
+#include <string>
+
+constexpr size_t SCRIPT_BUFFER_SIZE = 1 << 16; // Bytes held before forcing a write to disk
+
+namespace MODEL3D{
+
+  // Streams generated script lines to disk through a fixed-size buffer.
+  // Lines are written as they are emitted so memory use does not grow with
+  // the size of the cell being modelled.
+  class script_emitter
+  {
+  private:
+    std::ofstream outfile;
+    std::string buffer;
+    std::string output_path;
+    size_t capacity = SCRIPT_BUFFER_SIZE;
+    size_t lines_emitted = 0;
+    bool capturing = false;
+    bool holding = false;                 // Captured lines are not written
+    std::string captured;
+  public:
+    int         open(const std::string &path);
+    void        push_back(const std::string &line);
+    void        push_fragment(const std::string &fragment);
+    void        begin_capture(const bool &hold = false);
+    std::string end_capture();
+    void        flush();
+    int         close();
+    bool        is_open() const { return outfile.is_open(); }
+    size_t      line_count() const { return lines_emitted; }
+    script_emitter()
+    {
+      buffer.reserve(capacity);
+    }
+    ~script_emitter()
+    {
+      close();
+    }
+  };
+}
+#endif
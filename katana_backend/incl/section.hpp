@@ -7,15 +7,67 @@
  */
 #ifndef gdssection
 #define gdssection
+#include "clipper.hpp"
 #include "gdsCpp.hpp"
 #include "pipolly.hpp"
 #include <cassert>
+#include <set>
+#include <unordered_map>
 
-// Holds co-ordinates of a polygon.
-struct co_ord
+// Holds all polygons of a layout, key = layer number.
+// Points are stored as ClipperLib::IntPoint so that flattened polygons are
+// used by the Clipper operations as they are, without a second copy.
+typedef std::map<unsigned int, ClipperLib::Paths> polygon_store;
+
+// Axis-aligned region of a layout, in database units.
+struct clip_window
+{
+  ClipperLib::cInt min_x = 0;
+  ClipperLib::cInt min_y = 0;
+  ClipperLib::cInt max_x = 0;
+  ClipperLib::cInt max_y = 0;
+};
+
+// Extent of a fully flattened structure.
+struct structure_extent
+{
+  bool found = false;             // False for structures without any geometry
+  clip_window bounds;
+  std::set<unsigned int> layers;  // Layers used anywhere in the hierarchy
+};
+
+// Extents of flattened structures, key = structure index.
+typedef std::unordered_map<int, structure_extent> structure_bounds_map;
+
+// Placement of a structure: reflect about the x-axis, magnify, rotate
+// (degrees, counter-clockwise), then offset. Same order as GDSII.
+struct gds_transform
+{
+  bool reflect = false;
+  double magnification = 1;
+  double angle = 0;
+  int x = 0;
+  int y = 0;
+};
+
+// Unmagnified placement of a leaf cell.
+struct cell_placement
 {
-  std::vector<int> x; // Linked to y (xy pair) - path of polygon.
-  std::vector<int> y; // Linked to X (xy pair) - path of polygon.
+  int x;
+  int y;
+  double angle;
+};
+
+// A leaf cell (structure without references) and everywhere it is placed.
+// Mirrored placements are kept as a separate cell with the reflection
+// already applied to its polygons, so every placement is a rotation and
+// offset only.
+struct cell_instances
+{
+  std::string name;
+  bool reflected = false;
+  polygon_store polygons;                   // In cell coordinates
+  std::vector<cell_placement> placements;
 };
 
 struct POINT
@@ -65,7 +117,7 @@ class section_data
 {
 private:
   // Holds all elements converted to polygons
-  std::map<unsigned int, std::vector<co_ord>> polygons;         // key = layer number
+  polygon_store polygons;                                       // key = layer number
   std::map<int, std::vector<intercept_data>>  layer_intercepts; // key = layer number
   std::map<int, std::map<int, building_blocks>>
       section_blocks; // key = layer number, second key = block_ID
@@ -77,7 +129,7 @@ private:
   int populate_polygons(gdscpp &gds_file);
 
   int calculate_intercepts();
-  int analyze_polygon(int layer, const co_ord &line_data);
+  int analyze_polygon(int layer, const ClipperLib::Path &line_data);
   int analyze_line_seg(int ln_strt[2], int ln_end[2], int layer);
   int slice_horiz_horiz(int line_start[2], int line_end[2], int &layer);    // 1
   int slice_horiz_angled(int line_start[2], int line_end[2], int &layer);   // 2
@@ -98,8 +150,11 @@ private:
 
 public:
   int populate(int &xx1, int &yy1, int &xx2, int &yy2, gdscpp &gds_file);
-  int extract_all_polygons( gdscpp &gds_file,
-                            std::map<unsigned int, std::vector<co_ord>> &polygons );
+  int extract_all_polygons(gdscpp &gds_file, polygon_store &polygons);
+  int extract_window_polygons(gdscpp &gds_file, const clip_window &window,
+                              polygon_store &polygons);
+  int extract_instanced_polygons(gdscpp &gds_file, polygon_store &polygons,
+                                 std::vector<cell_instances> &cells);
   int pull_section_blocks(
       std::map<int, std::map<int, building_blocks>> &target_destination);
   int get_sec_dist();
@@ -121,47 +176,83 @@ bool check_for_intercept(int *bounding_box, int &axis_type, int &x1, int &y1,
                          int &x2, int &y2);
 int calibrate_line(int x1, int y1, int x2, int y2);
 int set_section_type(int &line_type, int &section_type);
-int path_to_polygon(gdsPATH path_data, co_ord &dest_co_ord);
-int co_ord_to_point_v(const co_ord  &c_v,
-                      std::vector<Point> &p_v);
+int path_to_polygon(const gdsPATH &path_data, ClipperLib::Path &dest_path);
+int path_to_polygon(const gdsPATH &path_data, ClipperLib::Path &dest_path,
+                    ClipperLib::ClipperOffset &offset,
+                    ClipperLib::Paths &solution);
+bool manhattan_path_to_polygon(const gdsPATH &path_data,
+                               ClipperLib::Path &dest_path);
+int path_to_point_v(const ClipperLib::Path &path,
+                    std::vector<Point> &p_v);
+void xy_to_path(const std::vector<int> &x, const std::vector<int> &y,
+                ClipperLib::Path &path);
+void path_to_xy(const ClipperLib::Path &path, std::vector<int> &x,
+                std::vector<int> &y);
 
 void recursive_unpack(
     const std::string &structure_name, std::vector<gdsSTR> &struct_vect,
     std::unordered_map<std::string, int> &struct_lookup,
-    std::map<unsigned int, std::vector<co_ord>> &retrieved_polygon_data);
+    polygon_store &retrieved_polygon_data);
+
+void recursive_unpack_window(
+    const std::string &structure_name, std::vector<gdsSTR> &struct_vect,
+    std::unordered_map<std::string, int> &struct_lookup,
+    const clip_window &window, structure_bounds_map &bounds_cache,
+    polygon_store &retrieved_polygon_data);
+bool structure_bounds(
+    const std::string &structure_name, std::vector<gdsSTR> &struct_vect,
+    std::unordered_map<std::string, int> &struct_lookup,
+    structure_bounds_map &bounds_cache, clip_window &bounds);
+bool windows_overlap(const clip_window &a, const clip_window &b);
+clip_window transform_window(const clip_window &window, bool reflect_x,
+                             double magnification, int angle, int x_offset,
+                             int y_offset);
+clip_window inverse_transform_window(const clip_window &window, bool reflect_x,
+                                     double magnification, int angle,
+                                     int x_offset, int y_offset);
+void aref_steps(const gdsAREF &aref_info, int delta_row[2], int delta_col[2]);
+
+void recursive_unpack_instanced(
+    const std::string &structure_name, std::vector<gdsSTR> &struct_vect,
+    std::unordered_map<std::string, int> &struct_lookup,
+    const gds_transform &placement, polygon_store &retrieved_polygon_data,
+    std::vector<cell_instances> &cells,
+    std::map<std::pair<std::string, bool>, size_t> &cell_lookup);
+gds_transform compose_transform(const gds_transform &parent,
+                                const gds_transform &child);
+bool is_leaf_structure(const gdsSTR &structure);
 
 int process_boundaries(
     std::vector<gdsBOUNDARY> &current_boundaries,
-    std::map<unsigned int, std::vector<co_ord>> &poly_map_destination);
+    polygon_store &poly_map_destination);
 int process_boxes(
     std::vector<gdsBOX> &current_boxes,
-    std::map<unsigned int, std::vector<co_ord>> &poly_map_destination);
+    polygon_store &poly_map_destination);
 int process_paths(
     std::vector<gdsPATH> &current_paths,
-    std::map<unsigned int, std::vector<co_ord>> &poly_map_destination);
+    polygon_store &poly_map_destination);
 int process_SREFs(
     std::vector<gdsSREF> &current_SREFs,
-    std::map<unsigned int, std::vector<co_ord>> &poly_map_destination,
+    polygon_store &poly_map_destination,
     std::vector<gdsSTR> &struct_vect,
     std::unordered_map<std::string, int> &struct_lookup);
 int process_AREFs(
     std::vector<gdsAREF> &current_arefs,
-    std::map<unsigned int, std::vector<co_ord>> &poly_map_destination,
+    polygon_store &poly_map_destination,
     std::vector<gdsSTR> &struct_vect,
     std::unordered_map<std::string, int> &struct_lookup);
 int transform_polygon_map(
-    std::map<unsigned int, std::vector<co_ord>> &polygon_map, bool reflect_x,
+    polygon_store &polygon_map, bool reflect_x,
     double magnification, int angle, int x_offset, int y_offset);
-int transform_aref_map(std::map<unsigned int, std::vector<co_ord>> &target,
+int transform_aref_map(polygon_store &target,
                        gdsAREF &aref_info);
-void repeat_polygon_map(std::map<unsigned int, std::vector<co_ord>> &target,
+void repeat_polygon_map(polygon_store &target,
                         gdsAREF &aref_info);
-void insert_or_append_to_polymap(
-    std::map<unsigned int, std::vector<co_ord>> &target_map, int key,
-    const co_ord &polygon);
+void insert_or_append_to_polymap(polygon_store &target_map, int key,
+                                 const ClipperLib::Path &polygon);
 void rotate_vector(double cx, double cy, double angle,
                    std::vector<POINT> &subject);
-void combine_maps(std::map<unsigned int, std::vector<co_ord>> &main,
-                  std::map<unsigned int, std::vector<co_ord>> &auxiliary);
+void combine_maps(polygon_store &main,
+                  polygon_store &auxiliary);
 constexpr auto PI = 3.14159265358979323846;
 #endif
\ No newline at end of file
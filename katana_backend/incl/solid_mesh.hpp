@@ -0,0 +1,79 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function declarations for native triangulated solid export
+ */
+#ifndef solidmesh
+#define solidmesh
+
+#include <string>
+#include <vector>
+#include "clipper.hpp"
+
+namespace MODEL3D{
+
+  // Height of one level of an extruded ring and the distance its outline is
+  // moved outward (into the surrounding space) at that height.
+  struct profile_level {
+    double z;
+    double offset;
+  };
+
+  // Closed outline swept through a series of levels. Outer rings are wound
+  // counter-clockwise and holes clockwise, so a positive offset always grows
+  // the material.
+  struct mesh_ring {
+    ClipperLib::Path outline;
+    std::vector<profile_level> levels;
+  };
+
+  // Outer ring with any holes running through it. All rings of a solid must
+  // share the same level heights.
+  struct mesh_solid {
+    mesh_ring outer;
+    std::vector<mesh_ring> holes;
+  };
+
+  struct cap_vertex {
+    double x;
+    double y;
+    unsigned int id;
+    int prev;
+    int next;
+  };
+
+  // Watertight triangle mesh assembled from extruded solids.
+  class triangle_mesh
+  {
+  private:
+    std::vector<double> vertices;           // x, y, z triples
+    std::vector<unsigned int> triangles;    // vertex index triples, outward facing
+    void  extrude_ring(const mesh_ring &ring, std::vector<unsigned int> &ring_start);
+    void  triangulate_cap(const std::vector<mesh_ring> &rings,
+                          const std::vector<unsigned int> &ring_start,
+                          const bool &facing_up);
+  public:
+    int   add_solid(const mesh_solid &solid);
+    int   write_stl(const std::string &output_path) const;
+    int   write_obj(const std::string &output_path, const std::string &object_name) const;
+    bool  empty() const { return triangles.empty(); }
+    size_t triangle_count() const { return triangles.size()/3; }
+    triangle_mesh() {}
+    ~triangle_mesh() {}
+  };
+
+  bool  orient_ring(mesh_ring &ring, const bool &is_outer);
+  void  ring_miters(const ClipperLib::Path &path,
+                     std::vector<double> &miter_x,
+                     std::vector<double> &miter_y);
+  void  ear_clip(std::vector<cap_vertex> &nodes, int ear, std::vector<unsigned int> &triangles);
+  int   find_hole_bridge(const std::vector<cap_vertex> &nodes, const int &hole, const int &outer);
+  int   split_polygon(std::vector<cap_vertex> &nodes, const int &a, const int &b);
+  bool  locally_inside(const std::vector<cap_vertex> &nodes, const int &a, const int &b);
+  bool  point_in_triangle(double ax, double ay, double bx, double by,
+                          double cx, double cy, double px, double py);
+  double turn_area(const cap_vertex &p, const cap_vertex &q, const cap_vertex &r);
+}
+#endif
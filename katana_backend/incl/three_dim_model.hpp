@@ -13,7 +13,15 @@
 #include <vector>
 #include "section.hpp"
 #include "clipper.hpp"
+#include "contour_library.hpp"
 #include "geofile_operations.hpp"
+#include "geo_builder.hpp"
+#include "geometry_kernels.hpp"
+#include "layer_cache.hpp"
+#include "path_decimation.hpp"
+#include "process_table.hpp"
+#include "script_emitter.hpp"
+#include "solid_mesh.hpp"
 constexpr double SUBTRACTIVE_OVERLAP_FACTOR = 1.05;   // Overlap factor is applied to layer contour width
 constexpr double ADDITIVE_OVERLAP_FACTOR = 1.05;
 constexpr int MIN_DIST_BETWEEN_POINTS = 30; //Points closer than 30 nm to one another get filtered out
@@ -21,63 +29,81 @@ constexpr int MIN_DIST_BETWEEN_POINTS = 30; //Points closer than 30 nm to one an
 constexpr double ISLAND_OVERLAP_FACTOR = 1.00;
 constexpr double BLOCK_EXPANSION_FACTOR = 5;// was 1.5
 constexpr bool ROUND_CONCAVE_CORNERS = true;//true still causing overlapping facets
+constexpr int LAYER_CACHE_VERSION = 4;      // Bump when generated fragments change for identical inputs
+constexpr double CIRCLE_SEGMENT_COST = 8;   // Build cost of a revolved or cylindrical ingredient, in outline vertices
 namespace MODEL3D{
 
-  struct Layer_prop {
-    std::string name;
-    int mask_type;
-    int z_start;
-    int thickness;
-    std::string material;
-  };
-
   struct euclid_vector {
     double i;
     double j;
     double k;
   };
 
-  enum input_type
+  enum output_type
   {
-      eError,
-      eNumber,
-      eName,
-      eMask_type,
-      eZ_Start,
-      eThickness,
-      eMaterial,
-      eDefault
+      eFreeCAD_script,
+      eSTL_mesh,
+      eOBJ_mesh,
+      eGEO_model
+  };
+
+  // A path recognised as a circle, kept as centre and radius so that the
+  // script can build it with native cylinder operations.
+  struct circle_primitive {
+    size_t path_index;              // Index of the (reconstructed) path it replaces
+    ClipperLib::IntPoint centre;
+    double radius;
+  };
+
+  // Build cost and reach of one emitted ingredient, used to plan the
+  // scheduling and the booleans of its list.
+  struct ingredient_estimate {
+    double cost;                  // Relative build cost
+    point_bounds bounds;          // Footprint including the contour flare
+  };
+
+  // Solids making up one named part of a layer: the layer itself or one of
+  // its junction sub-layers.
+  struct layer_part {
+    std::string name;
+    std::vector<mesh_solid> solids;
   };
   class three_dim_model
   {
   private:
-    std::map<unsigned int, std::vector<co_ord>> polygons_map;
-    std::map<unsigned int, std::vector<ClipperLib::Path>> clipper_polygons_map;
-    std::map<int, Layer_prop> proc_info_map;
+    polygon_store polygons_map;                 // Flattened GDS polygons, key = layer number
+    process_table<Layer_prop> process_info;     // Layer properties from the .pf file
     std::map<int, std::vector<int>> layer_boundary_map;
-    std::map<int, std::vector<GEO::point>> etch_contour_map;
-    std::vector<std::string> py_script;
+    contour_library etch_contours;
+    size_t contour_resolution = 0;              // Points per resampled contour, 0 = as loaded
+    script_emitter py_script;
+    layer_cache fragment_cache;
+    bool incremental = false;
     double model_default_char_length = 1e-6;
     std::string cell_name;
     bool enable_multiprocessing = false;
+    output_type output_format = eFreeCAD_script;
     double subtractive_overlap_factor = SUBTRACTIVE_OVERLAP_FACTOR;
     double additive_overlap_factor = ADDITIVE_OVERLAP_FACTOR;
     int min_distance_between_points = MIN_DIST_BETWEEN_POINTS;
+    decimation_mode decimation = eRadial;
     double island_overlap_factor = ISLAND_OVERLAP_FACTOR;
     bool round_concave_corners = ROUND_CONCAVE_CORNERS;
     double block_expansion_factor= BLOCK_EXPANSION_FACTOR;
-    int pnt_cnt = 0;
-    int ln_cnt  = 0;
-    int cl_cnt  = 0;
-    int ps_cnt  = 0;
-    int sl_cnt  = 0;
-    int vol_cnt = 0;
+    bool use_window = false;                    // Only model the region inside window
+    clip_window window;                         // Region to model, in database units
+    int window_margin = 0;                      // Extra layout kept around the window
+    std::map<std::string, std::vector<ingredient_estimate>> ingredient_estimates; // Per ingredient list
+    bool hierarchical = false;                  // Build leaf cells once and place copies
+    std::vector<cell_instances> cells;          // Leaf cells kept out of polygons_map
     void        generate_freecad_fill(  const ClipperLib::Path &outline,
                                         const ClipperLib::Paths &primary,
                                         const ClipperLib::Paths &secondary,
                                         const int &layer_number);
     void        generate_freecad_solid( const ClipperLib::Paths &primary,
                                         const ClipperLib::Paths &secondary,
+                                        const std::vector<circle_primitive> &primary_circles,
+                                        const std::vector<circle_primitive> &secondary_circles,
                                         const bool &has_holes,
                                         const int &layer_number,
                                         const int &mask_type);
@@ -86,105 +112,127 @@ namespace MODEL3D{
                                   const int &layer_number,
                                   const bool &is_additive,
                                   const double &overlap_factor);
+    void        push_freecad_circle_pss(const circle_primitive &circle,
+                                        const bool &bottom_start,
+                                        const int &layer_number,
+                                        const bool &is_additive,
+                                        const double &overlap_factor);
     void        push_freecad_prism( const ClipperLib::Path &shape_outline,
                                     const bool &is_additive,
                                     const int &z_start,
                                     const int &height,
                                     const std::string &sublayer_name);
-    void        python_script_write(std::string output_path);
+    void        push_freecad_cylinder(const ClipperLib::IntPoint &centre,
+                                      const double &radius,
+                                      const bool &is_additive,
+                                      const int &z_start,
+                                      const int &height,
+                                      const std::string &sublayer_name);
+    int         python_script_write(const std::string &output_path);
     void        python_script_conclude();
     void        add_recompute();
     void        build_subtractive_shapes(const int &layer_number);
     void        build_additive_shapes(const int &layer_number, const bool &is_pss);
     void        build_additive_sub_layer(const std::string &sub_layer_name);
+    void        push_list_build(const std::string &kind,
+                                const std::string &suffix,
+                                const std::string &shape_function);
+    void        push_number_list(const std::string &name, const std::vector<long long> &values);
+    std::string union_expression(const std::string &kind, const std::string &suffix) const;
+    void        record_ingredient(const std::string &list_name, const double &cost, const point_bounds &bounds);
     void        arrange_path(ClipperLib::Path &to_arrange, std::vector<int> &offset);
     void        initialize_python_script();
     void        initialize_layer_boundary_map();
-    int         load_etch_contour_map(const std::string &cont_path);
+    int         load_etch_contours(const std::string &cont_path);
+    const etch_contour* layer_contour(const int &layer_number) const;
     int         import_process_info(const std::string &pif_path);
-    void        co_ord_to_path(const co_ord &in_vec, ClipperLib::Path &out_path);
-    void        path_to_co_ord(const ClipperLib::Path &in_path, co_ord &out_co_ord);
     void        remove_outer_path(ClipperLib::Paths &paths_vec);
     void        close_paths(ClipperLib::Paths &paths_vec);
     void        calculate_all_layer_bounds();
-    void        synchronize_clipper_polygons_map();
-    void        synchronize_polygon_map();
+    clip_window expanded_window() const;
+    void        clip_layers_to_window();
+    void        place_filled_cell_layers();
+    void        generate_cell_instances();
+    void        clip_paths_to_window(ClipperLib::Paths &paths, const ClipperLib::cInt &inset) const;
     void        polygon_layer_to_gds(const int &layer_number);
     void        polygon_map_to_gds();
     void        clipper_paths_to_gds( const ClipperLib::Paths &target_paths,
                                       const std::string &gds_name,
                                       const int &layer_number);
     void        clipper_path_to_gds(const ClipperLib::Path &in_path, const std::string gds_name);
-    void        add_right_plane( int &n, int &gain, int &depth,
-                                 std::map<int, GEO::line> &lines_map,
-                                 std::map<int, std::vector<int>> &curve_loops_map,
-                                 std::map<int, int> &plane_surfaces_map,
-                                 const int &base_points_count,
-                                 int &panel_count,
-                                 std::vector<int> &roof_line_vector,
-                                 const int &prev_cl_count,
-                                 const int &prev_pls_count,
-                                 const int &prev_pnt_count);
-    void        add_normal_plane( int &n, int &gain, int &depth,
-                                 std::map<int, GEO::line> &lines_map,
-                                 std::map<int, std::vector<int>> &curve_loops_map,
-                                 std::map<int, int> &plane_surfaces_map,
-                                 const int &base_points_count,
-                                 int &panel_count,
-                                 std::vector<int> &roof_line_vector,
-                                 const int &prev_cl_count,
-                                 const int &prev_pls_count,
-                                 const int &prev_pnt_count);
-    bool        filter_paths(ClipperLib::Paths &primary_paths, ClipperLib::Paths &secondary_paths);
+    bool        filter_paths(ClipperLib::Paths &primary_paths, ClipperLib::Paths &secondary_paths) const;
     void        print_polygons_map();
-    int         import_layer_block( std::fstream &infile,
-                            std::string &file_buffer,
-                            int  &line_number);
-    input_type  hash_prop(std::string const& inString);
     int         generate_layer(const int &layer_number);
-    void        build_layer_box(  const int &layer_number,
-                                  const ClipperLib::IntPoint &a,
-                                  const ClipperLib::IntPoint &b,
-                                  const ClipperLib::IntPoint &c,
-                                  const ClipperLib::IntPoint &d,
-                                  GEO::geofile &generated_geofile );
+    int         generate_script_layer(const int &layer_number, bool &from_cache);
+    std::string hash_layer(const int &layer_number) const;
+    std::string mesh_extension() const;
     int         generate_non_fill_layer(const int &layer_number,
                                         const int &mask_type);
+    int         prepare_non_fill_paths( const int &layer_number,
+                                        ClipperLib::Paths &primary_paths,
+                                        ClipperLib::Paths &secondary_paths,
+                                        std::vector<circle_primitive> &primary_circles,
+                                        std::vector<circle_primitive> &secondary_circles,
+                                        bool &has_holes) const;
+    int         prepare_filled_paths( const int &layer_number,
+                                      const ClipperLib::Path &outline,
+                                      ClipperLib::Paths &primary_paths,
+                                      ClipperLib::Paths &secondary_paths) const;
+    void        apply_contour_offsets(const int &layer_number, ClipperLib::Paths &paths) const;
+    int         generate_mesh_layers(const std::string &output_path);
+    int         generate_mesh_layer(const int &layer_number, const std::string &output_stem) const;
+    int         generate_geo_model(const std::string &output_path);
+    int         generate_geo_layer(const int &layer_number, GEO::geo_builder &geometry) const;
+    int         collect_layer_parts(const int &layer_number, std::vector<layer_part> &parts) const;
+    std::string strip_extension(const std::string &path) const;
+    void        build_mesh_levels(const int &layer_number,
+                                  const bool &bottom_start,
+                                  const bool &is_additive,
+                                  std::vector<profile_level> &levels) const;
+    void        group_mesh_solids(const ClipperLib::Paths &rings,
+                                  const std::vector<profile_level> &outer_levels,
+                                  const std::vector<profile_level> &hole_levels,
+                                  std::vector<mesh_solid> &solids) const;
+    int         write_mesh( const triangle_mesh &mesh,
+                            const std::string &output_stem,
+                            const std::string &object_name) const;
     int         generate_inverted_layer(const int &layer_number);
     int         generate_filled_layer(const int &layer_number);
-    int         build_polyhedron( const ClipperLib::Path &contour,
-                                  const int &layer_number,
-                                  const int &unique_ID,
-                                  const bool &is_positive,
-                                  const bool &outward_facing,
-                                  GEO::geofile &generated_geofile);
-    bool        clipper_path_is_equal(const ClipperLib::Path &a, const ClipperLib::Path &b);
-    double      calculate_theta(const GEO::point &prev,
-                                const GEO::point &curr,
-                                const GEO::point &next );
-    int rotate_point(double cx, double cy, double angle, POINT &subject);
-    void rotate_vector( double cx, double cy, double angle,
-                        std::vector<GEO::point> &subject);
-    void translate_vector( std::vector<GEO::point> &point_vec, const double &delta_x,
-                           const double &delta_y, const double &delta_z );
-    bool is_elbow(const GEO::point &prev, const GEO::point &curr, const GEO::point &next);
-    void tidy_paths(ClipperLib::Paths &input_paths);
-    void tidy_path(ClipperLib::Path &input_path);
-    void repair_circles(ClipperLib::Paths &target_paths);
-    bool circle_test(ClipperLib::Path &target_path, const double &tolerance);
+    int         build_polyhedron( const mesh_solid &solid,
+                                  GEO::geo_builder &geometry,
+                                  int &volume_id) const;
+    void        add_ring_walls( const mesh_ring &ring,
+                                GEO::geo_builder &geometry,
+                                std::vector<std::vector<int>> &level_points,
+                                std::vector<int> &surfaces) const;
+    bool        clipper_path_is_equal(const ClipperLib::Path &a, const ClipperLib::Path &b) const;
+    void tidy_paths(ClipperLib::Paths &input_paths) const;
+    void tidy_path(ClipperLib::Path &input_path) const;
+    void repair_circles(ClipperLib::Paths &target_paths, std::vector<circle_primitive> &circles) const;
+    bool circle_test(ClipperLib::Path &target_path, const double &tolerance) const;
     void calc_bounding_box(const ClipperLib::Path &target_path, ClipperLib::Path &bounding_box);
-    double calculate_distance(const ClipperLib::IntPoint &a, const ClipperLib::IntPoint &b);
-    void reconstruct_circle(ClipperLib::Path &circle);
+    void reconstruct_circle(ClipperLib::Path &circle) const;
     ClipperLib::IntPoint rotate_IntPoint( const ClipperLib::IntPoint &origin,
                                           const ClipperLib::IntPoint &subject,
-                                          const double &theta );
-    ClipperLib::IntPoint calculate_centroid(const ClipperLib::Path &target_polygon);
+                                          const double &theta ) const;
+    ClipperLib::IntPoint calculate_centroid(const ClipperLib::Path &target_polygon) const;
   public:
       int generate_model( const std::string &gds_path,
                           const std::string &pif_path,
                           const std::string &py_path,
                           const std::string &cont_path,
                           const bool &multi_flag);
+      void set_output_format(const output_type &format) { output_format = format; }
+      void set_incremental(const bool &enable) { incremental = enable; }
+      void set_contour_resolution(const size_t &point_count) { contour_resolution = point_count; }
+      void set_decimation(const decimation_mode &mode) { decimation = mode; }
+      void set_hierarchical(const bool &enable) { hierarchical = enable; }
+      void set_window(const clip_window &region, const int &margin)
+      {
+          use_window = true;
+          window = region;
+          window_margin = margin;
+      }
       three_dim_model()
       {
 
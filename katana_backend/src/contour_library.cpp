@@ -0,0 +1,161 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function definitions for the shared etch-contour library
+ */
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "contour_library.hpp"
+#include "geofile_tokenizer.hpp"
+
+// Formats the contour as the point list of a FreeCAD Ingredient, three
+// points per line. The lines are identical for every shape of a layer, so
+// they are built once per contour.
+void MODEL3D::etch_contour::build_script_lines()
+{
+    script_lines.clear();
+    if(points.empty())
+        return;
+    auto point_text = [](const contour_point &pt) {
+        return "[" + std::to_string(pt.x) + ", " + std::to_string(pt.y) + ", " + std::to_string(pt.z) + "]";
+    };
+    std::string line = "    ], [" + point_text(points[0]);
+    auto etch_it = std::next(points.begin(),1);
+    auto etch_it_end = points.end();
+    while (etch_it != etch_it_end)
+    {
+        line += "    , " + point_text(*etch_it++);
+        for (int i = 0; (i < 2) && (etch_it != etch_it_end); i++)
+            line += ", " + point_text(*etch_it++);
+        script_lines.push_back(line);
+        line.clear();
+    }
+}
+
+// Returns the profile re-sampled at point_count heights spaced evenly from
+// the bottom to the top of the contour, interpolating the width linearly.
+MODEL3D::etch_contour MODEL3D::etch_contour::resample(const size_t &point_count) const
+{
+    etch_contour resampled;
+    if( (point_count<2) || (points.size()<2) )
+    {
+        resampled.points = points;
+        resampled.build_script_lines();
+        return resampled;
+    }
+    double z_low = points.front().z;
+    double z_high = points.back().z;
+    size_t segment = 0;
+    for (size_t i = 0; i < point_count; i++)
+    {
+        double z = z_low + (z_high - z_low)*i/(point_count-1);
+        while( (segment+2 < points.size()) && (points[segment+1].z < z) )
+            segment++;
+        const contour_point &low = points[segment];
+        const contour_point &high = points[segment+1];
+        double t = (high.z==low.z) ? 0 : (z - low.z)/(high.z - low.z);
+        resampled.points.push_back({ low.x + t*(high.x - low.x),
+                                     low.y + t*(high.y - low.y),
+                                     z });
+    }
+    // Keep the end points exact so widths and heights match the source
+    resampled.points.front() = points.front();
+    resampled.points.back() = points.back();
+    resampled.build_script_lines();
+    return resampled;
+}
+
+// Loads <directory>/<thickness>_contour.geo unless a contour of that
+// thickness is already in the library.
+int MODEL3D::contour_library::load(const std::string &directory, const int &thickness)
+{
+    if(contours.find({thickness, 0})!=contours.end())
+        return EXIT_SUCCESS;
+    std::string contour_path = directory;
+    if( (!contour_path.empty()) && (*contour_path.rbegin()=='/') )
+        contour_path.pop_back();
+    contour_path = contour_path + "/" + std::to_string(thickness) + "_contour.geo";
+    etch_contour contour;
+    if(read_contour_file(contour_path, contour)==EXIT_FAILURE)
+    {
+        std::cout<<"Error: Contour import failed. ["<<contour_path<<"]"<<std::endl;
+        return EXIT_FAILURE;
+    }
+    contour.build_script_lines();
+    contours.insert({{thickness, 0}, contour});
+    return EXIT_SUCCESS;
+}
+
+// Prepares a resampled profile of every loaded contour.
+void MODEL3D::contour_library::precompute(const size_t &point_count)
+{
+    if(point_count==0)
+        return;
+    std::vector<std::pair<int, etch_contour>> additions;
+    auto contours_end = contours.end();
+    for (auto contour_it = contours.begin(); contour_it != contours_end; contour_it++)
+    {
+        if( (contour_it->first.second==0) && (contours.find({contour_it->first.first, point_count})==contours_end) )
+            additions.push_back({contour_it->first.first, contour_it->second.resample(point_count)});
+    }
+    for (auto add_it = additions.begin(); add_it != additions.end(); add_it++)
+        contours.insert({{add_it->first, point_count}, add_it->second});
+}
+
+// Returns the contour of a thickness at the requested resolution
+// (0 = as loaded), or nullptr if it has not been loaded or precomputed.
+const MODEL3D::etch_contour* MODEL3D::contour_library::find(const int &thickness, const size_t &point_count) const
+{
+    auto contour_it = contours.find({thickness, point_count});
+    if(contour_it==contours.end())
+        return nullptr;
+    return &contour_it->second;
+}
+
+// Reads the points of a contour .geo file in ID order. Only Point entries
+// are used, so everything else in the file is skipped without parsing.
+// Point lines are split and converted by the .geo tokenizer.
+int MODEL3D::read_contour_file(const std::string &contour_path, etch_contour &contour)
+{
+    std::ifstream contour_file(contour_path, std::ios::in);
+    if(!contour_file.is_open())
+        return EXIT_FAILURE;
+    std::vector<std::pair<long, contour_point>> numbered_points;
+    std::vector<std::string_view> fields;
+    std::string file_buffer;
+    while (std::getline(contour_file, file_buffer))
+    {
+        size_t start = file_buffer.find_first_not_of(" \t");
+        if( (start==std::string::npos) || (file_buffer.compare(start, 5, "Point")!=0) )
+            continue;
+        GEO::split_geo_statement(file_buffer, fields);
+        int point_id;
+        double values[3];
+        if( (fields.size()<5) || (fields[0]!="Point") ||
+            (GEO::parse_geo_integer(fields[1], point_id)==false) ||
+            (GEO::parse_geo_real(fields[2], values[0])==false) ||
+            (GEO::parse_geo_real(fields[3], values[1])==false) ||
+            (GEO::parse_geo_real(fields[4], values[2])==false) )
+            continue;
+        numbered_points.push_back({point_id, {values[0], values[1], values[2]}});
+    }
+    if(numbered_points.empty())
+        return EXIT_FAILURE;
+    std::stable_sort(numbered_points.begin(), numbered_points.end(),
+                     [](const std::pair<long, contour_point> &a, const std::pair<long, contour_point> &b)
+                     { return a.first < b.first; });
+    // A repeated ID keeps its first definition
+    numbered_points.erase(std::unique(numbered_points.begin(), numbered_points.end(),
+                          [](const std::pair<long, contour_point> &a, const std::pair<long, contour_point> &b)
+                          { return a.first == b.first; }), numbered_points.end());
+    contour.points.clear();
+    auto numbered_end = numbered_points.end();
+    for (auto pt_it = numbered_points.begin(); pt_it != numbered_end; pt_it++)
+        contour.points.push_back(pt_it->second);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,189 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function definitions for append-only Gmsh .geo model assembly
+ */
+#include <fstream>
+#include <iostream>
+#include "geo_builder.hpp"
+#include "geofile_writer.hpp"
+
+// Orders the two end points so an edge has the same key in either direction.
+uint64_t GEO::geo_builder::line_key(const int &start, const int &end) const
+{
+    uint64_t low = (start < end) ? start : end;
+    uint64_t high = (start < end) ? end : start;
+    return (low << 32) | high;
+}
+
+int GEO::geo_builder::add_point(const double &x, const double &y, const double &z)
+{
+    points.push_back({x, y, z, 0});
+    return points.size();
+}
+
+// Returns the ID of the line from start to end, creating it if the edge does
+// not exist yet. A negative ID means the existing line runs the other way.
+int GEO::geo_builder::add_line(const int &start, const int &end)
+{
+    auto found = line_lookup.find(line_key(start, end));
+    if(found != line_lookup.end())
+        return (lines[found->second-1].start == start) ? found->second : -found->second;
+    lines.push_back({start, end});
+    int line_id = lines.size();
+    line_lookup.insert({line_key(start, end), line_id});
+    return line_id;
+}
+
+// Closes the given point sequence into a curve loop.
+int GEO::geo_builder::add_curve_loop(const std::vector<int> &loop_points)
+{
+    std::vector<int> loop_lines;
+    size_t n = loop_points.size();
+    for (size_t i = 0; i < n; i++)
+        loop_lines.push_back(add_line(loop_points[i], loop_points[(i+1)%n]));
+    curve_loops.push_back(loop_lines);
+    return curve_loops.size();
+}
+
+int GEO::geo_builder::add_plane_surface(const std::vector<int> &loops)
+{
+    plane_surfaces.push_back(loops);
+    return plane_surfaces.size();
+}
+
+int GEO::geo_builder::add_surface_loop(const std::vector<int> &surfaces)
+{
+    surface_loops.push_back(surfaces);
+    return surface_loops.size();
+}
+
+int GEO::geo_builder::add_volume(const int &surface_loop)
+{
+    volumes.push_back(surface_loop);
+    return volumes.size();
+}
+
+void GEO::geo_builder::add_physical_volume(const std::string &name, const std::vector<int> &group)
+{
+    physical_volumes.push_back({name, group});
+}
+
+// Adds every entity of another model after the existing ones. The other
+// model's IDs are shifted past this model's tables, so models built
+// independently (for example one per layer) can be concatenated in order.
+void GEO::geo_builder::append(const geo_builder &other)
+{
+    int point_offset = points.size();
+    int line_offset = lines.size();
+    int curve_loop_offset = curve_loops.size();
+    int surface_offset = plane_surfaces.size();
+    int surface_loop_offset = surface_loops.size();
+    int volume_offset = volumes.size();
+    auto shift = [](std::vector<int> &ids, const int &offset) {
+        for (auto id_it = ids.begin(); id_it != ids.end(); id_it++)
+            *id_it = (*id_it < 0) ? (*id_it - offset) : (*id_it + offset);
+    };
+    points.insert(points.end(), other.points.begin(), other.points.end());
+    auto lines_end = other.lines.end();
+    for (auto line_it = other.lines.begin(); line_it != lines_end; line_it++)
+    {
+        lines.push_back({line_it->start + point_offset, line_it->end + point_offset});
+        line_lookup.insert({line_key(lines.back().start, lines.back().end), (int)lines.size()});
+    }
+    auto loops_end = other.curve_loops.end();
+    for (auto loop_it = other.curve_loops.begin(); loop_it != loops_end; loop_it++)
+    {
+        curve_loops.push_back(*loop_it);
+        shift(curve_loops.back(), line_offset);
+    }
+    auto surfaces_end = other.plane_surfaces.end();
+    for (auto surface_it = other.plane_surfaces.begin(); surface_it != surfaces_end; surface_it++)
+    {
+        plane_surfaces.push_back(*surface_it);
+        shift(plane_surfaces.back(), curve_loop_offset);
+    }
+    auto sl_end = other.surface_loops.end();
+    for (auto sl_it = other.surface_loops.begin(); sl_it != sl_end; sl_it++)
+    {
+        surface_loops.push_back(*sl_it);
+        shift(surface_loops.back(), surface_offset);
+    }
+    auto volumes_end = other.volumes.end();
+    for (auto vol_it = other.volumes.begin(); vol_it != volumes_end; vol_it++)
+        volumes.push_back(*vol_it + surface_loop_offset);
+    auto pv_end = other.physical_volumes.end();
+    for (auto pv_it = other.physical_volumes.begin(); pv_it != pv_end; pv_it++)
+    {
+        physical_volumes.push_back(*pv_it);
+        shift(physical_volumes.back().volumes, volume_offset);
+    }
+}
+
+// Writes the model using the OpenCASCADE kernel. Volumes of a physical group
+// are fused first so overlapping solids of the same layer mesh as one body.
+// The text is formatted like geofile::export_geofile, so numbers are written
+// in the shortest form that reads back exactly.
+int GEO::geo_builder::export_geofile(const std::string &export_path) const
+{
+    if(volumes.empty())
+    {
+        std::cout << "Error: No volumes to export." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::ofstream gf_geometry_file(export_path, std::ios::out | std::ios::trunc | std::ios::binary);
+    if(!gf_geometry_file.is_open())
+    {
+        std::cout << "Error: Unable to open \"" << export_path << "\" for writing." << std::endl;
+        return EXIT_FAILURE;
+    }
+    geo_text text;
+    text.reserve(points.size()*64 + lines.size()*32 + curve_loops.size()*48 + plane_surfaces.size()*32);
+    write_geo_header(text, true);
+    text << "// ============================ POINTS ============================\n";
+    for (size_t i = 0; i < points.size(); i++)
+        text << "Point(" << (int)i+1 << ") = {"
+             << points[i].x << ", " << points[i].y << ", " << points[i].z << "};\n";
+    text << "// ============================ LINES =============================\n";
+    for (size_t i = 0; i < lines.size(); i++)
+        text << "Line(" << (int)i+1 << ") = {" << lines[i].start << ", " << lines[i].end << "};\n";
+    text << "// ========================= CURVE LOOPS ==========================\n";
+    for (size_t i = 0; i < curve_loops.size(); i++)
+        text << "Curve Loop(" << (int)i+1 << ") = {" << curve_loops[i] << "};\n";
+    text << "// ======================== PLANE SURFACES ========================\n";
+    for (size_t i = 0; i < plane_surfaces.size(); i++)
+        text << "Plane Surface(" << (int)i+1 << ") = {" << plane_surfaces[i] << "};\n";
+    text << "// ======================== SURFACE LOOPS =========================\n";
+    for (size_t i = 0; i < surface_loops.size(); i++)
+        text << "Surface Loop(" << (int)i+1 << ") = {" << surface_loops[i] << "};\n";
+    text << "// =========================== VOLUMES ============================\n";
+    for (size_t i = 0; i < volumes.size(); i++)
+        text << "Volume(" << (int)i+1 << ") = {" << volumes[i] << "};\n";
+    text << "// ======================= PHYSICAL VOLUMES =======================\n";
+    auto pv_end = physical_volumes.end();
+    for (auto pv_it = physical_volumes.begin(); pv_it != pv_end; pv_it++)
+    {
+        if(pv_it->volumes.empty())
+            continue;
+        if(pv_it->volumes.size()==1)
+            text << pv_it->name << "() = {" << pv_it->volumes[0] << "};\n";
+        else
+        {
+            text << pv_it->name << "() = BooleanUnion{ Volume{" << pv_it->volumes[0]
+                 << "}; Delete; }{ Volume{"
+                 << member_span{pv_it->volumes.data()+1, pv_it->volumes.size()-1}
+                 << "}; Delete; };\n";
+        }
+        text << "Physical Volume(\"" << pv_it->name << "\") = {" << pv_it->name << "()};\n";
+    }
+    gf_geometry_file.write(text.str().data(), text.size());
+    gf_geometry_file.close();
+    if(gf_geometry_file.fail())
+    {
+        std::cout << "Error: Writing \"" << export_path << "\" failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -5,14 +5,23 @@
  * license:     MIT
  * Description: Function definitions for FLOOXS for Gmsh .geo geometry file manipulation.
  */
+#include <algorithm>
 #include <cmath>
+#include <filesystem>
+#include <iomanip>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <fstream>
+#include <future>
 #include <map>
 #include <set>
+#include <unordered_map>
 #include <boost/algorithm/string.hpp>
 #include "geofile_operations.hpp"
+#include "geofile_tokenizer.hpp"
+#include "geofile_transform.hpp"
+#include "geofile_writer.hpp"
 
 //Initialization of object.
 GEO::geofile::geofile(/* args */)
@@ -23,6 +32,373 @@ GEO::geofile::~geofile()
 {
 }
 
+namespace {
+    // Stores an imported entity. IDs must be positive; a repeated ID keeps
+    // the first definition.
+    template <typename Table, typename Entity>
+    int insert_imported(Table &table, const int &id, const Entity &entity,
+                        const std::string &import_path, const int &line_number)
+    {
+        if (id<=0)
+        {
+            std::cout << "Error: Entity IDs must be positive (line "
+            << line_number << " of "
+            << import_path << ")" << std::endl;
+            return EXIT_FAILURE;
+        }
+        table.insert(id, entity);
+        return EXIT_SUCCESS;
+    }
+
+    std::string join_members(const GEO::member_span &loop)
+    {
+        std::ostringstream joined;
+        for (auto member_it = loop.begin(); member_it != loop.end(); member_it++)
+        {
+            if (member_it != loop.begin())
+                joined << ", ";
+            joined << *member_it;
+        }
+        return joined.str();
+    }
+
+    std::vector<int> identity_ids(const size_t &count)
+    {
+        std::vector<int> new_ids(count);
+        for (size_t id = 0; id < count; id++)
+            new_ids[id] = (int)id;
+        return new_ids;
+    }
+
+    // New IDs for the primary entities when a secondary table is merged in:
+    // every ID used by the secondary table moves past the highest primary
+    // ID, which frees it for the secondary entity.
+    template <typename Table>
+    std::vector<int> merge_shift(const Table &primary, const Table &secondary)
+    {
+        int delta = primary.last_id() - secondary.first_id() + 1;
+        std::vector<int> new_ids = identity_ids(std::max(primary.last_id(), secondary.last_id())+1);
+        for (int id = secondary.first_id(); id != 0; id = secondary.next_id(id))
+            new_ids[id] = id + delta;
+        return new_ids;
+    }
+
+    // Maps a signed reference through new_ids, keeping its orientation.
+    // References outside new_ids are left as they are.
+    void redirect(int &reference, const std::vector<int> &new_ids)
+    {
+        size_t id = (size_t)std::abs(reference);
+        if (id<new_ids.size())
+            reference = (reference<0) ? -new_ids[id] : new_ids[id];
+    }
+
+    void redirect_all(std::vector<int> &references, const std::vector<int> &new_ids)
+    {
+        auto references_end = references.end();
+        for (auto ref_it = references.begin(); ref_it != references_end; ref_it++)
+            redirect(*ref_it, new_ids);
+    }
+
+    // True if the cycle read from position a is lexicographically smaller
+    // than the cycle read from position b.
+    bool rotation_less(const std::vector<int> &cycle, const size_t &a, const size_t &b)
+    {
+        size_t n = cycle.size();
+        for (size_t i = 0; i < n; i++)
+        {
+            int x = cycle[(a+i)%n];
+            int y = cycle[(b+i)%n];
+            if (x!=y)
+                return x<y;
+        }
+        return false;
+    }
+
+    // The lexicographically smallest rotation of a cycle. Only rotations that
+    // start at the smallest member are candidates, which for loops without
+    // repeated members leaves exactly one.
+    std::vector<int> least_rotation(const std::vector<int> &cycle)
+    {
+        if (cycle.empty())
+            return cycle;
+        int lowest = *std::min_element(cycle.begin(), cycle.end());
+        size_t best = cycle.size();
+        for (size_t start = 0; start < cycle.size(); start++)
+        {
+            if ( (cycle[start]==lowest) && ((best==cycle.size()) || rotation_less(cycle, start, best)) )
+                best = start;
+        }
+        std::vector<int> rotated(cycle.begin()+best, cycle.end());
+        rotated.insert(rotated.end(), cycle.begin(), cycle.begin()+best);
+        return rotated;
+    }
+
+    // Members of a loop in a form shared by every copy of it. reversed is set
+    // if the form describes the loop in the opposite orientation.
+    struct loop_signature
+    {
+        std::vector<int> members;
+        bool reversed;
+    };
+
+    // A curve loop reads the same from any of its lines, and travelled
+    // backwards it lists its lines in reverse order with opposite signs. Of
+    // the least rotations of both directions the smaller is the signature.
+    loop_signature curve_loop_signature(const GEO::member_span &loop)
+    {
+        std::vector<int> forward(loop.begin(), loop.end());
+        std::vector<int> backward(forward.rbegin(), forward.rend());
+        for (auto member_it = backward.begin(); member_it != backward.end(); member_it++)
+            *member_it = -*member_it;
+        forward = least_rotation(forward);
+        backward = least_rotation(backward);
+        if (backward<forward)
+            return {backward, true};
+        return {forward, false};
+    }
+
+    // A surface loop is a closed shell: the order and orientation of its
+    // surfaces do not change the volume it encloses.
+    loop_signature surface_loop_signature(const GEO::member_span &loop)
+    {
+        std::vector<int> members(loop.begin(), loop.end());
+        for (auto member_it = members.begin(); member_it != members.end(); member_it++)
+            *member_it = std::abs(*member_it);
+        std::sort(members.begin(), members.end());
+        return {members, false};
+    }
+
+    void hash_combine(size_t &hash, const size_t &value)
+    {
+        hash ^= value + 0x9e3779b97f4a7c15ULL + (hash<<6) + (hash>>2);
+    }
+
+    struct members_hash
+    {
+        size_t operator()(const std::vector<int> &members) const
+        {
+            size_t hash = members.size();
+            for (auto member_it = members.begin(); member_it != members.end(); member_it++)
+                hash_combine(hash, std::hash<int>()(*member_it));
+            return hash;
+        }
+    };
+
+    // Hashes the coordinates only, as point::operator== compares them. Adding
+    // 0.0 folds -0.0 into 0.0.
+    struct point_hash
+    {
+        size_t operator()(const GEO::point &pt) const
+        {
+            size_t hash = std::hash<double>()(pt.x + 0.0);
+            hash_combine(hash, std::hash<double>()(pt.y + 0.0));
+            hash_combine(hash, std::hash<double>()(pt.z + 0.0));
+            return hash;
+        }
+    };
+
+    struct grid_cell
+    {
+        long long x, y, z;
+        bool operator==(const grid_cell &other) const
+        {
+            return ((x==other.x)&&(y==other.y)&&(z==other.z));
+        }
+    };
+
+    struct grid_cell_hash
+    {
+        size_t operator()(const grid_cell &cell) const
+        {
+            size_t hash = std::hash<long long>()(cell.x);
+            hash_combine(hash, std::hash<long long>()(cell.y));
+            hash_combine(hash, std::hash<long long>()(cell.z));
+            return hash;
+        }
+    };
+
+    // Erases every point identical to a point with a lower ID and returns the
+    // redirects to the kept points. Empty if no point was erased.
+    std::vector<int> merge_identical_points(GEO::entity_table<GEO::point> &points)
+    {
+        std::vector<int> redirects;
+        std::unordered_map<GEO::point, int, point_hash> first_seen;
+        first_seen.reserve(points.size());
+        for (int id = points.first_id(); id != 0; id = points.next_id(id))
+        {
+            auto outcome = first_seen.insert({points[id], id});
+            if (outcome.second==false)
+            {
+                if (redirects.empty())
+                    redirects = identity_ids(points.last_id()+1);
+                redirects[id] = outcome.first->second;
+                points.erase(id);
+            }
+        }
+        return redirects;
+    }
+
+    // Erases every point within tolerance of a kept point with a lower ID and
+    // redirects it to the lowest such point. Kept points are binned in a hash
+    // grid of cells one tolerance wide, so a point is only compared with the
+    // kept points in the 27 cells around it. Points are visited in ID order,
+    // which makes the result independent of the hashing.
+    std::vector<int> weld_points(GEO::entity_table<GEO::point> &points, const double &tolerance)
+    {
+        std::vector<int> redirects;
+        std::unordered_map<grid_cell, std::vector<int>, grid_cell_hash> grid;
+        grid.reserve(points.size());
+        const double tolerance_sqr = tolerance*tolerance;
+        for (int id = points.first_id(); id != 0; id = points.next_id(id))
+        {
+            const GEO::point &pt = points[id];
+            grid_cell cell = {  (long long)std::floor(pt.x/tolerance),
+                                (long long)std::floor(pt.y/tolerance),
+                                (long long)std::floor(pt.z/tolerance) };
+            int match = 0;
+            for (int neighbour = 0; neighbour < 27; neighbour++)
+            {
+                auto cell_it = grid.find({  cell.x + neighbour%3 - 1,
+                                            cell.y + (neighbour/3)%3 - 1,
+                                            cell.z + neighbour/9 - 1 });
+                if (cell_it == grid.end())
+                    continue;
+                for (auto kept_it = cell_it->second.begin(); kept_it != cell_it->second.end(); kept_it++)
+                {
+                    const GEO::point &kept = points[*kept_it];
+                    double dx = kept.x - pt.x;
+                    double dy = kept.y - pt.y;
+                    double dz = kept.z - pt.z;
+                    if ( (dx*dx + dy*dy + dz*dz <= tolerance_sqr) && ((match==0) || (*kept_it<match)) )
+                        match = *kept_it;
+                }
+            }
+            if (match==0)
+                grid[cell].push_back(id);
+            else
+            {
+                if (redirects.empty())
+                    redirects = identity_ids(points.last_id()+1);
+                redirects[id] = match;
+                points.erase(id);
+            }
+        }
+        return redirects;
+    }
+
+    // Erases every loop whose signature was already seen on a lower ID and
+    // returns the redirects for references to the erased loops: to the kept
+    // loop, negated if the two have opposite orientations. One hash lookup
+    // per loop.
+    template <typename Signature>
+    std::vector<int> merge_duplicate_loops(GEO::loop_table &loops, Signature signature_of)
+    {
+        std::vector<int> changes = identity_ids(loops.last_id()+1);
+        std::unordered_map<std::vector<int>, std::pair<int, bool>, members_hash> first_seen;
+        first_seen.reserve(loops.size());
+        for (int id = loops.first_id(); id != 0; id = loops.next_id(id))
+        {
+            loop_signature signature = signature_of(loops[id]);
+            bool reversed = signature.reversed;
+            auto outcome = first_seen.insert({std::move(signature.members), {id, reversed}});
+            if (outcome.second==false)
+            {
+                int kept = outcome.first->second.first;
+                changes[id] = (outcome.first->second.second==reversed) ? kept : -kept;
+                loops.erase(id);
+            }
+        }
+        return changes;
+    }
+
+    // Physical groups list entities without orientation, so a redirect to
+    // a reversed entity keeps the positive ID.
+    void redirect_physical(std::map<std::string, std::vector<int>> &physical_map,
+                           const std::vector<int> &new_ids)
+    {
+        auto physical_end = physical_map.end();
+        for (auto physical_it = physical_map.begin(); physical_it != physical_end; physical_it++)
+        {
+            redirect_all(physical_it->second, new_ids);
+            for (auto ref_it = physical_it->second.begin(); ref_it != physical_it->second.end(); ref_it++)
+                *ref_it = std::abs(*ref_it);
+        }
+    }
+}
+
+bool GEO::loop_table::insert(const int &id, const int *first, const size_t &count)
+{
+    if (runs.insert(id, {flat_members.size(), count})==false)
+        return false;
+    flat_members.insert(flat_members.end(), first, first+count);
+    live_members += count;
+    return true;
+}
+
+void GEO::loop_table::erase(const int &id)
+{
+    if (runs.contains(id))
+    {
+        live_members -= runs[id].count;
+        runs.erase(id);
+    }
+}
+
+void GEO::loop_table::remove_members(const std::vector<bool> &removed)
+{
+    for (int id = runs.first_id(); id != 0; id = runs.next_id(id))
+    {
+        member_run &run = runs[id];
+        size_t write_index = run.offset;
+        for (size_t read_index = run.offset; read_index < run.offset+run.count; read_index++)
+        {
+            size_t member = (size_t)std::abs(flat_members[read_index]);
+            if ( (member>=removed.size()) || (removed[member]==false) )
+                flat_members[write_index++] = flat_members[read_index];
+        }
+        live_members -= run.offset+run.count-write_index;
+        run.count = write_index-run.offset;
+    }
+}
+
+void GEO::loop_table::clear()
+{
+    runs.clear();
+    flat_members.clear();
+    live_members = 0;
+}
+
+// Drops the members of erased loops from the member array and lays the
+// remaining runs out in ascending ID order.
+void GEO::loop_table::compact()
+{
+    std::vector<int> compacted;
+    compacted.reserve(live_members);
+    for (int id = runs.first_id(); id != 0; id = runs.next_id(id))
+    {
+        member_run &run = runs[id];
+        size_t offset = compacted.size();
+        compacted.insert(compacted.end(), flat_members.begin()+run.offset,
+                         flat_members.begin()+run.offset+run.count);
+        run.offset = offset;
+    }
+    flat_members = std::move(compacted);
+}
+
+// Moves loop id to new_ids[id]. The runs keep their place in the member
+// array, so only the run table is rewritten.
+void GEO::loop_table::renumber(const std::vector<int> &new_ids)
+{
+    runs.renumber(new_ids);
+    if (live_members!=flat_members.size())
+        compact();
+}
+
+size_t GEO::loop_table::memory_bytes() const
+{
+    return runs.memory_bytes() + flat_members.capacity()*sizeof(int);
+}
+
 bool GEO::compare_point(const point &first, const point &second)
 {
     if (first.x==second.x)
@@ -55,36 +431,24 @@ int GEO::compare_line(const line &first, const line &second)
     return 3;
 }
 
-bool GEO::check_same_vec(const std::vector<int> &first, const std::vector<int> &second)
+bool GEO::check_same_vec(const member_span &first, const member_span &second)
 {
     if( first.size() == second.size() )
-    {
-        auto first_end = first.end();
-        for ( auto first_it = first.begin(); first_it != first_end; first_it++)
-        {
-            auto second_end = second.end();
-            for ( auto second_it = second.begin(); second_it != second_end; second_it++)
-            {
-                if (*first_it!=*second_it)
-                    return  false;
-            }
-        }
-        return true;
-    }
+        return std::equal(first.begin(), first.end(), second.begin());
     return false;
 }
 // Returns 1 if vectors are identical
 // Returns 2 if vectors are reversed
 // Returns 3 if vectors are different
-int GEO::compare_vector(const std::vector<int> &first, const std::vector<int> &second)
+int GEO::compare_vector(const member_span &first, const member_span &second)
 {
     if (check_same_vec(first,second))
         return 1;
     else
     {
-        auto reversed = second;
+        std::vector<int> reversed(second.begin(), second.end());
         std::reverse(reversed.begin(),reversed.end());
-        if (check_same_vec(first,reversed))
+        if (check_same_vec(first,{reversed.data(), reversed.size()}))
             return 2;
         else
             return 3;
@@ -93,345 +457,211 @@ int GEO::compare_vector(const std::vector<int> &first, const std::vector<int> &s
 
 GEO::geo_argument GEO::hashit(std::string const& inString)
 {
-    if (inString == "Point")            return GEO::ePoint;
-    if (inString == "cl__1")            return GEO::eChar_Len;
-    if (inString == "Line")             return GEO::eLine;
-    if (inString == "Line Loop")        return GEO::eCurve_Loop;
-    if (inString == "Curve Loop")       return GEO::eCurve_Loop;
-    if (inString == "Plane Surface")    return GEO::ePlane_surface;
-    if (inString == "Surface")          return GEO::ePlane_surface;
-    if (inString == "Surface Loop")     return GEO::eSurface_loop;
-    if (inString == "Volume")           return GEO::eVolume;
-    if (inString == "Physical Point")   return GEO::ePhysical_Point;
-    if (inString == "Physical Line")    return GEO::ePhysical_Curve;
-    if (inString == "Physical Curve")   return GEO::ePhysical_Curve;
-    if (inString == "Physical Surface") return GEO::ePhysical_Surface;
-    if (inString == "Physical Volume")  return GEO::ePhysical_Volume;
-    if (inString == "MeshSpac")         return GEO::eMesh_Spacing;
-    if (inString == "SetFactory")       return GEO::eOpenCASCADE;
-    if (inString == "")                 return GEO::eBlank_Space;
-    return GEO::eDefault;
-}
-int GEO::geofile::import_geofile(std::string import_path)
-{
-    std::fstream geo_file;
-    std::string file_buffer;
-    geo_file.open(import_path, std::ios::in);
-    if (geo_file.is_open())
-    {
-        int line_number =1;
-        while (getline(geo_file, file_buffer))
-        {
-            std::vector<std::string> split_string_vector;
-            boost::split(split_string_vector, file_buffer, boost::is_any_of("(),{}="));
-            trim_string_vector(split_string_vector);
-            geo_argument command = hashit(split_string_vector[0]);
-            switch (command)
-            {
-            case ePoint:
-                if(import_point(split_string_vector, import_path, line_number)==EXIT_FAILURE)
-                    return EXIT_FAILURE;
-                break;
-            case eLine:
-                if(import_line(split_string_vector, import_path, line_number)==EXIT_FAILURE)
-                    return EXIT_FAILURE;
-                break;
-            case eCurve_Loop:
-                if(import_curve_loop(split_string_vector, import_path, line_number)==EXIT_FAILURE)
-                    return EXIT_FAILURE;
-                break;
-            case ePlane_surface:
-                if(import_plane_surface(split_string_vector, import_path, line_number)==EXIT_FAILURE)
-                    return EXIT_FAILURE;
-                break;
-            case eMesh_Spacing:
-                if(import_mesh_spacing(split_string_vector)==EXIT_FAILURE)
-                    return EXIT_FAILURE;
-                break;
-            case eOpenCASCADE:
-                switch_to_OpenCASCADE();
-                break;
-            case eSurface_loop:
-                if(import_surface_loop(split_string_vector, import_path, line_number)==EXIT_FAILURE)
-                    return EXIT_FAILURE;
-                break;
-            case eVolume:
-                if(import_volume(split_string_vector, import_path, line_number)==EXIT_FAILURE)
-                    return EXIT_FAILURE;
-                break;
-            case ePhysical_Point:
-                if(import_physical_entity(  split_string_vector, import_path,
-                                            line_number, command)
-                                            == EXIT_FAILURE )
-                    return EXIT_FAILURE;
-                break;
-            case ePhysical_Curve:
-                if(import_physical_entity(  split_string_vector, import_path,
-                                            line_number, command)
-                                            == EXIT_FAILURE )
-                    return EXIT_FAILURE;
-                break;
-            case ePhysical_Surface:
-                if(import_physical_entity(  split_string_vector, import_path,
-                                            line_number, command)
-                                            == EXIT_FAILURE )
-                    return EXIT_FAILURE;
-                break;
-            case ePhysical_Volume:
-                if(import_physical_entity(  split_string_vector, import_path,
-                                            line_number, command)
-                                            == EXIT_FAILURE )
-                    return EXIT_FAILURE;
-                break;
-            case eBlank_Space:
-                break;
-            case eChar_Len:
-                if(import_mesh_spacing(split_string_vector)==EXIT_FAILURE)
-                    return EXIT_FAILURE;
-                break;
-            default:
-                if (!file_buffer.rfind("//", 0) == 0) {
-                    std::cout   << "Error: Unrecognized input in "
-                                << import_path << " at line "
-                                << line_number << "." << std::endl;
-                    std::cout   << "Violation: "
-                                << file_buffer << std::endl;
-                    return EXIT_FAILURE;
-                }
-                break;
-            }
-            line_number++;
-        }
-        geo_file.close();
-    }
-    else
-        return EXIT_FAILURE;
-    return EXIT_SUCCESS;
+    return keyword_code(inString);
 }
 
-int GEO::geofile::import_point( std::vector<std::string> &split_string_vector,
-                                std::string &import_path,
-                                int &line_number)
-{
-    if ( (is_integer(split_string_vector[1])==true)&&
-         (is_e_notation(split_string_vector[2])==true)&&
-         (is_e_notation(split_string_vector[3])==true)&&
-         (is_e_notation(split_string_vector[4])==true)&&
-         ( (is_e_notation(split_string_vector[5])==true)||
-           (split_string_vector[5]=="MeshSpac")||
-           (split_string_vector[5]=="cl__1") )||
-           (split_string_vector[5]==";") )
-    {
-        point input_point;
-        input_point.x = std::stod(split_string_vector[2]);
-        input_point.y = std::stod(split_string_vector[3]);
-        input_point.z = std::stod(split_string_vector[4]);
-        if( (split_string_vector[5]=="MeshSpac")||
-            (split_string_vector[5]=="cl__1") )
-        {
-            input_point.char_len = mesh_spacing;
-        }
-        else
-        {
-            if (split_string_vector[5]!=";")
-                input_point.char_len = std::stod(split_string_vector[5]);
-            else
-                input_point.char_len = 0;
-        }
-        points_map.insert({std::stoi(split_string_vector[1]), input_point});
-        return EXIT_SUCCESS;
-    }
-    else
+namespace {
+    int report_invalid_value(const std::string &import_path, const int &line_number)
     {
         std::cout << "Error: Invalid value (line "
         << line_number << " of "
         << import_path << ")" << std::endl;
         return EXIT_FAILURE;
     }
-}
 
-int GEO::geofile::import_line( std::vector<std::string> &split_string_vector,
-                                std::string &import_path,
-                                int &line_number)
-{
-    if ((is_integer(split_string_vector[1])==true)&&
-        (is_integer(split_string_vector[2])==true)&&
-        (is_integer(split_string_vector[3])==true))
+    // Converts fields [first, last) to integers. False if any is not one.
+    bool parse_references(  const std::vector<std::string_view> &fields,
+                            const size_t &first, const size_t &last,
+                            std::vector<int> &references)
     {
-        line input_line;
-        auto start = std::stoi(split_string_vector[2]);
-        auto end   = std::stoi(split_string_vector[3]);
-        input_line.start = start;
-        input_line.end = end;
-        lines_map.insert({std::stoi(split_string_vector[1]), input_line});
-        return EXIT_SUCCESS;
-    }
-    else
-    {
-        std::cout << "Error: Invalid value (line "
-        << line_number << " of "
-        << import_path << ")" << std::endl;
-        return EXIT_FAILURE;
+        references.clear();
+        for (size_t i = first; i < last; i++)
+        {
+            int reference;
+            if (GEO::parse_geo_integer(fields[i], reference)==false)
+                return false;
+            references.push_back(reference);
+        }
+        return true;
     }
-    return EXIT_SUCCESS;
 }
 
-int GEO::geofile::import_curve_loop( std::vector<std::string> &split_string_vector,
-                                std::string &import_path,
-                                int &line_number)
+// Reads the file through a memory map and splits each line into views of
+// the mapped text, so no line or field is copied before it is converted.
+int GEO::geofile::import_geofile(std::string import_path)
 {
-    auto it = split_string_vector.begin();
-    it++;
-    int key = std::stod(*it);
-    it++;
-    bool proceed = true;
-    auto ssv_end = std::prev(split_string_vector.end(),1);//don't check semicolon.
-    while (it!=ssv_end)
-    {
-        if (!is_integer(*it)) proceed = false;
-        it++;
-    }
-    if (proceed==false)
-    {
-        std::cout << "Error: Invalid value (line "
-        << line_number << " of "
-        << import_path << ")" << std::endl;
+    mapped_file geo_file;
+    if (geo_file.open(import_path)==EXIT_FAILURE)
         return EXIT_FAILURE;
+    std::string_view text = geo_file.contents();
+    std::vector<std::string_view> fields;
+    int line_number = 1;
+    size_t line_start = 0;
+    while (line_start < text.size())
+    {
+        size_t line_end = text.find('\n', line_start);
+        if (line_end==std::string_view::npos)
+            line_end = text.size();
+        std::string_view file_line = text.substr(line_start, line_end-line_start);
+        line_start = line_end+1;
+        // Colour statements, as written by -slice, only affect display.
+        if ( (file_line.rfind("//", 0)==0) || (file_line.rfind("Color ", 0)==0) )
+        {
+            line_number++;
+            continue;
+        }
+        split_geo_statement(file_line, fields);
+        geo_argument command = fields.empty() ? eBlank_Space : keyword_code(fields[0]);
+        int status = EXIT_SUCCESS;
+        switch (command)
+        {
+        case ePoint:
+            status = import_point(fields, import_path, line_number);
+            break;
+        case eLine:
+            status = import_line(fields, import_path, line_number);
+            break;
+        case eCurve_Loop:
+            status = import_curve_loop(fields, import_path, line_number);
+            break;
+        case ePlane_surface:
+            status = import_plane_surface(fields, import_path, line_number);
+            break;
+        case eMesh_Spacing:
+        case eChar_Len:
+            status = import_mesh_spacing(fields);
+            break;
+        case eOpenCASCADE:
+            switch_to_OpenCASCADE();
+            break;
+        case eSurface_loop:
+            status = import_surface_loop(fields, import_path, line_number);
+            break;
+        case eVolume:
+            status = import_volume(fields, import_path, line_number);
+            break;
+        case ePhysical_Point:
+        case ePhysical_Curve:
+        case ePhysical_Surface:
+        case ePhysical_Volume:
+            status = import_physical_entity(fields, import_path, line_number, command);
+            break;
+        case eBlank_Space:
+            break;
+        default:
+            std::cout   << "Error: Unrecognized input in "
+                        << import_path << " at line "
+                        << line_number << "." << std::endl;
+            std::cout   << "Violation: "
+                        << file_line << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (status==EXIT_FAILURE)
+            return EXIT_FAILURE;
+        line_number++;
     }
-    it = std::next(split_string_vector.begin(),2);
-    std::vector<int> curve_references;
-    while (it!=ssv_end)
-    {
-        curve_references.push_back(std::stod(*it));
-        it++;
-    }
-    curve_loops_map.insert({key,curve_references});
     return EXIT_SUCCESS;
 }
 
-int GEO::geofile::import_plane_surface( std::vector<std::string> &split_string_vector,
-                                std::string &import_path,
-                                int &line_number)
+// Point(id) = {x, y, z, char_len}; where char_len may be a number, MeshSpac
+// or cl__1, or left out.
+int GEO::geofile::import_point( const std::vector<std::string_view> &fields,
+                                const std::string &import_path,
+                                const int &line_number)
+{
+    int id;
+    point input_point;
+    if ( (fields.size()<6)||
+         (parse_geo_integer(fields[1], id)==false)||
+         (parse_geo_real(fields[2], input_point.x)==false)||
+         (parse_geo_real(fields[3], input_point.y)==false)||
+         (parse_geo_real(fields[4], input_point.z)==false) )
+        return report_invalid_value(import_path, line_number);
+    if( (fields[5]=="MeshSpac")||
+        (fields[5]=="cl__1") )
+        input_point.char_len = mesh_spacing;
+    else if (fields[5]==";")
+        input_point.char_len = 0;
+    else if (parse_geo_real(fields[5], input_point.char_len)==false)
+        return report_invalid_value(import_path, line_number);
+    return insert_imported(points, id, input_point, import_path, line_number);
+}
+
+int GEO::geofile::import_line(  const std::vector<std::string_view> &fields,
+                                const std::string &import_path,
+                                const int &line_number)
+{
+    int id;
+    line input_line;
+    if ( (fields.size()<4)||
+         (parse_geo_integer(fields[1], id)==false)||
+         (parse_geo_integer(fields[2], input_line.start)==false)||
+         (parse_geo_integer(fields[3], input_line.end)==false) )
+        return report_invalid_value(import_path, line_number);
+    return insert_imported(lines, id, input_line, import_path, line_number);
+}
+
+// The last field of a loop or surface statement is the closing ';'.
+int GEO::geofile::import_curve_loop(const std::vector<std::string_view> &fields,
+                                    const std::string &import_path,
+                                    const int &line_number)
+{
+    int key;
+    std::vector<int> curve_references;
+    if ( (fields.size()<3)||
+         (parse_geo_integer(fields[1], key)==false)||
+         (parse_references(fields, 2, fields.size()-1, curve_references)==false) )
+        return report_invalid_value(import_path, line_number);
+    return insert_imported(curve_loops, key, curve_references, import_path, line_number);
+}
+
+int GEO::geofile::import_plane_surface( const std::vector<std::string_view> &fields,
+                                        const std::string &import_path,
+                                        const int &line_number)
 {
-    auto it = split_string_vector.begin();
-    split_string_vector.erase(it);
-    it = std::prev(split_string_vector.end(),1);
-    split_string_vector.erase(it);
-    it = split_string_vector.begin();
-    bool proceed = true;
-    auto ssv_end = split_string_vector.end();
-    while (it!=ssv_end)
-    {
-        if (!is_integer(*it)) proceed = false;
-        it++;
-    }
-    if (proceed==false)
-    {
-        std::cout << "Error: Invalid value (line "
-        << line_number << " of "
-        << import_path << ")" << std::endl;
-        return EXIT_FAILURE;
-    }
-    it = split_string_vector.begin();
-    int key = std::stod(*it);
-    it++;
-    plane_surfaces_map.insert({key,std::stod(*it)});
-    return EXIT_SUCCESS;
+    std::vector<int> values;
+    if ( (fields.size()<4)||
+         (parse_references(fields, 1, fields.size()-1, values)==false) )
+        return report_invalid_value(import_path, line_number);
+    return insert_imported(plane_surfaces, values[0], values[1], import_path, line_number);
 }
 
-int GEO::geofile::import_surface_loop(  std::vector<std::string> &split_string_vector,
-                                        std::string &import_path,
-                                        int &line_number)
+int GEO::geofile::import_surface_loop(  const std::vector<std::string_view> &fields,
+                                        const std::string &import_path,
+                                        const int &line_number)
 {
-    auto it = split_string_vector.begin();
-    split_string_vector.erase(it);
-    it = std::prev(split_string_vector.end(),1);
-    split_string_vector.erase(it);
-    it = split_string_vector.begin();
-    bool proceed = true;
-    auto ssv_end = split_string_vector.end();
-    while (it!=ssv_end)
-    {
-        if (!is_integer(*it)) proceed = false;
-        it++;
-    }
-    if (proceed==false)
-    {
-        std::cout << "Error: Invalid value (line "
-        << line_number << " of "
-        << import_path << ")" << std::endl;
-        return EXIT_FAILURE;
-    }
-    it = split_string_vector.begin();
-    int key = std::stod(*it);
-    it++;
+    int key;
     std::vector<int> surface_references;
-    while (it!=ssv_end)
-    {
-        surface_references.push_back(std::stod(*it));
-        it++;
-    }
-    surface_loops_map.insert({key,surface_references});
-    return EXIT_SUCCESS;
+    if ( (fields.size()<3)||
+         (parse_geo_integer(fields[1], key)==false)||
+         (parse_references(fields, 2, fields.size()-1, surface_references)==false) )
+        return report_invalid_value(import_path, line_number);
+    return insert_imported(surface_loops, key, surface_references, import_path, line_number);
 }
 
-int GEO::geofile::import_volume(    std::vector<std::string> &split_string_vector,
-                                    std::string &import_path,
-                                    int &line_number)
+int GEO::geofile::import_volume(    const std::vector<std::string_view> &fields,
+                                    const std::string &import_path,
+                                    const int &line_number)
 {
-    auto it = split_string_vector.begin();
-    split_string_vector.erase(it);
-    it= std::prev(split_string_vector.end(),1);
-    split_string_vector.erase(it);
-    it = split_string_vector.begin();
-    bool proceed = true;
-    while (it!=split_string_vector.end())
-    {
-        if (!is_integer(*it)) proceed = false;
-        it++;
-    }
-    if (proceed==false)
-    {
-        std::cout << "Error: Invalid value (line "
-        << line_number << " of "
-        << import_path << ")" << std::endl;
-        return EXIT_FAILURE;
-    }
-    it = split_string_vector.begin();
-    int key = std::stod(*it);
-    it++;
-    volumes_map.insert({key,std::stod(*it)});
-    return EXIT_SUCCESS;
+    std::vector<int> values;
+    if ( (fields.size()<4)||
+         (parse_references(fields, 1, fields.size()-1, values)==false) )
+        return report_invalid_value(import_path, line_number);
+    return insert_imported(volumes, values[0], values[1], import_path, line_number);
 }
 
-int GEO::geofile::import_physical_entity(   std::vector<std::string> &split_string_vector,
-                                            std::string &import_path,
-                                            int &line_number,
-                                            geo_argument &physical_type)
+// Physical <Type>("name") = {ids};
+int GEO::geofile::import_physical_entity(   const std::vector<std::string_view> &fields,
+                                            const std::string &import_path,
+                                            const int &line_number,
+                                            const geo_argument &physical_type)
 {
-    auto it = split_string_vector.begin();
-    split_string_vector.erase(it);
-    boost::erase_all( *it, "\"" );
-    it=std::prev(split_string_vector.end(),1);
-    split_string_vector.erase(it);
-    it = split_string_vector.begin();
-    std::string group_name = *it++;
     std::vector<int> elements;
-    auto ssv_end = split_string_vector.end();
-    while (it != ssv_end)
-    {
-        if (is_integer(*it))
-        {
-            elements.push_back(std::stoi(*it++));
-        }
-        else
-        {
-            std::cout << "Error: Invalid value (line "
-            << line_number << " of "
-            << import_path << ")" << std::endl;
-            return EXIT_FAILURE;
-        }
-    }
+    if ( (fields.size()<3)||
+         (parse_references(fields, 2, fields.size()-1, elements)==false) )
+        return report_invalid_value(import_path, line_number);
+    std::string group_name(fields[1]);
+    boost::erase_all(group_name, "\"");
     switch (physical_type)
     {
     case ePhysical_Point:
@@ -456,17 +686,17 @@ int GEO::geofile::import_physical_entity(   std::vector<std::string> &split_stri
     return EXIT_SUCCESS;
 }
 
-int GEO::geofile::import_mesh_spacing(std::vector<std::string> &split_string_vector)
+// MeshSpac = value; or cl__1 = value;
+int GEO::geofile::import_mesh_spacing(const std::vector<std::string_view> &fields)
 {
-    boost::erase_all(split_string_vector[1], ";");
-    if (is_e_notation(split_string_vector[1]))
-    {
-        std::string msh_spc = split_string_vector[1];
-        mesh_spacing = std::stod(msh_spc);
-        return EXIT_SUCCESS;
-    }
-    else
+    if (fields.size()<2)
+        return EXIT_FAILURE;
+    std::string_view value = fields[1];
+    while ( (!value.empty()) && ((value.back()==';')||(value.back()==' ')||(value.back()=='\t')) )
+        value.remove_suffix(1);
+    if (parse_geo_real(value, mesh_spacing)==false)
         return EXIT_FAILURE;
+    return EXIT_SUCCESS;
 }
 
 bool GEO::is_integer(std::string const& n) noexcept
@@ -514,234 +744,132 @@ void GEO::remove_empty_strings(std::vector<std::string>& input_string)
   input_string.erase(it, input_string.end());
 }
 
+// Each section of the file is formatted into its own buffer and the buffers
+// are written in order. Large models format the sections on separate
+// threads; the text is the same either way.
 int GEO::geofile::export_geofile(std::string export_path)
 {
-    if(points_map.empty())
+    if(points.empty())
     {
         std::cout   << "Error: No points detected. Have you imported a .geo file?"
                     << std::endl;
         return EXIT_FAILURE;
     }
-    std::ofstream gf_geometry_file;
-    std::string file_output_name = export_path;
-    time_t log_attempt_time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-    gf_geometry_file.open( file_output_name, std::ios::out);
-    gf_geometry_file << "// -------------------------------------------------------------- //" << "\n";
-    gf_geometry_file << "//                    _                                           //" << "\n";
-    gf_geometry_file << "//          _________| |___________________________________       //" << "\n";
-    gf_geometry_file << "//         [_x_x_x_x_   ______________Katana______________/       //" << "\n";
-    gf_geometry_file << "//                   |_|                                          //" << "\n";
-    gf_geometry_file << "//                                                                //" << "\n";
-    gf_geometry_file << "//                      Katana Terminal Edition                   //" << "\n";
-    gf_geometry_file << "//    TCAD Tools for the Superconducting Electronics Community    //" << "\n";
-    gf_geometry_file << "// -------------------------------------------------------------- //" << "\n";
-    gf_geometry_file << "// File creation date = " << std::ctime(&log_attempt_time);
-    gf_geometry_file << "//\n";
-    if(is_open_cascade==true){gf_geometry_file << "SetFactory(\"OpenCASCADE\");\n";}
-    gf_geometry_file << "// ============================ POINTS ============================" << "\n";
-    auto p_iter     = points_map.begin();
-    auto p_iter_end = points_map.end();
-    while (p_iter != p_iter_end)
-    {
-        if( (ignore_char_len==false) && (p_iter->second.char_len != 0) )
-        {
-            gf_geometry_file    << "Point(" << p_iter->first << ") = {"
-                                << p_iter->second.x << ", "
-                                << p_iter->second.y << ", "
-                                << p_iter->second.z << ", "
-                                << p_iter->second.char_len
-                                << "};"             << "\n";
-        }
-        else
-        {
-            gf_geometry_file    << "Point(" << p_iter->first << ") = {"
-                                << p_iter->second.x << ", "
-                                << p_iter->second.y << ", "
-                                << p_iter->second.z
-                                << "};"             << "\n";
-        }
-        p_iter++;
-    }
-    gf_geometry_file << "// ============================ LINES =============================" << "\n";
-    auto l_iter     = lines_map.begin();
-    auto l_iter_end = lines_map.end();
-    while (l_iter != l_iter_end)
-    {
-        // Line(5) = {1, 5};
-            gf_geometry_file    << "Line("  << l_iter->first
-                                << ") = {"
-                                << l_iter->second.start
-                                << ", "
-                                << l_iter->second.end
-                                << "};"     << "\n";
-        l_iter++;
-    }
-    gf_geometry_file << "// ========================= CURVE LOOPS ==========================" << "\n";
-    auto cl_iter     = curve_loops_map.begin();
-    auto cl_iter_end = curve_loops_map.end();
-    while (cl_iter != cl_iter_end)
-    {
-        std::ostringstream curve_loop;
-        auto loop_iter      = cl_iter->second.begin();
-        auto loop_iter_last  = --cl_iter->second.end();
-        while (loop_iter != loop_iter_last)
-        {
-            curve_loop << *loop_iter++ << ", ";
-        }
-        curve_loop << *loop_iter;
-        std::string loop_string = curve_loop.str();
-        // Curve Loop(1) = {12, -3, -11, -9};
-        gf_geometry_file    << "Curve Loop("  << cl_iter->first
-                            << ") = {"
-                            << loop_string
-                            << "};"     << "\n";
-        cl_iter++;
-    }
-    gf_geometry_file << "// ======================== PLANE SURFACES ========================" << "\n";
-    auto pls_iter     = plane_surfaces_map.begin();
-    auto pls_iter_end = plane_surfaces_map.end();
-    while (pls_iter != pls_iter_end)
-    {
-        // Plane Surface(16) = {16};
-        gf_geometry_file    << "Plane Surface("  << pls_iter->first
-                            << ") = {"
-                            << pls_iter->second
-                            << "};"     << "\n";
-        pls_iter++;
-    }
-    gf_geometry_file << "// ======================== SURFACE LOOPS =========================" << "\n";
-    auto sl_iter     = surface_loops_map.begin();
-    auto sl_iter_end = surface_loops_map.end();
-    while (sl_iter != sl_iter_end)
-    {
-        std::ostringstream surface_loop;
-        auto inside_loop_iter       = sl_iter->second.begin();
-        auto inside_loop_iter_last  = --sl_iter->second.end();
-        while (inside_loop_iter != inside_loop_iter_last)
-        {
-            surface_loop << *inside_loop_iter++ << ", ";
-        }
-        surface_loop << *inside_loop_iter;
-        std::string sl_string = surface_loop.str();
-        gf_geometry_file    << "Surface Loop("  << sl_iter->first
-                            << ") = {"
-                            << sl_string
-                            << "};"     << "\n";
-        sl_iter++;
-    }
-    gf_geometry_file << "// =========================== VOLUMES ============================" << "\n";
-    //Volume(1) = {1};
-    auto vol_iter     = volumes_map.begin();
-    auto vol_iter_end = volumes_map.end();
-    while (vol_iter != vol_iter_end)
-    {
-        gf_geometry_file    << "Volume("  << vol_iter->first
-                            << ") = {"
-                            << vol_iter->second
-                            << "};"     << "\n";
-        vol_iter++;
-    }
-    gf_geometry_file << "// ======================= PHYSICAL POINTS ========================" << "\n";
-    auto pp_iter        = physical_points_map.begin();
-    auto pp_iter_end    = physical_points_map.end();
-    while (pp_iter != pp_iter_end)
-    {
-        std::ostringstream pp_loop;
-        auto pp_inside_loop_iter       = pp_iter->second.begin();
-        auto pp_inside_loop_iter_last  = --pp_iter->second.end();
-        while (pp_inside_loop_iter != pp_inside_loop_iter_last)
-        {
-            pp_loop << *pp_inside_loop_iter++ << ", ";
-        }
-        pp_loop << *pp_inside_loop_iter;
-        std::string pp_string = pp_loop.str();
-        gf_geometry_file    << "Physical Point(\""  << pp_iter->first
-                            << "\") = {"
-                            << pp_string
-                            << "};"     << "\n";
-        pp_iter++;
-    }
-    gf_geometry_file << "// ======================= PHYSICAL CURVES ========================" << "\n";
-    auto pc_iter        = physical_curves_map.begin();
-    auto pc_iter_end    = physical_curves_map.end();
-    while (pc_iter != pc_iter_end)
-    {
-        std::ostringstream pc_loop;
-        auto pc_inside_loop_iter       = pc_iter->second.begin();
-        auto pc_inside_loop_iter_last  = --pc_iter->second.end();
-        while (pc_inside_loop_iter != pc_inside_loop_iter_last)
-        {
-            pc_loop << *pc_inside_loop_iter++ << ", ";
-        }
-        pc_loop << *pc_inside_loop_iter;
-        std::string pc_string = pc_loop.str();
-        gf_geometry_file    << "Physical Curve(\""  << pc_iter->first
-                            << "\") = {"
-                            << pc_string
-                            << "};"     << "\n";
-        pc_iter++;
-    }
-    gf_geometry_file << "// ====================== PHYSICAL SURFACES =======================" << "\n";
-    auto ps_iter        = physical_surfaces_map.begin();
-    auto ps_iter_end    = physical_surfaces_map.end();
-    while (ps_iter != ps_iter_end)
-    {
-        std::ostringstream ps_loop;
-        auto ps_inside_loop_iter       = ps_iter->second.begin();
-        auto ps_inside_loop_iter_last  = --ps_iter->second.end();
-        while (ps_inside_loop_iter != ps_inside_loop_iter_last)
-        {
-            ps_loop << *ps_inside_loop_iter++ << ", ";
-        }
-        ps_loop << *ps_inside_loop_iter;
-        std::string ps_string = ps_loop.str();
-        gf_geometry_file    << "Physical Surface(\""  << ps_iter->first
-                            << "\") = {"
-                            << ps_string
-                            << "};"     << "\n";
-        ps_iter++;
-    }
-    gf_geometry_file << "// ====================== PHYSICAL VOLUMES ========================" << "\n";
-    auto pv_iter        = physical_volumes_map.begin();
-    auto pv_iter_end    = physical_volumes_map.end();
-    while (pv_iter != pv_iter_end)
-    {
-        std::ostringstream pv_loop;
-        auto pv_inside_loop_iter       = pv_iter->second.begin();
-        auto pv_inside_loop_iter_last  = --pv_iter->second.end();
-        while (pv_inside_loop_iter != pv_inside_loop_iter_last)
-        {
-            pv_loop << *pv_inside_loop_iter++ << ", ";
-        }
-        pv_loop << *pv_inside_loop_iter;
-        std::string pv_string = pv_loop.str();
-        gf_geometry_file    << "Physical Volume(\""  << pv_iter->first
-                            << "\") = {"
-                            << pv_string
-                            << "};"     << "\n";
-        pv_iter++;
-    }
-    if(bool_diff_rest==true)
-    {
-        gf_geometry_file << "BooleanDifference{ Volume{1}; Delete; }{\n";
-        auto vol_start = std::next(volumes_map.begin(),1);
-        auto vol_end = volumes_map.end();
-        int vol_count = 0;
-        for(auto vol_it = vol_start; vol_it!=vol_end;vol_it++)
-        {
-            vol_count = std::distance(volumes_map.begin(),vol_it)+1;
-            gf_geometry_file << "Volume{"<<vol_count<<"};\n";
-        }
-        gf_geometry_file << "Delete; }\n";
+    std::ofstream gf_geometry_file(export_path, std::ios::out | std::ios::binary);
+    if (!gf_geometry_file.is_open())
+    {
+        std::cout << "Error: Unable to open \"" << export_path << "\"." << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto header_section = [&]() {
+        geo_text text;
+        write_geo_header(text, is_open_cascade);
+        return text;
+    };
+    auto points_section = [&]() {
+        geo_text text;
+        text.reserve(points.size()*64);
+        text << "// ============================ POINTS ============================\n";
+        for (int id = points.first_id(); id != 0; id = points.next_id(id))
+        {
+            const point &p = points[id];
+            text << "Point(" << id << ") = {" << p.x << ", " << p.y << ", " << p.z;
+            if( (ignore_char_len==false) && (p.char_len != 0) )
+                text << ", " << p.char_len;
+            text << "};\n";
+        }
+        return text;
+    };
+    auto lines_section = [&]() {
+        geo_text text;
+        text.reserve(lines.size()*32);
+        text << "// ============================ LINES =============================\n";
+        for (int id = lines.first_id(); id != 0; id = lines.next_id(id))
+            text << "Line(" << id << ") = {" << lines[id].start << ", " << lines[id].end << "};\n";
+        return text;
+    };
+    auto curve_loops_section = [&]() {
+        geo_text text;
+        text.reserve(curve_loops.size()*48);
+        text << "// ========================= CURVE LOOPS ==========================\n";
+        for (int id = curve_loops.first_id(); id != 0; id = curve_loops.next_id(id))
+            text << "Curve Loop(" << id << ") = {" << curve_loops[id] << "};\n";
+        return text;
+    };
+    auto surfaces_section = [&]() {
+        geo_text text;
+        text.reserve(plane_surfaces.size()*32);
+        text << "// ======================== PLANE SURFACES ========================\n";
+        for (int id = plane_surfaces.first_id(); id != 0; id = plane_surfaces.next_id(id))
+            text << "Plane Surface(" << id << ") = {" << plane_surfaces[id] << "};\n";
+        return text;
+    };
+    auto volumes_section = [&]() {
+        geo_text text;
+        text << "// ======================== SURFACE LOOPS =========================\n";
+        for (int id = surface_loops.first_id(); id != 0; id = surface_loops.next_id(id))
+            text << "Surface Loop(" << id << ") = {" << surface_loops[id] << "};\n";
+        text << "// =========================== VOLUMES ============================\n";
+        for (int id = volumes.first_id(); id != 0; id = volumes.next_id(id))
+            text << "Volume(" << id << ") = {" << volumes[id] << "};\n";
+        return text;
+    };
+    auto physical_section = [&]() {
+        geo_text text;
+        auto add_groups = [&](const std::string_view &heading, const std::string_view &keyword,
+                              const std::map<std::string, std::vector<int>> &groups) {
+            text << heading;
+            for (auto group_it = groups.begin(); group_it != groups.end(); group_it++)
+                text << keyword << "(\"" << group_it->first << "\") = {" << group_it->second << "};\n";
+        };
+        add_groups("// ======================= PHYSICAL POINTS ========================\n",
+                   "Physical Point", physical_points_map);
+        add_groups("// ======================= PHYSICAL CURVES ========================\n",
+                   "Physical Curve", physical_curves_map);
+        add_groups("// ====================== PHYSICAL SURFACES =======================\n",
+                   "Physical Surface", physical_surfaces_map);
+        add_groups("// ====================== PHYSICAL VOLUMES ========================\n",
+                   "Physical Volume", physical_volumes_map);
+        if(bool_diff_rest==true)
+        {
+            text << "BooleanDifference{ Volume{1}; Delete; }{\n";
+            for(int vol_count = 2; vol_count <= (int)volumes.size(); vol_count++)
+                text << "Volume{" << vol_count << "};\n";
+            text << "Delete; }\n";
+        }
+        return text;
+    };
+    size_t entity_count = points.size() + lines.size() + curve_loops.size() + plane_surfaces.size();
+    std::launch policy = (entity_count>=PARALLEL_EXPORT_ENTITIES) ? std::launch::async : std::launch::deferred;
+    std::vector<std::future<geo_text>> sections;
+    sections.push_back(std::async(policy, header_section));
+    sections.push_back(std::async(policy, points_section));
+    sections.push_back(std::async(policy, lines_section));
+    sections.push_back(std::async(policy, curve_loops_section));
+    sections.push_back(std::async(policy, surfaces_section));
+    sections.push_back(std::async(policy, volumes_section));
+    sections.push_back(std::async(policy, physical_section));
+    for (auto section_it = sections.begin(); section_it != sections.end(); section_it++)
+    {
+        geo_text text = section_it->get();
+        gf_geometry_file.write(text.str().data(), text.size());
     }
     gf_geometry_file.close();
+    if (gf_geometry_file.fail())
+    {
+        std::cout << "Error: Unable to write \"" << export_path << "\"." << std::endl;
+        return EXIT_FAILURE;
+    }
     return EXIT_SUCCESS;
 }
 
-// Shift higher indices into sequential gaps to remove gaps from data.
+// Closes the gaps in the IDs of every entity kind. Each kind gets one remap
+// from a running count of the IDs in use, applied to its table in place and
+// to every reference into it in a single pass, so the cost is linear in the
+// size of the file.
 int GEO::geofile::simplify_data()
 {
-    if (points_map.empty())
+    if (points.empty())
     {
         std::cout   << "Error: No points detected. Have you imported a .geo file?"
                     << std::endl;
@@ -762,27 +890,27 @@ int GEO::geofile::simplify_element(int &current_status)
     switch (current_status)
     {
     case 0:
-        if(!points_map.empty())
+        if(!points.empty())
             simplify_points();
         break;
     case 1:
-        if(!lines_map.empty())
+        if(!lines.empty())
             simplify_lines();
         break;
     case 2:
-        if(!curve_loops_map.empty())
+        if(!curve_loops.empty())
             simplify_curve_loops();
         break;
     case 3:
-        if(!plane_surfaces_map.empty())
+        if(!plane_surfaces.empty())
             simplify_plane_surfaces();
         break;
     case 4:
-        if(!surface_loops_map.empty())
+        if(!surface_loops.empty())
             simplify_surface_loops();
         break;
     case 5:
-        if(!volumes_map.empty())
+        if(!volumes.empty())
             simplify_volumes();
         break;
     default:
@@ -794,480 +922,112 @@ int GEO::geofile::simplify_element(int &current_status)
     return EXIT_SUCCESS;
 }
 
-void GEO::geofile::perform_shift(   std::set<int> &gaps,
-                                    std::set<int> &numbers,
-                                    std::map<int, int>  &changes)
-{
-    auto a = numbers.begin();
-    auto b = gaps.begin();
-    while ((!gaps.empty())&&(*gaps.begin() < *std::prev(numbers.end(),1) ))
-    {
-        if (*a > *b)
-        {
-            int num_hold = *a;
-            int gap_hold = *b;
-            gaps.erase(gaps.find(gap_hold));
-            numbers.erase(numbers.find(num_hold));
-            gaps.insert(num_hold);
-            numbers.insert(gap_hold);
-            changes.insert({num_hold,gap_hold});
-            //reassess lowest point and gap
-            a = numbers.begin();
-            b = gaps.begin();
-        }
-        else
-        {
-            a++;
-        }
-    }
-}
-
 int GEO::geofile::simplify_points()
 {
-    std::set<int>       gaps;
-    std::set<int>       numbers;
-    std::map<int, int>  changes;
-    // Store all gaps
-    // before start
-    if (points_map.begin()->first>1)
-    {
-        int total_pre_gaps = points_map.begin()->first - 1;
-        for (size_t i = 1; i <= total_pre_gaps; i++)
-        {
-            gaps.insert(i);
-        }
-    }
-    auto point_it_end   = std::prev(points_map.end(),1);
-    for (auto point_it = points_map.begin(); point_it!=point_it_end; point_it++)
-    {
-        auto look_ahead = std::next(point_it,1);
-        for (int i = point_it->first+1; i < look_ahead->first; i++)
-        {
-            gaps.insert(i);
-        }
-    }
-    if (!gaps.empty())
-    {
-        // Store all non-gaps
-        point_it_end = points_map.end();
-        for (auto point_it = points_map.begin(); point_it != point_it_end; point_it++)
-        {
-            numbers.insert(point_it->first);
-        }
-        perform_shift(gaps, numbers, changes);
-        return adjust_points(changes);
-    }
+    std::vector<int> new_ids = points.gapless_ids();
+    if (!new_ids.empty())
+        return adjust_points(new_ids);
     return EXIT_SUCCESS;
 }
 
-int GEO::geofile::adjust_points(std::map<int,int> changes)
+// Renumbers the points and adjusts dependencies to mirror the changes.
+int GEO::geofile::adjust_points(const std::vector<int> &new_ids)
 {
-    auto change_end = changes.end();
-    for (auto i = changes.begin(); i != change_end; i++)
-    {
-        auto nodeHandler = points_map.extract(i->first);
-        if(!nodeHandler.empty())
-            {
-                nodeHandler.key() = i->second;
-                points_map.insert(std::move(nodeHandler));
-            }
-    }
-    // Adjust dependencies to mirror the changes.
+    points.renumber(new_ids);
     //Lines
-    auto l_m_end  = lines_map.end();
-    for (auto l_it = lines_map.begin(); l_it != l_m_end; l_it++)
+    for (int id = lines.first_id(); id != 0; id = lines.next_id(id))
     {
-        for (auto i = changes.begin(); i != change_end; i++)
-        {
-            if (l_it->second.start == i->first)
-                l_it->second.start = i->second;
-            if (l_it->second.end == i->first)
-                l_it->second.end = i->second;
-        }
+        redirect(lines[id].start, new_ids);
+        redirect(lines[id].end, new_ids);
     }
     //Physical points
-    auto phys_p_end = physical_points_map.end();
-    for (auto phys_p_it = physical_points_map.begin(); phys_p_it != phys_p_end; phys_p_it++)
-    {
-        for (auto i = changes.begin(); i != change_end; i++)
-        {
-            auto vector_it_end = phys_p_it->second.end();
-            for (auto vector_it = phys_p_it->second.begin(); vector_it != vector_it_end; vector_it++)
-            {
-                if(*vector_it==i->first)
-                    *vector_it=i->second;
-            }
-        }
-    }
+    redirect_physical(physical_points_map, new_ids);
     return EXIT_SUCCESS;
 }
 
 int GEO::geofile::simplify_lines()
 {
-    std::set<int>       gaps;
-    std::set<int>       numbers;
-    std::map<int, int>  changes;
-    // Store all gaps
-    // before start
-    if (lines_map.begin()->first>1)
-    {
-        int total_pre_gaps = lines_map.begin()->first - 1;
-        for (size_t i = 1; i <= total_pre_gaps; i++)
-        {
-            gaps.insert(i);
-        }
-    }
-    // after start
-    auto line_it_end   = std::prev(lines_map.end(),1);
-    for (auto line_it = lines_map.begin(); line_it!=line_it_end; line_it++)
-    {
-        auto look_ahead = std::next(line_it,1);
-        for (int i = line_it->first+1; i < look_ahead->first; i++)
-        {
-            gaps.insert(i);
-        }
-    }
-    if (!gaps.empty())
-    {
-        // Store all non-gaps
-        line_it_end = lines_map.end();
-        for (auto line_it = lines_map.begin(); line_it != line_it_end; line_it++)
-        {
-            numbers.insert(line_it->first);
-        }
-        perform_shift(gaps, numbers, changes);
-        return adjust_lines(changes);
-    }
+    std::vector<int> new_ids = lines.gapless_ids();
+    if (!new_ids.empty())
+        return adjust_lines(new_ids);
     return EXIT_SUCCESS;
 }
 
-int GEO::geofile::adjust_lines(std::map<int,int> changes)
+int GEO::geofile::adjust_lines(const std::vector<int> &new_ids)
 {
-    auto change_end = changes.end();
-    for (auto i = changes.begin(); i != change_end; i++)
-    {
-        auto nodeHandler = lines_map.extract(i->first);
-        if(!nodeHandler.empty())
-        {
-            nodeHandler.key() = i->second;
-            lines_map.insert(std::move(nodeHandler));
-        }
-    }
-    // Adjust dependencies to mirror the changes.
-    // Curve loops
-    auto c_l_m_end  = curve_loops_map.end();
-    for (auto c_l_m_it = curve_loops_map.begin(); c_l_m_it != c_l_m_end; c_l_m_it++)
-    {
-        for (auto i = changes.begin(); i != change_end; i++)
-        {
-            auto vec_end = c_l_m_it->second.end();
-            for (auto j = c_l_m_it->second.begin(); j != vec_end; j++)
-            {
-                if(*j==i->first)
-                    *j=i->second;
-                if(*j==-i->first)
-                    *j=-i->second;
-            }
-        }
-    }
+    lines.renumber(new_ids);
+    // Curve loops, members are signed by direction
+    redirect_all(curve_loops.members(), new_ids);
+    // Physical curves
+    redirect_physical(physical_curves_map, new_ids);
     return EXIT_SUCCESS;
 }
 
 int GEO::geofile::simplify_curve_loops()
 {
-    std::set<int>       gaps;
-    std::set<int>       numbers;
-    std::map<int, int>  changes;
-    // Store all gaps
-    // before start
-    if (curve_loops_map.begin()->first>1)
-    {
-        int total_pre_gaps = curve_loops_map.begin()->first - 1;
-        for (size_t i = 1; i <= total_pre_gaps; i++)
-        {
-            gaps.insert(i);
-        }
-    }
-    // after start
-    auto curve_loop_it_end   = std::prev(curve_loops_map.end(),1);
-    for (auto curve_loop_it = curve_loops_map.begin(); curve_loop_it!=curve_loop_it_end; curve_loop_it++)
-    {
-        auto look_ahead = std::next(curve_loop_it,1);
-        for (int i = curve_loop_it->first+1; i < look_ahead->first; i++)
-        {
-            gaps.insert(i);
-        }
-    }
-    if (!gaps.empty())
-    {
-        // Store all non-gaps
-        curve_loop_it_end = curve_loops_map.end();
-        for (auto curve_loop_it = curve_loops_map.begin(); curve_loop_it != curve_loop_it_end; curve_loop_it++)
-        {
-            numbers.insert(curve_loop_it->first);
-        }
-        perform_shift(gaps, numbers, changes);
-        return adjust_curve_loops(changes);
-    }
+    std::vector<int> new_ids = curve_loops.gapless_ids();
+    if (!new_ids.empty())
+        return adjust_curve_loops(new_ids);
     return EXIT_SUCCESS;
 }
 
-int GEO::geofile::adjust_curve_loops(std::map<int,int> changes)
+int GEO::geofile::adjust_curve_loops(const std::vector<int> &new_ids)
 {
-    auto change_end = changes.end();
-    for (auto i = changes.begin(); i != change_end; i++)
-    {
-        auto nodeHandler = curve_loops_map.extract(i->first);
-        if (!nodeHandler.empty())
-        {
-            nodeHandler.key() = i->second;
-            curve_loops_map.insert(std::move(nodeHandler));
-        }
-    }
-    // Adjust dependencies to mirror the changes.
+    curve_loops.renumber(new_ids);
     // Plane Surfaces
-    auto pl_sur_map_end  = plane_surfaces_map.end();
-    for (auto pl_sur_map_it = plane_surfaces_map.begin(); pl_sur_map_it != pl_sur_map_end; pl_sur_map_it++)
-    {
-        for (auto i = changes.begin(); i != change_end; i++)
-        {
-            // If plane surface references the original value
-            // Then change it to the new value
-            if(pl_sur_map_it->second==i->first)
-                pl_sur_map_it->second=i->second;
-        }
-    }
-    // Physical curves
-    auto phys_s_end = physical_curves_map.end();
-    for (auto phys_s_it = physical_curves_map.begin(); phys_s_it != phys_s_end; phys_s_it++)
-    {
-        for (auto i = changes.begin(); i != change_end; i++)
-        {
-            auto vector_it_end = phys_s_it->second.end();
-            for (auto vector_it = phys_s_it->second.begin(); vector_it != vector_it_end; vector_it++)
-            {
-                if(*vector_it==i->first)
-                    *vector_it=i->second;
-            }
-        }
-    }
-    return EXIT_SUCCESS;
-}
-
-int GEO::geofile::simplify_plane_surfaces()
-{
-    std::set<int>       gaps;
-    std::set<int>       numbers;
-    std::map<int, int>  changes;
-    // Store all gaps
-    // before start
-    if (plane_surfaces_map.begin()->first>1)
-    {
-        int total_pre_gaps = plane_surfaces_map.begin()->first - 1;
-        for (size_t i = 1; i <= total_pre_gaps; i++)
-        {
-            gaps.insert(i);
-        }
-    }
-    // after start
-    auto plane_surface_it_end   = std::prev(plane_surfaces_map.end(),1);
-    for (auto pl_sur_it = plane_surfaces_map.begin(); pl_sur_it!=plane_surface_it_end; pl_sur_it++)
-    {
-        auto look_ahead = std::next(pl_sur_it,1);
-        for (int i = pl_sur_it->first+1; i < look_ahead->first; i++)
-        {
-            gaps.insert(i);
-        }
-    }
-    if (!gaps.empty())
-    {
-        // Store all non-gaps
-        plane_surface_it_end = plane_surfaces_map.end();
-        for (auto pl_sur_it = plane_surfaces_map.begin(); pl_sur_it != plane_surface_it_end; pl_sur_it++)
-        {
-            numbers.insert(pl_sur_it->first);
-        }
-        perform_shift(gaps, numbers, changes);
-        return adjust_plane_surfaces(changes);
-    }
+    for (int id = plane_surfaces.first_id(); id != 0; id = plane_surfaces.next_id(id))
+        redirect(plane_surfaces[id], new_ids);
     return EXIT_SUCCESS;
 }
 
-int GEO::geofile::adjust_plane_surfaces(std::map<int,int> changes)
+int GEO::geofile::simplify_plane_surfaces()
 {
-    auto change_end = changes.end();
-    for (auto i = changes.begin(); i != change_end; i++)
-    {
-        auto nodeHandler = plane_surfaces_map.extract(i->first);
-        if(!nodeHandler.empty())
-        {
-            nodeHandler.key() = i->second;
-            plane_surfaces_map.insert(std::move(nodeHandler));
-        }
-    }
-    // Adjust dependencies to mirror the changes.
+    std::vector<int> new_ids = plane_surfaces.gapless_ids();
+    if (!new_ids.empty())
+        return adjust_plane_surfaces(new_ids);
+    return EXIT_SUCCESS;
+}
+
+int GEO::geofile::adjust_plane_surfaces(const std::vector<int> &new_ids)
+{
+    plane_surfaces.renumber(new_ids);
     // Surface Loops
-    auto sur_loop_map_end  = surface_loops_map.end();
-    for (auto sur_loop_map_it = surface_loops_map.begin(); sur_loop_map_it != sur_loop_map_end; sur_loop_map_it++)
-    {
-        for (auto i = changes.begin(); i != change_end; i++)
-        {
-            auto vector_it_end = sur_loop_map_it->second.end();
-            for (auto vector_it = sur_loop_map_it->second.begin(); vector_it != vector_it_end; vector_it++)
-            {
-                if(*vector_it==i->first)
-                    *vector_it=i->second;
-            }
-        }
-    }
+    redirect_all(surface_loops.members(), new_ids);
     // Physical surfaces
-    auto phys_sur_end = physical_surfaces_map.end();
-    for (auto phys_sur_it = physical_surfaces_map.begin(); phys_sur_it != phys_sur_end; phys_sur_it++)
-    {
-        for (auto i = changes.begin(); i != change_end; i++)
-        {
-            auto vector_it_end = phys_sur_it->second.end();
-            for (auto vector_it = phys_sur_it->second.begin(); vector_it != vector_it_end; vector_it++)
-            {
-                if(*vector_it==i->first)
-                    *vector_it=i->second;
-            }
-        }
-    }
+    redirect_physical(physical_surfaces_map, new_ids);
     return EXIT_SUCCESS;
 }
 
 int GEO::geofile::simplify_surface_loops()
 {
-    std::set<int>       gaps;
-    std::set<int>       numbers;
-    std::map<int, int>  changes;
-    // Store all gaps
-    // before start
-    if (surface_loops_map.begin()->first>1)
-    {
-        int total_pre_gaps = surface_loops_map.begin()->first - 1;
-        for (size_t i = 1; i <= total_pre_gaps; i++)
-        {
-            gaps.insert(i);
-        }
-    }
-    // after start
-    auto surf_loop_end   = std::prev(surface_loops_map.end(),1);
-    for (auto sur_loop_it = surface_loops_map.begin(); sur_loop_it!=surf_loop_end; sur_loop_it++)
-    {
-        auto look_ahead = std::next(sur_loop_it,1);
-        for (int i = sur_loop_it->first+1; i < look_ahead->first; i++)
-        {
-            gaps.insert(i);
-        }
-    }
-    if (!gaps.empty())
-    {
-        // Store all non-gaps
-        surf_loop_end = surface_loops_map.end();
-        for (auto sur_loop_it = surface_loops_map.begin(); sur_loop_it != surf_loop_end; sur_loop_it++)
-        {
-            numbers.insert(sur_loop_it->first);
-        }
-        perform_shift(gaps, numbers, changes);
-        return adjust_surface_loops(changes);
-    }
+    std::vector<int> new_ids = surface_loops.gapless_ids();
+    if (!new_ids.empty())
+        return adjust_surface_loops(new_ids);
     return EXIT_SUCCESS;
 }
 
-int GEO::geofile::adjust_surface_loops(std::map<int,int> changes)
+int GEO::geofile::adjust_surface_loops(const std::vector<int> &new_ids)
 {
-    auto change_end = changes.end();
-    for (auto i = changes.begin(); i != change_end; i++)
-    {
-        auto nodeHandler = surface_loops_map.extract(i->first);
-        if(!nodeHandler.empty())
-        {
-            nodeHandler.key() = i->second;
-            surface_loops_map.insert(std::move(nodeHandler));
-        }
-    }
-    // Adjust dependencies to mirror the changes.
+    surface_loops.renumber(new_ids);
     // Volumes
-    auto vol_map_end  = volumes_map.end();
-    for (auto vol_map_it = volumes_map.begin(); vol_map_it != vol_map_end; vol_map_it++)
-    {
-        for (auto i = changes.begin(); i != change_end; i++)
-        {
-            if(vol_map_it->second==i->first)
-                vol_map_it->second=i->second;
-        }
-    }
+    for (int id = volumes.first_id(); id != 0; id = volumes.next_id(id))
+        redirect(volumes[id], new_ids);
     return EXIT_SUCCESS;
 }
 
 int GEO::geofile::simplify_volumes()
 {
-    std::set<int>       gaps;
-    std::set<int>       numbers;
-    std::map<int, int>  changes;
-    // Store all gaps
-    // before start
-    if (volumes_map.begin()->first>1)
-    {
-        int total_pre_gaps = volumes_map.begin()->first - 1;
-        for (size_t i = 1; i <= total_pre_gaps; i++)
-        {
-            gaps.insert(i);
-        }
-    }
-    // after start
-    auto volumes_map_end = std::prev(volumes_map.end(),1);
-    for (auto vol_map_it = volumes_map.begin(); vol_map_it != volumes_map_end; vol_map_it++)
-    {
-        auto look_ahead = std::next(vol_map_it,1);
-        for (int i = vol_map_it->first+1; i < look_ahead->first; i++)
-        {
-            gaps.insert(i);
-        }
-    }
-    if (!gaps.empty())
-    {
-        // Store all non-gaps
-        volumes_map_end = volumes_map.end();
-        for (auto vol_map_it = volumes_map.begin(); vol_map_it != volumes_map_end; vol_map_it++)
-        {
-            numbers.insert(vol_map_it->first);
-        }
-        perform_shift(gaps, numbers, changes);
-        return adjust_volumes(changes);
-    }
+    std::vector<int> new_ids = volumes.gapless_ids();
+    if (!new_ids.empty())
+        return adjust_volumes(new_ids);
     return EXIT_SUCCESS;
 }
 
-int GEO::geofile::adjust_volumes(std::map<int,int> changes)
+int GEO::geofile::adjust_volumes(const std::vector<int> &new_ids)
 {
-    auto change_end = changes.end();
-    for (auto i = changes.begin(); i != change_end; i++)
-    {
-        auto nodeHandler = volumes_map.extract(i->first);
-        if(!nodeHandler.empty())
-        {
-            nodeHandler.key() = i->second;
-            volumes_map.insert(std::move(nodeHandler));
-        }
-    }
-    // Adjust dependencies to mirror the changes.
+    volumes.renumber(new_ids);
     // Physical volumes
-    auto phys_vol_map_end  = physical_volumes_map.end();
-    for (auto phys_vol_map_it = physical_volumes_map.begin(); phys_vol_map_it != phys_vol_map_end; phys_vol_map_it++)
-    {
-        for (auto i = changes.begin(); i != change_end; i++)
-        {
-            auto vector_it_end = phys_vol_map_it->second.end();
-            for (auto vector_it = phys_vol_map_it->second.begin(); vector_it != vector_it_end; vector_it++)
-            {
-                if(*vector_it==i->first)
-                    *vector_it=i->second;
-            }
-        }
-    }
+    redirect_physical(physical_volumes_map, new_ids);
     return EXIT_SUCCESS;
 }
 
@@ -1278,17 +1038,17 @@ int GEO::geofile::merge_with(geofile &secondary_file)
     secondary_file.make_coherent(true);
     simplify_data();
     secondary_file.simplify_data();
-    if(!secondary_file.points_map.empty())
+    if(!secondary_file.points.empty())
         merge_points(secondary_file);
-    if(!secondary_file.lines_map.empty())
+    if(!secondary_file.lines.empty())
         merge_lines(secondary_file);
-    if(!secondary_file.curve_loops_map.empty())
+    if(!secondary_file.curve_loops.empty())
         merge_curve_loops(secondary_file);
-    if(!secondary_file.plane_surfaces_map.empty())
+    if(!secondary_file.plane_surfaces.empty())
         merge_plane_surfaces(secondary_file);
-    if(!secondary_file.surface_loops_map.empty())
+    if(!secondary_file.surface_loops.empty())
         merge_surface_loops(secondary_file);
-    if(!secondary_file.volumes_map.empty())
+    if(!secondary_file.volumes.empty())
         merge_volumes(secondary_file);
     merge_physical_entities(secondary_file);
     make_coherent(true);
@@ -1299,18 +1059,7 @@ int GEO::geofile::merge_with(geofile &secondary_file)
 // For when you know there will be no conflicts. Simply appent map 2 to map 1
 int GEO::geofile::quick_merge_with(geofile &secondary_file)
 {
-    points_map.insert(              secondary_file.points_map.begin(),
-                                    secondary_file.points_map.end() );
-    lines_map.insert(               secondary_file.lines_map.begin(),
-                                    secondary_file.lines_map.end() );
-    curve_loops_map.insert(         secondary_file.curve_loops_map.begin(),
-                                    secondary_file.curve_loops_map.end() );
-    plane_surfaces_map.insert(      secondary_file.plane_surfaces_map.begin(),
-                                    secondary_file.plane_surfaces_map.end() );
-    surface_loops_map.insert(       secondary_file.surface_loops_map.begin(),
-                                    secondary_file.surface_loops_map.end() );
-    volumes_map.insert(             secondary_file.volumes_map.begin(),
-                                    secondary_file.volumes_map.end() );
+    insert_entities(secondary_file);
     physical_points_map.insert(     secondary_file.physical_points_map.begin(),
                                     secondary_file.physical_points_map.end() );
     physical_curves_map.insert(     secondary_file.physical_curves_map.begin(),
@@ -1322,194 +1071,199 @@ int GEO::geofile::quick_merge_with(geofile &secondary_file)
     return EXIT_SUCCESS;
 }
 
+// Copies the elementary entities of other under their own IDs. IDs already
+// in use keep the entity of this file.
+void GEO::geofile::insert_entities(const geofile &other)
+{
+    for (int id = other.points.first_id(); id != 0; id = other.points.next_id(id))
+        points.insert(id, other.points[id]);
+    for (int id = other.lines.first_id(); id != 0; id = other.lines.next_id(id))
+        lines.insert(id, other.lines[id]);
+    for (int id = other.curve_loops.first_id(); id != 0; id = other.curve_loops.next_id(id))
+        curve_loops.insert(id, other.curve_loops[id].first, other.curve_loops[id].count);
+    for (int id = other.plane_surfaces.first_id(); id != 0; id = other.plane_surfaces.next_id(id))
+        plane_surfaces.insert(id, other.plane_surfaces[id]);
+    for (int id = other.surface_loops.first_id(); id != 0; id = other.surface_loops.next_id(id))
+        surface_loops.insert(id, other.surface_loops[id].first, other.surface_loops[id].count);
+    for (int id = other.volumes.first_id(); id != 0; id = other.volumes.next_id(id))
+        volumes.insert(id, other.volumes[id]);
+}
+
+GEO::id_extents GEO::geofile::highest_ids() const
+{
+    return {points.last_id(), lines.last_id(), curve_loops.last_id(),
+            plane_surfaces.last_id(), surface_loops.last_id(), volumes.last_id()};
+}
+
+// Adds offsets to every ID of each kind and moves the references with them.
+void GEO::geofile::offset_ids(const id_extents &offsets)
+{
+    auto shifted_ids = [](const int &last_id, const int &offset) {
+        std::vector<int> new_ids = identity_ids(last_id+1);
+        for (int id = 1; id <= last_id; id++)
+            new_ids[id] += offset;
+        return new_ids;
+    };
+    if (offsets.points!=0)
+        adjust_points(shifted_ids(points.last_id(), offsets.points));
+    if (offsets.lines!=0)
+        adjust_lines(shifted_ids(lines.last_id(), offsets.lines));
+    if (offsets.curve_loops!=0)
+        adjust_curve_loops(shifted_ids(curve_loops.last_id(), offsets.curve_loops));
+    if (offsets.plane_surfaces!=0)
+        adjust_plane_surfaces(shifted_ids(plane_surfaces.last_id(), offsets.plane_surfaces));
+    if (offsets.surface_loops!=0)
+        adjust_surface_loops(shifted_ids(surface_loops.last_id(), offsets.surface_loops));
+    if (offsets.volumes!=0)
+        adjust_volumes(shifted_ids(volumes.last_id(), offsets.volumes));
+}
+
+// Adds a file whose IDs do not overlap with those of this one. Physical
+// groups of the same name are joined.
+void GEO::geofile::absorb(geofile &other)
+{
+    insert_entities(other);
+    merge_physical_entities(other);
+    if (other.is_open_cascade==true)
+        is_open_cascade = true;
+}
+
+// Merges any number of files into files[0]. The highest IDs of the files
+// are summed into offsets that give every file its own ID range, the files
+// are shifted concurrently and then joined pairwise in a tree, each level's
+// joins running concurrently. Coherence and simplification run once, on
+// the merged result.
+int GEO::merge_geofiles(std::vector<geofile> &files)
+{
+    if (files.empty())
+        return EXIT_FAILURE;
+    std::vector<id_extents> offsets(files.size());
+    for (size_t k = 1; k < files.size(); k++)
+    {
+        id_extents extent = files[k-1].highest_ids();
+        offsets[k].points = offsets[k-1].points + extent.points;
+        offsets[k].lines = offsets[k-1].lines + extent.lines;
+        offsets[k].curve_loops = offsets[k-1].curve_loops + extent.curve_loops;
+        offsets[k].plane_surfaces = offsets[k-1].plane_surfaces + extent.plane_surfaces;
+        offsets[k].surface_loops = offsets[k-1].surface_loops + extent.surface_loops;
+        offsets[k].volumes = offsets[k-1].volumes + extent.volumes;
+    }
+    std::vector<std::future<void>> jobs;
+    for (size_t k = 1; k < files.size(); k++)
+        jobs.push_back(std::async(std::launch::async, [&files, &offsets, k]() {
+            files[k].offset_ids(offsets[k]);
+        }));
+    for (auto job_it = jobs.begin(); job_it != jobs.end(); job_it++)
+        job_it->get();
+    for (size_t stride = 1; stride < files.size(); stride *= 2)
+    {
+        jobs.clear();
+        for (size_t k = 0; k + stride < files.size(); k += 2*stride)
+            jobs.push_back(std::async(std::launch::async, [&files, k, stride]() {
+                files[k].absorb(files[k+stride]);
+                files[k+stride] = geofile();
+            }));
+        for (auto job_it = jobs.begin(); job_it != jobs.end(); job_it++)
+            job_it->get();
+    }
+    files[0].make_coherent(true);
+    return files[0].simplify_data();
+}
+
+// The merge functions move the primary entities out of the IDs used by the
+// secondary file and then copy the secondary entities in under their own IDs.
 int GEO::geofile::merge_points(geofile &secondary_file)
 {
-    if (!points_map.empty())
+    const entity_table<point> &other = secondary_file.points;
+    if (!points.empty())
     {
-        int lowest_secondary    = secondary_file.points_map.begin()->first;
-        int highest_primary     = std::prev(points_map.end())->first;
-        int delta               = highest_primary - lowest_secondary + 1;
-        std::map <int,int> changes;
-        auto sec_point_map_end = secondary_file.points_map.end();
-        for (   auto sec_point_map_it = secondary_file.points_map.begin();
-                sec_point_map_it != sec_point_map_end;
-                sec_point_map_it++)
-        {
-            changes.insert({ sec_point_map_it->first,
-                            sec_point_map_it->first + delta});
-        }
-        adjust_points(changes);
-        sec_point_map_end = secondary_file.points_map.end();
-        for (   auto sec_point_map_it = secondary_file.points_map.begin();
-                sec_point_map_it != sec_point_map_end;
-                sec_point_map_it++)
-        {
-            points_map.insert({sec_point_map_it->first,sec_point_map_it->second});
-        }
+        adjust_points(merge_shift(points, other));
+        for (int id = other.first_id(); id != 0; id = other.next_id(id))
+            points.insert(id, other[id]);
     }
     else
     {
-        points_map = secondary_file.points_map;
+        points = other;
     }
     return EXIT_SUCCESS;
 }
 
 int GEO::geofile::merge_lines(geofile &secondary_file)
 {
-    if (!lines_map.empty())
+    const entity_table<line> &other = secondary_file.lines;
+    if (!lines.empty())
     {
-        int lowest_secondary    = secondary_file.lines_map.begin()->first;
-        int highest_primary     = std::prev(lines_map.end())->first;
-        int delta               = highest_primary - lowest_secondary + 1;
-        std::map <int,int> changes;
-        auto sec_lines_map_end = secondary_file.lines_map.end();
-        for (   auto sec_lines_map_it = secondary_file.lines_map.begin();
-                sec_lines_map_it != sec_lines_map_end;
-                sec_lines_map_it++)
-        {
-            changes.insert({ sec_lines_map_it->first,
-                            sec_lines_map_it->first + delta});
-        }
-        adjust_lines(changes);
-        sec_lines_map_end = secondary_file.lines_map.end();
-        for (   auto sec_lines_map_it = secondary_file.lines_map.begin();
-                sec_lines_map_it != sec_lines_map_end;
-                sec_lines_map_it++)
-        {
-            lines_map.insert({sec_lines_map_it->first,sec_lines_map_it->second});
-        }
+        adjust_lines(merge_shift(lines, other));
+        for (int id = other.first_id(); id != 0; id = other.next_id(id))
+            lines.insert(id, other[id]);
     }
     else
     {
-        lines_map = secondary_file.lines_map;
+        lines = other;
     }
     return EXIT_SUCCESS;
 }
 
 int GEO::geofile::merge_curve_loops(geofile &secondary_file)
 {
-    if (!curve_loops_map.empty())
+    const loop_table &other = secondary_file.curve_loops;
+    if (!curve_loops.empty())
     {
-        int lowest_secondary    = secondary_file.curve_loops_map.begin()->first;
-        int highest_primary     = std::prev(curve_loops_map.end())->first;
-        int delta               = highest_primary - lowest_secondary + 1;
-        std::map <int,int> changes;
-        auto sec_c_l_map_end = secondary_file.curve_loops_map.end();
-        for (   auto sec_c_l_it = secondary_file.curve_loops_map.begin();
-                sec_c_l_it != sec_c_l_map_end;
-                sec_c_l_it++)
-        {
-            changes.insert({ sec_c_l_it->first,
-                            sec_c_l_it->first + delta});
-        }
-        adjust_curve_loops(changes);
-        sec_c_l_map_end = secondary_file.curve_loops_map.end();
-        for (   auto sec_c_l_it = secondary_file.curve_loops_map.begin();
-                sec_c_l_it != sec_c_l_map_end;
-                sec_c_l_it++)
-        {
-            curve_loops_map.insert({sec_c_l_it->first,sec_c_l_it->second});
-        }
+        adjust_curve_loops(merge_shift(curve_loops, other));
+        for (int id = other.first_id(); id != 0; id = other.next_id(id))
+            curve_loops.insert(id, other[id].first, other[id].count);
     }
     else
     {
-        curve_loops_map = secondary_file.curve_loops_map;
+        curve_loops = other;
     }
     return EXIT_SUCCESS;
 }
 
 int GEO::geofile::merge_plane_surfaces(geofile &secondary_file)
 {
-    if (!plane_surfaces_map.empty())
+    const entity_table<int> &other = secondary_file.plane_surfaces;
+    if (!plane_surfaces.empty())
     {
-        int lowest_secondary    = secondary_file.plane_surfaces_map.begin()->first;
-        int highest_primary     = std::prev(plane_surfaces_map.end())->first;
-        int delta               = highest_primary - lowest_secondary + 1;
-        std::map <int,int> changes;
-        auto sec_pl_sur_map_end = secondary_file.plane_surfaces_map.end();
-        for (   auto sec_pl_sur_it = secondary_file.plane_surfaces_map.begin();
-                sec_pl_sur_it != sec_pl_sur_map_end;
-                sec_pl_sur_it++)
-        {
-            changes.insert({ sec_pl_sur_it->first,
-                            sec_pl_sur_it->first + delta});
-        }
-        adjust_plane_surfaces(changes);
-        sec_pl_sur_map_end = secondary_file.plane_surfaces_map.end();
-        for (   auto sec_pl_sur_it = secondary_file.plane_surfaces_map.begin();
-                sec_pl_sur_it != sec_pl_sur_map_end;
-                sec_pl_sur_it++)
-        {
-            plane_surfaces_map.insert({sec_pl_sur_it->first,sec_pl_sur_it->second});
-        }
+        adjust_plane_surfaces(merge_shift(plane_surfaces, other));
+        for (int id = other.first_id(); id != 0; id = other.next_id(id))
+            plane_surfaces.insert(id, other[id]);
     }
     else
     {
-        plane_surfaces_map = secondary_file.plane_surfaces_map;
+        plane_surfaces = other;
     }
     return EXIT_SUCCESS;
 }
 
 int GEO::geofile::merge_surface_loops(geofile &secondary_file)
 {
-    if (!surface_loops_map.empty())
+    const loop_table &other = secondary_file.surface_loops;
+    if (!surface_loops.empty())
     {
-        int lowest_secondary    = secondary_file.surface_loops_map.begin()->first;
-        int highest_primary     = std::prev(surface_loops_map.end())->first;
-        int delta               = highest_primary - lowest_secondary + 1;
-        std::map <int,int> changes;
-        auto sec_sur_loop_map_end = secondary_file.surface_loops_map.end();
-        for (   auto sec_sur_loop_it = secondary_file.surface_loops_map.begin();
-                sec_sur_loop_it != sec_sur_loop_map_end;
-                sec_sur_loop_it++)
-        {
-            changes.insert({ sec_sur_loop_it->first,
-                            sec_sur_loop_it->first + delta});
-        }
-        adjust_surface_loops(changes);
-        sec_sur_loop_map_end = secondary_file.surface_loops_map.end();
-        for (   auto sec_sur_loop_it = secondary_file.surface_loops_map.begin();
-                sec_sur_loop_it != sec_sur_loop_map_end;
-                sec_sur_loop_it++)
-        {
-            surface_loops_map.insert({sec_sur_loop_it->first,sec_sur_loop_it->second});
-        }
+        adjust_surface_loops(merge_shift(surface_loops, other));
+        for (int id = other.first_id(); id != 0; id = other.next_id(id))
+            surface_loops.insert(id, other[id].first, other[id].count);
     }
     else
     {
-        surface_loops_map = secondary_file.surface_loops_map;
+        surface_loops = other;
     }
     return EXIT_SUCCESS;
 }
 
 int GEO::geofile::merge_volumes(geofile &secondary_file)
 {
-    if (!volumes_map.empty())
+    const entity_table<int> &other = secondary_file.volumes;
+    if (!volumes.empty())
     {
-        int lowest_secondary    = secondary_file.volumes_map.begin()->first;
-        int highest_primary     = std::prev(volumes_map.end())->first;
-        int delta               = highest_primary - lowest_secondary + 1;
-        std::map <int,int> changes;
-        auto sec_vol_map_end = secondary_file.volumes_map.end();
-        for (   auto sec_vol_map_it = secondary_file.volumes_map.begin();
-                sec_vol_map_it != sec_vol_map_end;
-                sec_vol_map_it++)
-        {
-            changes.insert({ sec_vol_map_it->first,
-                            sec_vol_map_it->first + delta});
-        }
-        adjust_volumes(changes);
-        sec_vol_map_end = secondary_file.volumes_map.end();
-        for (   auto sec_vol_map_it = secondary_file.volumes_map.begin();
-                sec_vol_map_it != sec_vol_map_end;
-                sec_vol_map_it++)
-        {
-            volumes_map.insert({sec_vol_map_it->first,sec_vol_map_it->second});
-        }
+        adjust_volumes(merge_shift(volumes, other));
+        for (int id = other.first_id(); id != 0; id = other.next_id(id))
+            volumes.insert(id, other[id]);
     }
     else
     {
-        volumes_map = secondary_file.volumes_map;
+        volumes = other;
     }
     return EXIT_SUCCESS;
 }
@@ -1669,11 +1423,7 @@ int GEO::geofile::translate_data(   const double &delta_x,
 {
     make_coherent(true);
     simplify_data();
-    auto end = points_map.end();
-    for (auto i = points_map.begin(); i != end; i++)
-    {
-        translate_point(i->second, delta_x, delta_y, delta_z);
-    }
+    transform_data(translation(delta_x, delta_y, delta_z));
     return EXIT_SUCCESS;
 }
 
@@ -1693,11 +1443,7 @@ int GEO::geofile::rotate_data( const double &o_x,      const double &o_y,
 {
     make_coherent(true);
     simplify_data();
-    auto pm_end = points_map.end();
-    for (auto i = points_map.begin(); i != pm_end; i++)
-    {
-        rotate_point(o_x,o_y,o_z,theta_x,theta_y,theta_z,i->second);
-    }
+    transform_data(rotation(o_x, o_y, o_z, theta_x, theta_y, theta_z));
     return EXIT_SUCCESS;
 }
 
@@ -1705,122 +1451,36 @@ int GEO::geofile::scale_data(const double factor)
 {
     make_coherent(true);
     simplify_data();
-    auto pm_end = points_map.end();
-    for (auto i = points_map.begin(); i != pm_end; i++)
-    {
-        scale_point(i->second, factor);
-    }
+    transform_data(scaling(factor));
     return EXIT_SUCCESS;
 }
 
-void GEO::geofile::scale_point(point &in_point, const double factor)
-{
-    in_point.x = in_point.x * factor;
-    in_point.y = in_point.y * factor;
-    in_point.z = in_point.z * factor;
-}
-
-void GEO::geofile::translate_point(GEO::point &point,
-                                  const double &delta_x,
-                                  const double &delta_y,
-                                  const double &delta_z )
+// Moves every point without the coherence check of the functions above.
+void GEO::geofile::transform_data(const affine_transform &transform)
 {
-    point.x = point.x + delta_x;
-    point.y = point.y + delta_y;
-    point.z = point.z + delta_z;
+    for (int id = points.first_id(); id != 0; id = points.next_id(id))
+    {
+        transform_point(transform, points[id]);
+    }
 }
 
-/**
- * [Rotate Point]
- * Rotates a specified POINT's co-ordinates by reference.
- * @param  o_x      [ The x co-ordinate of the point to rotate around ]
- * @param  o_y      [ The y co-ordinate of the point to rotate around ]
- * @param  o_z      [ The z co-ordinate of the point to rotate around ]
- * @param theta_x   [ Angle in degrees around x-axis of {c}
- * @param theta_y   [ Angle in degrees around y-axis of {c}
- * @param theta_z   [ Angle in degrees around z-axis of {c}
- * @param subject   [ The point which must be rotated]
- */
-void GEO::geofile::rotate_point(const double &o_x,       const double &o_y,
-                                const double &o_z,       const double &theta_x,
-                                const double &theta_y,   const double &theta_z,
-                                point &subject)
-{
-    point p = subject;
-    double t_x = theta_x * 3.141592653589 / 180; // convert angle to radians
-    double t_y = theta_y * 3.141592653589 / 180; // convert angle to radians
-    double t_z = theta_z * 3.141592653589 / 180; // convert angle to radians
-
-    // translate point back to origin:
-    p.x -= o_x;
-    p.y -= o_y;
-    p.z -= o_z;
-
-    // rotate point
-    rotate_X(t_x, p);
-    rotate_Y(t_y, p);
-    rotate_Z(t_z, p);
-
-    // translate point back:
-    p.x = (p.x + o_x);
-    p.y = (p.y + o_y);
-    p.z = (p.z + o_z);
-    subject = p;         // Overwrite the original point with the rotated one.
-}
-
-void GEO::geofile::rotate_X(const double &theta, point &in_point)
-{
-    double sin_theta = std::sin(theta);
-    double cos_theta = std::cos(theta);
-    double y = in_point.y * cos_theta - in_point.z * sin_theta;
-    double z = in_point.z * cos_theta + in_point.y * sin_theta;
-    in_point.y = y;
-    in_point.z = z;
-};
-
-void GEO::geofile::rotate_Y(const double &theta, point &in_point)
-{
-    double sin_theta = std::sin(theta);
-    double cos_theta = std::cos(theta);
-    double x = in_point.x * cos_theta + in_point.z * sin_theta;
-    double z = in_point.z * cos_theta - in_point.x * sin_theta;
-    in_point.x = x;
-    in_point.z = z;
-};
-
-void GEO::geofile::rotate_Z(const double &theta, point &in_point)
-{
-    double sin_theta = std::sin(theta);
-    double cos_theta = std::cos(theta);
-    double x = in_point.x * cos_theta - in_point.y * sin_theta;
-    double y = in_point.y * cos_theta + in_point.x * sin_theta;
-    in_point.x = x;
-    in_point.y = y;
-};
-
 // fills a vector of GEO::point with all the points in the geofile
 void GEO::geofile::pull_points(std::vector<GEO::point> &in_vector)
 {
-//std::map<int, point>            points_map;
-    if (points_map.size()>0)
+    for (int id = points.first_id(); id != 0; id = points.next_id(id))
     {
-        auto pm_end = points_map.end();
-        for ( auto pm_it = points_map.begin();
-             pm_it != pm_end; pm_it++)
-        {
-            in_vector.push_back(pm_it->second);
-        }
+        in_vector.push_back(points[id]);
     }
 }
 
 int GEO::geofile::insert_points_map(std::map<int, point> &in_points_map)
 {
-    if(points_map.empty()==true)
+    if(points.empty()==true)
     {
         auto pm_end = in_points_map.end();
         for ( auto pm_it = in_points_map.begin(); pm_it != pm_end; pm_it++)
         {
-            points_map.insert({pm_it->first, pm_it->second});
+            points.insert(pm_it->first, pm_it->second);
         }
         return EXIT_SUCCESS;
     }
@@ -1833,12 +1493,12 @@ int GEO::geofile::insert_points_map(std::map<int, point> &in_points_map)
 }
 int GEO::geofile::insert_lines_map(std::map<int, line> &in_lines_map)
 {
-    if(lines_map.empty()==true)
+    if(lines.empty()==true)
     {
         auto lm_end = in_lines_map.end();
         for ( auto lm_it = in_lines_map.begin(); lm_it != lm_end; lm_it++)
         {
-            lines_map.insert({lm_it->first, lm_it->second});
+            lines.insert(lm_it->first, lm_it->second);
         }
         return EXIT_SUCCESS;
     }
@@ -1852,12 +1512,12 @@ int GEO::geofile::insert_lines_map(std::map<int, line> &in_lines_map)
 
 int GEO::geofile::insert_curve_loops_map(const std::map<int, std::vector<int>> &in_curve_loops_map)
 {
-    if(curve_loops_map.empty()==true)
+    if(curve_loops.empty()==true)
     {
         auto clm_end = in_curve_loops_map.end();
         for ( auto clm_it = in_curve_loops_map.begin(); clm_it != clm_end; clm_it++)
         {
-            curve_loops_map.insert({clm_it->first, clm_it->second});
+            curve_loops.insert(clm_it->first, clm_it->second);
         }
         return EXIT_SUCCESS;
     }
@@ -1871,12 +1531,12 @@ int GEO::geofile::insert_curve_loops_map(const std::map<int, std::vector<int>> &
 
 int GEO::geofile::insert_plane_surfaces_map(const std::map<int, int> &in_plane_surfaces_map)
 {
-    if(plane_surfaces_map.empty()==true)
+    if(plane_surfaces.empty()==true)
     {
         auto psm_end = in_plane_surfaces_map.end();
         for ( auto psm_it = in_plane_surfaces_map.begin(); psm_it != psm_end; psm_it++)
         {
-            plane_surfaces_map.insert({psm_it->first, psm_it->second});
+            plane_surfaces.insert(psm_it->first, psm_it->second);
         }
         return EXIT_SUCCESS;
     }
@@ -1890,12 +1550,12 @@ int GEO::geofile::insert_plane_surfaces_map(const std::map<int, int> &in_plane_s
 
 int GEO::geofile::insert_surface_loops_map(const std::map<int, std::vector<int>> &in_surface_loops_map)
 {
-    if(surface_loops_map.empty()==true)
+    if(surface_loops.empty()==true)
     {
         auto slm_end = in_surface_loops_map.end();
         for ( auto slm_it = in_surface_loops_map.begin(); slm_it != slm_end; slm_it++)
         {
-            surface_loops_map.insert({slm_it->first, slm_it->second});
+            surface_loops.insert(slm_it->first, slm_it->second);
         }
         return EXIT_SUCCESS;
     }
@@ -1909,12 +1569,12 @@ int GEO::geofile::insert_surface_loops_map(const std::map<int, std::vector<int>>
 
 int GEO::geofile::insert_volumes_map(const std::map<int, int> &in_volumes_map)
 {
-    if(volumes_map.empty()==true)
+    if(volumes.empty()==true)
     {
         auto vm_it_end = in_volumes_map.end();
         for ( auto vm_it = in_volumes_map.begin(); vm_it != vm_it_end; vm_it++)
         {
-            volumes_map.insert({vm_it->first, vm_it->second});
+            volumes.insert(vm_it->first, vm_it->second);
         }
         return EXIT_SUCCESS;
     }
@@ -1926,6 +1586,70 @@ int GEO::geofile::insert_volumes_map(const std::map<int, int> &in_volumes_map)
     }
 }
 
+int GEO::geofile::insert_physical_volumes_map(const std::map<std::string, std::vector<int>> &in_physical_volumes_map)
+{
+    if(physical_volumes_map.empty()==true)
+    {
+        physical_volumes_map = in_physical_volumes_map;
+        return EXIT_SUCCESS;
+    }
+    else
+    {
+        std::cout<<"Error: Cannot insert fresh physical volumes into existing GEO file."<<std::endl;
+        std::cout<<"Rather create new geo file and merge."<<std::endl;
+        return EXIT_FAILURE;
+    }
+}
+
+// Walks the curve loop of every plane surface and lists the start point of
+// each line, taking the line's direction in the loop into account. Holes are
+// not followed: only the first (outer) curve loop is stored per surface.
+int GEO::geofile::pull_surface_outlines(std::vector<surface_outline> &outlines) const
+{
+    std::map<int, std::string> surface_groups;
+    for (auto group_it = physical_surfaces_map.begin(); group_it != physical_surfaces_map.end(); group_it++)
+    {
+        for (auto surface_it = group_it->second.begin(); surface_it != group_it->second.end(); surface_it++)
+            surface_groups.insert({std::abs(*surface_it), group_it->first});
+    }
+    for (int id = plane_surfaces.first_id(); id != 0; id = plane_surfaces.next_id(id))
+    {
+        int loop_id = std::abs(plane_surfaces[id]);
+        if(curve_loops.contains(loop_id)==false)
+        {
+            std::cout << "Error: Plane Surface(" << id << ") references missing Curve Loop("
+                      << loop_id << ")." << std::endl;
+            return EXIT_FAILURE;
+        }
+        surface_outline outline;
+        outline.surface = id;
+        auto group = surface_groups.find(id);
+        if(group != surface_groups.end())
+            outline.physical = group->second;
+        member_span loop = curve_loops[loop_id];
+        for (auto line_it = loop.begin(); line_it != loop.end(); line_it++)
+        {
+            if(lines.contains(std::abs(*line_it))==false)
+            {
+                std::cout << "Error: Curve Loop(" << loop_id << ") references missing Line("
+                          << std::abs(*line_it) << ")." << std::endl;
+                return EXIT_FAILURE;
+            }
+            const line &edge = lines[std::abs(*line_it)];
+            int corner = (*line_it > 0) ? edge.start : edge.end;
+            if(points.contains(corner)==false)
+            {
+                std::cout << "Error: Line(" << std::abs(*line_it) << ") references missing Point("
+                          << corner << ")." << std::endl;
+                return EXIT_FAILURE;
+            }
+            outline.corners.push_back(points[corner]);
+        }
+        outlines.push_back(outline);
+    }
+    return EXIT_SUCCESS;
+}
+
 void GEO::geofile::switch_to_OpenCASCADE()
 {
     is_open_cascade = true;
@@ -1964,117 +1688,36 @@ void GEO::geofile::make_coherent(const bool &detailed)
     // start_timer();                                                                      //DEBUG
     if ( detailed==true)
     {
-        std::map<int,int> changes;
         // ------- Search for duplicated curve loops --------
-        if (!curve_loops_map.empty())
-        {
-            auto main_cl_loop_end = std::prev(curve_loops_map.end());
-            for (auto main_cl_loop_it = curve_loops_map.begin();
-                main_cl_loop_it != main_cl_loop_end;
-                main_cl_loop_it++)
-            {
-                auto inner_cl_loop_end = curve_loops_map.end();
-                auto cl_p_holder = main_cl_loop_it; cl_p_holder++;
-                for (auto inner_cl_loop_it = cl_p_holder;
-                    inner_cl_loop_it != inner_cl_loop_end;
-                    inner_cl_loop_it++)
-                {
-                    int curve_type = compare_vector(main_cl_loop_it->second, inner_cl_loop_it->second);
-                    switch (curve_type)
-                    {
-                    case 1/*identical*/:
-                        cl_p_holder = inner_cl_loop_it; cl_p_holder--;
-                        changes.insert({inner_cl_loop_it->first,main_cl_loop_it->first});
-                        curve_loops_map.erase(inner_cl_loop_it->first);
-                        inner_cl_loop_it = cl_p_holder;
-                        inner_cl_loop_end = curve_loops_map.end();
-                        main_cl_loop_end = std::prev(curve_loops_map.end());
-                        break;
-                    case 2/*reversed*/:
-                        cl_p_holder = inner_cl_loop_it; cl_p_holder--;
-                        changes.insert({inner_cl_loop_it->first,-main_cl_loop_it->first});
-                        curve_loops_map.erase(inner_cl_loop_it->first);
-                        inner_cl_loop_it = cl_p_holder;
-                        inner_cl_loop_end = curve_loops_map.end();
-                        main_cl_loop_end = std::prev(curve_loops_map.end());
-                        break;
-                    default:
-                        break;
-                    }
-                }
-            }
-            adjust_curve_loops(changes);
-            changes.clear();
-        }
+        // Loops are matched on a signature that ignores the starting line
+        // and the direction of travel, so duplicates and reversed duplicates
+        // are found in one pass.
+        if (!curve_loops.empty())
+            adjust_curve_loops(merge_duplicate_loops(curve_loops, curve_loop_signature));
         // ------ Search for duplicated plane surfaces ------
-        if (!plane_surfaces_map.empty())
-        {
-            auto main_ps_loop_end = std::prev(plane_surfaces_map.end());
-            for (auto main_ps_loop_it = plane_surfaces_map.begin();
-                main_ps_loop_it != main_ps_loop_end;
-                main_ps_loop_it++)
+        // Surfaces on the same curve loop match in either direction; a
+        // reversed duplicate is redirected to the negated kept surface.
+        if (!plane_surfaces.empty())
+        {
+            std::vector<int> changes = identity_ids(plane_surfaces.last_id()+1);
+            std::unordered_map<int, std::pair<int, bool>> first_seen;
+            first_seen.reserve(plane_surfaces.size());
+            for (int id = plane_surfaces.first_id(); id != 0; id = plane_surfaces.next_id(id))
             {
-                auto inner_ps_loop_end = plane_surfaces_map.end();
-                auto ps_p_holder = main_ps_loop_it; ps_p_holder++;
-                for (auto inner_ps_loop_it = ps_p_holder;
-                    inner_ps_loop_it != inner_ps_loop_end;
-                    inner_ps_loop_it++)
+                bool reversed = (plane_surfaces[id] < 0);
+                auto outcome = first_seen.insert({std::abs(plane_surfaces[id]), {id, reversed}});
+                if (outcome.second==false)
                 {
-                    if (main_ps_loop_it->second == inner_ps_loop_it->second)
-                    {
-                        ps_p_holder = inner_ps_loop_it; ps_p_holder--;
-                        changes.insert({ inner_ps_loop_it->first, main_ps_loop_it->first });
-                        plane_surfaces_map.erase(inner_ps_loop_it->first);
-                        inner_ps_loop_it = ps_p_holder;
-                        inner_ps_loop_end = plane_surfaces_map.end();
-                        main_ps_loop_end = std::prev(plane_surfaces_map.end());
-                    }
+                    int kept = outcome.first->second.first;
+                    changes[id] = (outcome.first->second.second==reversed) ? kept : -kept;
+                    plane_surfaces.erase(id);
                 }
             }
             adjust_plane_surfaces(changes);
-            changes.clear();
         }
         // ------ Search for duplicated surface loops -------
-        if (!surface_loops_map.empty())
-        {
-            auto main_sur_loop_end = std::prev(surface_loops_map.end());
-            for (auto main_sur_loop_it = surface_loops_map.begin();
-                main_sur_loop_it != main_sur_loop_end;
-                main_sur_loop_it++)
-            {
-                auto inner_sur_loop_end = surface_loops_map.end();
-                auto sur_p_holder = main_sur_loop_it; sur_p_holder++;
-                for (auto inner_sur_loop_it = sur_p_holder;
-                    inner_sur_loop_it != inner_sur_loop_end;
-                    inner_sur_loop_it++)
-                {
-                    int curve_type = compare_vector(main_sur_loop_it->second, inner_sur_loop_it->second);
-                    switch (curve_type)
-                    {
-                    case 1/*identical*/:
-                        sur_p_holder = inner_sur_loop_it; sur_p_holder--;
-                        changes.insert({inner_sur_loop_it->first,main_sur_loop_it->first});
-                        curve_loops_map.erase(inner_sur_loop_it->first);
-                        inner_sur_loop_it = sur_p_holder;
-                        inner_sur_loop_end = surface_loops_map.end();
-                        main_sur_loop_end = std::prev(surface_loops_map.end());
-                        break;
-                    case 2/*reversed*/:
-                        sur_p_holder = inner_sur_loop_it; sur_p_holder--;
-                        changes.insert({inner_sur_loop_it->first,-main_sur_loop_it->first});
-                        curve_loops_map.erase(inner_sur_loop_it->first);
-                        inner_sur_loop_it = sur_p_holder;
-                        inner_sur_loop_end = surface_loops_map.end();
-                        main_sur_loop_end = std::prev(surface_loops_map.end());
-                        break;
-                    default:
-                        break;
-                    }
-                }
-            }
-            adjust_surface_loops(changes);
-            changes.clear();
-        }
+        if (!surface_loops.empty())
+            adjust_surface_loops(merge_duplicate_loops(surface_loops, surface_loop_signature));
         // --- Search for duplicated physical elemements ----
         // Physical Curves
         auto pc_m_end = physical_curves_map.end();
@@ -2107,158 +1750,133 @@ void GEO::geofile::make_coherent(const bool &detailed)
 }
 
 // Perform coherence check on geofile points.
-// Removes all duplicate points by inverting the points map.
+// Without a weld tolerance only identical points are merged. With one, every
+// point within the tolerance of a point with a lower ID is merged into it.
 void GEO::geofile::coherent_points()
 {
-    std::map<point, int> inv_point_map;
-    std::map<int, int> point_adjustment_map;
-    auto pm_it_end = points_map.end();
-    for ( auto pm_it = points_map.begin(); pm_it != pm_it_end; pm_it++)
+    std::vector<int> point_redirects = (weld_tolerance>0)   ? weld_points(points, weld_tolerance)
+                                                            : merge_identical_points(points);
+    if (!point_redirects.empty())
     {
-        auto outcome = inv_point_map.insert({pm_it->second, pm_it->first});
-        if (outcome.second==false)
-        {
-            int failed = pm_it->first;                      // get index that failed
-            int reason = inv_point_map.find(pm_it->second)->second;
-            point_adjustment_map.insert({failed, reason});  // add to list of duplicates
-        }
+        redirect_physical_points(point_redirects);
+        redirect_lines(point_redirects);
     }
-    update_points(inv_point_map, point_adjustment_map);
+    if (weld_tolerance>0)
+        remove_collapsed_lines();
 }
 
-
-// If changes are detected:
-// Clear the points map and repopulate with unique
-// entries, then update dependencies
-void GEO::geofile::update_points(const std::map<point, int> &inv_point_map,
-                                 const std::map<int, int> &point_adjustment_map)
+// Lines shorter than the weld tolerance start and end on the same point
+// after welding. They have no length to mesh, so they are erased and taken
+// out of the curve loops and physical curves that use them. A curve loop
+// left with fewer than 3 lines no longer bounds an area and is reported.
+void GEO::geofile::remove_collapsed_lines()
 {
-    if(!point_adjustment_map.empty())
+    std::vector<bool> collapsed;
+    int collapsed_count = 0;
+    for (int id = lines.first_id(); id != 0; id = lines.next_id(id))
     {
-        points_map.clear();
-        auto inv_map_end = inv_point_map.end();
-        for (auto inv_map_it = inv_point_map.begin(); inv_map_it != inv_map_end; inv_map_it++)
+        if (lines[id].start==lines[id].end)
         {
-            points_map.insert({inv_map_it->second, inv_map_it->first});
+            if (collapsed.empty())
+                collapsed.assign(lines.last_id()+1, false);
+            collapsed[id] = true;
+            lines.erase(id);
+            collapsed_count++;
         }
-        redirect_physical_points(point_adjustment_map);
-        redirect_lines(point_adjustment_map);
     }
+    if (collapsed_count==0)
+        return;
+    std::cout   << "Warning: Removed " << collapsed_count << " lines shorter than the weld tolerance."
+                << std::endl;
+    curve_loops.remove_members(collapsed);
+    for (int id = curve_loops.first_id(); id != 0; id = curve_loops.next_id(id))
+    {
+        if (curve_loops[id].size()<3)
+            std::cout   << "Error: Curve Loop(" << id << ") has " << curve_loops[id].size()
+                        << " lines left after welding." << std::endl;
+    }
+    auto pc_end = physical_curves_map.end();
+    for (auto pc_it = physical_curves_map.begin(); pc_it != pc_end; pc_it++)
+    {
+        std::vector<int> &group = pc_it->second;
+        group.erase(std::remove_if(group.begin(), group.end(), [&collapsed](const int &line) {
+                        size_t id = (size_t)std::abs(line);
+                        return (id<collapsed.size()) && (collapsed[id]==true);
+                    }), group.end());
+    }
+}
+
+// Points closer together than tolerance are merged by make_coherent. Zero
+// merges identical points only.
+void GEO::geofile::set_weld_tolerance(const double &tolerance)
+{
+    weld_tolerance = tolerance;
 }
 
-void GEO::geofile::redirect_physical_points(const std::map<int, int> &point_adjustment_map)
+void GEO::geofile::redirect_physical_points(const std::vector<int> &point_redirects)
 {
-    // Guard against waste of time
-    if ( (!physical_points_map.empty()) && (!point_adjustment_map.empty() ) )
+    // Look through all physical point names
+    auto phys_p_end = physical_points_map.end();
+    for (auto phys_p_it = physical_points_map.begin(); phys_p_it != phys_p_end; phys_p_it++)
     {
-        // Look through all physical point names
-        auto phys_p_end = physical_points_map.end();
-        for (auto phys_p_it = physical_points_map.begin(); phys_p_it != phys_p_end; phys_p_it++)
-        {
-            // Look through entire vector of references
-            auto p_vec_begin = phys_p_it->second.begin();
-            auto p_vec_end = phys_p_it->second.end();
-            for ( auto p_vec = p_vec_begin; p_vec != p_vec_end; p_vec++)
-            {
-                auto j = point_adjustment_map.find(*p_vec);
-                if (j != point_adjustment_map.end())
-                    *p_vec = j->second;//redirect old reference to new
-            }
-            // Remove duplicates
-            std::sort(p_vec_begin,p_vec_end);
-            phys_p_it->second.erase(unique(p_vec_begin,p_vec_end), p_vec_end);
-        }
+        redirect_all(phys_p_it->second, point_redirects);
+        // Remove duplicates
+        std::sort(phys_p_it->second.begin(),phys_p_it->second.end());
+        phys_p_it->second.erase(unique(phys_p_it->second.begin(),phys_p_it->second.end()), phys_p_it->second.end());
     }
 }
 
 // looks through all lines for references to duplicate points.
 // adjusts them to point to unique points
-void GEO::geofile::redirect_lines( const std::map<int, int> &point_adjustment_map)
+void GEO::geofile::redirect_lines(const std::vector<int> &point_redirects)
 {
-    if(!point_adjustment_map.empty())
+    for (int id = lines.first_id(); id != 0; id = lines.next_id(id))
     {
-        auto lm_end = lines_map.end();
-        for ( auto lm_it = lines_map.begin(); lm_it != lm_end; lm_it++)
-        {
-            auto result = point_adjustment_map.find(lm_it->second.start);
-            if (result != point_adjustment_map.end())
-                lm_it->second.start = result->second;
-            result = point_adjustment_map.find(lm_it->second.end);
-            if (result != point_adjustment_map.end())
-                lm_it->second.end = result->second;
-        }
+        redirect(lines[id].start, point_redirects);
+        redirect(lines[id].end, point_redirects);
     }
 }
 
 // Perform coherence check on geofile lines.
-// Removes all duplicate points by inverting the points map.
+// Removes all duplicate lines by inverting the lines map.
 void GEO::geofile::coherent_lines()
 {
     std::map<opti_line, int> inv_directional_lines_map;
-    std::map<int, int> lines_adjustment_map;
-    // populate directional_lines_map from lines_map
-    auto lm_end = lines_map.end();
-    for ( auto lm_it = lines_map.begin(); lm_it != lm_end; lm_it++)
+    std::vector<int> line_redirects;
+    for (int id = lines.first_id(); id != 0; id = lines.next_id(id))
     {
         opti_line incoming_line;
-        incoming_line.low       = lm_it->second.start;
-        incoming_line.high      = lm_it->second.end;
+        incoming_line.low       = lines[id].start;
+        incoming_line.high      = lines[id].end;
         incoming_line.reversed  = false;
-        int placeholder;
         if ( incoming_line.low > incoming_line.high )
         {
-            placeholder = incoming_line.low;
-            incoming_line.low = incoming_line.high;
-            incoming_line.high = placeholder;
+            std::swap(incoming_line.low, incoming_line.high);
             incoming_line.reversed = true;
         }
         //try to insert the line.
-        auto outcome = inv_directional_lines_map.insert({incoming_line, lm_it->first});
+        auto outcome = inv_directional_lines_map.insert({incoming_line, id});
         if (outcome.second==false)
         {
             // high and low is the same. Is the directionality?
-            auto existing_it = inv_directional_lines_map.find(incoming_line);
-            auto existing_is_reversed = existing_it->first.reversed;
-            int sign = (incoming_line.reversed == existing_is_reversed) ?  (1) : (-1) ;
-            // insert the duplicate adjustment
-            lines_adjustment_map.insert({lm_it->first,
-                                         sign*existing_it->second});
+            int sign = (incoming_line.reversed == outcome.first->first.reversed) ?  (1) : (-1) ;
+            if (line_redirects.empty())
+                line_redirects = identity_ids(lines.last_id()+1);
+            line_redirects[id] = sign*outcome.first->second;
+            lines.erase(id);
         }
     }
-    update_lines(lines_adjustment_map);
-}
-
-void GEO::geofile::update_lines( const std::map<int, int> &lines_adjustment_map)
-{
-    if(!lines_adjustment_map.empty())
+    // Change the curve loops and physical curves to point to unique elements
+    if (!line_redirects.empty())
     {
-        // actually delete the duplicates from the main map
-        auto lam_end = lines_adjustment_map.end();
-        for ( auto lam_it = lines_adjustment_map.begin(); lam_it != lam_end; lam_it++)
-        {
-            lines_map.erase(lam_it->first);
-        }
-        // Change the curve loops to point to unique elements
-        redirect_curve_loops(lines_adjustment_map);
+        redirect_curve_loops(line_redirects);
+        redirect_physical(physical_curves_map, line_redirects);
     }
 }
 
-void GEO::geofile::redirect_curve_loops(const std::map<int, int> &lines_adjustment_map)
+void GEO::geofile::redirect_curve_loops(const std::vector<int> &line_redirects)
 {
-    if (!lines_adjustment_map.empty())
-    {
-        auto clm_end = curve_loops_map.end();
-        for ( auto clm_it = curve_loops_map.begin(); clm_it != clm_end; clm_it++)
-        {
-            auto cli_end = clm_it->second.end();
-            for ( auto cl_it = clm_it->second.begin(); cl_it != cli_end; cl_it++)
-            {
-                auto result = lines_adjustment_map.find(*cl_it);
-                if(result != lines_adjustment_map.end())
-                    *cl_it = result->second ;
-            }
-        }
-    }
+    redirect_all(curve_loops.members(), line_redirects);
 }
 
 void GEO::geofile::start_timer()
@@ -2278,6 +1896,377 @@ void GEO::geofile::enable_bool_diff_rest_from_first()
     bool_diff_rest = true;
 }
 
+// Heap memory held by the elementary entity tables.
+size_t GEO::geofile::memory_bytes() const
+{
+    return  points.memory_bytes() + lines.memory_bytes() +
+            curve_loops.memory_bytes() + plane_surfaces.memory_bytes() +
+            surface_loops.memory_bytes() + volumes.memory_bytes();
+}
+
+namespace {
+    // Allocator that tallies the bytes it hands out, to measure the heap
+    // footprint of the map layout the tables replaced.
+    size_t counted_bytes = 0;
+    template <typename T>
+    struct counting_allocator
+    {
+        typedef T value_type;
+        counting_allocator() = default;
+        template <typename U> counting_allocator(const counting_allocator<U> &) {}
+        T *allocate(size_t count)
+        {
+            counted_bytes += count*sizeof(T);
+            return std::allocator<T>().allocate(count);
+        }
+        void deallocate(T *pointer, size_t count)
+        {
+            counted_bytes -= count*sizeof(T);
+            std::allocator<T>().deallocate(pointer, count);
+        }
+        template <typename U> bool operator==(const counting_allocator<U> &) const { return true; }
+        template <typename U> bool operator!=(const counting_allocator<U> &) const { return false; }
+    };
+    template <typename Value>
+    using counted_map = std::map<int, Value, std::less<int>,
+                                 counting_allocator<std::pair<const int, Value>>>;
+    typedef std::vector<int, counting_allocator<int>> counted_vector;
+
+    // Geometry of a row of boxes as the 3D model writes it: per box 8 points,
+    // 12 lines, 6 curve loops of 4 lines, 6 plane surfaces, 1 surface loop
+    // of 6 surfaces and 1 volume.
+    struct box_model
+    {
+        std::vector<GEO::point> points;
+        std::vector<GEO::line> lines;
+        std::vector<std::vector<int>> curve_loops;
+        std::vector<std::vector<int>> surface_loops;
+    };
+
+    box_model generate_boxes(const int &box_count)
+    {
+        box_model model;
+        const int faces[6][4] = { {1, 2, 3, 4}, {5, 6, 7, 8}, {1, 10, -5, -9},
+                                  {2, 11, -6, -10}, {3, 12, -7, -11}, {4, 9, -8, -12} };
+        for (int b = 0; b < box_count; b++)
+        {
+            int p_0 = 8*b;
+            int l_0 = 12*b;
+            for (int level = 0; level < 2; level++)
+            {
+                double z = level;
+                model.points.push_back({3.0*b, 0, z, 0});
+                model.points.push_back({3.0*b+1, 0, z, 0});
+                model.points.push_back({3.0*b+1, 1, z, 0});
+                model.points.push_back({3.0*b, 1, z, 0});
+            }
+            for (int level = 0; level < 2; level++)
+            {
+                for (int c = 0; c < 4; c++)
+                    model.lines.push_back({p_0+4*level+c+1, p_0+4*level+(c+1)%4+1});
+            }
+            for (int c = 0; c < 4; c++)
+                model.lines.push_back({p_0+c+1, p_0+c+5});
+            std::vector<int> shell;
+            for (int f = 0; f < 6; f++)
+            {
+                std::vector<int> loop;
+                for (int e = 0; e < 4; e++)
+                    loop.push_back((faces[f][e]<0) ? -(l_0-faces[f][e]) : (l_0+faces[f][e]));
+                model.curve_loops.push_back(loop);
+                shell.push_back(6*b+f+1);
+            }
+            model.surface_loops.push_back(shell);
+        }
+        return model;
+    }
+
+    // Builds the layout, then resolves every reference chain once (surface
+    // loop -> surface -> curve loop -> line -> point) and returns the time
+    // of each step and a checksum so the work cannot be optimised away.
+    template <typename Layout>
+    void time_layout(const std::string &name, const box_model &model, Layout &layout)
+    {
+        auto start = std::chrono::steady_clock::now();
+        size_t bytes = layout.build(model);
+        std::chrono::duration<double> built = std::chrono::steady_clock::now() - start;
+        start = std::chrono::steady_clock::now();
+        double checksum = layout.resolve();
+        std::chrono::duration<double> resolved = std::chrono::steady_clock::now() - start;
+        size_t entity_count = model.points.size() + model.lines.size() + 2*model.curve_loops.size()
+                            + 2*model.surface_loops.size();
+        std::cout << "  " << std::left << std::setw(14) << name << std::right
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(9) << bytes/1048576.0 << " MiB"
+                  << std::setw(8) << (double)bytes/entity_count << " B/entity"
+                  << std::setprecision(2)
+                  << std::setw(9) << built.count()*1e3 << " ms build"
+                  << std::setw(9) << resolved.count()*1e3 << " ms resolve"
+                  << "   (check " << std::scientific << std::setprecision(3) << checksum << ")"
+                  << std::defaultfloat << std::endl;
+    }
+
+    // The ordered map layout GEO::geofile used before the entity tables.
+    struct map_layout
+    {
+        counted_map<GEO::point> points;
+        counted_map<GEO::line> lines;
+        counted_map<counted_vector> curve_loops;
+        counted_map<int> plane_surfaces;
+        counted_map<counted_vector> surface_loops;
+        counted_map<int> volumes;
+        size_t build(const box_model &model)
+        {
+            counted_bytes = 0;
+            for (size_t i = 0; i < model.points.size(); i++)
+                points.insert({(int)i+1, model.points[i]});
+            for (size_t i = 0; i < model.lines.size(); i++)
+                lines.insert({(int)i+1, model.lines[i]});
+            for (size_t i = 0; i < model.curve_loops.size(); i++)
+            {
+                curve_loops.insert({(int)i+1, counted_vector(model.curve_loops[i].begin(), model.curve_loops[i].end())});
+                plane_surfaces.insert({(int)i+1, (int)i+1});
+            }
+            for (size_t i = 0; i < model.surface_loops.size(); i++)
+            {
+                surface_loops.insert({(int)i+1, counted_vector(model.surface_loops[i].begin(), model.surface_loops[i].end())});
+                volumes.insert({(int)i+1, (int)i+1});
+            }
+            return counted_bytes;
+        }
+        double resolve()
+        {
+            double sum = 0;
+            for (auto vol_it = volumes.begin(); vol_it != volumes.end(); vol_it++)
+            {
+                const counted_vector &shell = surface_loops.find(vol_it->second)->second;
+                for (auto surface_it = shell.begin(); surface_it != shell.end(); surface_it++)
+                {
+                    const counted_vector &loop = curve_loops.find(plane_surfaces.find(*surface_it)->second)->second;
+                    for (auto line_it = loop.begin(); line_it != loop.end(); line_it++)
+                        sum += points.find(lines.find(std::abs(*line_it))->second.start)->second.x;
+                }
+            }
+            return sum;
+        }
+    };
+
+    struct table_layout
+    {
+        GEO::entity_table<GEO::point> points;
+        GEO::entity_table<GEO::line> lines;
+        GEO::loop_table curve_loops;
+        GEO::entity_table<int> plane_surfaces;
+        GEO::loop_table surface_loops;
+        GEO::entity_table<int> volumes;
+        size_t build(const box_model &model)
+        {
+            for (size_t i = 0; i < model.points.size(); i++)
+                points.insert((int)i+1, model.points[i]);
+            for (size_t i = 0; i < model.lines.size(); i++)
+                lines.insert((int)i+1, model.lines[i]);
+            for (size_t i = 0; i < model.curve_loops.size(); i++)
+            {
+                curve_loops.insert((int)i+1, model.curve_loops[i]);
+                plane_surfaces.insert((int)i+1, (int)i+1);
+            }
+            for (size_t i = 0; i < model.surface_loops.size(); i++)
+            {
+                surface_loops.insert((int)i+1, model.surface_loops[i]);
+                volumes.insert((int)i+1, (int)i+1);
+            }
+            return  points.memory_bytes() + lines.memory_bytes() + curve_loops.memory_bytes() +
+                    plane_surfaces.memory_bytes() + surface_loops.memory_bytes() + volumes.memory_bytes();
+        }
+        double resolve()
+        {
+            double sum = 0;
+            for (int vol_id = volumes.first_id(); vol_id != 0; vol_id = volumes.next_id(vol_id))
+            {
+                GEO::member_span shell = surface_loops[volumes[vol_id]];
+                for (auto surface_it = shell.begin(); surface_it != shell.end(); surface_it++)
+                {
+                    GEO::member_span loop = curve_loops[plane_surfaces[*surface_it]];
+                    for (auto line_it = loop.begin(); line_it != loop.end(); line_it++)
+                        sum += points[lines[std::abs(*line_it)].start].x;
+                }
+            }
+            return sum;
+        }
+    };
+}
+
+namespace {
+    // Erases every third point and line, then closes the gaps the way
+    // simplify_data does and times it.
+    void time_gap_closing(table_layout &layout)
+    {
+        for (int id = 3; id <= layout.points.last_id(); id += 3)
+            layout.points.erase(id);
+        for (int id = 3; id <= layout.lines.last_id(); id += 3)
+            layout.lines.erase(id);
+        size_t entity_count = layout.points.size() + layout.lines.size() + layout.curve_loops.members().size();
+        auto start = std::chrono::steady_clock::now();
+        std::vector<int> point_ids = layout.points.gapless_ids();
+        layout.points.renumber(point_ids);
+        for (int id = layout.lines.first_id(); id != 0; id = layout.lines.next_id(id))
+        {
+            redirect(layout.lines[id].start, point_ids);
+            redirect(layout.lines[id].end, point_ids);
+        }
+        std::vector<int> line_ids = layout.lines.gapless_ids();
+        layout.lines.renumber(line_ids);
+        redirect_all(layout.curve_loops.members(), line_ids);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "  " << std::left << std::setw(14) << "gap closing" << std::right
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(9) << elapsed.count()*1e3 << " ms"
+                  << std::setw(9) << elapsed.count()*1e9/entity_count << " ns/reference"
+                  << std::defaultfloat << std::endl;
+    }
+}
+
+namespace {
+    void print_throughput(const std::string &name, const size_t &bytes,
+                          const std::chrono::steady_clock::time_point &start, const double &checksum = 0)
+    {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "  " << std::left << std::setw(14) << name << std::right
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(9) << elapsed.count()*1e3 << " ms"
+                  << std::setprecision(1)
+                  << std::setw(9) << bytes/1048576.0/elapsed.count() << " MiB/s";
+        if (checksum!=0)
+            std::cout << "   (check " << std::scientific << std::setprecision(3) << checksum << ")";
+        std::cout << std::defaultfloat << std::endl;
+    }
+
+    // Writes the model as a .geo file through an ostream at round-trip
+    // precision, then times splitting it into fields and converting the
+    // numbers the way the import did before (getline, boost::split, trim,
+    // stod) against the mapped tokenizer, and times a full import and
+    // export. Last, rotating the file through import and export is timed
+    // against streaming the rotation.
+    void time_import(const box_model &model)
+    {
+        std::string path = (std::filesystem::temp_directory_path() / "katana_geofile_benchmark.geo").string();
+        auto write_start = std::chrono::steady_clock::now();
+        {
+            std::ofstream geo_out(path);
+            geo_out << std::setprecision(17);
+            for (size_t i = 0; i < model.points.size(); i++)
+                geo_out << "Point(" << i+1 << ") = {" << model.points[i].x << ", " << model.points[i].y
+                        << ", " << model.points[i].z << ", 1.0};\n";
+            for (size_t i = 0; i < model.lines.size(); i++)
+                geo_out << "Line(" << i+1 << ") = {" << model.lines[i].start << ", " << model.lines[i].end << "};\n";
+            for (size_t i = 0; i < model.curve_loops.size(); i++)
+            {
+                std::vector<int> loop = model.curve_loops[i];
+                GEO::member_span members = {loop.data(), loop.size()};
+                geo_out << "Curve Loop(" << i+1 << ") = {" << join_members(members) << "};\n"
+                        << "Plane Surface(" << i+1 << ") = {" << i+1 << "};\n";
+            }
+            for (size_t i = 0; i < model.surface_loops.size(); i++)
+            {
+                std::vector<int> shell = model.surface_loops[i];
+                GEO::member_span members = {shell.data(), shell.size()};
+                geo_out << "Surface Loop(" << i+1 << ") = {" << join_members(members) << "};\n"
+                        << "Volume(" << i+1 << ") = {" << i+1 << "};\n";
+            }
+        }
+        size_t bytes = std::filesystem::file_size(path);
+        print_throughput("ostream write", bytes, write_start);
+        {
+            auto start = std::chrono::steady_clock::now();
+            double checksum = 0;
+            std::ifstream geo_in(path);
+            std::string file_buffer;
+            while (getline(geo_in, file_buffer))
+            {
+                std::vector<std::string> split_string_vector;
+                boost::split(split_string_vector, file_buffer, boost::is_any_of("(),{}="));
+                GEO::trim_string_vector(split_string_vector);
+                for (auto field_it = split_string_vector.begin(); field_it != split_string_vector.end(); field_it++)
+                {
+                    if (GEO::is_e_notation(*field_it))
+                        checksum += std::stod(*field_it);
+                }
+            }
+            print_throughput("split + stod", bytes, start, checksum);
+        }
+        {
+            auto start = std::chrono::steady_clock::now();
+            double checksum = 0;
+            GEO::mapped_file geo_in;
+            geo_in.open(path);
+            std::string_view text = geo_in.contents();
+            std::vector<std::string_view> fields;
+            size_t line_start = 0;
+            while (line_start < text.size())
+            {
+                size_t line_end = std::min(text.find('\n', line_start), text.size());
+                GEO::split_geo_statement(text.substr(line_start, line_end-line_start), fields);
+                for (auto field_it = fields.begin(); field_it != fields.end(); field_it++)
+                {
+                    double value;
+                    if (GEO::parse_geo_real(*field_it, value))
+                        checksum += value;
+                }
+                line_start = line_end+1;
+            }
+            print_throughput("tokenizer", bytes, start, checksum);
+        }
+        {
+            auto start = std::chrono::steady_clock::now();
+            GEO::geofile imported;
+            imported.import_geofile(path);
+            print_throughput("full import", bytes, start, (double)imported.memory_bytes());
+            start = std::chrono::steady_clock::now();
+            imported.export_geofile(path);
+            print_throughput("full export", std::filesystem::file_size(path), start);
+        }
+        {
+            std::string rotated_path = path + ".rotated";
+            size_t exported_bytes = std::filesystem::file_size(path);
+            auto start = std::chrono::steady_clock::now();
+            GEO::geofile rotated;
+            rotated.import_geofile(path);
+            rotated.rotate_data(0, 0, 0, 10, 20, 30);
+            rotated.export_geofile(rotated_path);
+            print_throughput("full rotate", exported_bytes, start);
+            start = std::chrono::steady_clock::now();
+            GEO::stream_transform(path, rotated_path, GEO::rotation(0, 0, 0, 10, 20, 30));
+            print_throughput("stream rotate", exported_bytes, start);
+            std::filesystem::remove(rotated_path);
+        }
+        std::filesystem::remove(path);
+    }
+}
+
+// Compares the memory and access time of the entity tables with the ordered
+// maps they replaced, on a generated model of the size of a merged 3D .geo,
+// times closing the ID gaps left by erasing a third of the entities, and
+// times reading the model back from a .geo file.
+int GEO::run_geofile_benchmarks()
+{
+    const int box_count = 100000;
+    box_model model = generate_boxes(box_count);
+    std::cout << "Geometry file benchmark: " << box_count << " boxes, "
+              << model.points.size() << " points, " << model.lines.size() << " lines, "
+              << model.curve_loops.size() << " curve loops" << std::endl;
+    {
+        map_layout layout;
+        time_layout("ordered maps", model, layout);
+    }
+    {
+        table_layout layout;
+        time_layout("entity tables", model, layout);
+        time_gap_closing(layout);
+    }
+    time_import(generate_boxes(box_count/5));
+    return EXIT_SUCCESS;
+}
+
 // curve physical curve must point to the correct curve loop
 // void GEO::geofile::redirect_physical_curves(const std::map<int, int> &lines_adjustment_map)
 // {
@@ -0,0 +1,371 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function definitions for stacking 2D cross-sections into a 3D .geo model
+ */
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <iostream>
+#include <map>
+#include <string>
+#include "geofile_stacking.hpp"
+
+namespace {
+    // A region of a slice with its bounding box in the slice plane.
+    struct region
+    {
+        const GEO::surface_outline *outline;
+        double min_x, min_y, max_x, max_y;
+    };
+
+    std::vector<region> slice_regions(const std::vector<GEO::surface_outline> &outlines)
+    {
+        std::vector<region> regions;
+        for (auto outline_it = outlines.begin(); outline_it != outlines.end(); outline_it++)
+        {
+            if(outline_it->corners.size()<3)
+                continue;
+            region current = {&(*outline_it), INFINITY, INFINITY, -INFINITY, -INFINITY};
+            for (auto pt_it = outline_it->corners.begin(); pt_it != outline_it->corners.end(); pt_it++)
+            {
+                current.min_x = std::min(current.min_x, pt_it->x);
+                current.min_y = std::min(current.min_y, pt_it->y);
+                current.max_x = std::max(current.max_x, pt_it->x);
+                current.max_y = std::max(current.max_y, pt_it->y);
+            }
+            regions.push_back(current);
+        }
+        return regions;
+    }
+
+    // Area shared by the bounding boxes of two regions; 0 if they only touch.
+    double overlap_area(const region &a, const region &b)
+    {
+        double width = std::min(a.max_x, b.max_x) - std::max(a.min_x, b.min_x);
+        double height = std::min(a.max_y, b.max_y) - std::max(a.min_y, b.min_y);
+        return ((width>0) && (height>0)) ? width*height : 0;
+    }
+
+    // For every lower region, the index of the upper region it is lofted
+    // into, or -1. A pair is kept when both regions are in the same physical
+    // group and each is the other's largest overlap. The upper regions are
+    // visited in order of min_x, so the scan for one lower region stops at
+    // the first upper region that starts past its right edge.
+    std::vector<int> match_regions(const std::vector<region> &lower, const std::vector<region> &upper)
+    {
+        std::vector<size_t> order(upper.size());
+        for (size_t j = 0; j < order.size(); j++)
+            order[j] = j;
+        std::sort(order.begin(), order.end(), [&](const size_t &a, const size_t &b) {
+            return upper[a].min_x < upper[b].min_x;
+        });
+        std::vector<int> best_upper(lower.size(), -1);
+        std::vector<double> best_upper_area(lower.size(), 0);
+        std::vector<int> best_lower(upper.size(), -1);
+        std::vector<double> best_lower_area(upper.size(), 0);
+        for (size_t i = 0; i < lower.size(); i++)
+        {
+            for (auto order_it = order.begin(); order_it != order.end(); order_it++)
+            {
+                const region &candidate = upper[*order_it];
+                if(candidate.min_x>=lower[i].max_x)
+                    break;
+                if(candidate.outline->physical!=lower[i].outline->physical)
+                    continue;
+                double area = overlap_area(lower[i], candidate);
+                if(area>best_upper_area[i])
+                {
+                    best_upper_area[i] = area;
+                    best_upper[i] = *order_it;
+                }
+                if(area>best_lower_area[*order_it])
+                {
+                    best_lower_area[*order_it] = area;
+                    best_lower[*order_it] = i;
+                }
+            }
+        }
+        std::vector<int> matches(lower.size(), -1);
+        for (size_t i = 0; i < lower.size(); i++)
+        {
+            if( (best_upper[i]>=0) && (best_lower[best_upper[i]]==(int)i) )
+                matches[i] = best_upper[i];
+        }
+        return matches;
+    }
+
+    double signed_area(const std::vector<GEO::point> &corners)
+    {
+        double area = 0;
+        for (size_t i = 0; i < corners.size(); i++)
+        {
+            const GEO::point &p = corners[i];
+            const GEO::point &q = corners[(i+1)%corners.size()];
+            area += p.x*q.y - q.x*p.y;
+        }
+        return 0.5*area;
+    }
+
+    // Reorders the upper corners to run in the same direction as the lower
+    // ones and to start at the corner that best corresponds to the first
+    // lower corner. Corners are compared relative to their region's bounding
+    // box, so a region that grows or shifts still pairs corner with corner.
+    std::vector<GEO::point> align_corners(const std::vector<GEO::point> &lower, const region &lower_box,
+                                          std::vector<GEO::point> upper, const region &upper_box)
+    {
+        if( (signed_area(lower)<0) != (signed_area(upper)<0) )
+            std::reverse(upper.begin(), upper.end());
+        auto relative = [](const GEO::point &pt, const region &box) {
+            double width = box.max_x - box.min_x;
+            double height = box.max_y - box.min_y;
+            return std::make_pair( (width>0) ? (pt.x - box.min_x)/width : 0,
+                                   (height>0) ? (pt.y - box.min_y)/height : 0 );
+        };
+        size_t n = lower.size();
+        size_t best_shift = 0;
+        double best_cost = INFINITY;
+        for (size_t shift = 0; shift < n; shift++)
+        {
+            double cost = 0;
+            for (size_t i = 0; i < n; i++)
+            {
+                auto a = relative(lower[i], lower_box);
+                auto b = relative(upper[(i+shift)%n], upper_box);
+                cost += (a.first-b.first)*(a.first-b.first) + (a.second-b.second)*(a.second-b.second);
+            }
+            if(cost<best_cost)
+            {
+                best_cost = cost;
+                best_shift = shift;
+            }
+        }
+        std::rotate(upper.begin(), upper.begin()+best_shift, upper.end());
+        return upper;
+    }
+
+    // Entity maps of the stacked model, filled in the form the geofile
+    // insert functions take. Points are shared by position and lines by end
+    // points, so neighbouring faces of a volume close up.
+    class stack_builder
+    {
+    private:
+        std::map<GEO::point, int> point_lookup;
+        std::map<std::pair<int, int>, int> line_lookup;     // (low, high) point pair to line ID
+        std::map<int, GEO::point> points;
+        std::map<int, GEO::line> lines;
+        std::map<int, std::vector<int>> curve_loops;
+        std::map<int, int> plane_surfaces;
+        std::map<int, std::vector<int>> surface_loops;
+        std::map<int, int> volumes;
+        std::map<std::string, std::vector<int>> physical_volumes;
+
+        int add_point(GEO::point pt, const double &z)
+        {
+            pt.z = z;
+            auto found = point_lookup.find(pt);
+            if(found != point_lookup.end())
+                return found->second;
+            int point_id = points.size()+1;
+            points.insert({point_id, pt});
+            point_lookup.insert({pt, point_id});
+            return point_id;
+        }
+        int add_line(const int &start, const int &end)
+        {
+            auto key = std::make_pair(std::min(start, end), std::max(start, end));
+            auto found = line_lookup.find(key);
+            if(found != line_lookup.end())
+                return (lines[found->second].start==start) ? found->second : -found->second;
+            int line_id = lines.size()+1;
+            lines.insert({line_id, {start, end}});
+            line_lookup.insert({key, line_id});
+            return line_id;
+        }
+        int add_face(const std::vector<int> &corners)
+        {
+            std::vector<int> loop;
+            for (size_t i = 0; i < corners.size(); i++)
+                loop.push_back(add_line(corners[i], corners[(i+1)%corners.size()]));
+            int loop_id = curve_loops.size()+1;
+            curve_loops.insert({loop_id, loop});
+            plane_surfaces.insert({loop_id, loop_id});
+            return loop_id;
+        }
+        // Side face between lower edge (a, b) and upper edge (d, c). It is
+        // one plane surface if the four corners are coplanar, as they are
+        // for edges that stay parallel, otherwise two triangles. The split
+        // runs from the corner with the lowest point ID, so the neighbouring
+        // volume, which walks the face as (b, a, d, c), splits it the same way.
+        void add_side(const int &a, const int &b, const int &c, const int &d,
+                      std::vector<int> &faces)
+        {
+            const GEO::point &pa = points[a], &pb = points[b], &pc = points[c], &pd = points[d];
+            double d1[3] = {pc.x-pa.x, pc.y-pa.y, pc.z-pa.z};
+            double d2[3] = {pd.x-pb.x, pd.y-pb.y, pd.z-pb.z};
+            double normal[3] = {d1[1]*d2[2] - d1[2]*d2[1],
+                                d1[2]*d2[0] - d1[0]*d2[2],
+                                d1[0]*d2[1] - d1[1]*d2[0]};
+            double normal_length = std::sqrt(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+            double edge[3] = {pb.x-pa.x, pb.y-pa.y, pb.z-pa.z};
+            double offset = std::abs(normal[0]*edge[0] + normal[1]*edge[1] + normal[2]*edge[2]);
+            double scale = std::sqrt(d1[0]*d1[0] + d1[1]*d1[1] + d1[2]*d1[2])
+                         + std::sqrt(d2[0]*d2[0] + d2[1]*d2[1] + d2[2]*d2[2]);
+            if( (normal_length==0) || (offset <= 1e-9*normal_length*scale) )
+                faces.push_back(add_face({a, b, c, d}));
+            else if(std::min(a, c) < std::min(b, d))
+            {
+                faces.push_back(add_face({a, b, c}));
+                faces.push_back(add_face({a, c, d}));
+            }
+            else
+            {
+                faces.push_back(add_face({a, b, d}));
+                faces.push_back(add_face({b, c, d}));
+            }
+        }
+    public:
+        // Volume between a region at lower_z and the same number of
+        // corresponding corners at upper_z.
+        void add_loft(const std::vector<GEO::point> &lower, const double &lower_z,
+                      const std::vector<GEO::point> &upper, const double &upper_z,
+                      const std::string &physical)
+        {
+            size_t n = lower.size();
+            std::vector<int> lower_ids, upper_ids;
+            for (size_t i = 0; i < n; i++)
+            {
+                lower_ids.push_back(add_point(lower[i], lower_z));
+                upper_ids.push_back(add_point(upper[i], upper_z));
+            }
+            std::vector<int> faces;
+            faces.push_back(add_face(lower_ids));
+            faces.push_back(add_face(upper_ids));
+            for (size_t i = 0; i < n; i++)
+                add_side(lower_ids[i], lower_ids[(i+1)%n], upper_ids[(i+1)%n], upper_ids[i], faces);
+            int loop_id = surface_loops.size()+1;
+            surface_loops.insert({loop_id, faces});
+            volumes.insert({loop_id, loop_id});
+            if(physical.empty()==false)
+                physical_volumes[physical].push_back(loop_id);
+        }
+        size_t volume_count() const { return volumes.size(); }
+        int write_to(GEO::geofile &target)
+        {
+            if( (target.insert_points_map(points)==EXIT_SUCCESS) &&
+                (target.insert_lines_map(lines)==EXIT_SUCCESS) &&
+                (target.insert_curve_loops_map(curve_loops)==EXIT_SUCCESS) &&
+                (target.insert_plane_surfaces_map(plane_surfaces)==EXIT_SUCCESS) &&
+                (target.insert_surface_loops_map(surface_loops)==EXIT_SUCCESS) &&
+                (target.insert_volumes_map(volumes)==EXIT_SUCCESS) &&
+                (target.insert_physical_volumes_map(physical_volumes)==EXIT_SUCCESS) )
+                return EXIT_SUCCESS;
+            return EXIT_FAILURE;
+        }
+    };
+}
+
+// The outlines of every slice and the region matches of every pair of
+// neighbouring slices are independent, so each is found on its own thread.
+// The volumes are then built gap by gap, bottom to top.
+int GEO::stack_slices(const std::vector<geofile> &slices, const double &spacing,
+                      geofile &stacked)
+{
+    if(slices.size()<2)
+    {
+        std::cout << "Error: Stacking needs at least two slices." << std::endl;
+        return EXIT_FAILURE;
+    }
+    if(spacing<=0)
+    {
+        std::cout << "Error: Slice spacing must be positive." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::vector<std::vector<surface_outline>> outlines(slices.size());
+    std::vector<std::future<int>> pulls;
+    for (size_t k = 0; k < slices.size(); k++)
+    {
+        pulls.push_back(std::async(std::launch::async, [&slices, &outlines, k]() {
+            return slices[k].pull_surface_outlines(outlines[k]);
+        }));
+    }
+    bool pulled = true;
+    for (auto pull_it = pulls.begin(); pull_it != pulls.end(); pull_it++)
+        pulled = (pull_it->get()==EXIT_SUCCESS) && pulled;
+    if(pulled==false)
+        return EXIT_FAILURE;
+    std::vector<std::vector<region>> regions(slices.size());
+    for (size_t k = 0; k < slices.size(); k++)
+    {
+        regions[k] = slice_regions(outlines[k]);
+        if(regions[k].empty()==true)
+        {
+            std::cout << "Error: Slice " << k+1 << " has no plane surfaces." << std::endl;
+            return EXIT_FAILURE;
+        }
+        double plane_z = regions[k][0].outline->corners[0].z;
+        for (auto region_it = regions[k].begin(); region_it != regions[k].end(); region_it++)
+        {
+            for (auto pt_it = region_it->outline->corners.begin(); pt_it != region_it->outline->corners.end(); pt_it++)
+            {
+                if(pt_it->z!=plane_z)
+                {
+                    std::cout << "Error: Slice " << k+1 << " does not lie in one x-y plane." << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+    }
+    std::vector<std::future<std::vector<int>>> matching;
+    for (size_t k = 0; k+1 < slices.size(); k++)
+    {
+        matching.push_back(std::async(std::launch::async, [&regions, k]() {
+            return match_regions(regions[k], regions[k+1]);
+        }));
+    }
+    stack_builder builder;
+    size_t lofted = 0;
+    size_t ended = 0;
+    for (size_t k = 0; k+1 < slices.size(); k++)
+    {
+        std::vector<int> matches = matching[k].get();
+        const std::vector<region> &lower = regions[k];
+        const std::vector<region> &upper = regions[k+1];
+        double lower_z = k*spacing;
+        double upper_z = (k+1)*spacing;
+        double middle_z = (k+0.5)*spacing;
+        std::vector<char> upper_joined(upper.size(), 0);
+        for (size_t i = 0; i < lower.size(); i++)
+        {
+            const std::vector<point> &lower_corners = lower[i].outline->corners;
+            int j = matches[i];
+            if( (j>=0) && (upper[j].outline->corners.size()==lower_corners.size()) )
+            {
+                builder.add_loft(lower_corners, lower_z,
+                                 align_corners(lower_corners, lower[i], upper[j].outline->corners, upper[j]),
+                                 upper_z, lower[i].outline->physical);
+                upper_joined[j] = 1;
+                lofted++;
+            }
+            else
+            {
+                builder.add_loft(lower_corners, lower_z, lower_corners, middle_z, lower[i].outline->physical);
+                ended++;
+            }
+        }
+        for (size_t j = 0; j < upper.size(); j++)
+        {
+            if(upper_joined[j]==0)
+            {
+                const std::vector<point> &upper_corners = upper[j].outline->corners;
+                builder.add_loft(upper_corners, middle_z, upper_corners, upper_z, upper[j].outline->physical);
+                ended++;
+            }
+        }
+    }
+    std::cout << "Stacked " << slices.size() << " slices: " << lofted << " lofted and "
+              << ended << " ending regions in " << builder.volume_count() << " volumes." << std::endl;
+    return builder.write_to(stacked);
+}
@@ -0,0 +1,196 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function definitions for reading and tokenizing Gmsh .geo
+ *              files
+ */
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "geofile_tokenizer.hpp"
+
+namespace {
+    struct keyword_entry
+    {
+        std::string_view text;
+        GEO::geo_argument code = GEO::eDefault;
+    };
+
+    constexpr keyword_entry KEYWORDS[] = {
+        {"Point",            GEO::ePoint},
+        {"cl__1",            GEO::eChar_Len},
+        {"Line",             GEO::eLine},
+        {"Line Loop",        GEO::eCurve_Loop},
+        {"Curve Loop",       GEO::eCurve_Loop},
+        {"Plane Surface",    GEO::ePlane_surface},
+        {"Surface",          GEO::ePlane_surface},
+        {"Surface Loop",     GEO::eSurface_loop},
+        {"Volume",           GEO::eVolume},
+        {"Physical Point",   GEO::ePhysical_Point},
+        {"Physical Line",    GEO::ePhysical_Curve},
+        {"Physical Curve",   GEO::ePhysical_Curve},
+        {"Physical Surface", GEO::ePhysical_Surface},
+        {"Physical Volume",  GEO::ePhysical_Volume},
+        {"MeshSpac",         GEO::eMesh_Spacing},
+        {"SetFactory",       GEO::eOpenCASCADE}
+    };
+    constexpr size_t KEYWORD_SLOTS = 32;
+
+    // Length, last and middle character give every keyword its own slot.
+    constexpr size_t keyword_slot(const std::string_view &word)
+    {
+        return (word.size() + 4*(unsigned char)word.back()
+                + 7*(unsigned char)word[word.size()/2]) % KEYWORD_SLOTS;
+    }
+
+    // Fails to compile if two keywords share a slot.
+    constexpr std::array<keyword_entry, KEYWORD_SLOTS> build_keyword_table()
+    {
+        std::array<keyword_entry, KEYWORD_SLOTS> table{};
+        for (const keyword_entry &entry : KEYWORDS)
+        {
+            size_t slot = keyword_slot(entry.text);
+            if (!table[slot].text.empty())
+                throw "keyword_slot does not separate the .geo keywords";
+            table[slot] = entry;
+        }
+        return table;
+    }
+    constexpr std::array<keyword_entry, KEYWORD_SLOTS> KEYWORD_TABLE = build_keyword_table();
+
+    // Character classes of the tokenizer, looked up instead of compared.
+    enum char_class : unsigned char { eText, eSeparator, eBlank };
+    constexpr std::array<char_class, 256> build_char_classes()
+    {
+        std::array<char_class, 256> classes{};
+        for (unsigned char c : {'(', ')', ',', '{', '}', '='})
+            classes[c] = eSeparator;
+        for (unsigned char c : {' ', '\t', '\r', '\n', '\v', '\f'})
+            classes[c] = eBlank;
+        return classes;
+    }
+    constexpr std::array<char_class, 256> CHAR_CLASSES = build_char_classes();
+
+    char_class class_of(const char &c)
+    {
+        return CHAR_CLASSES[(unsigned char)c];
+    }
+}
+
+GEO::mapped_file::~mapped_file()
+{
+    if (mapping!=nullptr)
+        munmap((void*)mapping, length);
+}
+
+int GEO::mapped_file::open(const std::string &path)
+{
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor<0)
+    {
+        std::cout << "Error: Unable to open \"" << path << "\"." << std::endl;
+        return EXIT_FAILURE;
+    }
+    struct stat file_status;
+    if ( (fstat(descriptor, &file_status)==0) && (file_status.st_size>0) )
+    {
+        void *address = mmap(nullptr, file_status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (address!=MAP_FAILED)
+        {
+            madvise(address, file_status.st_size, MADV_SEQUENTIAL);
+            mapping = (const char*)address;
+            length = file_status.st_size;
+        }
+    }
+    close(descriptor);
+    if (mapping==nullptr)
+    {
+        // Empty files, pipes and file systems without mmap support.
+        std::ifstream geo_file(path, std::ios::in | std::ios::binary);
+        if (!geo_file.is_open())
+        {
+            std::cout << "Error: Unable to open \"" << path << "\"." << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::ostringstream contents;
+        contents << geo_file.rdbuf();
+        buffer = contents.str();
+    }
+    return EXIT_SUCCESS;
+}
+
+void GEO::mapped_file::release(const size_t &offset)
+{
+    if (mapping==nullptr)
+        return;
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t end = std::min(offset, length)/page*page;
+    if (end>released)
+    {
+        madvise((void*)(mapping+released), end-released, MADV_DONTNEED);
+        released = end;
+    }
+}
+
+std::string_view GEO::mapped_file::contents() const
+{
+    if (mapping!=nullptr)
+        return std::string_view(mapping, length);
+    return buffer;
+}
+
+void GEO::split_geo_statement(const std::string_view &line, std::vector<std::string_view> &fields)
+{
+    fields.clear();
+    size_t field_start = 0;
+    for (size_t i = 0; i <= line.size(); i++)
+    {
+        if ( (i<line.size()) && (class_of(line[i])!=eSeparator) )
+            continue;
+        size_t first = field_start;
+        size_t last = i;
+        while ( (first<last) && (class_of(line[first])==eBlank) )
+            first++;
+        while ( (last>first) && (class_of(line[last-1])==eBlank) )
+            last--;
+        if (last>first)
+            fields.push_back(line.substr(first, last-first));
+        field_start = i+1;
+    }
+}
+
+GEO::geo_argument GEO::keyword_code(const std::string_view &keyword)
+{
+    if (keyword.empty())
+        return eBlank_Space;
+    const keyword_entry &entry = KEYWORD_TABLE[keyword_slot(keyword)];
+    return (entry.text==keyword) ? entry.code : eDefault;
+}
+
+bool GEO::parse_geo_integer(std::string_view field, int &value)
+{
+    if ( (field.size()>1) && (field[0]=='+') )
+        field.remove_prefix(1);
+    const char *field_end = field.data() + field.size();
+    std::from_chars_result result = std::from_chars(field.data(), field_end, value);
+    return (result.ec==std::errc()) && (result.ptr==field_end);
+}
+
+bool GEO::parse_geo_real(std::string_view field, double &value)
+{
+    if ( (field.size()>1) && (field[0]=='+') )
+        field.remove_prefix(1);
+    const char *field_end = field.data() + field.size();
+    std::from_chars_result result = std::from_chars(field.data(), field_end, value);
+    return (result.ec==std::errc()) && (result.ptr==field_end);
+}
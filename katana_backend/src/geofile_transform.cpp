@@ -0,0 +1,325 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function definitions for affine transforms of .geo point data
+ */
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "geofile_tokenizer.hpp"
+#include "geofile_transform.hpp"
+
+namespace {
+    // Points transformed per kernel call.
+    constexpr size_t STREAM_BATCH = 4096;
+    // Unchanged text is written and its mapped pages released at least this
+    // often, so long runs without points do not stay resident either.
+    constexpr size_t STREAM_CHUNK = 16 << 20;
+
+    // Rotation about one axis by an angle in radians, in the sense of the
+    // original rotate_X, rotate_Y and rotate_Z.
+    GEO::affine_transform axis_rotation(const int &axis, const double &theta)
+    {
+        GEO::affine_transform rotation;
+        int first = (axis+1)%3;
+        int second = (axis+2)%3;
+        double c = std::cos(theta);
+        double s = std::sin(theta);
+        rotation.m[first][first] = c;
+        rotation.m[first][second] = -s;
+        rotation.m[second][first] = s;
+        rotation.m[second][second] = c;
+        return rotation;
+    }
+
+    // Whether the line, after leading blanks, opens a Point statement.
+    bool starts_point(const std::string_view &line)
+    {
+        size_t first = line.find_first_not_of(" \t");
+        if ( (first==std::string_view::npos) || (line.compare(first, 5, "Point")!=0) )
+            return false;
+        size_t bracket = line.find_first_not_of(" \t", first+5);
+        return (bracket!=std::string_view::npos) && (line[bracket]=='(');
+    }
+}
+
+GEO::affine_transform GEO::translation(const double &delta_x, const double &delta_y, const double &delta_z)
+{
+    affine_transform shift;
+    shift.m[0][3] = delta_x;
+    shift.m[1][3] = delta_y;
+    shift.m[2][3] = delta_z;
+    return shift;
+}
+
+// Composes the three axis rotations once, so each point costs one
+// matrix product instead of three pairs of sin and cos.
+GEO::affine_transform GEO::rotation(const double &o_x,     const double &o_y,     const double &o_z,
+                                    const double &theta_x, const double &theta_y, const double &theta_z)
+{
+    const double degrees = std::acos(-1.0)/180;
+    affine_transform turn = chain(chain(axis_rotation(0, theta_x*degrees),
+                                        axis_rotation(1, theta_y*degrees)),
+                                  axis_rotation(2, theta_z*degrees));
+    return chain(chain(translation(-o_x, -o_y, -o_z), turn), translation(o_x, o_y, o_z));
+}
+
+GEO::affine_transform GEO::scaling(const double &factor)
+{
+    affine_transform scale;
+    for (int axis = 0; axis < 3; axis++)
+        scale.m[axis][axis] = factor;
+    return scale;
+}
+
+GEO::affine_transform GEO::chain(const affine_transform &first, const affine_transform &second)
+{
+    affine_transform product;
+    for (int row = 0; row < 3; row++)
+    {
+        for (int col = 0; col < 4; col++)
+        {
+            double sum = (col==3) ? second.m[row][3] : 0;
+            for (int k = 0; k < 3; k++)
+                sum += second.m[row][k]*first.m[k][col];
+            product.m[row][col] = sum;
+        }
+    }
+    return product;
+}
+
+// Coefficients are copied into locals so the compiler knows they do not
+// change with the stores, and the loop vectorises over the three arrays.
+void GEO::transform_points(const affine_transform &transform,
+                           double *x, double *y, double *z, const size_t &count)
+{
+    const double m00 = transform.m[0][0], m01 = transform.m[0][1], m02 = transform.m[0][2], m03 = transform.m[0][3];
+    const double m10 = transform.m[1][0], m11 = transform.m[1][1], m12 = transform.m[1][2], m13 = transform.m[1][3];
+    const double m20 = transform.m[2][0], m21 = transform.m[2][1], m22 = transform.m[2][2], m23 = transform.m[2][3];
+    for (size_t i = 0; i < count; i++)
+    {
+        double p_x = x[i], p_y = y[i], p_z = z[i];
+        x[i] = m00*p_x + m01*p_y + m02*p_z + m03;
+        y[i] = m10*p_x + m11*p_y + m12*p_z + m13;
+        z[i] = m20*p_x + m21*p_y + m22*p_z + m23;
+    }
+}
+
+// Point lines are collected a batch at a time: their coordinates go to the
+// kernel and the positions of the x, y and z fields are kept. Writing a
+// batch copies the text up to each field straight from the mapped input,
+// followed by the new coordinate in the shortest round-trip form, so the
+// text between points (and every other statement) is written in bulk.
+int GEO::stream_transform(const std::string &import_path, const std::string &export_path,
+                          const affine_transform &transform)
+{
+    std::error_code same_error;
+    if (std::filesystem::equivalent(import_path, export_path, same_error))
+    {
+        std::cout << "Error: Streaming needs an output file other than the input." << std::endl;
+        return EXIT_FAILURE;
+    }
+    mapped_file geo_file;
+    if (geo_file.open(import_path)==EXIT_FAILURE)
+        return EXIT_FAILURE;
+    std::ofstream out_file(export_path, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!out_file.is_open())
+    {
+        std::cout << "Error: Unable to open \"" << export_path << "\" for writing." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::string_view text = geo_file.contents();
+    std::vector<double> x(STREAM_BATCH), y(STREAM_BATCH), z(STREAM_BATCH);
+    std::vector<std::string_view> fields;
+    std::vector<std::string_view> coordinate_fields;    // x, y and z field of each batched point
+    size_t batched = 0;
+    size_t written = 0;                                 // Offset of the first unwritten character
+    auto write_batch = [&](const size_t &up_to) {
+        transform_points(transform, x.data(), y.data(), z.data(), batched);
+        char digits[32];
+        for (size_t i = 0; i < batched; i++)
+        {
+            const double values[3] = {x[i], y[i], z[i]};
+            for (int axis = 0; axis < 3; axis++)
+            {
+                const std::string_view &field = coordinate_fields[3*i+axis];
+                size_t field_start = field.data()-text.data();
+                out_file.write(text.data()+written, field_start-written);
+                std::to_chars_result result = std::to_chars(digits, digits+sizeof(digits), values[axis]);
+                out_file.write(digits, result.ptr-digits);
+                written = field_start+field.size();
+            }
+        }
+        out_file.write(text.data()+written, up_to-written);
+        written = up_to;
+        geo_file.release(written);
+        batched = 0;
+        coordinate_fields.clear();
+    };
+    int line_number = 1;
+    size_t line_start = 0;
+    while (line_start < text.size())
+    {
+        size_t line_end = text.find('\n', line_start);
+        if (line_end==std::string_view::npos)
+            line_end = text.size();
+        std::string_view file_line = text.substr(line_start, line_end-line_start);
+        if (starts_point(file_line))
+        {
+            split_geo_statement(file_line, fields);
+            if ( (fields.size()<5)||
+                 (parse_geo_real(fields[2], x[batched])==false)||
+                 (parse_geo_real(fields[3], y[batched])==false)||
+                 (parse_geo_real(fields[4], z[batched])==false) )
+            {
+                std::cout << "Error: Invalid value (line "
+                          << line_number << " of "
+                          << import_path << ")" << std::endl;
+                return EXIT_FAILURE;
+            }
+            coordinate_fields.insert(coordinate_fields.end(), fields.begin()+2, fields.begin()+5);
+            batched++;
+        }
+        line_start = std::min(line_end+1, text.size());
+        if ( (batched==STREAM_BATCH) || (line_start-written >= STREAM_CHUNK) )
+            write_batch(line_start);
+        line_number++;
+    }
+    write_batch(text.size());
+    out_file.close();
+    if (out_file.fail())
+    {
+        std::cout << "Error: Writing \"" << export_path << "\" failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int GEO::parse_pipeline(const std::vector<std::string> &arguments, std::vector<pipeline_step> &steps)
+{
+    size_t i = 0;
+    while (i < arguments.size())
+    {
+        const std::string &operation = arguments[i];
+        size_t value_count = 0;
+        if (operation=="-t")            value_count = 3;
+        else if (operation=="-r")       value_count = 6;
+        else if (operation=="-scale")   value_count = 1;
+        else if (operation=="-m")       value_count = 1;
+        else
+        {
+            std::cout << "Error: Unrecognized pipeline step <" << operation << ">. "
+                      << "Expected -t, -r, -scale or -m." << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (i+value_count >= arguments.size())
+        {
+            std::cout << "Error: Pipeline step " << operation << " expects "
+                      << value_count << " value(s)." << std::endl;
+            return EXIT_FAILURE;
+        }
+        pipeline_step step;
+        if (operation=="-m")
+            step.merge_path = arguments[i+1];
+        else
+        {
+            double values[6];
+            for (size_t v = 0; v < value_count; v++)
+            {
+                if (is_e_notation(arguments[i+1+v])==false)
+                {
+                    std::cout << "Error: Pipeline step " << operation << " has invalid value <"
+                              << arguments[i+1+v] << ">." << std::endl;
+                    return EXIT_FAILURE;
+                }
+                values[v] = std::stod(arguments[i+1+v]);
+            }
+            if (operation=="-t")
+                step.transform = translation(values[0], values[1], values[2]);
+            else if (operation=="-r")
+                step.transform = rotation(values[0], values[1], values[2], values[3], values[4], values[5]);
+            else
+                step.transform = scaling(values[0]);
+        }
+        steps.push_back(step);
+        i += 1+value_count;
+    }
+    return EXIT_SUCCESS;
+}
+
+int GEO::read_pipeline_file(const std::string &pipeline_path, std::vector<std::string> &arguments)
+{
+    std::ifstream pipeline_file(pipeline_path);
+    if (!pipeline_file.is_open())
+    {
+        std::cout << "Error: Unable to open \"" << pipeline_path << "\"." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::string file_line;
+    while (getline(pipeline_file, file_line))
+    {
+        std::istringstream words(file_line.substr(0, file_line.find("//")));
+        std::string word;
+        while (words >> word)
+            arguments.push_back(word);
+    }
+    return EXIT_SUCCESS;
+}
+
+// A transform applies to the input and to every file merged before it, so
+// the transform of each file is the product of the transform steps after
+// its merge. The files are imported and moved concurrently and then joined
+// by merge_geofiles, which runs the single coherence check.
+int GEO::run_pipeline(const std::string &input_path, const std::vector<pipeline_step> &steps,
+                      const double &weld_tolerance, const std::string &export_path)
+{
+    std::vector<std::string> paths = {input_path};
+    std::vector<affine_transform> transforms(1);
+    for (auto step_it = steps.begin(); step_it != steps.end(); step_it++)
+    {
+        if (step_it->merge_path.empty()==false)
+        {
+            paths.push_back(step_it->merge_path);
+            transforms.emplace_back();
+        }
+        else
+        {
+            for (auto transform_it = transforms.begin(); transform_it != transforms.end(); transform_it++)
+                *transform_it = chain(*transform_it, step_it->transform);
+        }
+    }
+    std::vector<geofile> files(paths.size());
+    files[0].set_weld_tolerance(weld_tolerance);
+    std::vector<std::future<int>> imports;
+    for (size_t k = 0; k < files.size(); k++)
+    {
+        imports.push_back(std::async(std::launch::async, [&files, &paths, &transforms, k]() {
+            if (files[k].import_geofile(paths[k])==EXIT_FAILURE)
+                return EXIT_FAILURE;
+            files[k].transform_data(transforms[k]);
+            return EXIT_SUCCESS;
+        }));
+    }
+    bool imported = true;
+    for (size_t k = 0; k < imports.size(); k++)
+    {
+        if (imports[k].get()!=EXIT_SUCCESS)
+        {
+            std::cout << "Error: Import of \"" << paths[k] << "\" failed." << std::endl;
+            imported = false;
+        }
+    }
+    if (imported==false)
+        return EXIT_FAILURE;
+    if (merge_geofiles(files)==EXIT_FAILURE)
+        return EXIT_FAILURE;
+    return files[0].export_geofile(export_path);
+}
@@ -0,0 +1,64 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function definitions for formatting Gmsh .geo file text
+ */
+#include <charconv>
+#include <chrono>
+#include <ctime>
+#include "geofile_writer.hpp"
+
+GEO::geo_text &GEO::geo_text::operator<<(const int &number)
+{
+    char digits[16];
+    std::to_chars_result result = std::to_chars(digits, digits+sizeof(digits), number);
+    text.append(digits, result.ptr);
+    return *this;
+}
+
+// Without a format std::to_chars writes the shortest text that parses back
+// to exactly the same double, in fixed or scientific notation, whichever is
+// shorter.
+GEO::geo_text &GEO::geo_text::operator<<(const double &number)
+{
+    char digits[32];
+    std::to_chars_result result = std::to_chars(digits, digits+sizeof(digits), number);
+    text.append(digits, result.ptr);
+    return *this;
+}
+
+GEO::geo_text &GEO::geo_text::operator<<(const member_span &members)
+{
+    for (auto member_it = members.begin(); member_it != members.end(); member_it++)
+    {
+        if (member_it != members.begin())
+            text.append(", ");
+        *this << *member_it;
+    }
+    return *this;
+}
+
+GEO::geo_text &GEO::geo_text::operator<<(const std::vector<int> &members)
+{
+    return *this << member_span{members.data(), members.size()};
+}
+
+void GEO::write_geo_header(geo_text &text, const bool &open_cascade)
+{
+    time_t creation_time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    text << "// -------------------------------------------------------------- //\n";
+    text << "//                    _                                           //\n";
+    text << "//          _________| |___________________________________       //\n";
+    text << "//         [_x_x_x_x_   ______________Katana______________/       //\n";
+    text << "//                   |_|                                          //\n";
+    text << "//                                                                //\n";
+    text << "//                      Katana Terminal Edition                   //\n";
+    text << "//    TCAD Tools for the Superconducting Electronics Community    //\n";
+    text << "// -------------------------------------------------------------- //\n";
+    text << "// File creation date = " << std::ctime(&creation_time);
+    text << "//\n";
+    if (open_cascade==true)
+        text << "SetFactory(\"OpenCASCADE\");\n";
+}
@@ -0,0 +1,274 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function definitions for polygon reduction kernels
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "geometry_kernels.hpp"
+
+// Branch-free min/max over the packed points. x86-64 only has packed 64-bit
+// min/max with AVX-512, so the default build runs this as scalar compares and
+// is no faster than the branching loop it replaced; with KATANA_NATIVE_ARCH
+// on an AVX-512 machine the compiler vectorises it.
+MODEL3D::point_bounds MODEL3D::kernel_bounds(const ClipperLib::IntPoint *points, const size_t &count)
+{
+    point_bounds bounds = {points[0].X, points[0].Y, points[0].X, points[0].Y};
+    for (size_t i = 1; i < count; i++)
+    {
+        bounds.min_x = std::min(bounds.min_x, points[i].X);
+        bounds.min_y = std::min(bounds.min_y, points[i].Y);
+        bounds.max_x = std::max(bounds.max_x, points[i].X);
+        bounds.max_y = std::max(bounds.max_y, points[i].Y);
+    }
+    return bounds;
+}
+
+void MODEL3D::kernel_merge_bounds(point_bounds &target, const point_bounds &addition)
+{
+    target.min_x = std::min(target.min_x, addition.min_x);
+    target.min_y = std::min(target.min_y, addition.min_y);
+    target.max_x = std::max(target.max_x, addition.max_x);
+    target.max_y = std::max(target.max_y, addition.max_y);
+}
+
+double MODEL3D::kernel_signed_area(const ClipperLib::IntPoint *points, const size_t &count)
+{
+    return kernel_moments(points, count).signed_area;
+}
+
+// Shoelace area and area centroid in one pass. The closing edge (last to
+// first point) is added after the loop so the loop body has no wrap-around.
+MODEL3D::polygon_moments MODEL3D::kernel_moments(const ClipperLib::IntPoint *points, const size_t &count)
+{
+    double area = 0;
+    double sum_x = 0;
+    double sum_y = 0;
+    auto add_edge = [&](const ClipperLib::IntPoint &p, const ClipperLib::IntPoint &q) {
+        double x_0 = (double)p.X;
+        double y_0 = (double)p.Y;
+        double x_1 = (double)q.X;
+        double y_1 = (double)q.Y;
+        double a = x_0*y_1 - x_1*y_0;
+        area += a;
+        sum_x += (x_0 + x_1)*a;
+        sum_y += (y_0 + y_1)*a;
+    };
+    for (size_t i = 0; i+1 < count; i++)
+        add_edge(points[i], points[i+1]);
+    add_edge(points[count-1], points[0]);
+    polygon_moments moments;
+    moments.signed_area = 0.5*area;
+    if(area!=0)
+    {
+        moments.centroid_x = sum_x/(3.0*area);
+        moments.centroid_y = sum_y/(3.0*area);
+    }
+    return moments;
+}
+
+// Distance statistics of the points about a centre, in one pass. Minimum and
+// maximum are tracked on squared distances, so the only root per point is
+// the one needed for the mean.
+MODEL3D::radial_spread MODEL3D::kernel_radial_spread(const ClipperLib::IntPoint *points, const size_t &count,
+                                                     const double &centre_x, const double &centre_y)
+{
+    double sum = 0;
+    double sum_sqr = 0;
+    double low = INFINITY;
+    double high = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        double dx = (double)points[i].X - centre_x;
+        double dy = (double)points[i].Y - centre_y;
+        double dist_sqr = dx*dx + dy*dy;
+        sum += std::sqrt(dist_sqr);
+        sum_sqr += dist_sqr;
+        low = std::min(low, dist_sqr);
+        high = std::max(high, dist_sqr);
+    }
+    radial_spread spread;
+    spread.mean = sum/count;
+    spread.min = std::sqrt(low);
+    spread.max = std::sqrt(high);
+    spread.variance = std::max(0.0, sum_sqr/count - spread.mean*spread.mean);
+    return spread;
+}
+
+// Sweep over the boxes in order of min_x, keeping the boxes whose x-range
+// is still open. Overlapping boxes are joined in a union-find forest.
+std::vector<std::vector<size_t>> MODEL3D::overlap_groups(const std::vector<point_bounds> &boxes)
+{
+    std::vector<size_t> parent(boxes.size());
+    for (size_t i = 0; i < boxes.size(); i++)
+        parent[i] = i;
+    auto find_root = [&](size_t i) {
+        while (parent[i]!=i)
+        {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    };
+    std::vector<size_t> order(boxes.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](const size_t &a, const size_t &b) {
+        return boxes[a].min_x < boxes[b].min_x;
+    });
+    std::vector<size_t> active;
+    for (auto order_it = order.begin(); order_it != order.end(); order_it++)
+    {
+        const point_bounds &box = boxes[*order_it];
+        active.erase(std::remove_if(active.begin(), active.end(), [&](const size_t &i) {
+            return boxes[i].max_x < box.min_x;
+        }), active.end());
+        for (auto active_it = active.begin(); active_it != active.end(); active_it++)
+        {
+            const point_bounds &other = boxes[*active_it];
+            if( (other.min_y<=box.max_y) && (box.min_y<=other.max_y) )
+                parent[find_root(*active_it)] = find_root(*order_it);
+        }
+        active.push_back(*order_it);
+    }
+    std::vector<std::vector<size_t>> groups;
+    std::vector<size_t> group_of(boxes.size(), boxes.size());
+    for (size_t i = 0; i < boxes.size(); i++)
+    {
+        size_t root = find_root(i);
+        if(group_of[root]==boxes.size())
+        {
+            group_of[root] = groups.size();
+            groups.emplace_back();
+        }
+        groups[group_of[root]].push_back(i);
+    }
+    return groups;
+}
+
+namespace {
+    // Per-point versions in the form the model helpers used before the
+    // kernels, timed alongside them: bounds with a flag check per coordinate
+    // and separate x and y passes, and the circle statistics as separate
+    // centroid, distance and area passes.
+    MODEL3D::point_bounds reference_bounds(const ClipperLib::Path &path)
+    {
+        MODEL3D::point_bounds bounds = {0, 0, 0, 0};
+        bool empty[4] = {true, true, true, true};
+        for (auto pt_it = path.begin(); pt_it != path.end(); pt_it++)
+        {
+            if( (empty[0]==true) || (pt_it->X < bounds.min_x) ) { bounds.min_x = pt_it->X; empty[0] = false; }
+            if( (empty[2]==true) || (pt_it->X > bounds.max_x) ) { bounds.max_x = pt_it->X; empty[2] = false; }
+        }
+        for (auto pt_it = path.begin(); pt_it != path.end(); pt_it++)
+        {
+            if( (empty[1]==true) || (pt_it->Y < bounds.min_y) ) { bounds.min_y = pt_it->Y; empty[1] = false; }
+            if( (empty[3]==true) || (pt_it->Y > bounds.max_y) ) { bounds.max_y = pt_it->Y; empty[3] = false; }
+        }
+        return bounds;
+    }
+
+    double reference_circle_statistics(const ClipperLib::Path &path)
+    {
+        double area = 0, sum_x = 0, sum_y = 0;
+        size_t n = path.size();
+        for (size_t i = 0; i < n; i++)
+        {
+            double x_0 = path[i].X, y_0 = path[i].Y;
+            double x_1 = path[(i+1)%n].X, y_1 = path[(i+1)%n].Y;
+            double a = x_0*y_1 - x_1*y_0;
+            area += a;
+            sum_x += (x_0 + x_1)*a;
+            sum_y += (y_0 + y_1)*a;
+        }
+        double centre_x = std::round(sum_x/(3.0*area));
+        double centre_y = std::round(sum_y/(3.0*area));
+        auto distance = [&](const ClipperLib::IntPoint &pt) {
+            return std::round(std::sqrt(std::pow(pt.X - centre_x, 2) + std::pow(pt.Y - centre_y, 2)));
+        };
+        double sum = 0;
+        for (auto pt_it = path.begin(); pt_it != path.end(); pt_it++)
+            sum += distance(*pt_it);
+        double mean = sum/n;
+        double furthest = 0;
+        for (auto pt_it = path.begin(); pt_it != path.end(); pt_it++)
+            furthest = std::max(furthest, std::abs(distance(*pt_it) - mean));
+        return mean + furthest + ClipperLib::Area(path);
+    }
+
+    template <typename F>
+    void time_kernel(const std::string &name, const std::vector<ClipperLib::Path> &paths,
+                     const size_t &total_points, const int &repeats, F kernel)
+    {
+        double checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeats; r++)
+        {
+            for (auto path_it = paths.begin(); path_it != paths.end(); path_it++)
+                checksum += kernel(*path_it);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        double ns_per_point = elapsed.count()*1e9/((double)total_points*repeats);
+        std::cout << "  " << std::left << std::setw(26) << name << std::right
+                  << std::fixed << std::setprecision(3) << std::setw(9) << ns_per_point << " ns/point"
+                  << std::setprecision(1) << std::setw(10) << 1e3/ns_per_point << " Mpoints/s"
+                  << "   (check " << std::scientific << std::setprecision(3) << checksum << ")"
+                  << std::defaultfloat << std::endl;
+    }
+}
+
+// Times each kernel against the per-point loops it replaced, on randomly
+// perturbed circles of a size typical of rounded layout features. The data
+// set fits in cache so the timings reflect computation, not memory traffic.
+int MODEL3D::run_kernel_benchmarks()
+{
+    const size_t polygon_count = 256;
+    const size_t points_per_polygon = 128;
+    const int repeats = 2000;
+    std::mt19937_64 generator(1);
+    std::uniform_int_distribution<ClipperLib::cInt> centre_dist(-1000000, 1000000);
+    std::uniform_int_distribution<ClipperLib::cInt> jitter_dist(-50, 50);
+    const double full_turn = 2*std::acos(-1.0);
+    std::vector<ClipperLib::Path> paths(polygon_count);
+    for (auto path_it = paths.begin(); path_it != paths.end(); path_it++)
+    {
+        ClipperLib::cInt centre_x = centre_dist(generator);
+        ClipperLib::cInt centre_y = centre_dist(generator);
+        for (size_t i = 0; i < points_per_polygon; i++)
+        {
+            double angle = full_turn*i/points_per_polygon;
+            path_it->push_back(ClipperLib::IntPoint(
+                centre_x + (ClipperLib::cInt)std::round(2000*std::cos(angle)) + jitter_dist(generator),
+                centre_y + (ClipperLib::cInt)std::round(2000*std::sin(angle)) + jitter_dist(generator)));
+        }
+    }
+    size_t total_points = polygon_count*points_per_polygon;
+    std::cout << "Geometry kernel benchmark: " << polygon_count << " polygons x "
+              << points_per_polygon << " points, " << repeats << " repeats" << std::endl;
+    time_kernel("bounds (reference)", paths, total_points, repeats, [](const ClipperLib::Path &p) {
+        point_bounds b = reference_bounds(p);
+        return (double)(b.max_x - b.min_x);
+    });
+    time_kernel("bounds (kernel)", paths, total_points, repeats, [](const ClipperLib::Path &p) {
+        point_bounds b = kernel_bounds(p.data(), p.size());
+        return (double)(b.max_x - b.min_x);
+    });
+    time_kernel("circle stats (reference)", paths, total_points, repeats, [](const ClipperLib::Path &p) {
+        return reference_circle_statistics(p);
+    });
+    time_kernel("circle stats (kernel)", paths, total_points, repeats, [](const ClipperLib::Path &p) {
+        polygon_moments m = kernel_moments(p.data(), p.size());
+        radial_spread r = kernel_radial_spread(p.data(), p.size(),
+                                               std::round(m.centroid_x), std::round(m.centroid_y));
+        return r.mean + std::max(r.max - r.mean, r.mean - r.min) + m.signed_area;
+    });
+    return EXIT_SUCCESS;
+}
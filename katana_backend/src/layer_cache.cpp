@@ -0,0 +1,140 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function definitions for the per-layer model fragment cache
+ */
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "layer_cache.hpp"
+
+void MODEL3D::content_hash::add(const void *data, const size_t &size)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        value ^= bytes[i];
+        value *= FNV_PRIME;
+    }
+}
+
+// Strings are length-prefixed so that consecutive fields cannot run together.
+void MODEL3D::content_hash::add(const std::string &text)
+{
+    add((int64_t)text.size());
+    add(text.data(), text.size());
+}
+
+std::string MODEL3D::content_hash::hex() const
+{
+    std::ostringstream hex_stream;
+    hex_stream << std::hex << std::setw(16) << std::setfill('0') << value;
+    return hex_stream.str();
+}
+
+// Creates the cache directory if needed and enables the cache.
+int MODEL3D::layer_cache::open(const std::string &directory)
+{
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if(error)
+    {
+        std::cout << "Warning: Unable to create cache directory \"" << directory
+                  << "\". Incremental generation disabled." << std::endl;
+        enabled = false;
+        return EXIT_FAILURE;
+    }
+    cache_dir = directory;
+    enabled = true;
+    return EXIT_SUCCESS;
+}
+
+std::string MODEL3D::layer_cache::layer_dir(const int &layer_number) const
+{
+    return cache_dir + "/layer_" + std::to_string(layer_number);
+}
+
+// Reads a cached text fragment. Returns false on a cache miss.
+bool MODEL3D::layer_cache::fetch(const int &layer_number, const std::string &fragment_name, std::string &contents) const
+{
+    if(enabled==false)
+        return false;
+    std::ifstream fragment_file(layer_dir(layer_number) + "/" + fragment_name, std::ios::in | std::ios::binary);
+    if(!fragment_file.is_open())
+        return false;
+    std::ostringstream fragment_stream;
+    fragment_stream << fragment_file.rdbuf();
+    contents = fragment_stream.str();
+    return true;
+}
+
+// Writes a text fragment. The file is written under a temporary name and
+// renamed into place so an interrupted run never leaves a partial fragment.
+int MODEL3D::layer_cache::store(const int &layer_number, const std::string &fragment_name, const std::string &contents) const
+{
+    if(enabled==false)
+        return EXIT_FAILURE;
+    std::error_code error;
+    std::filesystem::create_directories(layer_dir(layer_number), error);
+    std::string final_path = layer_dir(layer_number) + "/" + fragment_name;
+    std::string temp_path = final_path + ".tmp";
+    std::ofstream fragment_file(temp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!fragment_file.is_open())
+        return EXIT_FAILURE;
+    fragment_file.write(contents.data(), contents.size());
+    fragment_file.close();
+    if(fragment_file.fail())
+        return EXIT_FAILURE;
+    std::filesystem::rename(temp_path, final_path, error);
+    return (error) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// Copies a cached file fragment to target_path. Returns false on a cache miss.
+bool MODEL3D::layer_cache::fetch_file(const int &layer_number, const std::string &fragment_name, const std::string &target_path) const
+{
+    if(enabled==false)
+        return false;
+    std::error_code error;
+    std::filesystem::copy_file(layer_dir(layer_number) + "/" + fragment_name, target_path,
+                               std::filesystem::copy_options::overwrite_existing, error);
+    return !error;
+}
+
+int MODEL3D::layer_cache::store_file(const int &layer_number, const std::string &fragment_name, const std::string &source_path) const
+{
+    if(enabled==false)
+        return EXIT_FAILURE;
+    std::error_code error;
+    std::filesystem::create_directories(layer_dir(layer_number), error);
+    std::string final_path = layer_dir(layer_number) + "/" + fragment_name;
+    std::filesystem::copy_file(source_path, final_path + ".tmp",
+                               std::filesystem::copy_options::overwrite_existing, error);
+    if(!error)
+        std::filesystem::rename(final_path + ".tmp", final_path, error);
+    return (error) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// Removes fragments of a layer that were produced from other inputs.
+void MODEL3D::layer_cache::prune(const int &layer_number, const std::string &current_hash) const
+{
+    if(enabled==false)
+        return;
+    std::error_code error;
+    std::filesystem::directory_iterator dir_it(layer_dir(layer_number), error);
+    if(error)
+        return;
+    std::vector<std::filesystem::path> stale_files;
+    for (auto entry_it = std::filesystem::begin(dir_it); entry_it != std::filesystem::end(dir_it); entry_it++)
+    {
+        std::string file_name = entry_it->path().filename().string();
+        if(file_name.compare(0, current_hash.size(), current_hash)!=0)
+            stale_files.push_back(entry_it->path());
+    }
+    for (auto file_it = stale_files.begin(); file_it != stale_files.end(); file_it++)
+        std::filesystem::remove(*file_it, error);
+}
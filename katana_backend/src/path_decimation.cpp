@@ -0,0 +1,229 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function definitions for polygon vertex decimation
+ */
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+#include "path_decimation.hpp"
+
+namespace {
+  double squared_distance(const ClipperLib::IntPoint &a, const ClipperLib::IntPoint &b)
+  {
+    double dx = (double)(b.X - a.X);
+    double dy = (double)(b.Y - a.Y);
+    return dx*dx + dy*dy;
+  }
+
+  // Twice the area of the triangle a, b, c.
+  double double_triangle_area(const ClipperLib::IntPoint &a,
+                              const ClipperLib::IntPoint &b,
+                              const ClipperLib::IntPoint &c)
+  {
+    return std::abs( (double)(b.X - a.X)*(double)(c.Y - a.Y)
+                   - (double)(c.X - a.X)*(double)(b.Y - a.Y) );
+  }
+
+  // Squared distance from p to the segment a-b.
+  double squared_segment_distance(const ClipperLib::IntPoint &p,
+                                  const ClipperLib::IntPoint &a,
+                                  const ClipperLib::IntPoint &b)
+  {
+    double length_sqr = squared_distance(a, b);
+    if(length_sqr==0)
+      return squared_distance(a, p);
+    double t = ( (double)(p.X - a.X)*(double)(b.X - a.X)
+               + (double)(p.Y - a.Y)*(double)(b.Y - a.Y) ) / length_sqr;
+    if(t<=0)
+      return squared_distance(a, p);
+    if(t>=1)
+      return squared_distance(b, p);
+    double area = double_triangle_area(a, b, p);
+    return area*area/length_sqr;
+  }
+
+  // Moves the points flagged in keep to the front of the path and drops the rest.
+  void compact_path(ClipperLib::Path &path, const std::vector<bool> &keep)
+  {
+    size_t write_index = 0;
+    for (size_t read_index = 0; read_index < path.size(); read_index++)
+    {
+      if(keep[read_index]==true)
+        path[write_index++] = path[read_index];
+    }
+    path.resize(write_index);
+  }
+}
+
+void MODEL3D::decimate_path(ClipperLib::Path &path, const double &tolerance, const decimation_mode &mode)
+{
+  switch (mode)
+  {
+  case eDouglasPeucker:
+    douglas_peucker_decimate(path, tolerance);
+    break;
+  case eVisvalingam:
+    visvalingam_decimate(path, tolerance);
+    break;
+  default:
+    radial_decimate(path, tolerance);
+    break;
+  }
+}
+
+// Keeps the first point, then every point that lies at least the tolerance
+// away from the previously kept point. Linear in the number of points.
+void MODEL3D::radial_decimate(ClipperLib::Path &path, const double &tolerance)
+{
+  if(path.size()<2)
+    return;
+  double tolerance_sqr = tolerance*tolerance;
+  size_t write_index = 1;
+  for (size_t read_index = 1; read_index < path.size(); read_index++)
+  {
+    if(squared_distance(path[write_index-1], path[read_index]) >= tolerance_sqr)
+      path[write_index++] = path[read_index];
+  }
+  path.resize(write_index);
+}
+
+// Closed-ring Douglas-Peucker. The ring is split at the first point and the
+// point furthest from it, and each half is simplified with an explicit stack.
+// A ring thinner than the tolerance keeps its point furthest from the split
+// chord as well, so at least 3 points remain.
+void MODEL3D::douglas_peucker_decimate(ClipperLib::Path &path, const double &tolerance)
+{
+  size_t n = path.size();
+  if(n<4)
+    return;
+  double tolerance_sqr = tolerance*tolerance;
+  size_t split_index = 0;
+  double split_distance = -1;
+  for (size_t i = 1; i < n; i++)
+  {
+    double distance = squared_distance(path[0], path[i]);
+    if(distance > split_distance)
+    {
+      split_distance = distance;
+      split_index = i;
+    }
+  }
+  std::vector<bool> keep(n, false);
+  keep[0] = true;
+  keep[split_index] = true;
+  size_t kept = 2;
+  // Ranges are (first, last) indices into the ring, with last==n meaning point 0.
+  std::vector<std::pair<size_t, size_t>> ranges = {{0, split_index}, {split_index, n}};
+  while (!ranges.empty())
+  {
+    size_t first = ranges.back().first;
+    size_t last = ranges.back().second;
+    ranges.pop_back();
+    const ClipperLib::IntPoint &a = path[first];
+    const ClipperLib::IntPoint &b = path[last % n];
+    size_t furthest = first;
+    double furthest_distance = tolerance_sqr;
+    for (size_t i = first+1; i < last; i++)
+    {
+      double distance = squared_segment_distance(path[i], a, b);
+      if(distance > furthest_distance)
+      {
+        furthest_distance = distance;
+        furthest = i;
+      }
+    }
+    if(furthest!=first)
+    {
+      keep[furthest] = true;
+      kept++;
+      ranges.push_back({first, furthest});
+      ranges.push_back({furthest, last});
+    }
+  }
+  if(kept<3)
+  {
+    size_t furthest = 0;
+    double furthest_distance = -1;
+    for (size_t i = 1; i < n; i++)
+    {
+      if(i==split_index)
+        continue;
+      double distance = squared_segment_distance(path[i], path[0], path[split_index]);
+      if(distance > furthest_distance)
+      {
+        furthest_distance = distance;
+        furthest = i;
+      }
+    }
+    keep[furthest] = true;
+  }
+  compact_path(path, keep);
+}
+
+// Closed-ring Visvalingam-Whyatt. Repeatedly removes the point whose triangle
+// with its two neighbours has the smallest area until every remaining
+// triangle is at least half a tolerance square, keeping at least 3 points.
+void MODEL3D::visvalingam_decimate(ClipperLib::Path &path, const double &tolerance)
+{
+  size_t n = path.size();
+  if(n<4)
+    return;
+  double area_limit = tolerance*tolerance; // Twice the area of half a tolerance square
+  std::vector<size_t> prev(n), next(n);
+  std::vector<double> area(n);
+  std::vector<bool> keep(n, true);
+  for (size_t i = 0; i < n; i++)
+  {
+    prev[i] = (i+n-1)%n;
+    next[i] = (i+1)%n;
+  }
+  typedef std::pair<double, size_t> area_entry;
+  std::priority_queue<area_entry, std::vector<area_entry>, std::greater<area_entry>> smallest;
+  for (size_t i = 0; i < n; i++)
+  {
+    area[i] = double_triangle_area(path[prev[i]], path[i], path[next[i]]);
+    smallest.push({area[i], i});
+  }
+  size_t remaining = n;
+  while ( (remaining>3) && (!smallest.empty()) )
+  {
+    area_entry entry = smallest.top();
+    smallest.pop();
+    size_t i = entry.second;
+    // Entries are not updated in place; skip the ones that are out of date
+    if( (keep[i]==false) || (entry.first!=area[i]) )
+      continue;
+    if(entry.first >= area_limit)
+      break;
+    keep[i] = false;
+    remaining--;
+    next[prev[i]] = next[i];
+    prev[next[i]] = prev[i];
+    size_t neighbours[2] = {prev[i], next[i]};
+    for (size_t neighbour : neighbours)
+    {
+      area[neighbour] = double_triangle_area(path[prev[neighbour]], path[neighbour], path[next[neighbour]]);
+      smallest.push({area[neighbour], neighbour});
+    }
+  }
+  compact_path(path, keep);
+}
+
+bool MODEL3D::parse_decimation_mode(const std::string &mode_name, decimation_mode &mode)
+{
+  if(mode_name=="radial")
+    mode = eRadial;
+  else if( (mode_name=="douglas-peucker") || (mode_name=="dp") )
+    mode = eDouglasPeucker;
+  else if( (mode_name=="visvalingam") || (mode_name=="vw") )
+    mode = eVisvalingam;
+  else
+    return false;
+  return true;
+}
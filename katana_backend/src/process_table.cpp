@@ -0,0 +1,331 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function definitions for process information and layer
+ *              definition file parsing
+ */
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include "process_table.hpp"
+
+namespace {
+  // Parsed files, kept so that repeated runs in one process do not parse the
+  // same unchanged file again.
+  struct cached_file {
+    std::uintmax_t size;
+    std::filesystem::file_time_type modified;
+    std::vector<MODEL3D::process_block> blocks;
+  };
+  std::map<std::string, cached_file> file_cache;
+  std::mutex file_cache_mutex;
+
+  const char *WHITESPACE = " \t\r";
+
+  std::string trim(const std::string &text, const size_t &begin, const size_t &end)
+  {
+    size_t first = text.find_first_not_of(WHITESPACE, begin);
+    if( (first==std::string::npos) || (first>=end) )
+      return "";
+    size_t last = text.find_last_not_of(WHITESPACE, end-1);
+    return text.substr(first, last-first+1);
+  }
+
+  bool parse_integer(const std::string &value, int &result)
+  {
+    if(value.empty())
+      return false;
+    char *end;
+    errno = 0;
+    long number = std::strtol(value.c_str(), &end, 10);
+    if( (*end!='\0') || (errno!=0) || (number<INT_MIN) || (number>INT_MAX) )
+      return false;
+    result = (int)number;
+    return true;
+  }
+
+  bool parse_real(const std::string &value, double &result)
+  {
+    if(value.empty())
+      return false;
+    char *end;
+    result = std::strtod(value.c_str(), &end);
+    return *end=='\0';
+  }
+
+  void report_line(const std::string &message, const int &line_number)
+  {
+    std::cout << "Error: " << message << std::endl;
+    std::cout << "Line " << line_number << ". " << std::endl;
+  }
+}
+
+// Splits the text of a .pf or .ldf file into its blocks in a single pass.
+// Blank lines, lines starting with '*' and lines outside blocks are skipped.
+// Every other line in a block must be of the form "Key = Value".
+int MODEL3D::tokenize_process_text( const std::string &text,
+                                    const std::string &source_name,
+                                    std::vector<process_block> &blocks)
+{
+  blocks.clear();
+  bool in_block = false;
+  int line_number = 0;
+  size_t line_start = 0;
+  while (line_start < text.size())
+  {
+    size_t line_end = text.find('\n', line_start);
+    if(line_end==std::string::npos)
+      line_end = text.size();
+    line_number++;
+    size_t first = text.find_first_not_of(WHITESPACE, line_start);
+    if( (first!=std::string::npos) && (first<line_end) && (text[first]!='*') )
+    {
+      if(text[first]=='$')
+      {
+        std::string block_type = trim(text, first+1, line_end);
+        if(block_type=="End")
+        {
+          if(in_block==false)
+          {
+            report_line("$End without a matching block in \"" + source_name + "\".", line_number);
+            return EXIT_FAILURE;
+          }
+          in_block = false;
+        }
+        else
+        {
+          if(in_block==true)
+          {
+            report_line("$" + blocks.back().type + " block in \"" + source_name + "\" is not closed with $End.", line_number);
+            return EXIT_FAILURE;
+          }
+          blocks.push_back({block_type, line_number, {}});
+          in_block = true;
+        }
+      }
+      else if(in_block==true)
+      {
+        size_t equals = text.find('=', first);
+        if( (equals==std::string::npos) || (equals>=line_end) )
+        {
+          report_line("Expected \"Key = Value\" in \"" + source_name + "\".", line_number);
+          return EXIT_FAILURE;
+        }
+        blocks.back().entries.push_back({ trim(text, first, equals),
+                                          trim(text, equals+1, line_end),
+                                          line_number });
+      }
+    }
+    line_start = line_end + 1;
+  }
+  if(in_block==true)
+  {
+    report_line("$" + blocks.back().type + " block in \"" + source_name + "\" is not closed with $End.", blocks.back().line_number);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+// Reads and tokenizes a .pf or .ldf file. A file that has not changed since
+// it was last read in this process is taken from the cache.
+int MODEL3D::read_process_file(const std::string &path, std::vector<process_block> &blocks)
+{
+  std::error_code error;
+  std::uintmax_t size = std::filesystem::file_size(path, error);
+  std::filesystem::file_time_type modified = std::filesystem::last_write_time(path, error);
+  if(error)
+  {
+    std::cout << "Error: Unable to open \"" << path << "\"." << std::endl;
+    return EXIT_FAILURE;
+  }
+  {
+    std::lock_guard<std::mutex> lock(file_cache_mutex);
+    auto cache_it = file_cache.find(path);
+    if( (cache_it!=file_cache.end()) && (cache_it->second.size==size) && (cache_it->second.modified==modified) )
+    {
+      blocks = cache_it->second.blocks;
+      return EXIT_SUCCESS;
+    }
+  }
+  std::ifstream process_file(path, std::ios::in | std::ios::binary);
+  if(!process_file.is_open())
+  {
+    std::cout << "Error: Unable to open \"" << path << "\"." << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::ostringstream contents;
+  contents << process_file.rdbuf();
+  if(tokenize_process_text(contents.str(), path, blocks)==EXIT_FAILURE)
+    return EXIT_FAILURE;
+  std::lock_guard<std::mutex> lock(file_cache_mutex);
+  file_cache[path] = {size, modified, blocks};
+  return EXIT_SUCCESS;
+}
+
+// Builds the 3D model process table from the $Layer blocks of a .pf file.
+// Every block must give Number, Name, MaskType, ZStart, Thickness and
+// Material. A repeated layer number keeps its first definition.
+int MODEL3D::build_pif_table(const std::vector<process_block> &blocks, process_table<Layer_prop> &table)
+{
+  const char *required[6] = {"Number", "Name", "MaskType", "ZStart", "Thickness", "Material"};
+  std::vector<std::pair<int, Layer_prop>> numbered;
+  auto blocks_end = blocks.end();
+  for (auto block_it = blocks.begin(); block_it != blocks_end; block_it++)
+  {
+    if(block_it->type!="Layer")
+      continue;
+    int layer_number = 0;
+    Layer_prop layer_block;
+    bool loaded[6] = {false, false, false, false, false, false};
+    auto entries_end = block_it->entries.end();
+    for (auto entry_it = block_it->entries.begin(); entry_it != entries_end; entry_it++)
+    {
+      int field = (int)(std::find_if(required, required+6, [&](const char *key) { return entry_it->key==key; }) - required);
+      int *integer_value = nullptr;
+      switch (field)
+      {
+      case 0: integer_value = &layer_number; break;
+      case 1: layer_block.name = entry_it->value; break;
+      case 2: integer_value = &layer_block.mask_type; break;
+      case 3: integer_value = &layer_block.z_start; break;
+      case 4: integer_value = &layer_block.thickness; break;
+      case 5: layer_block.material = entry_it->value; break;
+      default:
+        std::cout   << "Warning: Unknown property specified in .PF file ["
+                    << entry_it->key << "]." << std::endl;
+        std::cout << "Line " << entry_it->line_number << ". " << std::endl;
+        continue;
+      }
+      if( (integer_value!=nullptr) && (parse_integer(entry_it->value, *integer_value)==false) )
+      {
+        report_line(std::string(required[field]) + " is not an integer in .PF file.", entry_it->line_number);
+        return EXIT_FAILURE;
+      }
+      loaded[field] = true;
+    }
+    for (int field = 0; field < 6; field++)
+    {
+      if(loaded[field]==false)
+      {
+        report_line(std::string("Process information block has no ") + required[field] + " entry.", block_it->line_number);
+        return EXIT_FAILURE;
+      }
+    }
+    if( (layer_number<0) || (layer_number>MAX_LAYER_NUMBER) )
+    {
+      report_line("Layer number " + std::to_string(layer_number) + " is outside the GDS layer range.", block_it->line_number);
+      return EXIT_FAILURE;
+    }
+    if( (layer_block.mask_type<0) || (layer_block.mask_type>4) )
+    {
+      report_line("MaskType must be 0 (standard), 1 (inverted), 2 (filled), 3 (junction) or 4 (auxiliary).", block_it->line_number);
+      return EXIT_FAILURE;
+    }
+    if(layer_block.thickness<=0)
+    {
+      report_line("Thickness must be positive.", block_it->line_number);
+      return EXIT_FAILURE;
+    }
+    numbered.push_back({layer_number, layer_block});
+  }
+  table.assign(numbered, false);
+  return EXIT_SUCCESS;
+}
+
+// Builds the layer definition table from the $Parameters and $Layer blocks
+// of an .ldf file. Thickness is converted to nanometres with the Units
+// parameter. A repeated layer number keeps its last definition.
+int MODEL3D::build_ldf_table( const std::vector<process_block> &blocks,
+                              process_table<layer_data> &table,
+                              double &database_unit)
+{
+  database_unit = 0;
+  auto blocks_end = blocks.end();
+  for (auto block_it = blocks.begin(); block_it != blocks_end; block_it++)
+  {
+    if(block_it->type!="Parameters")
+      continue;
+    for (auto entry_it = block_it->entries.begin(); entry_it != block_it->entries.end(); entry_it++)
+    {
+      if( (entry_it->key=="Units") && (parse_real(entry_it->value, database_unit)==false) )
+      {
+        report_line("Units is not a number in .LDF file.", entry_it->line_number);
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  std::vector<std::pair<int, layer_data>> numbered;
+  for (auto block_it = blocks.begin(); block_it != blocks_end; block_it++)
+  {
+    if(block_it->type!="Layer")
+      continue;
+    int layer_number = -1;
+    layer_data layer_block;
+    auto entries_end = block_it->entries.end();
+    for (auto entry_it = block_it->entries.begin(); entry_it != entries_end; entry_it++)
+    {
+      const std::string &key = entry_it->key;
+      const std::string &value = entry_it->value;
+      bool valid = true;
+      if(key=="Number")
+        valid = parse_integer(value, layer_number);
+      else if(key=="Name")
+        layer_block.name = value;
+      else if(key=="Thickness")
+      {
+        // Always stores the thickness in nanometers
+        // t = value * database unit (usually um) * 1e9 (to nano)
+        double thickness = 0;
+        valid = parse_real(value, thickness);
+        if(database_unit<=0)
+        {
+          report_line("Thickness given before the Units parameter is defined in .LDF file.", entry_it->line_number);
+          return EXIT_FAILURE;
+        }
+        layer_block.thickness = (int)std::round(thickness * database_unit * 1e9);
+      }
+      else if(key=="Order")
+        valid = parse_integer(value, layer_block.order);
+      else if(key=="Mask")
+        valid = parse_integer(value, layer_block.mask);
+      else if(key=="Filmtype")
+      {
+        valid = !value.empty();
+        if(valid==true)
+          layer_block.film_type = value.back();
+      }
+      else if(key=="Colour")
+        valid = parse_integer(value, layer_block.colour);
+      if(valid==false)
+      {
+        report_line(key + " has an invalid value in .LDF file.", entry_it->line_number);
+        return EXIT_FAILURE;
+      }
+    }
+    if( (layer_number<0) || (layer_number>MAX_LAYER_NUMBER) )
+    {
+      report_line("Layer block has no valid Number in .LDF file.", block_it->line_number);
+      return EXIT_FAILURE;
+    }
+    numbered.push_back({layer_number, layer_block});
+  }
+  table.assign(numbered, true);
+  return EXIT_SUCCESS;
+}
+
+int MODEL3D::load_pif_table(const std::string &path, process_table<Layer_prop> &table)
+{
+  std::vector<process_block> blocks;
+  if(read_process_file(path, blocks)==EXIT_FAILURE)
+    return EXIT_FAILURE;
+  return build_pif_table(blocks, table);
+}
@@ -0,0 +1,119 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function definitions for the buffered script emitter
+ */
+
+#include <algorithm>
+#include <iostream>
+#include "script_emitter.hpp"
+
+// Opens (and truncates) the output file. Any previously open file is closed first.
+int MODEL3D::script_emitter::open(const std::string &path)
+{
+    close();
+    outfile.open(path, std::ios::out | std::ios::trunc);
+    if(!outfile.is_open())
+    {
+        std::cout << "Error: Unable to open \"" << path << "\" for writing." << std::endl;
+        return EXIT_FAILURE;
+    }
+    output_path = path;
+    lines_emitted = 0;
+    buffer.clear();
+    return EXIT_SUCCESS;
+}
+
+// Appends a line to the buffer, writing the buffer out when it would overflow.
+// Lines larger than the buffer itself are written straight through.
+void MODEL3D::script_emitter::push_back(const std::string &line)
+{
+    if(capturing==true)
+    {
+        captured.append(line);
+        captured.push_back('\n');
+        if(holding==true)
+            return;
+    }
+    lines_emitted++;
+    if(buffer.size() + line.size() + 1 > capacity)
+    {
+        flush();
+        if(line.size() + 1 > capacity)
+        {
+            outfile << line << '\n';
+            return;
+        }
+    }
+    buffer.append(line);
+    buffer.push_back('\n');
+}
+
+// Appends a block of previously generated, newline-terminated lines.
+void MODEL3D::script_emitter::push_fragment(const std::string &fragment)
+{
+    if(capturing==true)
+    {
+        captured.append(fragment);
+        if(holding==true)
+            return;
+    }
+    lines_emitted += std::count(fragment.begin(), fragment.end(), '\n');
+    if(buffer.size() + fragment.size() > capacity)
+    {
+        flush();
+        if(fragment.size() > capacity)
+        {
+            outfile.write(fragment.data(), fragment.size());
+            return;
+        }
+    }
+    buffer.append(fragment);
+}
+
+// Keeps a copy of every line emitted from now until end_capture(). With
+// hold set the lines are only captured and not written, so that the caller
+// can edit them before pushing them as a fragment.
+void MODEL3D::script_emitter::begin_capture(const bool &hold)
+{
+    captured.clear();
+    capturing = true;
+    holding = hold;
+}
+
+std::string MODEL3D::script_emitter::end_capture()
+{
+    capturing = false;
+    holding = false;
+    std::string fragment;
+    fragment.swap(captured);
+    return fragment;
+}
+
+// Writes all buffered lines to disk.
+void MODEL3D::script_emitter::flush()
+{
+    if(!buffer.empty())
+    {
+        outfile.write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+    outfile.flush();
+}
+
+int MODEL3D::script_emitter::close()
+{
+    if(!outfile.is_open())
+        return EXIT_SUCCESS;
+    flush();
+    bool write_failed = outfile.fail();
+    outfile.close();
+    if(write_failed)
+    {
+        std::cout << "Error: Writing \"" << output_path << "\" failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
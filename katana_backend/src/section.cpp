@@ -9,6 +9,7 @@
 #include "clipper.hpp"
 #include "gdsCpp.hpp"
 #include "pipolly.hpp"
+#include <algorithm>
 #include <cmath>
 using namespace std;
 
@@ -18,13 +19,12 @@ void section_data::polygon_to_gds(const string &outpath)
   gdsSTR main;
   main.name = "Polygons";
   vector<int> x_cor, y_cor;
-  // std::map<unsigned int, std::vector<co_ord>> polygons; // key = layer number
   for (auto polymap_it = polygons.begin(); polymap_it != polygons.end();
        polymap_it++) {
     for (auto layer_polygon_it = polymap_it->second.begin();
          layer_polygon_it < polymap_it->second.end(); layer_polygon_it++) {
-      main.BOUNDARY.push_back(drawBoundary(
-          polymap_it->first, layer_polygon_it->x, layer_polygon_it->y));
+      path_to_xy(*layer_polygon_it, x_cor, y_cor);
+      main.BOUNDARY.push_back(drawBoundary(polymap_it->first, x_cor, y_cor));
     }
   }
   my_polygons.setSTR(main);
@@ -134,21 +134,11 @@ int section_data::populate_polygons(gdscpp &gds_file)
       if (check_for_intercept(str_it->bounding_box, axis_type,
                               x1, y1, x2, y2) == true)
       {
-        std::map<unsigned int, std::vector<co_ord>> polygon_data;
+        polygon_store polygon_data;
         recursive_unpack(str_it->name, structure_vector, structure_lookup,
                          polygon_data);
         // append polygon data to polygons map
-        for (auto poly_it = polygon_data.begin(); poly_it != polygon_data.end();
-             poly_it++) {
-          if (polygons.count(poly_it->first) > 0) {
-            polygons[poly_it->first].insert(polygons[poly_it->first].end(),
-                                            poly_it->second.begin(),
-                                            poly_it->second.end());
-          } else {
-            polygons.insert(pair<unsigned int, vector<co_ord>>(
-                poly_it->first, poly_it->second));
-          }
-        }
+        combine_maps(polygons, polygon_data);
       }
     }
   }
@@ -162,8 +152,7 @@ int section_data::populate_polygons(gdscpp &gds_file)
  * @param polygons Map to extract polygons into.
  *  @return 0 - Function completed successfully.
  */
-int section_data::extract_all_polygons( gdscpp &gds_file,
-                                        std::map<unsigned int, std::vector<co_ord>> &polygons)
+int section_data::extract_all_polygons(gdscpp &gds_file, polygon_store &polygons)
 {
   vector<gdsSTR> structure_vector;
   unordered_map<string, int> structure_lookup;
@@ -172,24 +161,81 @@ int section_data::extract_all_polygons( gdscpp &gds_file,
        str_it++) {
     if (str_it->heirarchical_level == 0)
     {
-      std::map<unsigned int, std::vector<co_ord>> polygon_data;
+      polygon_store polygon_data;
       recursive_unpack(str_it->name, structure_vector, structure_lookup,
                         polygon_data);
       // append polygon data to polygons map
-      for (auto poly_it = polygon_data.begin();
-            poly_it != polygon_data.end();
-            poly_it++)
-        {
-        if (polygons.count(poly_it->first) > 0)
-        {
-          polygons[poly_it->first].insert(polygons[poly_it->first].end(),
-                                          poly_it->second.begin(),
-                                          poly_it->second.end());
-        } else {
-          polygons.insert(pair<unsigned int, vector<co_ord>>(
-          poly_it->first, poly_it->second));
-        }
-      }
+      combine_maps(polygons, polygon_data);
+    }
+  }
+  return EXIT_SUCCESS;
+}
+
+/**
+ *  @brief Variant of extract_all_polygons that only flattens the part of the
+ *         hierarchy that meets the window. Elements and references outside
+ *         the window are skipped without being unpacked. Polygons that cross
+ *         the window edge are kept whole. Every layer used by the design
+ *         is given an entry, which may be empty.
+ *  @param gds_file Gds file which holds the structure information
+ *  @param window Region to extract, in database units
+ *  @param polygons Map to extract polygons into.
+ *  @return 0 - Function completed successfully.
+ */
+int section_data::extract_window_polygons(gdscpp &gds_file,
+                                          const clip_window &window,
+                                          polygon_store &polygons)
+{
+  vector<gdsSTR> structure_vector;
+  unordered_map<string, int> structure_lookup;
+  gds_file.getSTR(structure_vector, structure_lookup);
+  structure_bounds_map bounds_cache;
+  for (auto str_it = structure_vector.begin(); str_it != structure_vector.end();
+       str_it++) {
+    clip_window bounds;
+    if ((str_it->heirarchical_level != 0) ||
+        (structure_bounds(str_it->name, structure_vector, structure_lookup,
+                          bounds_cache, bounds) == false))
+      continue;
+    // Every layer of the design gets an entry, even if none of its polygons
+    // meet the window, so that filled layers still cover the window.
+    for (auto layer : bounds_cache[structure_lookup[str_it->name]].layers)
+      polygons[layer];
+    if (windows_overlap(bounds, window) == true) {
+      polygon_store polygon_data;
+      recursive_unpack_window(str_it->name, structure_vector, structure_lookup,
+                              window, bounds_cache, polygon_data);
+      combine_maps(polygons, polygon_data);
+    }
+  }
+  return EXIT_SUCCESS;
+}
+
+/**
+ *  @brief Variant of extract_all_polygons that keeps leaf cells whole.
+ *         Unmagnified placements of leaf cells are listed per cell instead
+ *         of being flattened; everything else is flattened into polygons.
+ *  @param gds_file Gds file which holds the structure information
+ *  @param polygons Map to extract the flattened polygons into.
+ *  @param cells Leaf cells and their placements.
+ *  @return 0 - Function completed successfully.
+ */
+int section_data::extract_instanced_polygons(gdscpp &gds_file,
+                                             polygon_store &polygons,
+                                             vector<cell_instances> &cells)
+{
+  vector<gdsSTR> structure_vector;
+  unordered_map<string, int> structure_lookup;
+  gds_file.getSTR(structure_vector, structure_lookup);
+  map<pair<string, bool>, size_t> cell_lookup;
+  for (auto str_it = structure_vector.begin(); str_it != structure_vector.end();
+       str_it++) {
+    if (str_it->heirarchical_level == 0) {
+      polygon_store polygon_data;
+      recursive_unpack_instanced(str_it->name, structure_vector,
+                                 structure_lookup, gds_transform(),
+                                 polygon_data, cells, cell_lookup);
+      combine_maps(polygons, polygon_data);
     }
   }
   return EXIT_SUCCESS;
@@ -265,9 +311,9 @@ bool check_for_intercept(int *bounding_box, int &axis_type, int &x1, int &y1,
 void recursive_unpack(
     const std::string &structure_name, std::vector<gdsSTR> &struct_vect,
     std::unordered_map<std::string, int> &struct_lookup,
-    std::map<unsigned int, std::vector<co_ord>> &retrieved_polygon_data)
+    polygon_store &retrieved_polygon_data)
 {
-  std::map<unsigned int, std::vector<co_ord>> polygon_data;
+  polygon_store polygon_data;
   int structure_index = struct_lookup[structure_name];
   process_boundaries(struct_vect[structure_index].BOUNDARY, polygon_data);
   process_boxes(struct_vect[structure_index].BOX, polygon_data);
@@ -279,6 +325,433 @@ void recursive_unpack(
   combine_maps(retrieved_polygon_data, polygon_data);
 }
 
+namespace {
+  clip_window coordinate_bounds(const vector<int> &x, const vector<int> &y,
+                                ClipperLib::cInt expansion)
+  {
+    auto x_range = minmax_element(x.begin(), x.end());
+    auto y_range = minmax_element(y.begin(), y.end());
+    return {*x_range.first - expansion, *y_range.first - expansion,
+            *x_range.second + expansion, *y_range.second + expansion};
+  }
+
+  void merge_window(clip_window &target, const clip_window &addition)
+  {
+    target.min_x = min(target.min_x, addition.min_x);
+    target.min_y = min(target.min_y, addition.min_y);
+    target.max_x = max(target.max_x, addition.max_x);
+    target.max_y = max(target.max_y, addition.max_y);
+  }
+
+  clip_window shift_window(const clip_window &window, ClipperLib::cInt dx,
+                           ClipperLib::cInt dy)
+  {
+    return {window.min_x + dx, window.min_y + dy, window.max_x + dx,
+            window.max_y + dy};
+  }
+
+  // Bounds of the four corners of a window after applying point_transform,
+  // grown by one unit to cover rounding.
+  template <typename F>
+  clip_window corner_bounds(const clip_window &window, F point_transform)
+  {
+    double corners[4][2] = {{(double)window.min_x, (double)window.min_y},
+                            {(double)window.max_x, (double)window.min_y},
+                            {(double)window.max_x, (double)window.max_y},
+                            {(double)window.min_x, (double)window.max_y}};
+    double low[2] = {INFINITY, INFINITY};
+    double high[2] = {-INFINITY, -INFINITY};
+    for (auto &corner : corners) {
+      point_transform(corner[0], corner[1]);
+      low[0] = min(low[0], corner[0]);
+      low[1] = min(low[1], corner[1]);
+      high[0] = max(high[0], corner[0]);
+      high[1] = max(high[1], corner[1]);
+    }
+    return {(ClipperLib::cInt)floor(low[0]) - 1,
+            (ClipperLib::cInt)floor(low[1]) - 1,
+            (ClipperLib::cInt)ceil(high[0]) + 1,
+            (ClipperLib::cInt)ceil(high[1]) + 1};
+  }
+}
+
+bool windows_overlap(const clip_window &a, const clip_window &b)
+{
+  return (a.min_x <= b.max_x) && (b.min_x <= a.max_x) &&
+         (a.min_y <= b.max_y) && (b.min_y <= a.max_y);
+}
+
+// Bounds of a window after the reflect, scale, rotate and offset steps of
+// transform_polygon_map.
+clip_window transform_window(const clip_window &window, bool reflect_x,
+                             double magnification, int angle, int x_offset,
+                             int y_offset)
+{
+  double radians = (angle * PI) / ((double)180);
+  double s = sin(radians);
+  double c = cos(radians);
+  return corner_bounds(window, [&](double &x, double &y) {
+    if (reflect_x == true)
+      y = -y;
+    if (magnification != 0) {
+      x = x * magnification;
+      y = y * magnification;
+    }
+    double x_rotated = x * c - y * s;
+    y = x * s + y * c;
+    x = x_rotated + x_offset;
+    y = y + y_offset;
+  });
+}
+
+// Bounds of a window taken back through the transformation, i.e. the part
+// of the referenced structure that lands inside the window.
+clip_window inverse_transform_window(const clip_window &window, bool reflect_x,
+                                     double magnification, int angle,
+                                     int x_offset, int y_offset)
+{
+  double radians = (angle * PI) / ((double)180);
+  double s = sin(radians);
+  double c = cos(radians);
+  return corner_bounds(window, [&](double &x, double &y) {
+    x = x - x_offset;
+    y = y - y_offset;
+    double x_rotated = x * c + y * s;
+    y = -x * s + y * c;
+    x = x_rotated;
+    if (magnification != 0) {
+      x = x / magnification;
+      y = y / magnification;
+    }
+    if (reflect_x == true)
+      y = -y;
+  });
+}
+
+// Returns the bounds of a structure with all of its references placed.
+// Results are kept in bounds_cache, so each structure is measured once.
+bool structure_bounds(
+    const std::string &structure_name, std::vector<gdsSTR> &struct_vect,
+    std::unordered_map<std::string, int> &struct_lookup,
+    structure_bounds_map &bounds_cache, clip_window &bounds)
+{
+  int structure_index = struct_lookup[structure_name];
+  auto cache_it = bounds_cache.find(structure_index);
+  if (cache_it != bounds_cache.end()) {
+    bounds = cache_it->second.bounds;
+    return cache_it->second.found;
+  }
+  structure_extent extent;
+  auto add_bounds = [&](const clip_window &element) {
+    if (extent.found == false)
+      extent.bounds = element;
+    else
+      merge_window(extent.bounds, element);
+    extent.found = true;
+  };
+  auto add_child = [&](const std::string &child_name, clip_window &child) {
+    if (structure_bounds(child_name, struct_vect, struct_lookup, bounds_cache,
+                         child) == false)
+      return false;
+    const set<unsigned int> &child_layers =
+        bounds_cache[struct_lookup[child_name]].layers;
+    extent.layers.insert(child_layers.begin(), child_layers.end());
+    return true;
+  };
+  gdsSTR &structure = struct_vect[structure_index];
+  for (auto &boundary : structure.BOUNDARY) {
+    if (!boundary.xCor.empty()) {
+      add_bounds(coordinate_bounds(boundary.xCor, boundary.yCor, 0));
+      extent.layers.insert(boundary.layer);
+    }
+  }
+  for (auto &box : structure.BOX) {
+    if (!box.xCor.empty()) {
+      add_bounds(coordinate_bounds(box.xCor, box.yCor, 0));
+      extent.layers.insert(box.layer);
+    }
+  }
+  // A full width covers half the width plus any end extension
+  for (auto &path : structure.PATH) {
+    if (!path.xCor.empty()) {
+      add_bounds(coordinate_bounds(path.xCor, path.yCor, path.width));
+      extent.layers.insert(path.layer);
+    }
+  }
+  for (auto &sref : structure.SREF) {
+    clip_window child;
+    if (add_child(sref.name, child) == true)
+      add_bounds(transform_window(child, sref.reflection, sref.scale,
+                                  sref.angle, sref.xCor, sref.yCor));
+  }
+  for (auto &aref : structure.AREF) {
+    clip_window child;
+    if ((aref.colCnt < 1) || (aref.rowCnt < 1) ||
+        (add_child(aref.name, child) == false))
+      continue;
+    clip_window placed = transform_window(child, aref.reflection, aref.scale,
+                                          aref.angle, aref.xCor, aref.yCor);
+    int delta_row[2], delta_col[2];
+    aref_steps(aref, delta_row, delta_col);
+    // The instance lattice is linear, so its corners bound every instance
+    int last_col = aref.colCnt - 1;
+    int last_row = aref.rowCnt - 1;
+    add_bounds(placed);
+    add_bounds(shift_window(placed, delta_row[0] * last_col,
+                            delta_row[1] * last_col));
+    add_bounds(shift_window(placed, delta_col[0] * last_row,
+                            delta_col[1] * last_row));
+    add_bounds(shift_window(placed,
+                            delta_row[0] * last_col + delta_col[0] * last_row,
+                            delta_row[1] * last_col + delta_col[1] * last_row));
+  }
+  bounds = extent.bounds;
+  bool found = extent.found;
+  bounds_cache.insert({structure_index, std::move(extent)});
+  return found;
+}
+
+// Flattens a structure like recursive_unpack, but keeps only the elements
+// whose bounds meet the window (given in the structure's own coordinates).
+// References are unpacked only if their placed bounds meet the window, and
+// of an array only the instances that do are placed.
+void recursive_unpack_window(
+    const std::string &structure_name, std::vector<gdsSTR> &struct_vect,
+    std::unordered_map<std::string, int> &struct_lookup,
+    const clip_window &window, structure_bounds_map &bounds_cache,
+    polygon_store &retrieved_polygon_data)
+{
+  polygon_store polygon_data;
+  int structure_index = struct_lookup[structure_name];
+  gdsSTR &structure = struct_vect[structure_index];
+  for (auto &boundary : structure.BOUNDARY) {
+    if ((!boundary.xCor.empty()) &&
+        (windows_overlap(coordinate_bounds(boundary.xCor, boundary.yCor, 0),
+                         window) == true)) {
+      ClipperLib::Paths &layer_paths = polygon_data[boundary.layer];
+      layer_paths.emplace_back();
+      xy_to_path(boundary.xCor, boundary.yCor, layer_paths.back());
+    }
+  }
+  for (auto &box : structure.BOX) {
+    if ((!box.xCor.empty()) &&
+        (windows_overlap(coordinate_bounds(box.xCor, box.yCor, 0), window) ==
+         true)) {
+      ClipperLib::Paths &layer_paths = polygon_data[box.layer];
+      layer_paths.emplace_back();
+      xy_to_path(box.xCor, box.yCor, layer_paths.back());
+    }
+  }
+  ClipperLib::ClipperOffset offset;
+  ClipperLib::Paths solution;
+  for (auto &path : structure.PATH) {
+    if ((!path.xCor.empty()) &&
+        (windows_overlap(coordinate_bounds(path.xCor, path.yCor, path.width),
+                         window) == true)) {
+      ClipperLib::Paths &layer_paths = polygon_data[path.layer];
+      layer_paths.emplace_back();
+      if (path_to_polygon(path, layer_paths.back(), offset, solution) ==
+          EXIT_FAILURE)
+        layer_paths.pop_back();
+    }
+  }
+  for (auto &sref : structure.SREF) {
+    clip_window child;
+    if ((structure_bounds(sref.name, struct_vect, struct_lookup, bounds_cache,
+                          child) == false) ||
+        (windows_overlap(transform_window(child, sref.reflection, sref.scale,
+                                          sref.angle, sref.xCor, sref.yCor),
+                         window) == false))
+      continue;
+    polygon_store sref_data;
+    recursive_unpack_window(
+        sref.name, struct_vect, struct_lookup,
+        inverse_transform_window(window, sref.reflection, sref.scale,
+                                 sref.angle, sref.xCor, sref.yCor),
+        bounds_cache, sref_data);
+    transform_polygon_map(sref_data, sref.reflection, sref.scale, sref.angle,
+                          sref.xCor, sref.yCor);
+    combine_maps(polygon_data, sref_data);
+  }
+  for (auto &aref : structure.AREF) {
+    clip_window child;
+    if (structure_bounds(aref.name, struct_vect, struct_lookup, bounds_cache,
+                         child) == false)
+      continue;
+    clip_window placed = transform_window(child, aref.reflection, aref.scale,
+                                          aref.angle, aref.xCor, aref.yCor);
+    int delta_row[2], delta_col[2];
+    aref_steps(aref, delta_row, delta_col);
+    // Instances that meet the window, and the part of the first instance
+    // that any of them needs
+    vector<pair<int, int>> instances;
+    clip_window needed;
+    for (int i = 0; i < aref.colCnt; i++) {
+      for (int j = 0; j < aref.rowCnt; j++) {
+        ClipperLib::cInt dx = delta_row[0] * i + delta_col[0] * j;
+        ClipperLib::cInt dy = delta_row[1] * i + delta_col[1] * j;
+        if (windows_overlap(shift_window(placed, dx, dy), window) == false)
+          continue;
+        if (instances.empty())
+          needed = shift_window(window, -dx, -dy);
+        else
+          merge_window(needed, shift_window(window, -dx, -dy));
+        instances.push_back({i, j});
+      }
+    }
+    if (instances.empty())
+      continue;
+    polygon_store aref_data;
+    recursive_unpack_window(
+        aref.name, struct_vect, struct_lookup,
+        inverse_transform_window(needed, aref.reflection, aref.scale,
+                                 aref.angle, aref.xCor, aref.yCor),
+        bounds_cache, aref_data);
+    transform_polygon_map(aref_data, aref.reflection, aref.scale, aref.angle,
+                          aref.xCor, aref.yCor);
+    polygon_store repeated_map;
+    for (auto layer_it = aref_data.begin(); layer_it != aref_data.end();
+         layer_it++) {
+      ClipperLib::Paths &layer_paths = repeated_map[layer_it->first];
+      layer_paths.reserve(layer_it->second.size() * instances.size());
+      for (auto polygon_it = layer_it->second.begin();
+           polygon_it != layer_it->second.end(); polygon_it++) {
+        for (auto &instance : instances) {
+          layer_paths.push_back(*polygon_it);
+          for (auto &point : layer_paths.back()) {
+            point.X += delta_row[0] * instance.first +
+                       delta_col[0] * instance.second;
+            point.Y += delta_row[1] * instance.first +
+                       delta_col[1] * instance.second;
+          }
+        }
+      }
+    }
+    combine_maps(polygon_data, repeated_map);
+  }
+  combine_maps(retrieved_polygon_data, polygon_data);
+}
+
+bool is_leaf_structure(const gdsSTR &structure)
+{
+  return structure.SREF.empty() && structure.AREF.empty();
+}
+
+// Transform equal to applying child first, then parent.
+// A reflection in the parent reverses the sense of the child rotation.
+gds_transform compose_transform(const gds_transform &parent,
+                                const gds_transform &child)
+{
+  double x = child.x;
+  double y = (parent.reflect == true) ? -child.y : child.y;
+  double radians = (parent.angle * PI) / ((double)180);
+  gds_transform combined;
+  combined.x = (int)round(parent.magnification *
+                          (x * cos(radians) - y * sin(radians))) + parent.x;
+  combined.y = (int)round(parent.magnification *
+                          (x * sin(radians) + y * cos(radians))) + parent.y;
+  combined.reflect = (parent.reflect != child.reflect);
+  combined.magnification = parent.magnification * child.magnification;
+  combined.angle = fmod(parent.angle + ((parent.reflect == true) ? -child.angle
+                                                                 : child.angle),
+                        360.0);
+  if (combined.angle < 0)
+    combined.angle += 360.0;
+  return combined;
+}
+
+namespace {
+  // Places one reference. Unmagnified leaf cells are recorded as a
+  // placement of their cell, anything else is flattened into the polygons.
+  void place_reference(
+      const std::string &reference_name, const gds_transform &placement,
+      std::vector<gdsSTR> &struct_vect,
+      std::unordered_map<std::string, int> &struct_lookup,
+      polygon_store &polygon_data, vector<cell_instances> &cells,
+      map<pair<string, bool>, size_t> &cell_lookup)
+  {
+    gdsSTR &reference = struct_vect[struct_lookup[reference_name]];
+    if (is_leaf_structure(reference) == false) {
+      recursive_unpack_instanced(reference_name, struct_vect, struct_lookup,
+                                 placement, polygon_data, cells, cell_lookup);
+      return;
+    }
+    polygon_store leaf_data;
+    if (placement.magnification != 1) {
+      recursive_unpack(reference_name, struct_vect, struct_lookup, leaf_data);
+      transform_polygon_map(leaf_data, placement.reflect,
+                            placement.magnification, placement.angle,
+                            placement.x, placement.y);
+      combine_maps(polygon_data, leaf_data);
+      return;
+    }
+    auto lookup_it = cell_lookup.find({reference_name, placement.reflect});
+    if (lookup_it == cell_lookup.end()) {
+      cell_instances cell;
+      cell.name = reference_name;
+      cell.reflected = placement.reflect;
+      recursive_unpack(reference_name, struct_vect, struct_lookup,
+                       cell.polygons);
+      if (cell.reflected == true)
+        transform_polygon_map(cell.polygons, true, 0, 0, 0, 0);
+      lookup_it = cell_lookup.insert({{reference_name, placement.reflect},
+                                      cells.size()}).first;
+      cells.push_back(std::move(cell));
+    }
+    cells[lookup_it->second].placements.push_back(
+        {placement.x, placement.y, placement.angle});
+  }
+}
+
+// Flattens a structure like recursive_unpack, with every element placed by
+// the accumulated transform of its parents. References to leaf cells are
+// passed to place_reference.
+void recursive_unpack_instanced(
+    const std::string &structure_name, std::vector<gdsSTR> &struct_vect,
+    std::unordered_map<std::string, int> &struct_lookup,
+    const gds_transform &placement, polygon_store &retrieved_polygon_data,
+    std::vector<cell_instances> &cells,
+    std::map<std::pair<std::string, bool>, size_t> &cell_lookup)
+{
+  polygon_store polygon_data;
+  int structure_index = struct_lookup[structure_name];
+  process_boundaries(struct_vect[structure_index].BOUNDARY, polygon_data);
+  process_boxes(struct_vect[structure_index].BOX, polygon_data);
+  process_paths(struct_vect[structure_index].PATH, polygon_data);
+  transform_polygon_map(polygon_data, placement.reflect,
+                        placement.magnification, placement.angle, placement.x,
+                        placement.y);
+  for (auto &sref : struct_vect[structure_index].SREF) {
+    gds_transform child;
+    child.reflect = sref.reflection;
+    child.magnification = (sref.scale != 0) ? sref.scale : 1;
+    child.angle = sref.angle;
+    child.x = sref.xCor;
+    child.y = sref.yCor;
+    place_reference(sref.name, compose_transform(placement, child),
+                    struct_vect, struct_lookup, polygon_data, cells,
+                    cell_lookup);
+  }
+  for (auto &aref : struct_vect[structure_index].AREF) {
+    int delta_row[2], delta_col[2];
+    aref_steps(aref, delta_row, delta_col);
+    gds_transform child;
+    child.reflect = aref.reflection;
+    child.magnification = (aref.scale != 0) ? aref.scale : 1;
+    child.angle = aref.angle;
+    for (int i = 0; i < aref.colCnt; i++) {
+      for (int j = 0; j < aref.rowCnt; j++) {
+        child.x = aref.xCor + delta_row[0] * i + delta_col[0] * j;
+        child.y = aref.yCor + delta_row[1] * i + delta_col[1] * j;
+        place_reference(aref.name, compose_transform(placement, child),
+                        struct_vect, struct_lookup, polygon_data, cells,
+                        cell_lookup);
+      }
+    }
+  }
+  combine_maps(retrieved_polygon_data, polygon_data);
+}
+
 // Returns what type of line the polygon is.
 // 1 = horizontal   line
 // 2 = diagonal     line
@@ -328,24 +801,13 @@ int calibrate_line(int line_start[2], int line_end[2])
 // Runs through all boundaries of structure and
 // adds them to the polygons map.
 int process_boundaries(vector<gdsBOUNDARY> &current_boundaries,
-                       map<unsigned int, vector<co_ord>> &poly_map_destination)
+                       polygon_store &poly_map_destination)
 {
   auto bound_iter = current_boundaries.begin();
-  int key = 0;
-  co_ord temp_co;
   while (bound_iter != current_boundaries.end()) {
-    key = bound_iter->layer;
-    temp_co.x = bound_iter->xCor;
-    temp_co.y = bound_iter->yCor;
-    if (poly_map_destination.count(key) > 0) // append
-    {
-      poly_map_destination[key].push_back(temp_co);
-    } else {
-      vector<co_ord> new_vector;
-      new_vector.push_back(temp_co);
-      poly_map_destination.insert(
-          pair<unsigned int, vector<co_ord>>(bound_iter->layer, new_vector));
-    }
+    ClipperLib::Paths &layer_paths = poly_map_destination[bound_iter->layer];
+    layer_paths.emplace_back();
+    xy_to_path(bound_iter->xCor, bound_iter->yCor, layer_paths.back());
     bound_iter++;
   }
   return EXIT_SUCCESS;
@@ -353,46 +815,43 @@ int process_boundaries(vector<gdsBOUNDARY> &current_boundaries,
 
 int process_boxes(
     std::vector<gdsBOX> &current_boxes,
-    std::map<unsigned int, std::vector<co_ord>> &poly_map_destination)
+    polygon_store &poly_map_destination)
 {
   auto box_iter = current_boxes.begin();
-  int key = 0;
-  co_ord temp_co;
   while (box_iter != current_boxes.end()) {
-    key = box_iter->layer;
-    temp_co.x = box_iter->xCor;
-    temp_co.y = box_iter->yCor;
-    if (poly_map_destination.count(key) > 0) // append
-    {
-      poly_map_destination[key].push_back(temp_co);
-    } else {
-      vector<co_ord> new_vector;
-      new_vector.push_back(temp_co);
-      poly_map_destination.insert(
-          pair<unsigned int, vector<co_ord>>(box_iter->layer, new_vector));
-    }
+    ClipperLib::Paths &layer_paths = poly_map_destination[box_iter->layer];
+    layer_paths.emplace_back();
+    xy_to_path(box_iter->xCor, box_iter->yCor, layer_paths.back());
     box_iter++;
   }
   return EXIT_SUCCESS;
 }
 
+// Converts all paths of a structure in one pass. Space for every layer is
+// reserved up front and a single offsetter is reused for the paths that are
+// not simple Manhattan wires.
 int process_paths(
     std::vector<gdsPATH> &current_paths,
-    std::map<unsigned int, std::vector<co_ord>> &poly_map_destination)
+    polygon_store &poly_map_destination)
 {
+  map<unsigned int, size_t> layer_counts;
+  for (auto path_iter = current_paths.begin(); path_iter != current_paths.end();
+       path_iter++)
+    layer_counts[path_iter->layer]++;
+  for (auto count_iter = layer_counts.begin(); count_iter != layer_counts.end();
+       count_iter++) {
+    ClipperLib::Paths &layer_paths = poly_map_destination[count_iter->first];
+    layer_paths.reserve(layer_paths.size() + count_iter->second);
+  }
+  ClipperLib::ClipperOffset offset;
+  ClipperLib::Paths solution;
   auto path_iter = current_paths.begin();
-  co_ord temp_co;
   while (path_iter != current_paths.end()) {
-    path_to_polygon(*path_iter, temp_co);
-    if (poly_map_destination.count(path_iter->layer) > 0) // append
-    {
-      poly_map_destination[path_iter->layer].push_back(temp_co);
-    } else {
-      vector<co_ord> new_vector;
-      new_vector.push_back(temp_co);
-      poly_map_destination.insert(
-          pair<unsigned int, vector<co_ord>>(path_iter->layer, new_vector));
-    }
+    ClipperLib::Paths &layer_paths = poly_map_destination[path_iter->layer];
+    layer_paths.emplace_back();
+    if (path_to_polygon(*path_iter, layer_paths.back(), offset, solution) ==
+        EXIT_FAILURE)
+      layer_paths.pop_back();
     path_iter++;
   }
   return EXIT_SUCCESS;
@@ -405,13 +864,13 @@ int process_paths(
 // add sref_map to polygon_data map
 int process_SREFs(
     std::vector<gdsSREF> &current_SREFs,
-    std::map<unsigned int, std::vector<co_ord>> &poly_map_destination,
+    polygon_store &poly_map_destination,
     std::vector<gdsSTR> &struct_vect,
     std::unordered_map<std::string, int> &struct_lookup)
 {
   for (auto sref_iter = current_SREFs.begin(); sref_iter < current_SREFs.end();
        sref_iter++) {
-    std::map<unsigned int, std::vector<co_ord>> polygon_data;
+    polygon_store polygon_data;
     recursive_unpack(sref_iter->name, struct_vect, struct_lookup, polygon_data);
     transform_polygon_map(polygon_data, sref_iter->reflection, sref_iter->scale,
                           sref_iter->angle, sref_iter->xCor, sref_iter->yCor);
@@ -428,13 +887,13 @@ int process_SREFs(
 // add aref_map to polygon_data map
 int process_AREFs(
     std::vector<gdsAREF> &current_arefs,
-    std::map<unsigned int, std::vector<co_ord>> &poly_map_destination,
+    polygon_store &poly_map_destination,
     std::vector<gdsSTR> &struct_vect,
     std::unordered_map<std::string, int> &struct_lookup)
 {
   for (auto aref_iter = current_arefs.begin(); aref_iter < current_arefs.end();
        aref_iter++) {
-    std::map<unsigned int, std::vector<co_ord>> polygon_data;
+    polygon_store polygon_data;
     recursive_unpack(aref_iter->name, struct_vect, struct_lookup, polygon_data);
     transform_aref_map(polygon_data, *aref_iter);
     combine_maps(poly_map_destination, polygon_data);
@@ -442,84 +901,68 @@ int process_AREFs(
   return EXIT_SUCCESS;
 }
 
-void combine_maps(std::map<unsigned int, std::vector<co_ord>> &main,
-                  std::map<unsigned int, std::vector<co_ord>> &auxiliary)
+// Moves the polygons of auxiliary into main. auxiliary is left empty.
+void combine_maps(polygon_store &main, polygon_store &auxiliary)
 {
   // check if aux layer exists in main
   for (auto aux_iter = auxiliary.begin(); aux_iter != auxiliary.end();
        aux_iter++) {
-    if (main.count(aux_iter->first) > 0) {
-      main[aux_iter->first].insert(main[aux_iter->first].end(),
-                                   aux_iter->second.begin(),
-                                   aux_iter->second.end());
+    auto main_iter = main.find(aux_iter->first);
+    if (main_iter != main.end()) {
+      main_iter->second.insert(main_iter->second.end(),
+                               make_move_iterator(aux_iter->second.begin()),
+                               make_move_iterator(aux_iter->second.end()));
     } else {
-      main.insert(pair<unsigned int, vector<co_ord>>(aux_iter->first,
-                                                     aux_iter->second));
+      main.insert({aux_iter->first, std::move(aux_iter->second)});
     }
   }
+  auxiliary.clear();
 }
 
 int transform_polygon_map(
-    std::map<unsigned int, std::vector<co_ord>> &polygon_map, bool reflect_x,
+    polygon_store &polygon_map, bool reflect_x,
     double magnification, int angle, int x_offset, int y_offset)
 {
   // For each layer
   for (auto map_iter = polygon_map.begin(); map_iter != polygon_map.end();
        map_iter++) {
-    // For each co-ordinate set on a layer:
+    // For each polygon on a layer:
     for (auto vec_iter = map_iter->second.begin();
          vec_iter != map_iter->second.end(); vec_iter++) {
       //  ============================= Reflect =============================
       if (reflect_x == true) {
-        double myconstant{-1};
-        std::transform(vec_iter->y.begin(), vec_iter->y.end(),
-                       vec_iter->y.begin(),
-                       [myconstant](auto &c) { return c * myconstant; });
+        for (auto &point : *vec_iter)
+          point.Y = -point.Y;
       }
       //  ============================ Multiply =============================
       if (magnification != 0) {
-        std::transform(vec_iter->x.begin(), vec_iter->x.end(),
-                       vec_iter->x.begin(),
-                       [magnification](auto &c) { return c * magnification; });
-        std::transform(vec_iter->y.begin(), vec_iter->y.end(),
-                       vec_iter->y.begin(),
-                       [magnification](auto &c) { return c * magnification; });
+        for (auto &point : *vec_iter) {
+          point.X = (ClipperLib::cInt)(point.X * magnification);
+          point.Y = (ClipperLib::cInt)(point.Y * magnification);
+        }
       }
       //  ============================= Rotate ==============================
       if (angle != 0) {
         vector<POINT> point_vector;
+        point_vector.reserve(vec_iter->size());
         // Convert to compatible type for rotation function
-        auto vec_it_x = vec_iter->x.begin();
-        auto vec_it_y = vec_iter->y.begin();
-        while (vec_it_x != vec_iter->x.end()) {
-          POINT temp_point;
-          temp_point.x = (double)*vec_it_x;
-          temp_point.y = (double)*vec_it_y;
-          point_vector.push_back(temp_point);
-          vec_it_x++;
-          vec_it_y++;
-        }
-        // Convert back to compatible type for
+        for (auto &point : *vec_iter)
+          point_vector.push_back({(double)point.X, (double)point.Y});
         rotate_vector(0, 0, angle, point_vector);
-        vec_it_x = vec_iter->x.begin();
-        vec_it_y = vec_iter->y.begin();
+        // Convert back
         auto point_it = point_vector.begin();
-        while (vec_it_x != vec_iter->x.end()) {
-          *vec_it_x = (int)round(point_it->x);
-          *vec_it_y = (int)round(point_it->y);
-          vec_it_x++;
-          vec_it_y++;
+        for (auto &point : *vec_iter) {
+          point.X = (int)round(point_it->x);
+          point.Y = (int)round(point_it->y);
           point_it++;
         }
       }
       //  ============================= Offset ==============================
       if ((x_offset != 0) || (y_offset != 0)) {
-        std::transform(vec_iter->x.begin(), vec_iter->x.end(),
-                       vec_iter->x.begin(),
-                       [&x_offset](auto &c) { return c + x_offset; });
-        std::transform(vec_iter->y.begin(), vec_iter->y.end(),
-                       vec_iter->y.begin(),
-                       [&y_offset](auto &c) { return c + y_offset; });
+        for (auto &point : *vec_iter) {
+          point.X += x_offset;
+          point.Y += y_offset;
+        }
       }
     }
   }
@@ -528,34 +971,22 @@ int transform_polygon_map(
 
 // take referred structure and transform it
 
-int transform_aref_map(std::map<unsigned int, std::vector<co_ord>> &target,
-                       gdsAREF &aref_info)
+int transform_aref_map(polygon_store &target, gdsAREF &aref_info)
 {
-  // Take original cell
-  std::map<unsigned int, std::vector<co_ord>> aref_map = target;
   // Reflect, scale, rotate, offset the cell.
-  transform_polygon_map(aref_map, aref_info.reflection, aref_info.scale,
+  transform_polygon_map(target, aref_info.reflection, aref_info.scale,
                         aref_info.angle, aref_info.xCor, aref_info.yCor);
-  repeat_polygon_map(aref_map, aref_info);
-  target.clear();
-  target = aref_map;
+  repeat_polygon_map(target, aref_info);
   return EXIT_SUCCESS;
 }
 
-void repeat_polygon_map(std::map<unsigned int, std::vector<co_ord>> &target,
-                        gdsAREF &aref_info)
+void repeat_polygon_map(polygon_store &target, gdsAREF &aref_info)
 {
   // pull aref into own map
-  std::map<unsigned int, std::vector<co_ord>> repeated_map;
+  polygon_store repeated_map;
   // calculate offset;
-  int delta_row[2] = {(int)round((double)(aref_info.xCorRow - aref_info.xCor) /
-                                 aref_info.colCnt),
-                      (int)round((double)(aref_info.yCorRow - aref_info.yCor) /
-                                 aref_info.colCnt)};
-  int delta_col[2] = {(int)round((double)(aref_info.xCorCol - aref_info.xCor) /
-                                 aref_info.rowCnt),
-                      (int)round((double)(aref_info.yCorCol - aref_info.yCor) /
-                                 aref_info.rowCnt)};
+  int delta_row[2], delta_col[2];
+  aref_steps(aref_info, delta_row, delta_col);
   // perform repeated placement , each layer, each vector, offset and append
   for (auto layer_it = target.begin(); layer_it != target.end(); layer_it++)
   {
@@ -566,37 +997,38 @@ void repeat_polygon_map(std::map<unsigned int, std::vector<co_ord>> &target,
       {
         for (int j = 0; j <= aref_info.rowCnt-1; j++)
         {
-          co_ord shifted_polygon = *polygon_it;
-          std::transform(shifted_polygon.x.begin(), shifted_polygon.x.end(),
-                         shifted_polygon.x.begin(),
-                         [&i, &j, &delta_row, &delta_col](auto &c) {
-                           return c + delta_row[0] * i + delta_col[0] * j;
-                         });
-          std::transform(shifted_polygon.y.begin(), shifted_polygon.y.end(),
-                         shifted_polygon.y.begin(),
-                         [&i, &j, &delta_row, &delta_col](auto &c) {
-                           return c + delta_row[1] * i + delta_col[1] * j;
-                         });
+          ClipperLib::Path shifted_polygon = *polygon_it;
+          for (auto &point : shifted_polygon) {
+            point.X += delta_row[0] * i + delta_col[0] * j;
+            point.Y += delta_row[1] * i + delta_col[1] * j;
+          }
           insert_or_append_to_polymap(repeated_map, layer_it->first,
                                       shifted_polygon);
         }
       }
     }
   }
-  target.clear();
-  target = repeated_map;
+  target.swap(repeated_map);
 }
 
-void insert_or_append_to_polymap(
-    std::map<unsigned int, std::vector<co_ord>> &target_map, int key,
-    const co_ord &polygon)
+// Offset between neighbouring columns (delta_row) and rows (delta_col) of an
+// array reference.
+void aref_steps(const gdsAREF &aref_info, int delta_row[2], int delta_col[2])
 {
-  if (target_map.count(key) > 0) {
-    target_map[key].push_back(polygon);
-  } else {
-    vector<co_ord> polygons = {polygon};
-    target_map.insert(pair<unsigned int, vector<co_ord>>(key, polygons));
-  }
+  delta_row[0] = (int)round((double)(aref_info.xCorRow - aref_info.xCor) /
+                            aref_info.colCnt);
+  delta_row[1] = (int)round((double)(aref_info.yCorRow - aref_info.yCor) /
+                            aref_info.colCnt);
+  delta_col[0] = (int)round((double)(aref_info.xCorCol - aref_info.xCor) /
+                            aref_info.rowCnt);
+  delta_col[1] = (int)round((double)(aref_info.yCorCol - aref_info.yCor) /
+                            aref_info.rowCnt);
+}
+
+void insert_or_append_to_polymap(polygon_store &target_map, int key,
+                                 const ClipperLib::Path &polygon)
+{
+  target_map[key].push_back(polygon);
 }
 /**
  *  @brief Rotates the specified vector of points
@@ -631,23 +1063,27 @@ void rotate_vector(double cx, double cy, double angle,
            translate_back); // translate points back
 }
 
-int path_to_polygon(gdsPATH path_data, co_ord &dest_co_ord)
+int path_to_polygon(const gdsPATH &path_data, ClipperLib::Path &dest_path)
+{
+  ClipperLib::ClipperOffset offset;
+  ClipperLib::Paths solution;
+  return path_to_polygon(path_data, dest_path, offset, solution);
+}
+
+// Variant of the above that reuses the offsetter and solution storage of
+// the caller between paths.
+int path_to_polygon(const gdsPATH &path_data, ClipperLib::Path &dest_path,
+                    ClipperLib::ClipperOffset &offset,
+                    ClipperLib::Paths &solution)
 {
   if (path_data.xCor.size() < 2) {
     throw invalid_argument("Path cannot be one point.");
   }
-  co_ord poly_co_ord; // Polygon storage (remember to add to dest)
+  if (manhattan_path_to_polygon(path_data, dest_path) == true)
+    return EXIT_SUCCESS;
   ClipperLib::Path subj;
-  ClipperLib::ClipperOffset offset;
-  ClipperLib::Paths solution;
-  auto path_iter_x = path_data.xCor.begin();
-  auto path_iter_y = path_data.yCor.begin();
-  // Convert to clipper library format ------------
-  while (path_iter_x != path_data.xCor.end()) {
-    subj << ClipperLib::IntPoint(*path_iter_x, *path_iter_y);
-    path_iter_x++;
-    path_iter_y++;
-  }
+  xy_to_path(path_data.xCor, path_data.yCor, subj);
+  offset.Clear();
   switch (path_data.pathtype) {
   case 0: // flush endcap
     offset.AddPath(subj, ClipperLib::jtMiter, ClipperLib::etOpenButt);
@@ -660,18 +1096,60 @@ int path_to_polygon(gdsPATH path_data, co_ord &dest_co_ord)
     break;
   }
   offset.Execute(solution, ((double)path_data.width * 0.5));
-  auto a = solution.begin();
-  auto b = *a;
-  auto clipper_point_iterator = b.begin();
-  while (clipper_point_iterator != b.end()) {
-    poly_co_ord.x.push_back(clipper_point_iterator->X);
-    poly_co_ord.y.push_back(clipper_point_iterator->Y);
-    clipper_point_iterator++;
-  }
-  dest_co_ord = poly_co_ord;
+  if (solution.empty())
+    return EXIT_FAILURE;
+  dest_path = std::move(solution.front());
   return EXIT_SUCCESS;
 }
 
+// Converts a two-point horizontal or vertical path with flush end caps
+// straight to its rectangle. The offset is computed the same way as
+// ClipperOffset (unit normal times half width, rounded half away from zero)
+// and the corners are listed in the order Clipper returns them, so the
+// result is identical to the general conversion.
+// Returns false if the path is not of this form.
+bool manhattan_path_to_polygon(const gdsPATH &path_data,
+                               ClipperLib::Path &dest_path)
+{
+  if ((path_data.pathtype != 0) || (path_data.width <= 0) ||
+      (path_data.xCor.size() != 2) || (path_data.yCor.size() != 2))
+    return false;
+  const ClipperLib::cInt x1 = path_data.xCor[0], y1 = path_data.yCor[0];
+  const ClipperLib::cInt x2 = path_data.xCor[1], y2 = path_data.yCor[1];
+  if (((x1 != x2) && (y1 != y2)) || ((x1 == x2) && (y1 == y2)))
+    return false;
+  auto round_half_away = [](double v) {
+    return (v < 0) ? (ClipperLib::cInt)(v - 0.5) : (ClipperLib::cInt)(v + 0.5);
+  };
+  double delta = (double)path_data.width * 0.5;
+  double dx = (double)(x2 - x1);
+  double dy = (double)(y2 - y1);
+  double f = 1.0 / std::sqrt(dx * dx + dy * dy);
+  dest_path.resize(4);
+  if (y1 == y2) {
+    double normal = -dx * f;
+    ClipperLib::cInt a = round_half_away(y1 + normal * delta);
+    ClipperLib::cInt b = round_half_away(y1 - normal * delta);
+    ClipperLib::cInt y_low = std::min(a, b), y_high = std::max(a, b);
+    ClipperLib::cInt x_low = std::min(x1, x2), x_high = std::max(x1, x2);
+    dest_path[0] = ClipperLib::IntPoint(x_high, y_high);
+    dest_path[1] = ClipperLib::IntPoint(x_low, y_high);
+    dest_path[2] = ClipperLib::IntPoint(x_low, y_low);
+    dest_path[3] = ClipperLib::IntPoint(x_high, y_low);
+  } else {
+    double normal = dy * f;
+    ClipperLib::cInt a = round_half_away(x1 + normal * delta);
+    ClipperLib::cInt b = round_half_away(x1 - normal * delta);
+    ClipperLib::cInt x_low = std::min(a, b), x_high = std::max(a, b);
+    ClipperLib::cInt y_low = std::min(y1, y2), y_high = std::max(y1, y2);
+    dest_path[0] = ClipperLib::IntPoint(x_high, y_high);
+    dest_path[1] = ClipperLib::IntPoint(x_low, y_high);
+    dest_path[2] = ClipperLib::IntPoint(x_low, y_low);
+    dest_path[3] = ClipperLib::IntPoint(x_high, y_low);
+  }
+  return true;
+}
+
 // Runs through all polygons of shape and
 // calculates where in the layer the intercepts lie.
 int section_data::calculate_intercepts()
@@ -679,7 +1157,7 @@ int section_data::calculate_intercepts()
   auto current_polygon = polygons.begin();
   while (current_polygon != polygons.end()) // each layer
   {
-    auto vect = current_polygon->second;
+    const ClipperLib::Paths &vect = current_polygon->second;
     auto vect_iter = vect.begin();
     while (vect_iter != vect.end()) // each vector of polygons
     {
@@ -699,7 +1177,7 @@ int section_data::calculate_intercepts()
           for ( auto v_it = vect.begin(); v_it!= v_end; v_it++)
           {
             vector<Point> v_it_as_Point;
-            co_ord_to_point_v(*v_it, v_it_as_Point);
+            path_to_point_v(*v_it, v_it_as_Point);
             if(Is_Inside(p, v_it_as_Point)==true)
               is_inside=true;
           }
@@ -723,18 +1201,16 @@ int section_data::calculate_intercepts()
 }
 
 // Analyze each polygon for line-segments to check against cross-section line.
-int section_data::analyze_polygon(int layer, const co_ord &line_data)
+int section_data::analyze_polygon(int layer, const ClipperLib::Path &line_data)
 {
-  vector<int> xvec = line_data.x;
-  vector<int> yvec = line_data.y;
   uint count = 0;
-  uint veclen = xvec.size() - 1;
+  uint veclen = line_data.size() - 1;
   int vec_beg[2], vec_end[2]; // xy
   while (count < veclen) {
-    vec_beg[0] = xvec[count];
-    vec_beg[1] = yvec[count];
-    vec_end[0] = xvec[count + 1];
-    vec_end[1] = yvec[count + 1];
+    vec_beg[0] = line_data[count].X;
+    vec_beg[1] = line_data[count].Y;
+    vec_end[0] = line_data[count + 1].X;
+    vec_end[1] = line_data[count + 1].Y;
     count++;
     analyze_line_seg(vec_beg, vec_end, layer);
   }
@@ -1211,21 +1687,11 @@ int section_data::generate_blocks()
       my_segment.start_distance = start_dist;
       my_segment.end_distance = end_dist;
       my_segment.primary = false;
-      vector<co_ord>::iterator current_polygon = polygons[key].begin();
+      ClipperLib::Paths::iterator current_polygon = polygons[key].begin();
       while ( current_polygon != polygons[key].end()) // Check midpoint against every polygon on layer
       {
-        // while not end of current_polygon->x push current polygon to converted polygon
         vector<Point> converted_polygon;
-        auto itx = current_polygon->x.begin();
-        auto ity = current_polygon->y.begin();
-        while (itx != current_polygon->x.end()) {
-          Point current_point;
-          current_point.x = *itx;
-          current_point.y = *ity;
-          converted_polygon.push_back(current_point);
-          itx++;
-          ity++;
-        }
+        path_to_point_v(*current_polygon, converted_polygon);
         if (Is_Inside(checkme, converted_polygon) == true) {
           my_segment.primary = true;
         }
@@ -1294,18 +1760,41 @@ int section_data::pull_used_layers(vector<int> &destination_vector)
   return EXIT_SUCCESS;
 }
 
-int co_ord_to_point_v(const co_ord &co,
-                        std::vector<Point> &p_v)
+int path_to_point_v(const ClipperLib::Path &path,
+                    std::vector<Point> &p_v)
 {
-  auto itx = co.x.begin();
-  auto ity = co.y.begin();
-  while (itx != co.x.end()) {
+  p_v.reserve(p_v.size() + path.size());
+  for (auto point_it = path.begin(); point_it != path.end(); point_it++) {
     Point current_point;
-    current_point.x = *itx;
-    current_point.y = *ity;
+    current_point.x = point_it->X;
+    current_point.y = point_it->Y;
     p_v.push_back(current_point);
-    itx++;
-    ity++;
   }
   return EXIT_SUCCESS;
+}
+
+// Builds a polygon from the separate x and y co-ordinate lists used by GDS
+// elements.
+void xy_to_path(const std::vector<int> &x, const std::vector<int> &y,
+                ClipperLib::Path &path)
+{
+  path.clear();
+  path.reserve(x.size());
+  auto ity = y.begin();
+  for (auto itx = x.begin(); itx != x.end(); itx++, ity++)
+    path.emplace_back(*itx, *ity);
+}
+
+// Splits a polygon into the x and y co-ordinate lists used by GDS elements.
+void path_to_xy(const ClipperLib::Path &path, std::vector<int> &x,
+                std::vector<int> &y)
+{
+  x.clear();
+  y.clear();
+  x.reserve(path.size());
+  y.reserve(path.size());
+  for (auto point_it = path.begin(); point_it != path.end(); point_it++) {
+    x.push_back(point_it->X);
+    y.push_back(point_it->Y);
+  }
 }
\ No newline at end of file
@@ -0,0 +1,436 @@
+/**
+ * Author:      H.F. Herbst
+ * Origin:      Stellenbosch University
+ * For:         IARPA SuperTools Project
+ * license:     MIT
+ * Description: Function definitions for native triangulated solid export
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "solid_mesh.hpp"
+
+constexpr double MITER_LIMIT = 4; // Longest allowed vertex shift, in multiples of the offset
+
+// Extrudes a solid through its levels and closes it with a floor and roof.
+// Nothing is added if the outline or any hole cannot be meshed, since
+// dropping a hole would fill it with material.
+int MODEL3D::triangle_mesh::add_solid(const mesh_solid &solid)
+{
+    std::vector<mesh_ring> rings;
+    rings.push_back(solid.outer);
+    if( (rings[0].levels.size()<2) || (orient_ring(rings[0], true)==false) )
+    {
+        std::cout << "Error: Solid outline is degenerate." << std::endl;
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < solid.holes.size(); i++)
+    {
+        mesh_ring hole = solid.holes[i];
+        if(hole.levels.size()!=rings[0].levels.size())
+        {
+            std::cout << "Error: Hole " << i+1 << " has " << hole.levels.size()
+                      << " levels, the solid outline has " << rings[0].levels.size() << "." << std::endl;
+            return EXIT_FAILURE;
+        }
+        if(orient_ring(hole, false)==false)
+        {
+            std::cout << "Error: Hole " << i+1 << " is degenerate." << std::endl;
+            return EXIT_FAILURE;
+        }
+        rings.push_back(hole);
+    }
+    // Walls
+    std::vector<std::vector<unsigned int>> ring_starts(rings.size());
+    for (size_t i = 0; i < rings.size(); i++)
+        extrude_ring(rings[i], ring_starts[i]);
+    // Floor and roof reuse the first and last level of every ring
+    std::vector<unsigned int> floor_start, roof_start;
+    for (size_t i = 0; i < rings.size(); i++)
+    {
+        floor_start.push_back(ring_starts[i].front());
+        roof_start.push_back(ring_starts[i].back());
+    }
+    triangulate_cap(rings, floor_start, false);
+    triangulate_cap(rings, roof_start, true);
+    return EXIT_SUCCESS;
+}
+
+// Removes repeated points and winds outer rings counter-clockwise and holes clockwise.
+bool MODEL3D::orient_ring(mesh_ring &ring, const bool &is_outer)
+{
+    ClipperLib::Path cleaned;
+    auto outline_end = ring.outline.end();
+    for (auto pt_it = ring.outline.begin(); pt_it != outline_end; pt_it++)
+    {
+        if( cleaned.empty() || !(cleaned.back() == *pt_it) )
+            cleaned.push_back(*pt_it);
+    }
+    while( (cleaned.size()>1) && (cleaned.front() == cleaned.back()) )
+        cleaned.pop_back();
+    if(cleaned.size()<3)
+        return false;
+    if(ClipperLib::Orientation(cleaned)!=is_outer)
+        ClipperLib::ReversePath(cleaned);
+    ring.outline = cleaned;
+    return true;
+}
+
+// Places the ring vertices at every level, moving each vertex along its
+// miter by the level offset, and joins consecutive levels with quads.
+void MODEL3D::triangle_mesh::extrude_ring(const mesh_ring &ring, std::vector<unsigned int> &ring_start)
+{
+    const ClipperLib::Path &path = ring.outline;
+    size_t n = path.size();
+    std::vector<double> miter_x, miter_y;
+    ring_miters(path, miter_x, miter_y);
+    auto levels_end = ring.levels.end();
+    for (auto level_it = ring.levels.begin(); level_it != levels_end; level_it++)
+    {
+        ring_start.push_back(vertices.size()/3);
+        for (size_t j = 0; j < n; j++)
+        {
+            vertices.push_back(path[j].X + level_it->offset*miter_x[j]);
+            vertices.push_back(path[j].Y + level_it->offset*miter_y[j]);
+            vertices.push_back(level_it->z);
+        }
+    }
+    for (size_t l = 0; l+1 < ring_start.size(); l++)
+    {
+        for (size_t j = 0; j < n; j++)
+        {
+            unsigned int a = ring_start[l] + j;
+            unsigned int b = ring_start[l] + (j+1)%n;
+            unsigned int a_up = ring_start[l+1] + j;
+            unsigned int b_up = ring_start[l+1] + (j+1)%n;
+            triangles.insert(triangles.end(), {a, b, b_up});
+            triangles.insert(triangles.end(), {a, b_up, a_up});
+        }
+    }
+}
+
+// Triangulates the outline of a solid at one level, holes included.
+// Holes are bridged into the outer ring before ear clipping so the cap
+// reuses the wall vertices exactly and the surface stays closed.
+void MODEL3D::triangle_mesh::triangulate_cap(
+const std::vector<mesh_ring> &rings,
+const std::vector<unsigned int> &ring_start,
+const bool &facing_up)
+{
+    std::vector<cap_vertex> nodes;
+    std::vector<int> ring_first;
+    for (size_t i = 0; i < rings.size(); i++)
+    {
+        int first = nodes.size();
+        size_t n = rings[i].outline.size();
+        for (size_t j = 0; j < n; j++)
+        {
+            unsigned int id = ring_start[i] + j;
+            int index = first + j;
+            nodes.push_back({ vertices[3*id], vertices[3*id+1], id,
+                              (j==0) ? (int)(first+n-1) : index-1,
+                              (j==n-1) ? first : index+1 });
+        }
+        ring_first.push_back(first);
+    }
+    // Eliminate holes from left to right, each starting at its leftmost vertex
+    std::vector<int> hole_nodes;
+    for (size_t i = 1; i < rings.size(); i++)
+    {
+        int leftmost = ring_first[i];
+        int node = nodes[leftmost].next;
+        while(node != ring_first[i])
+        {
+            if( (nodes[node].x < nodes[leftmost].x) ||
+                ((nodes[node].x == nodes[leftmost].x) && (nodes[node].y < nodes[leftmost].y)) )
+                leftmost = node;
+            node = nodes[node].next;
+        }
+        hole_nodes.push_back(leftmost);
+    }
+    std::sort(hole_nodes.begin(), hole_nodes.end(),
+              [&nodes](const int &a, const int &b){ return nodes[a].x < nodes[b].x; });
+    int outer = ring_first[0];
+    for (auto hole_it = hole_nodes.begin(); hole_it != hole_nodes.end(); hole_it++)
+    {
+        int bridge = find_hole_bridge(nodes, *hole_it, outer);
+        if(bridge >= 0)
+            split_polygon(nodes, bridge, *hole_it);
+    }
+    std::vector<unsigned int> cap;
+    ear_clip(nodes, outer, cap);
+    if(facing_up==false)
+    {
+        for (size_t t = 0; t < cap.size(); t += 3)
+            std::swap(cap[t+1], cap[t+2]);
+    }
+    triangles.insert(triangles.end(), cap.begin(), cap.end());
+}
+
+// Calculates the direction and distance each vertex moves per unit of offset
+// so that every edge stays parallel to the original outline. Sharp corners
+// are clamped to MITER_LIMIT.
+void MODEL3D::ring_miters(
+const ClipperLib::Path &path,
+std::vector<double> &miter_x,
+std::vector<double> &miter_y)
+{
+    size_t n = path.size();
+    miter_x.assign(n, 0);
+    miter_y.assign(n, 0);
+    for (size_t j = 0; j < n; j++)
+    {
+        const ClipperLib::IntPoint &prev = path[(j+n-1)%n];
+        const ClipperLib::IntPoint &curr = path[j];
+        const ClipperLib::IntPoint &next = path[(j+1)%n];
+        double e1_x = (double)(curr.X - prev.X), e1_y = (double)(curr.Y - prev.Y);
+        double e2_x = (double)(next.X - curr.X), e2_y = (double)(next.Y - curr.Y);
+        double e1_len = std::hypot(e1_x, e1_y), e2_len = std::hypot(e2_x, e2_y);
+        // Right-hand normals point away from the material for both ring types
+        double n1_x = e1_y/e1_len, n1_y = -e1_x/e1_len;
+        double n2_x = e2_y/e2_len, n2_y = -e2_x/e2_len;
+        double sum_x = n1_x + n2_x, sum_y = n1_y + n2_y;
+        double denom = 1 + n1_x*n2_x + n1_y*n2_y;
+        if(std::hypot(sum_x, sum_y) < 1e-9)
+        {
+            miter_x[j] = n1_x;
+            miter_y[j] = n1_y;
+        }
+        else if(denom < 2/(MITER_LIMIT*MITER_LIMIT))
+        {
+            double sum_len = std::hypot(sum_x, sum_y);
+            miter_x[j] = MITER_LIMIT*sum_x/sum_len;
+            miter_y[j] = MITER_LIMIT*sum_y/sum_len;
+        }
+        else
+        {
+            miter_x[j] = sum_x/denom;
+            miter_y[j] = sum_y/denom;
+        }
+    }
+}
+
+// Writes the mesh as binary STL.
+int MODEL3D::triangle_mesh::write_stl(const std::string &output_path) const
+{
+    std::ofstream stl_file(output_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!stl_file.is_open())
+    {
+        std::cout << "Error: Unable to open \"" << output_path << "\" for writing." << std::endl;
+        return EXIT_FAILURE;
+    }
+    char header[80] = {0};
+    std::strncpy(header, "Katana generated binary STL", sizeof(header)-1);
+    stl_file.write(header, sizeof(header));
+    uint32_t facet_count = triangle_count();
+    stl_file.write(reinterpret_cast<const char*>(&facet_count), sizeof(facet_count));
+    std::vector<char> buffer;
+    buffer.reserve(50*facet_count);
+    for (size_t t = 0; t < triangles.size(); t += 3)
+    {
+        const double *a = &vertices[3*triangles[t]];
+        const double *b = &vertices[3*triangles[t+1]];
+        const double *c = &vertices[3*triangles[t+2]];
+        double u[3] = {b[0]-a[0], b[1]-a[1], b[2]-a[2]};
+        double v[3] = {c[0]-a[0], c[1]-a[1], c[2]-a[2]};
+        double normal[3] = { u[1]*v[2]-u[2]*v[1], u[2]*v[0]-u[0]*v[2], u[0]*v[1]-u[1]*v[0] };
+        double length = std::sqrt(normal[0]*normal[0]+normal[1]*normal[1]+normal[2]*normal[2]);
+        float facet[12];
+        for (int k = 0; k < 3; k++)
+        {
+            facet[k]   = (length>0) ? (float)(normal[k]/length) : 0.0f;
+            facet[3+k] = (float)a[k];
+            facet[6+k] = (float)b[k];
+            facet[9+k] = (float)c[k];
+        }
+        const char *raw = reinterpret_cast<const char*>(facet);
+        buffer.insert(buffer.end(), raw, raw+sizeof(facet));
+        buffer.push_back(0);// attribute byte count
+        buffer.push_back(0);
+    }
+    stl_file.write(buffer.data(), buffer.size());
+    if(stl_file.fail())
+    {
+        std::cout << "Error: Writing \"" << output_path << "\" failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Writes the mesh as a Wavefront OBJ with a single named object.
+int MODEL3D::triangle_mesh::write_obj(const std::string &output_path, const std::string &object_name) const
+{
+    std::ofstream obj_file(output_path, std::ios::out | std::ios::trunc);
+    if(!obj_file.is_open())
+    {
+        std::cout << "Error: Unable to open \"" << output_path << "\" for writing." << std::endl;
+        return EXIT_FAILURE;
+    }
+    obj_file.precision(12);
+    obj_file << "# Katana generated OBJ\n";
+    obj_file << "o " << object_name << "\n";
+    for (size_t v = 0; v < vertices.size(); v += 3)
+        obj_file << "v " << vertices[v] << " " << vertices[v+1] << " " << vertices[v+2] << "\n";
+    for (size_t t = 0; t < triangles.size(); t += 3)
+        obj_file << "f " << triangles[t]+1 << " " << triangles[t+1]+1 << " " << triangles[t+2]+1 << "\n";
+    if(obj_file.fail())
+    {
+        std::cout << "Error: Writing \"" << output_path << "\" failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Signed turn of p->q->r. Negative for a left (convex) turn in a counter-clockwise ring.
+double MODEL3D::turn_area(const cap_vertex &p, const cap_vertex &q, const cap_vertex &r)
+{
+    return (q.y - p.y) * (r.x - q.x) - (q.x - p.x) * (r.y - q.y);
+}
+
+bool MODEL3D::point_in_triangle(double ax, double ay, double bx, double by,
+                                double cx, double cy, double px, double py)
+{
+    return ((cx - px) * (ay - py) >= (ax - px) * (cy - py)) &&
+           ((ax - px) * (by - py) >= (bx - px) * (ay - py)) &&
+           ((bx - px) * (cy - py) >= (cx - px) * (by - py));
+}
+
+// Checks whether the diagonal a-b leaves a towards the inside of the polygon.
+bool MODEL3D::locally_inside(const std::vector<cap_vertex> &nodes, const int &a, const int &b)
+{
+    const cap_vertex &na = nodes[a];
+    const cap_vertex &nb = nodes[b];
+    const cap_vertex &prev = nodes[na.prev];
+    const cap_vertex &next = nodes[na.next];
+    if(turn_area(prev, na, next) < 0)
+        return (turn_area(na, nb, next) >= 0) && (turn_area(na, prev, nb) >= 0);
+    return (turn_area(na, nb, prev) < 0) || (turn_area(na, next, nb) < 0);
+}
+
+// Finds the outer vertex that the leftmost vertex of a hole can be joined to
+// without crossing any edge, by casting a ray to the left (David Eberly).
+int MODEL3D::find_hole_bridge(const std::vector<cap_vertex> &nodes, const int &hole, const int &outer)
+{
+    double hx = nodes[hole].x;
+    double hy = nodes[hole].y;
+    double qx = -HUGE_VAL;
+    int m = -1;
+    int p = outer;
+    do
+    {
+        const cap_vertex &np = nodes[p];
+        const cap_vertex &nn = nodes[np.next];
+        if( (hy <= np.y) && (hy >= nn.y) && (nn.y != np.y) )
+        {
+            double x = np.x + (hy - np.y) * (nn.x - np.x) / (nn.y - np.y);
+            if( (x <= hx) && (x > qx) )
+            {
+                qx = x;
+                m = (np.x < nn.x) ? p : np.next;
+                if(x == hx)
+                    return m;
+            }
+        }
+        p = np.next;
+    } while (p != outer);
+    if(m < 0)
+        return -1;
+    // Prefer the visible reflex vertex closest in angle to the ray
+    int stop = m;
+    double mx = nodes[m].x;
+    double my = nodes[m].y;
+    double tan_min = HUGE_VAL;
+    p = m;
+    do
+    {
+        const cap_vertex &np = nodes[p];
+        if( (hx >= np.x) && (np.x >= mx) && (hx != np.x) &&
+            point_in_triangle((hy < my) ? hx : qx, hy, mx, my, (hy < my) ? qx : hx, hy, np.x, np.y) )
+        {
+            double tan = std::abs(hy - np.y) / (hx - np.x);
+            if( locally_inside(nodes, p, hole) && ((tan < tan_min) || ((tan == tan_min) && (np.x > nodes[m].x))) )
+            {
+                m = p;
+                tan_min = tan;
+            }
+        }
+        p = np.next;
+    } while (p != stop);
+    return m;
+}
+
+// Joins vertex a to vertex b with a pair of coincident edges, duplicating
+// both nodes (but not their mesh vertices).
+int MODEL3D::split_polygon(std::vector<cap_vertex> &nodes, const int &a, const int &b)
+{
+    int a2 = nodes.size();
+    nodes.push_back(nodes[a]);
+    int b2 = nodes.size();
+    nodes.push_back(nodes[b]);
+    int an = nodes[a].next;
+    int bp = nodes[b].prev;
+    nodes[a].next = b;
+    nodes[b].prev = a;
+    nodes[a2].next = an;
+    nodes[an].prev = a2;
+    nodes[b2].next = a2;
+    nodes[a2].prev = b2;
+    nodes[bp].next = b2;
+    nodes[b2].prev = bp;
+    return b2;
+}
+
+// Ear clipping over the linked ring. When no clean ear remains (collinear or
+// slightly self-touching input) the test is relaxed so every vertex is still
+// consumed and no boundary edge is left without a triangle.
+void MODEL3D::ear_clip(std::vector<cap_vertex> &nodes, int ear, std::vector<unsigned int> &triangles)
+{
+    int stop = ear;
+    int pass = 0;
+    while (nodes[ear].prev != nodes[ear].next)
+    {
+        int prev = nodes[ear].prev;
+        int next = nodes[ear].next;
+        const cap_vertex &a = nodes[prev];
+        const cap_vertex &b = nodes[ear];
+        const cap_vertex &c = nodes[next];
+        double turn = turn_area(a, b, c);
+        bool is_ear = (pass==2) || (turn < 0) || ((pass==1) && (turn == 0));
+        if( is_ear && (pass < 2) )
+        {
+            double x0 = std::min({a.x, b.x, c.x}), x1 = std::max({a.x, b.x, c.x});
+            double y0 = std::min({a.y, b.y, c.y}), y1 = std::max({a.y, b.y, c.y});
+            int p = c.next;
+            while (p != prev)
+            {
+                const cap_vertex &np = nodes[p];
+                bool on_corner = ((np.x==a.x)&&(np.y==a.y)) || ((np.x==b.x)&&(np.y==b.y)) || ((np.x==c.x)&&(np.y==c.y));
+                if( (np.x >= x0) && (np.x <= x1) && (np.y >= y0) && (np.y <= y1) && !on_corner &&
+                    point_in_triangle(a.x, a.y, b.x, b.y, c.x, c.y, np.x, np.y) &&
+                    (turn_area(nodes[np.prev], np, nodes[np.next]) >= 0) )
+                {
+                    is_ear = false;
+                    break;
+                }
+                p = np.next;
+            }
+        }
+        if(is_ear)
+        {
+            triangles.insert(triangles.end(), {a.id, b.id, c.id});
+            nodes[prev].next = next;
+            nodes[next].prev = prev;
+            ear = nodes[next].next;
+            stop = ear;
+            pass = 0;
+            continue;
+        }
+        ear = next;
+        if(ear == stop)
+            pass++;
+    }
+}
@@ -9,7 +9,10 @@
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <cctype>
 #include <cmath>
+#include <filesystem>
+#include <future>
 #include <boost/algorithm/string.hpp>
 #include "geofile_operations.hpp"
 #include "gdsCpp.hpp"
@@ -33,18 +36,46 @@ const bool        &multi_flag)
     cell_name = *std::prev(split_string_vector.end(),2);;
     if(gds_file.import(gds_path)==EXIT_SUCCESS)
     {
-        import_process_info(pif_path);
-        if(load_etch_contour_map(cont_path)==EXIT_SUCCESS)
+        if(import_process_info(pif_path)==EXIT_FAILURE)
+            return EXIT_FAILURE;
+        if(load_etch_contours(cont_path)==EXIT_SUCCESS)
         {
             // Populate polygon map with all GDS data
             std::cout<<"Beginning GDS expansion process..."<<std::endl;
-            if(section_polygon_only.extract_all_polygons(gds_file, polygons_map)==EXIT_SUCCESS)
+            if( (hierarchical==true) && ( (use_window==true) || (output_format!=eFreeCAD_script) ) )
+            {
+                std::cout<<"Hierarchical generation applies to the FreeCAD script without --window only. Flattening all cells."<<std::endl;
+                hierarchical = false;
+            }
+            if(hierarchical==true)
+            {
+                // Leaf cells are kept whole and only the rest is flattened
+                if(section_polygon_only.extract_instanced_polygons(gds_file, polygons_map, cells)==EXIT_SUCCESS)
+                    std::cout<<"GDS expansion completed. "<<cells.size()<<" unique leaf cells kept for instancing."<<std::endl;
+                place_filled_cell_layers();
+            }
+            else if(use_window==true)
+            {
+                // Only the hierarchy that meets the window is flattened
+                if(section_polygon_only.extract_window_polygons(gds_file, expanded_window(), polygons_map)==EXIT_SUCCESS)
+                    std::cout<<"GDS expansion completed."<<std::endl;
+                clip_layers_to_window();
+            }
+            else if(section_polygon_only.extract_all_polygons(gds_file, polygons_map)==EXIT_SUCCESS)
                 std::cout<<"GDS expansion completed."<<std::endl;
             calculate_all_layer_bounds();
-            // Convert map to clipper library compatible form
-            std::cout<<"Converting polygons to clipper format..."<<std::endl;
-            synchronize_clipper_polygons_map();
-            std::cout<<"Polygon map ready."<<std::endl;
+            if(incremental==true)
+            {
+                if(output_format==eGEO_model)
+                    std::cout<<"Incremental generation does not apply to .geo output. Building all layers."<<std::endl;
+                else
+                {
+                    std::string cache_path = std::filesystem::path(py_path).parent_path().string();
+                    cache_path = ((cache_path.empty()) ? "." : cache_path) + "/.katana_cache/" + cell_name;
+                    if(fragment_cache.open(cache_path)==EXIT_SUCCESS)
+                        std::cout<<"Reusing unchanged layers from \""<<cache_path<<"\"."<<std::endl;
+                }
+            }
             // Generate a volume for each layer
             std::cout<< "# ------------------------- Generating 3D Layers ------------------------- #"<<std::endl;
             auto layer_end = polygons_map.end();
@@ -58,19 +89,40 @@ const bool        &multi_flag)
             // int ps_cnt = 0;
             // int sl_cnt = 0;
             // int vl_cnt = 0;
+            if(output_format==eGEO_model)
+            {
+                if(generate_geo_model(py_path)==EXIT_FAILURE)
+                    return EXIT_FAILURE;
+                std::cout<< "# ----------------------- Model Generation Complete ---------------------- #"<<std::endl;
+                return EXIT_SUCCESS;
+            }
+            if(output_format!=eFreeCAD_script)
+            {
+                if(generate_mesh_layers(py_path)==EXIT_FAILURE)
+                    return EXIT_FAILURE;
+                std::cout<< "# ----------------------- Model Generation Complete ---------------------- #"<<std::endl;
+                return EXIT_SUCCESS;
+            }
+            if(py_script.open(py_path)==EXIT_FAILURE)
+                return EXIT_FAILURE;
             initialize_python_script();
             for (auto layer = polygons_map.begin(); layer != layer_end; layer++)
             {
                 std::cout << "Generating Layer "
                 << ++layer_count << "/" << total_layers
                 << "\t---> ";
-                if(proc_info_map.find(layer->first)!=proc_info_map.end())
-                    generate_layer(layer->first);
-                std::cout << "Done." << std::endl;
+                bool from_cache = false;
+                if(process_info.contains(layer->first))
+                    generate_script_layer(layer->first, from_cache);
+                // Each completed layer is written out before the next begins
+                py_script.flush();
+                std::cout << ((from_cache==true) ? "Cached." : "Done.") << std::endl;
             }
             // generate_layer(60);
+            generate_cell_instances();
             python_script_conclude();
-            python_script_write(py_path);
+            if(python_script_write(py_path)==EXIT_FAILURE)
+                return EXIT_FAILURE;
             std::cout<< "# ----------------------- Model Generation Complete ---------------------- #"<<std::endl;
             return EXIT_SUCCESS;
         }
@@ -81,259 +133,127 @@ const bool        &multi_flag)
         return EXIT_FAILURE;
 }
 
-//Overwrites clipper_polygons_map with polygons_map data
-void MODEL3D::three_dim_model::synchronize_clipper_polygons_map()
+// Filled layers are a single solid across the whole layout, so their cell
+// polygons are placed into the flattened polygons rather than instanced.
+void MODEL3D::three_dim_model::place_filled_cell_layers()
 {
-    clipper_polygons_map.clear();
-    auto layer_it_end = polygons_map.end();
-    // for each layer
-    for (auto layer_it = polygons_map.begin(); layer_it != layer_it_end; layer_it++)
+    for (auto &cell : cells)
     {
-        // for each polygon
-        auto polygon_it_end = layer_it->second.end();
-        for (auto polygon_it = layer_it->second.begin(); polygon_it != polygon_it_end; polygon_it++)
+        for (auto layer_it = cell.polygons.begin(); layer_it != cell.polygons.end();)
         {
-            ClipperLib::Path placeholder_path;              // Path = polygon in this case
-            co_ord_to_path(*polygon_it, placeholder_path);
-            if (clipper_polygons_map.count(layer_it->first) > 0) // Check map for key
+            int dense_id = process_info.find(layer_it->first);
+            if( (dense_id<0) || (process_info[dense_id].mask_type!=2) )
             {
-                clipper_polygons_map[layer_it->first].push_back(placeholder_path);
+                layer_it++;
+                continue;
             }
-            else
+            ClipperLib::Paths &layer_paths = polygons_map[layer_it->first];
+            auto placements_end = cell.placements.end();
+            for (auto place_it = cell.placements.begin(); place_it != placements_end; place_it++)
             {
-                std::vector<ClipperLib::Path> path_vec;
-                path_vec.push_back(placeholder_path);
-                clipper_polygons_map.insert({layer_it->first, path_vec});
+                polygon_store placed = {{layer_it->first, layer_it->second}};
+                transform_polygon_map(placed, false, 0, place_it->angle, place_it->x, place_it->y);
+                layer_paths.insert(layer_paths.end(), std::make_move_iterator(placed.begin()->second.begin()),
+                                   std::make_move_iterator(placed.begin()->second.end()));
             }
+            layer_it = cell.polygons.erase(layer_it);
         }
     }
 }
 
-//Overwrites polygons_map with clipper_polygons_map data.
-void MODEL3D::three_dim_model::synchronize_polygon_map()
+// Emits the solids of every leaf cell once, at the cell origin, followed by
+// a link array per solid that places it at all of its placements. The cell
+// layers are generated by the usual layer code; only the names of the
+// document objects are changed so that they do not clash with the layers
+// of the flattened geometry.
+void MODEL3D::three_dim_model::generate_cell_instances()
 {
-    polygons_map.clear();
-    auto clipper_polymap_end = clipper_polygons_map.end();
-    //For each layer
-    for (   auto clipper_polymap_it = clipper_polygons_map.begin();
-            clipper_polymap_it != clipper_polymap_end;
-            clipper_polymap_it++)
+    polygon_store flat_polygons;
+    flat_polygons.swap(polygons_map);
+    const std::string object_call = "addObject(\"Part::Feature\",\"";
+    for (size_t cell_index = 0; cell_index < cells.size(); cell_index++)
     {
-        // Create the polygons' vector for that layer
-        std::vector<co_ord> layer_polygons;
-        // For each polygon (clipper::Path) , convert to co_ord (vector of x and vector of y),
-        // Then add co-ord to vector of co_ord.
-        auto clipper_path_end = clipper_polymap_it->second.end();
-        for (   auto clipper_path_it = clipper_polymap_it->second.begin();
-                clipper_path_it != clipper_path_end;
-                clipper_path_it++)
+        const cell_instances &cell = cells[cell_index];
+        std::string prefix = "cell" + std::to_string(cell_index) + "_";
+        for (auto name_it = cell.name.begin(); name_it != cell.name.end(); name_it++)
+            prefix.push_back( (std::isalnum((unsigned char)*name_it)) ? *name_it : '_' );
+        prefix += (cell.reflected==true) ? "_mirrored_" : "_";
+        std::cout << "Generating cell " << cell.name << ((cell.reflected==true) ? " (mirrored)" : "")
+                  << " for " << cell.placements.size() << " placements\t---> ";
+        polygons_map = cell.polygons;
+        std::vector<std::string> object_names;
+        for (auto layer_it = polygons_map.begin(); layer_it != polygons_map.end(); layer_it++)
         {
-            //convert polygon to co-ord
-            co_ord p_hold_co_ord;
-            auto i_end = clipper_path_it->end();
-            for (auto i = clipper_path_it->begin(); i != i_end; i++)
+            if(!process_info.contains(layer_it->first))
+                continue;
+            py_script.begin_capture(true);
+            generate_layer(layer_it->first);
+            std::string fragment = py_script.end_capture();
+            size_t name_pos = fragment.find(object_call);
+            while (name_pos!=std::string::npos)
             {
-                p_hold_co_ord.x.push_back(i->X);
-                p_hold_co_ord.y.push_back(i->Y);
+                name_pos += object_call.size();
+                fragment.insert(name_pos, prefix);
+                object_names.push_back(fragment.substr(name_pos, fragment.find('"', name_pos)-name_pos));
+                name_pos = fragment.find(object_call, name_pos);
             }
-            //Push to co-ord to vector of<co_ord> for the layer
-            layer_polygons.push_back(p_hold_co_ord);
+            py_script.push_fragment(fragment);
         }
-        // Finally, push the vector of co ord to the polygon map.
-        polygons_map.insert({clipper_polymap_it->first, layer_polygons});
-    }
-}
-
-
-void MODEL3D::three_dim_model::co_ord_to_path(  const co_ord &in_vec,
-                                                ClipperLib::Path &out_path)
-{
-    // for each point convert to clipper point
-    // then push point to path
-    ClipperLib::Path holder_path;
-    auto point_it_y = in_vec.y.begin();
-    auto point_it_x_end = in_vec.x.end();
-    for (auto point_it_x = in_vec.x.begin(); point_it_x != point_it_x_end; point_it_x++)
-    {
-        ClipperLib::IntPoint current_point;
-        current_point.X = *point_it_x;
-        current_point.Y = *point_it_y;
-        holder_path.push_back(current_point);
-        point_it_y++;
-    }
-    out_path = holder_path;
-}
-
-// This function converts a ClipperLib::Path to co_ord.
-// (polygon of one type to polygon of another type)
-void MODEL3D::three_dim_model::path_to_co_ord(const ClipperLib::Path &in_path, co_ord &out_co_ord)
-{
-    co_ord holder_co_ord;
-    //For each clipper point, push onto co_ord
-    auto path_it_end = in_path.end();
-    for (auto i = in_path.begin(); i != path_it_end; i++)
-    {
-        holder_co_ord.x.push_back(i->X);
-        holder_co_ord.y.push_back(i->Y);
-    }
-    out_co_ord = holder_co_ord;
-}
-
-int MODEL3D::three_dim_model::import_process_info(const std::string &pif_path)
-{
-    std::fstream geo_file;
-    std::string file_buffer;
-    geo_file.open(pif_path, std::ios::in);
-    if (geo_file.is_open())
-    {
-        int line_number =1;
-        while (getline(geo_file, file_buffer))
+        if(!object_names.empty())
         {
-            if (file_buffer[0]!='*')
+            std::string placement_list = prefix + "placements";
+            py_script.push_back("    # Placements of cell " + cell.name);
+            py_script.push_back("    " + placement_list + " = [");
+            std::string line = "   ";
+            for (size_t i = 0; i < cell.placements.size(); i++)
             {
-                std::vector<std::string> split_string_vector;
-                boost::split(split_string_vector, file_buffer, boost::is_any_of("="));
-                GEO::trim_string_vector(split_string_vector);
-                if (*split_string_vector.begin()=="$Layer")
+                const cell_placement &placement = cell.placements[i];
+                line += " [" + std::to_string(placement.x) + ", " + std::to_string(placement.y)
+                        + ", " + std::to_string(placement.angle) + "]";
+                if(i+1 < cell.placements.size())
+                    line += ",";
+                if( ((i+1)%4==0) || (i+1==cell.placements.size()) )
                 {
-                    import_layer_block(geo_file, file_buffer, line_number);
+                    py_script.push_back(line);
+                    line = "   ";
                 }
             }
-            line_number++;
+            py_script.push_back("    ]");
+            for (auto name_it = object_names.begin(); name_it != object_names.end(); name_it++)
+                py_script.push_back("    create_instances(\"" + *name_it + "\", " + placement_list + ")");
         }
-        geo_file.close();
+        py_script.flush();
+        std::cout << "Done." << std::endl;
     }
-    return EXIT_SUCCESS;
-}
-
-MODEL3D::input_type MODEL3D::three_dim_model::hash_prop(std::string const& inString)
-{
-    if(inString == "Number") return eNumber;
-    if(inString == "Name") return eName;
-    if(inString == "MaskType") return eMask_type;
-    if(inString == "ZStart") return eZ_Start;
-    if(inString == "Thickness") return eThickness;
-    if(inString == "Material") return eMaterial;
-    if(inString == "$End") return eError;
-    return eDefault;
+    polygons_map.swap(flat_polygons);
 }
 
-int MODEL3D::three_dim_model::import_layer_block(std::fstream &infile,
-                                                 std::string &file_buffer,
-                                                 int  &line_number)
+// Loads the layer properties of the .pf file into the process table.
+int MODEL3D::three_dim_model::import_process_info(const std::string &pif_path)
 {
-    int elements_loaded = 0;
-    std::vector<std::string> split_string_vector;
-    int layer_number=0;
-    Layer_prop layer_block;
-    while (elements_loaded < 6)
-    {
-        getline(infile, file_buffer);
-        line_number++;
-        boost::split(split_string_vector, file_buffer, boost::is_any_of("="));
-        GEO::trim_string_vector(split_string_vector);
-        input_type intype = hash_prop(*split_string_vector.begin());
-        switch (intype)
-        {
-        case eNumber:
-            if(GEO::is_integer(*std::prev(split_string_vector.end(),1)))
-            {
-                layer_number = std::stoi(*std::prev(split_string_vector.end(),1));
-                elements_loaded++;
-            }
-            else
-            {
-                std::cout << "Error: Number is not an integer in .PF file." << std::endl;
-                std::cout << "Line " << line_number << ". " << std::endl;
-                return EXIT_FAILURE;
-            }
-            break;
-        case eName:
-            layer_block.name = *std::prev(split_string_vector.end(),1);
-            elements_loaded++;
-            break;
-        case eMask_type:
-            if(GEO::is_integer(*std::prev(split_string_vector.end(),1)))
-            {
-                layer_block.mask_type = std::stoi(*std::prev(split_string_vector.end(),1));
-                elements_loaded++;
-            }
-            else
-            {
-                std::cout << "Error: Number is not an integer in .PF file." << std::endl;
-                std::cout << "Line " << line_number << ". " << std::endl;
-                return EXIT_FAILURE;
-            }
-            break;
-        case eZ_Start:
-            if(GEO::is_integer(*std::prev(split_string_vector.end(),1)))
-            {
-                layer_block.z_start = std::stoi(*std::prev(split_string_vector.end(),1));
-                elements_loaded++;
-            }
-            else
-            {
-                std::cout << "Error: Number is not an integer in .PF file." << std::endl;
-                std::cout << "Line " << line_number << ". " << std::endl;
-                return EXIT_FAILURE;
-            }
-            break;
-        case eThickness:
-            if(GEO::is_integer(*std::prev(split_string_vector.end(),1)))
-            {
-                layer_block.thickness = std::stoi(*std::prev(split_string_vector.end(),1));
-                elements_loaded++;
-            }
-            else
-            {
-                std::cout << "Error: Number is not an integer in .PF file." << std::endl;
-                std::cout << "Line " << line_number << ". " << std::endl;
-                return EXIT_FAILURE;
-            }
-            break;
-        case eMaterial:
-            layer_block.material = *std::prev(split_string_vector.end(),1);
-            elements_loaded++;
-            break;
-        case eError:
-            std::cout << "Error: End command reached before 6 entries in process information block." << std::endl;
-            std::cout << "Line " << line_number << ". " << std::endl;
-            return EXIT_FAILURE;
-            break;
-        default:
-            std::cout   << "Warning: Unknown property specified in .PF file ["
-                        << *split_string_vector.begin()<<"]." << std::endl;
-            std::cout << "Line " << line_number << ". " << std::endl;
-            break;
-        }
-    }
-    if(proc_info_map.find(layer_number)==proc_info_map.end())
-        proc_info_map.insert({layer_number, layer_block});
-    getline(infile, file_buffer);
-    line_number++;
-    boost::split(split_string_vector, file_buffer, boost::is_any_of("="));
-    GEO::trim_string_vector(split_string_vector);
-    if (split_string_vector[0]=="$End")
-        return EXIT_SUCCESS;
-    else
+    if(load_pif_table(pif_path, process_info)==EXIT_FAILURE)
+    {
+        std::cout << "Error: Process information import failed. [" << pif_path << "]" << std::endl;
         return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
 }
 
 int MODEL3D::three_dim_model::generate_layer(const int &layer_number)
 {
-    switch (proc_info_map[layer_number].mask_type)
+    switch (process_info.at(layer_number).mask_type)
     {
     case 0://standard
-        generate_non_fill_layer(layer_number, proc_info_map[layer_number].mask_type);
+        generate_non_fill_layer(layer_number, process_info.at(layer_number).mask_type);
         break;
     case 1://inverted
-        generate_non_fill_layer(layer_number, proc_info_map[layer_number].mask_type);
+        generate_non_fill_layer(layer_number, process_info.at(layer_number).mask_type);
         break;
     case 2://filled
         generate_filled_layer(layer_number);
         break;
     case 3://junction
-        generate_non_fill_layer(layer_number, proc_info_map[layer_number].mask_type);
+        generate_non_fill_layer(layer_number, process_info.at(layer_number).mask_type);
         break;
     case 4://auxiliary, do nothing.
         break;
@@ -345,15 +265,141 @@ int MODEL3D::three_dim_model::generate_layer(const int &layer_number)
     return EXIT_SUCCESS;
 }
 
+// Emits the script of one layer. When incremental generation is enabled the
+// fragment of a layer with unchanged inputs is replayed from the cache, and
+// a freshly generated fragment is stored for the next run.
+int MODEL3D::three_dim_model::generate_script_layer(const int &layer_number, bool &from_cache)
+{
+    from_cache = false;
+    if(fragment_cache.is_enabled()==false)
+        return generate_layer(layer_number);
+    std::string layer_hash = hash_layer(layer_number);
+    std::string fragment;
+    if(fragment_cache.fetch(layer_number, layer_hash+".py", fragment)==true)
+    {
+        py_script.push_fragment(fragment);
+        from_cache = true;
+        return EXIT_SUCCESS;
+    }
+    py_script.begin_capture();
+    int status = generate_layer(layer_number);
+    fragment = py_script.end_capture();
+    if(status==EXIT_SUCCESS)
+    {
+        fragment_cache.store(layer_number, layer_hash+".py", fragment);
+        fragment_cache.prune(layer_number, layer_hash);
+    }
+    return status;
+}
+
+// Hashes every input the generated fragment of a layer depends on: the
+// flattened polygons, process information, etch contour, layer bounds and
+// generation settings.
+std::string MODEL3D::three_dim_model::hash_layer(const int &layer_number) const
+{
+    content_hash layer_hash;
+    layer_hash.add((int64_t)LAYER_CACHE_VERSION);
+    layer_hash.add((int64_t)output_format);
+    layer_hash.add((int64_t)enable_multiprocessing);
+    layer_hash.add((int64_t)layer_number);
+    layer_hash.add(subtractive_overlap_factor);
+    layer_hash.add(additive_overlap_factor);
+    layer_hash.add((int64_t)min_distance_between_points);
+    layer_hash.add((int64_t)decimation);
+    layer_hash.add(island_overlap_factor);
+    layer_hash.add((int64_t)round_concave_corners);
+    layer_hash.add(block_expansion_factor);
+    layer_hash.add((int64_t)use_window);
+    if(use_window==true)
+    {
+        layer_hash.add((int64_t)window.min_x);
+        layer_hash.add((int64_t)window.min_y);
+        layer_hash.add((int64_t)window.max_x);
+        layer_hash.add((int64_t)window.max_y);
+        layer_hash.add((int64_t)window_margin);
+    }
+    const Layer_prop &layer_prop = process_info.at(layer_number);
+    layer_hash.add(layer_prop.name);
+    layer_hash.add((int64_t)layer_prop.mask_type);
+    layer_hash.add((int64_t)layer_prop.z_start);
+    layer_hash.add((int64_t)layer_prop.thickness);
+    layer_hash.add(layer_prop.material);
+    const etch_contour *contour = layer_contour(layer_number);
+    if(contour!=nullptr)
+    {
+        layer_hash.add((int64_t)contour->points.size());
+        auto contour_end = contour->points.end();
+        for (auto pt_it = contour->points.begin(); pt_it != contour_end; pt_it++)
+        {
+            layer_hash.add(pt_it->x);
+            layer_hash.add(pt_it->y);
+            layer_hash.add(pt_it->z);
+        }
+    }
+    auto bounds_it = layer_boundary_map.find(layer_number);
+    if(bounds_it!=layer_boundary_map.end())
+    {
+        auto bounds_end = bounds_it->second.end();
+        for (auto bound_it = bounds_it->second.begin(); bound_it != bounds_end; bound_it++)
+            layer_hash.add((int64_t)*bound_it);
+    }
+    auto polygons_it = polygons_map.find(layer_number);
+    if(polygons_it!=polygons_map.end())
+    {
+        layer_hash.add((int64_t)polygons_it->second.size());
+        auto polygons_end = polygons_it->second.end();
+        for (auto poly_it = polygons_it->second.begin(); poly_it != polygons_end; poly_it++)
+        {
+            layer_hash.add((int64_t)poly_it->size());
+            auto path_end = poly_it->end();
+            for (auto pt_it = poly_it->begin(); pt_it != path_end; pt_it++)
+            {
+                layer_hash.add((int64_t)pt_it->X);
+                layer_hash.add((int64_t)pt_it->Y);
+            }
+        }
+    }
+    return layer_hash.hex();
+}
+
 int MODEL3D::three_dim_model::generate_non_fill_layer(const int &layer_number, const int &mask_type)
 {
-    double cont_wid = std::prev(etch_contour_map[layer_number].end(),1)->x;
-    double countour_width = std::round(cont_wid*1.4);//40% tolerance to avoid bunching
-    double foot_adjustment = std::round(-(countour_width/10));
+    ClipperLib::Paths primary_paths, secondary_paths;
+    std::vector<circle_primitive> primary_circles, secondary_circles;
+    bool has_holes = false;
+    if(prepare_non_fill_paths(layer_number, primary_paths, secondary_paths,
+                              primary_circles, secondary_circles, has_holes)==EXIT_FAILURE)
+        return EXIT_FAILURE;
+    py_script.push_back("");
+    py_script.push_back("    # Layer " + std::to_string(layer_number) );
+    py_script.push_back("    current_layer =  " + std::to_string(layer_number) );
+    py_script.push_back("    print(f'Generating Layer {current_layer}.')");
+    generate_freecad_solid(primary_paths, secondary_paths, primary_circles, secondary_circles,
+                           has_holes, layer_number, mask_type);
+    // if (primary_paths.size()>0)
+    //     clipper_paths_to_gds(primary_paths, "Primary_paths", layer_number);
+    // if (secondary_paths.size()>0)
+    //     clipper_paths_to_gds(secondary_paths, "Secondary_paths", layer_number);
+    return EXIT_SUCCESS;
+}
+
+// Applies the contour-dependent offsets to a non-filled layer and splits the
+// result into primary (outer) and secondary (hole) paths. Paths recognised as
+// circles are also listed in primary_circles and secondary_circles.
+// Only reads model state, so layers may be prepared concurrently.
+int MODEL3D::three_dim_model::prepare_non_fill_paths(
+const int &layer_number,
+ClipperLib::Paths &primary_paths,
+ClipperLib::Paths &secondary_paths,
+std::vector<circle_primitive> &primary_circles,
+std::vector<circle_primitive> &secondary_circles,
+bool &has_holes) const
+{
     ClipperLib::Paths positives;
-    auto poly_end = clipper_polygons_map[layer_number].end();
+    const ClipperLib::Paths &layer_polygons = polygons_map.at(layer_number);
+    auto poly_end = layer_polygons.end();
     // For each polygon on this layer.
-    for (   auto poly_it = clipper_polygons_map[layer_number].begin();
+    for (   auto poly_it = layer_polygons.begin();
             poly_it != poly_end; poly_it++)
     {
         ClipperLib::Path my_path = *poly_it;
@@ -368,12 +414,35 @@ int MODEL3D::three_dim_model::generate_non_fill_layer(const int &layer_number, c
             }
         }
     }
-    ClipperLib::Clipper my_mask;
+    apply_contour_offsets(layer_number, positives);
+    // Filled layers need no cut, their outline already is the window
+    if(use_window==true)
+        clip_paths_to_window(positives, (ClipperLib::cInt)std::ceil(layer_contour(layer_number)->width()));
+    // filter into primary and secondary shapes
+    primary_paths = positives;
+    secondary_paths.clear();
+    has_holes = filter_paths(primary_paths, secondary_paths);
+    tidy_paths(primary_paths);
+    tidy_paths(secondary_paths);
+    primary_circles.clear();
+    secondary_circles.clear();
+    repair_circles(primary_paths, primary_circles);
+    repair_circles(secondary_paths, secondary_circles);
+    return EXIT_SUCCESS;
+}
+
+// Shifts paths by the foot adjustment, then grows and shrinks them by the
+// contour width so that the result can carry the etch contour profile.
+void MODEL3D::three_dim_model::apply_contour_offsets(const int &layer_number, ClipperLib::Paths &paths) const
+{
+    double cont_wid = layer_contour(layer_number)->width();
+    double countour_width = std::round(cont_wid*1.4);//40% tolerance to avoid bunching
+    double foot_adjustment = std::round(-(countour_width/10));
     ClipperLib::Paths solution_paths;
     ClipperLib::ClipperOffset co;
     // shift by foot adjustment
     co.Clear();
-    co.AddPaths(positives, ClipperLib::jtMiter, ClipperLib::etClosedPolygon);
+    co.AddPaths(paths, ClipperLib::jtMiter, ClipperLib::etClosedPolygon);
     solution_paths.clear();
     co.Execute(solution_paths, foot_adjustment);
     // grow by contour width
@@ -390,33 +459,13 @@ int MODEL3D::three_dim_model::generate_non_fill_layer(const int &layer_number, c
     solution_paths.clear();
     // co.ArcTolerance = 0.25;
     co.Execute(solution_paths, -countour_width);
-    // filter into primary and secondary shapes
-    ClipperLib::Paths primary_paths, secondary_paths;
-    primary_paths = solution_paths;
-    bool has_holes = filter_paths(primary_paths, secondary_paths);
-    tidy_paths(primary_paths);
-    tidy_paths(secondary_paths);
-    repair_circles(primary_paths);
-    repair_circles(secondary_paths);
-    py_script.push_back("");
-    py_script.push_back("    # Layer " + std::to_string(layer_number) );
-    py_script.push_back("    current_layer =  " + std::to_string(layer_number) );
-    py_script.push_back("    print(f'Generating Layer {current_layer}.')");
-    generate_freecad_solid(primary_paths, secondary_paths, has_holes, layer_number, mask_type);
-    // if (primary_paths.size()>0)
-    //     clipper_paths_to_gds(primary_paths, "Primary_paths", layer_number);
-    // if (secondary_paths.size()>0)
-    //     clipper_paths_to_gds(secondary_paths, "Secondary_paths", layer_number);
-    return EXIT_SUCCESS;
+    paths = solution_paths;
 }
 
 int MODEL3D::three_dim_model::generate_filled_layer(const int &layer_number)
 {
-    if(etch_contour_map[layer_number].size() > 0)
+    if(layer_contour(layer_number)!=nullptr)
     {
-        double cont_wid = std::prev(etch_contour_map[layer_number].end(),1)->x;
-        double countour_width = std::round(cont_wid*1.4);//40% tolerance to avoid bunching
-        double foot_adjustment = std::round(-(countour_width/10));
         // make bounding polygon (Will be used for OpenCascade Boolean difference)
         ClipperLib::IntPoint a,b,c,d;//clockwise
         a.X = layer_boundary_map[layer_number][0];
@@ -427,64 +476,9 @@ int MODEL3D::three_dim_model::generate_filled_layer(const int &layer_number)
         c.Y = layer_boundary_map[layer_number][3];
         d.X = layer_boundary_map[layer_number][2];
         d.Y = layer_boundary_map[layer_number][1];
-        // GEO::geofile layer_parent, child_polyhedron;
-        // build_layer_box(layer_number, a, b, c, d, layer_parent);
         ClipperLib::Path bp_vec = {a,b,c,d};
-        // Determine ground plane holes
-        ClipperLib::Paths negatives;
-        auto poly_end = clipper_polygons_map[layer_number].end();
-        // For each polygon on this layer.
-        for (   auto poly_it = clipper_polygons_map[layer_number].begin();
-                poly_it != poly_end; poly_it++)
-        {
-            ClipperLib::Path my_path = *poly_it;
-            ClipperLib::Paths negative;
-            ClipperLib::SimplifyPolygon(my_path, negative, ClipperLib::pftNonZero);
-            if(negative.size()>0)
-            {
-                auto neg_end = negative.end();
-                for (auto neg_it = negative.begin(); neg_it != neg_end; neg_it++)
-                {
-                    negatives.insert(negatives.end(),negative.begin(),negative.end());
-                }
-            }
-        }
-        ClipperLib::Clipper my_mask;
-        ClipperLib::Paths solution_paths;
-        // clipper_paths_to_gds(negatives)
-        my_mask.AddPath(bp_vec, ClipperLib::ptSubject, true);
-        my_mask.AddPaths(negatives, ClipperLib::ptClip, true);
-        my_mask.Execute(    ClipperLib::ctDifference,
-                            solution_paths,
-                            ClipperLib::pftNonZero,
-                            ClipperLib::pftNonZero);
-
-        ClipperLib::ClipperOffset co;
-        // shift by foot adjustment
-        co.Clear();
-        co.AddPaths(solution_paths, ClipperLib::jtMiter, ClipperLib::etClosedPolygon);
-        solution_paths.clear();
-        co.Execute(solution_paths, foot_adjustment);
-        // grow by contour width
-        co.Clear();
-        co.AddPaths(solution_paths, ClipperLib::jtMiter, ClipperLib::etClosedPolygon);
-        solution_paths.clear();
-        co.Execute(solution_paths, countour_width);
-        // reduce by contour width (creates correct contour profile)
-        co.Clear();
-        if(round_concave_corners==true)
-            co.AddPaths(solution_paths, ClipperLib::jtRound, ClipperLib::etClosedPolygon);
-        else
-            co.AddPaths(solution_paths, ClipperLib::jtMiter, ClipperLib::etClosedPolygon);
-        solution_paths.clear();
-        co.Execute(solution_paths, -countour_width);
-        // filter into primary and secondary shapes
         ClipperLib::Paths primary_paths, secondary_paths;
-        primary_paths = solution_paths;
-        // clipper_paths_to_gds(primary_paths, "Before_filter", layer_number);
-        bool has_holes = filter_paths(primary_paths, secondary_paths);
-        tidy_paths(primary_paths);
-        tidy_paths(secondary_paths);
+        prepare_filled_paths(layer_number, bp_vec, primary_paths, secondary_paths);
         // clipper_paths_to_gds(primary_paths, "Primary", layer_number);//DEBUG
         // clipper_paths_to_gds(secondary_paths, "Secondary", layer_number);
         // Compartmentalize the layer
@@ -493,15 +487,16 @@ int MODEL3D::three_dim_model::generate_filled_layer(const int &layer_number)
         py_script.push_back("    current_layer =  " + std::to_string(layer_number) );
         py_script.push_back("    print(f'Generating Layer {current_layer}.')");
         // generate additive-block
-        double b_e_factor = (std::prev(etch_contour_map[layer_number].end(),1)->x)*BLOCK_EXPANSION_FACTOR;
+        // A windowed block ends at the window edge
+        double b_e_factor = (use_window==true) ? 0 : layer_contour(layer_number)->width()*BLOCK_EXPANSION_FACTOR;
         //chose ceiling for consistency and preference to rather have more material than less
         //Rounding not necessary but simply preferred in this case.
         double origin_x = std::ceil(a.X - b_e_factor);
         double origin_y = std::ceil(a.Y - b_e_factor);
-        double origin_z = proc_info_map[layer_number].z_start;
+        double origin_z = process_info.at(layer_number).z_start;
         double delta_x =  std::ceil((c.X - a.X)+2*b_e_factor);
         double delta_y =  std::ceil((c.Y - a.Y)+2*b_e_factor);
-        double delta_z = std::prev(etch_contour_map[layer_number].end(),1)->z;
+        double delta_z = layer_contour(layer_number)->height();
         std::string additive_block = "    additive_block_"
         +std::to_string(layer_number)+" = Part.makeBox("
         +std::to_string(delta_x)+","
@@ -523,6 +518,55 @@ int MODEL3D::three_dim_model::generate_filled_layer(const int &layer_number)
     }
 }
 
+// Removes the layer polygons (holes in the fill) from the supplied outline,
+// applies the contour offsets and splits the result into primary and
+// secondary paths. Only reads model state.
+int MODEL3D::three_dim_model::prepare_filled_paths(
+const int &layer_number,
+const ClipperLib::Path &outline,
+ClipperLib::Paths &primary_paths,
+ClipperLib::Paths &secondary_paths) const
+{
+    // Determine ground plane holes
+    ClipperLib::Paths negatives;
+    const ClipperLib::Paths &layer_polygons = polygons_map.at(layer_number);
+    auto poly_end = layer_polygons.end();
+    // For each polygon on this layer.
+    for (   auto poly_it = layer_polygons.begin();
+            poly_it != poly_end; poly_it++)
+    {
+        ClipperLib::Path my_path = *poly_it;
+        ClipperLib::Paths negative;
+        ClipperLib::SimplifyPolygon(my_path, negative, ClipperLib::pftNonZero);
+        if(negative.size()>0)
+        {
+            auto neg_end = negative.end();
+            for (auto neg_it = negative.begin(); neg_it != neg_end; neg_it++)
+            {
+                negatives.insert(negatives.end(),negative.begin(),negative.end());
+            }
+        }
+    }
+    ClipperLib::Clipper my_mask;
+    ClipperLib::Paths solution_paths;
+    // clipper_paths_to_gds(negatives)
+    my_mask.AddPath(outline, ClipperLib::ptSubject, true);
+    my_mask.AddPaths(negatives, ClipperLib::ptClip, true);
+    my_mask.Execute(    ClipperLib::ctDifference,
+                        solution_paths,
+                        ClipperLib::pftNonZero,
+                        ClipperLib::pftNonZero);
+    apply_contour_offsets(layer_number, solution_paths);
+    // filter into primary and secondary shapes
+    primary_paths = solution_paths;
+    secondary_paths.clear();
+    // clipper_paths_to_gds(primary_paths, "Before_filter", layer_number);
+    filter_paths(primary_paths, secondary_paths);
+    tidy_paths(primary_paths);
+    tidy_paths(secondary_paths);
+    return EXIT_SUCCESS;
+}
+
 void MODEL3D::three_dim_model::remove_outer_path(ClipperLib::Paths &paths_vec)
 {
     if (paths_vec.size()>1)
@@ -544,10 +588,12 @@ void MODEL3D::three_dim_model::polygon_layer_to_gds(const int &layer_number)
     gdscpp my_polygons;
     gdsSTR main;
     main.name = std::to_string(layer_number);
+    std::vector<int> cor_x, cor_y;
     auto poly_end = polygons_map[layer_number].end();
     for (auto poly_it = polygons_map[layer_number].begin(); poly_it != poly_end; poly_it++)
     {
-        main.BOUNDARY.push_back(drawBoundary( layer_number , poly_it->x, poly_it->y));
+        path_to_xy(*poly_it, cor_x, cor_y);
+        main.BOUNDARY.push_back(drawBoundary( layer_number , cor_x, cor_y));
     }
     my_polygons.setSTR(main);
     my_polygons.write("data/"+main.name+".gds");
@@ -561,15 +607,8 @@ void MODEL3D::three_dim_model::clipper_path_to_gds(const ClipperLib::Path &in_pa
     main.name = "Debug_polygon";
     if (gds_name.size()>0)
       main.name = gds_name;
-    //convert path to dual vectors of co_ord
-    std::vector<int> cor_x;
-    std::vector<int> cor_y;
-    auto in_end = in_path.end();
-    for (auto i = in_path.begin(); i != in_end; i++)
-    {
-        cor_x.push_back(i->X);
-        cor_y.push_back(i->Y);
-    }
+    std::vector<int> cor_x, cor_y;
+    path_to_xy(in_path, cor_x, cor_y);
     main.BOUNDARY.push_back(drawBoundary( 1 , cor_x, cor_y));
     my_polygons.setSTR(main);
     my_polygons.write("data/"+main.name+".gds");
@@ -581,6 +620,7 @@ void MODEL3D::three_dim_model::polygon_map_to_gds()
     gdscpp my_polygons;
     gdsSTR main;
     main.name = "Polygon_Map";
+    std::vector<int> cor_x, cor_y;
     auto poly_map_end = polygons_map.end();
     // For each layer
     for (auto layer_it = polygons_map.begin(); layer_it != poly_map_end; layer_it++)
@@ -589,79 +629,116 @@ void MODEL3D::three_dim_model::polygon_map_to_gds()
         auto poly_end = layer_it->second.end();
         for (auto poly_it = layer_it->second.begin(); poly_it != poly_end; poly_it++)
         {
-            main.BOUNDARY.push_back(drawBoundary( layer_it->first , poly_it->x, poly_it->y));
+            path_to_xy(*poly_it, cor_x, cor_y);
+            main.BOUNDARY.push_back(drawBoundary( layer_it->first , cor_x, cor_y));
         }
     }
     my_polygons.setSTR(main);
     my_polygons.write("data/"+main.name+".gds");
 }
 
+// Bounding box of every layer, stored as {min x, min y, max x, max y}.
 void MODEL3D::three_dim_model::calculate_all_layer_bounds()
 {
     initialize_layer_boundary_map();
-    bool empty[4] = {true, true, true, true};
-    //scan through each layer
     auto layers_end = polygons_map.end();
     for (auto i = polygons_map.begin(); i != layers_end; i++)
     {
-        //scan through each polygon
+        // A windowed model covers exactly the window on every layer
+        if(use_window==true)
+        {
+            layer_boundary_map[i->first] = {(int)window.min_x, (int)window.min_y,
+                                            (int)window.max_x, (int)window.max_y};
+            continue;
+        }
+        bool empty = true;
+        point_bounds layer_bounds = {0, 0, 0, 0};
         auto polygons_vector_end = i->second.end();
         for (auto j = i->second.begin(); j != polygons_vector_end; j++)
         {
-            //scan through each x point
-            auto k_end = j->x.end();
-            for (auto k = j->x.begin(); k != k_end; k++)
-            {
-                //min  x check
-                if (empty[0]==true)
-                {
-                    layer_boundary_map[i->first][0] = *k;
-                    empty[0] = false;
-                }
-                else if(*k < layer_boundary_map[i->first][0])
-                {
-                    layer_boundary_map[i->first][0] = *k;
-                }
-                //max x check
-                if (empty[2]==true)
-                {
-                    layer_boundary_map[i->first][2] = *k;
-                    empty[2] = false;
-                }
-                else if(*k > layer_boundary_map[i->first][2])
-                {
-                    layer_boundary_map[i->first][2] = *k;
-                }
-            }
-            //scan through each y point
-            auto n_end = j->y.end();
-            for (auto n = j->y.begin(); n != n_end; n++)
+            if(j->empty())
+                continue;
+            point_bounds polygon_bounds = kernel_bounds(j->data(), j->size());
+            if(empty==true)
+                layer_bounds = polygon_bounds;
+            else
+                kernel_merge_bounds(layer_bounds, polygon_bounds);
+            empty = false;
+        }
+        layer_boundary_map[i->first] = {(int)layer_bounds.min_x, (int)layer_bounds.min_y,
+                                        (int)layer_bounds.max_x, (int)layer_bounds.max_y};
+    }
+}
+
+// Window grown by the margin. Layout within the margin is kept so that
+// offsets near the window edge see their neighbours.
+clip_window MODEL3D::three_dim_model::expanded_window() const
+{
+    return {window.min_x-window_margin, window.min_y-window_margin,
+            window.max_x+window_margin, window.max_y+window_margin};
+}
+
+// Cuts the flattened polygons to the expanded window. Polygons inside it are
+// kept as they are and only those crossing its edge go through Clipper.
+// Layers left without polygons are removed, except filled layers, which
+// still cover the window.
+void MODEL3D::three_dim_model::clip_layers_to_window()
+{
+    clip_window region = expanded_window();
+    ClipperLib::Path region_path = {{region.min_x, region.min_y}, {region.max_x, region.min_y},
+                                    {region.max_x, region.max_y}, {region.min_x, region.max_y}};
+    ClipperLib::Clipper clipper;
+    ClipperLib::Paths solution;
+    for (auto layer_it = polygons_map.begin(); layer_it != polygons_map.end();)
+    {
+        ClipperLib::Paths clipped;
+        clipped.reserve(layer_it->second.size());
+        auto polygons_end = layer_it->second.end();
+        for (auto poly_it = layer_it->second.begin(); poly_it != polygons_end; poly_it++)
+        {
+            if(poly_it->empty())
+                continue;
+            point_bounds bounds = kernel_bounds(poly_it->data(), poly_it->size());
+            if( (bounds.min_x>=region.min_x) && (bounds.min_y>=region.min_y) &&
+                (bounds.max_x<=region.max_x) && (bounds.max_y<=region.max_y) )
             {
-                //min  y check
-                if (empty[1]==true)
-                {
-                    layer_boundary_map[i->first][1] = *n;
-                    empty[1] = false;
-                }
-                else if(*n < layer_boundary_map[i->first][1])
-                {
-                    layer_boundary_map[i->first][1] = *n;
-                }
-                //max y check
-                if (empty[3]==true)
-                {
-                    layer_boundary_map[i->first][3] = *n;
-                    empty[3] = false;
-                }
-                else if(*n > layer_boundary_map[i->first][3])
-                {
-                    layer_boundary_map[i->first][3] = *n;
-                }
+                clipped.push_back(std::move(*poly_it));
+                continue;
             }
+            if( (bounds.max_x<region.min_x) || (bounds.min_x>region.max_x) ||
+                (bounds.max_y<region.min_y) || (bounds.min_y>region.max_y) )
+                continue;
+            clipper.Clear();
+            clipper.AddPath(*poly_it, ClipperLib::ptSubject, true);
+            clipper.AddPath(region_path, ClipperLib::ptClip, true);
+            clipper.Execute(ClipperLib::ctIntersection, solution, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+            clipped.insert(clipped.end(), std::make_move_iterator(solution.begin()),
+                           std::make_move_iterator(solution.end()));
+        }
+        int dense_id = process_info.find(layer_it->first);
+        bool is_filled = (dense_id>=0) && (process_info[dense_id].mask_type==2);
+        if( (clipped.empty()) && (is_filled==false) )
+            layer_it = polygons_map.erase(layer_it);
+        else
+        {
+            layer_it->second.swap(clipped);
+            layer_it++;
         }
     }
 }
 
+// Cuts offset paths back to the window shrunk by inset, so that solids whose
+// sidewalls flare out by inset end at the window edge and not at the margin.
+void MODEL3D::three_dim_model::clip_paths_to_window(ClipperLib::Paths &paths, const ClipperLib::cInt &inset) const
+{
+    ClipperLib::Path region_path = {{window.min_x+inset, window.min_y+inset}, {window.max_x-inset, window.min_y+inset},
+                                    {window.max_x-inset, window.max_y-inset}, {window.min_x+inset, window.max_y-inset}};
+    ClipperLib::Clipper clipper;
+    clipper.AddPaths(paths, ClipperLib::ptSubject, true);
+    clipper.AddPath(region_path, ClipperLib::ptClip, true);
+    clipper.Execute(ClipperLib::ctIntersection, paths, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+}
+
 void MODEL3D::three_dim_model::initialize_layer_boundary_map()
 {
     layer_boundary_map.clear();
@@ -684,14 +761,12 @@ void MODEL3D::three_dim_model::print_polygons_map()
         for (auto j = i->second.begin(); j != poly_end; j++)
         {
             std::cout<<"Polygon "<<std::to_string(++poly_count)<<"~~~~~~~~~~~~"<<std::endl;
-            auto k_end = j->x.end();
-            auto k_2 = j->y.begin();
+            auto k_end = j->end();
             int point_count = 0;
-            for (auto k = j->x.begin(); k != k_end; k++)
+            for (auto k = j->begin(); k != k_end; k++)
             {
                 std::cout << "P" << std::to_string(++point_count)
-                << ": X=" << *k << "|Y=" << *k_2 << std::endl;
-                k_2++;
+                << ": X=" << k->X << "|Y=" << k->Y << std::endl;
             }
         }
     }
@@ -704,18 +779,12 @@ void MODEL3D::three_dim_model::clipper_paths_to_gds(    const ClipperLib::Paths
     gdscpp my_polygons;
     gdsSTR main;
     main.name = gds_name;
-    std::vector<co_ord> polygons;
+    std::vector<int> cor_x, cor_y;
     auto paths_it_end = target_paths.end();
     for (auto path_it = target_paths.begin(); path_it != paths_it_end; path_it++)
     {
-        co_ord p_hold_poly;
-        path_to_co_ord(*path_it, p_hold_poly);
-        polygons.push_back(p_hold_poly);
-    }
-    auto polygons_it_end = polygons.end();
-    for (auto polygon_it = polygons.begin(); polygon_it != polygons_it_end; polygon_it++)
-    {
-        main.BOUNDARY.push_back(drawBoundary( layer_number , polygon_it->x, polygon_it->y));
+        path_to_xy(*path_it, cor_x, cor_y);
+        main.BOUNDARY.push_back(drawBoundary( layer_number , cor_x, cor_y));
     }
     my_polygons.setSTR(main);
     my_polygons.write("data/"+main.name+".gds");
@@ -736,7 +805,7 @@ void MODEL3D::three_dim_model::close_paths(ClipperLib::Paths &paths_vec)
 
 bool MODEL3D::three_dim_model::clipper_path_is_equal(
 const ClipperLib::Path &a,
-const ClipperLib::Path &b)
+const ClipperLib::Path &b) const
 {
     if( (a.empty())||(b.empty()))//safeguard
         return false;
@@ -761,7 +830,7 @@ const ClipperLib::Path &b)
 // question out of primary paths and into secondary paths. It is a hole.
 bool MODEL3D::three_dim_model::filter_paths(
 ClipperLib::Paths &primary_paths,
-ClipperLib::Paths &secondary_paths)
+ClipperLib::Paths &secondary_paths) const
 {
     auto outer_it_end = primary_paths.end();
     for ( auto outer_it = primary_paths.begin();
@@ -808,730 +877,137 @@ ClipperLib::Paths &secondary_paths)
     return false;
 }
 
-int  MODEL3D::three_dim_model::load_etch_contour_map(const std::string &cont_path)
-{
-    //std::map<int, Layer_prop> proc_info;
-    //std::map<int, std::vector<GEO::point>> etch_contour_map;
-    auto proc_map_end = proc_info_map.end();
-    for ( auto proc_map_it = proc_info_map.begin();
-         proc_map_it != proc_map_end;
-         proc_map_it++)
-    {
-        // get layer thickness
-        int thickness = proc_map_it->second.thickness;
-        std::string thickness_string = std::to_string(thickness);
-        std::string contour_path = cont_path;
-        if(*contour_path.rbegin()=='/')
-            contour_path.pop_back();
-        contour_path = cont_path + "/" + thickness_string + "_contour.geo";
-        // std::string contour_path = "../data/3DGen/"+ thickness_string +"_contour.geo";//TODO: Fix this to a user input
-        // if file exists open else return error
-        GEO::geofile contour;
-        if(contour.import_geofile(contour_path)==EXIT_SUCCESS)
-        {
-            std::vector<GEO::point> contour_vec;
-            contour.pull_points(contour_vec);
-            etch_contour_map.insert({proc_map_it->first, contour_vec});
-        }
-        else
-        {
-            std::cout<<"Error: Contour import failed. ["<<contour_path<<"]"<<std::endl;
+// Loads the contour of every distinct layer thickness once. Layers look
+// their contour up by thickness, so layers of equal thickness share it.
+int MODEL3D::three_dim_model::load_etch_contours(const std::string &cont_path)
+{
+    for (size_t id = 0; id < process_info.size(); id++)
+    {
+        if(etch_contours.load(cont_path, process_info[id].thickness)==EXIT_FAILURE)
             return EXIT_FAILURE;
-        }
     }
+    etch_contours.precompute(contour_resolution);
     return EXIT_SUCCESS;
 }
 
+// Returns the contour used for a layer, or nullptr if the layer has none.
+const MODEL3D::etch_contour* MODEL3D::three_dim_model::layer_contour(const int &layer_number) const
+{
+    int id = process_info.find(layer_number);
+    if(id<0)
+        return nullptr;
+    return etch_contours.find(process_info[id].thickness, contour_resolution);
+}
+
 /**
- * [build_polyhedron - Creates 3D polyhedron based off the following]
- * @param   contour             [The base shape outline which the
- *                              etch-contour is attached to]
- * @param   layer_number        [The layer number which the
- *                              polyhedron belongs to]
- * @param   unique_ID           [The ID of the polyhedron on this layer]
- * @param   is_positive         [Dictates whether the shape is additive or
- *                              subtractive in the greater shape]
- * @param   outward_facing      [Dictates whether the etch countour should
- *                              be placed towards the outside of shape]
- * @param   generated_geofile   [the GEO::geofile containing the generated polyhedron.
+ * [build_polyhedron - Adds a swept solid to a .geo model]
+ * @param   solid               [Outline, holes and extrusion levels of
+ *                              the solid]
+ * @param   geometry            [The model receiving the polyhedron]
+ * @param   volume_id           [The ID of the created volume]
  * @return                      [0 - Exit Success or
  *                              1 - Exit Failure]
  */
 int MODEL3D::three_dim_model::build_polyhedron(
-const ClipperLib::Path &contour,
-const int &layer_number,
-const int &unique_ID,
-const bool &is_positive,
-const bool &outward_facing,
-GEO::geofile &generated_geofile)
+const mesh_solid &solid,
+GEO::geo_builder &geometry,
+int &volume_id) const
 {
-    if(contour.size()<3)
+    std::vector<mesh_ring> rings;
+    rings.push_back(solid.outer);
+    if( (rings[0].levels.size()<2) || (orient_ring(rings[0], true)==false) )
     {
         std::cout << "Error: Invalid polyhedron supplied." << std::endl;
         return EXIT_FAILURE;
     }
-    GEO::geofile polyhedron;
-    std::map<int, GEO::point> poly_points_map;
-    std::map<int, GEO::line> poly_lines_map;
-    std::map<int, std::vector<int>> poly_curve_loops_map;
-    std::map<int, int> poly_plane_surfaces_map;
-    std::map<int, std::vector<int>> poly_surface_loops_map;
-    std::map<int, int> poly_volumes_map;
-    std::vector<int> roof_line_vector;
-    int hp_point = pnt_cnt;//highest point from previous shape
-    int hp_line = ln_cnt;
-    int hp_curve_loop = cl_cnt;
-    int hp_plane_sur = ps_cnt;
-    int hp_sur_loop = sl_cnt;
-    int hp_vol_cnt = vol_cnt;
-    int point_counter = hp_point;// these counter values are changed from 0 for run-on testing
-    int line_counter = hp_line;//0
-    int curve_loop_counter = hp_curve_loop;//0
-    int plane_surfaces_counter = hp_plane_sur;//0
-    int surface_loops_counter = hp_sur_loop;//0
-    int volumes_counter = hp_vol_cnt;//0
-    // Insert base points & lines ----------------------------
-    auto c_end = std::prev(contour.end(),1);
-    for ( auto c_it = contour.begin(); c_it != c_end; c_it++)
-    {
-        GEO::point in_point;
-        GEO::line in_line;
-        in_point.x = c_it->X;
-        in_point.y = c_it->Y;
-        in_point.z = proc_info_map[layer_number].z_start;
-        in_point.char_len = 1e3;
-        in_line.start = ++point_counter;
-        poly_points_map.insert({point_counter, in_point});
-        in_line.end = point_counter+1;
-        poly_lines_map.insert({++line_counter,in_line});
-    }
-    GEO::point in_point;
-    GEO::line in_line;
-    in_point.x = c_end->X;
-    in_point.y = c_end->Y;
-    in_point.z = proc_info_map[layer_number].z_start;
-    in_point.char_len = 1e3;
-    in_line.start = ++point_counter;
-    poly_points_map.insert({point_counter, in_point});
-    in_line.end = hp_point+1;//start of points for this polyhedron
-    poly_lines_map.insert({++line_counter,in_line});
-    //--------------------------------------------------------//
-    // Create base surface -----------------------------------//
-    auto plm_end = poly_lines_map.end();
-    std::vector<int> base_loop;
-    for ( auto plm_it = poly_lines_map.begin(); plm_it != plm_end; plm_it++)
-        base_loop.push_back(plm_it->first);
-    poly_curve_loops_map.insert({++curve_loop_counter, base_loop});
-    poly_plane_surfaces_map.insert({ ++plane_surfaces_counter,
-                                     plane_surfaces_counter});
-    //--------------------------------------------------------//
-    // Etch profile creation ---------------------------------//
-    auto ppm_end = poly_points_map.end();
-    std::map<int, GEO::point> contour_points;
-    std::vector<int> right_angled_points;
-    for ( auto ppm_it = poly_points_map.begin();
-          ppm_it != ppm_end; ppm_it++)
-    {
-        GEO::point prev_point, current_point, next_point;
-        // First Case
-        if(ppm_it == poly_points_map.begin())
-        {
-            prev_point      = std::prev(ppm_end,1)->second;
-            current_point   = ppm_it->second;
-            next_point      = std::next(ppm_it,1)->second;
-        }
-        // Last Case
-        else if(ppm_it == std::prev(poly_points_map.end(),1))
-        {
-            prev_point      = std::prev(ppm_it,1)->second;
-            current_point   = ppm_it->second;
-            next_point      = poly_points_map.begin()->second;
-        }
-        // Normal Case
-        else
-        {
-            prev_point     = std::prev(ppm_it,1)->second;
-            current_point  = ppm_it->second;
-            next_point     = std::next(ppm_it,1)->second;
-        }
-        // Prime the contour for insertion
-        double theta = calculate_theta(prev_point, current_point, next_point)*180/PI;
-        //create a point at poly points map it, + 5 nm
-        std::vector<GEO::point> test_point_v;
-        GEO::point test_point;
-        test_point.x = (int)ppm_it->second.x+5;
-        test_point.y = (int)ppm_it->second.y;
-        test_point.z = 0;
-        test_point_v.push_back(test_point);
-        //rotate point by theta
-        rotate_vector(test_point.x-5, test_point.y, theta, test_point_v);
-        //convert to clipper compatible
-        ClipperLib::IntPoint cl_test_point;
-        cl_test_point.X = (int)test_point_v[0].x;
-        cl_test_point.Y = (int)test_point_v[0].y;
-        // do point in polygon check. depending on setting, adjust theta
-        if(outward_facing==true)
-        {
-            if(ClipperLib::PointInPolygon(cl_test_point, contour)==1)
-                theta = theta + 180;
-        }
-        else
-        {
-            if(ClipperLib::PointInPolygon(cl_test_point, contour)==0)
-                theta = theta + 180;
-        }
-        // get all but first point of contour
-        std::vector<GEO::point> contour_instance;
-        contour_instance.insert( contour_instance.end(),
-                                 std::next(etch_contour_map[layer_number].begin(),1),
-                                 etch_contour_map[layer_number].end() );
-        rotate_vector(0, 0, theta, contour_instance);
-        translate_vector(contour_instance, current_point.x, current_point.y, current_point.z);
-        int cont_inst_size = contour_instance.size();
-        // test for 90deg elbow
-        // 90 degree elbow check
-        // if 90 degree elbow reverse by 45 degrees and then place 6 every 15 degrees
-        if (is_elbow(prev_point, current_point, next_point)==true)
-        {
-            int eldist = std::distance(poly_points_map.begin(), ppm_it) + 1+hp_point;
-            right_angled_points.push_back(eldist);
-            rotate_vector(current_point.x, current_point.y, -45, contour_instance);
-            for ( int i = 0; i < 7; i++)
-            {
-                for ( auto j = contour_instance.begin(); j != contour_instance.end(); j++)// TODO: REVIEW
-                {
-                    contour_points.insert({++point_counter, *j});
-                }
-                rotate_vector(current_point.x, current_point.y, 15, contour_instance);
-            }
-        }
-        // Otherwise, place like normal.
-        else
-        {
-            for ( auto i = contour_instance.begin(); i != contour_instance.end(); i++)
-            {
-                contour_points.insert({++point_counter, *i});
-            }
-        }
-    }
-    poly_points_map.insert(contour_points.begin(),contour_points.end());
-    //--------------------------------------------------------//
-    // Plane surface creation --------------------------------//
-    int base_points_count = contour.size();
-    auto layer_count = etch_contour_map[layer_number].size();
-    // for each edge of base polygon
-    int panel_count = 0;
-    for ( int n = hp_point+1; n < (base_points_count+hp_point+1); n++)
-    {
-        int gain = n + contour.size()-(hp_point+1);
-        int depth = etch_contour_map[layer_number].size()-1;
-        bool r_angle_flag = false;
-        if (std::find(right_angled_points.begin(),right_angled_points.end(),n)!=right_angled_points.end())
-            r_angle_flag = true;
-        if (r_angle_flag==true)
+    // Every ring is checked before anything is added to the model, since
+    // dropping a hole would fill it with material.
+    for (size_t i = 0; i < solid.holes.size(); i++)
+    {
+        mesh_ring hole = solid.holes[i];
+        if(hole.levels.size()!=rings[0].levels.size())
         {
-            add_right_plane( n, gain, depth,
-                            poly_lines_map,
-                            poly_curve_loops_map,
-                            poly_plane_surfaces_map,
-                            base_points_count,
-                            panel_count,
-                            roof_line_vector,
-                            hp_curve_loop,
-                            hp_plane_sur,
-                            hp_point);
+            std::cout << "Error: Hole " << i+1 << " has " << hole.levels.size()
+                      << " levels, the polyhedron outline has " << rings[0].levels.size() << "." << std::endl;
+            return EXIT_FAILURE;
         }
-        else
+        if(orient_ring(hole, false)==false)
         {
-            add_normal_plane( n, gain, depth,
-                              poly_lines_map,
-                              poly_curve_loops_map,
-                              poly_plane_surfaces_map,
-                              base_points_count,
-                              panel_count,
-                              roof_line_vector,
-                              hp_curve_loop,
-                              hp_plane_sur,
-                              hp_point);
+            std::cout << "Error: Hole " << i+1 << " is degenerate." << std::endl;
+            return EXIT_FAILURE;
         }
-
+        rings.push_back(hole);
     }
-    // Create roof surface -----------------------------------//
-    curve_loop_counter = std::prev(poly_curve_loops_map.end(),1)->first;
-    plane_surfaces_counter = std::prev(poly_plane_surfaces_map.end(),1)->first;
-    poly_curve_loops_map.insert({++curve_loop_counter, roof_line_vector});
-    poly_plane_surfaces_map.insert({++plane_surfaces_counter, curve_loop_counter});
-    //--------------------------------------------------------//
-    polyhedron.insert_points_map(poly_points_map);
-    polyhedron.insert_lines_map(poly_lines_map);
-    polyhedron.insert_curve_loops_map(poly_curve_loops_map);
-    polyhedron.insert_plane_surfaces_map(poly_plane_surfaces_map);
-    polyhedron.make_coherent(false);
-    // Make surface loop out of all plane surfaces
     std::vector<int> polyhedron_surface;
-    auto slm_it_end = poly_plane_surfaces_map.end();
-    for ( auto slm_it = poly_plane_surfaces_map.begin(); slm_it != slm_it_end; slm_it++)
-    {
-    polyhedron_surface.push_back(slm_it->first);
-    }
-    poly_surface_loops_map.insert({++surface_loops_counter, polyhedron_surface});
-    // Make volume out of surface loop
-    poly_volumes_map.insert({++volumes_counter, surface_loops_counter});
-    // insert volume and surface loops maps into geo file.
-    polyhedron.insert_surface_loops_map(poly_surface_loops_map); //TODO: uncomment
-    polyhedron.insert_volumes_map(poly_volumes_map);             //TODO: Uncomment
-    polyhedron.switch_to_OpenCASCADE();
-    polyhedron.disable_char_len();
-    //update global counters for next shape
-    pnt_cnt = std::prev(poly_points_map.end(),1)->first;
-    ln_cnt = std::prev(poly_lines_map.end(),1)->first;
-    cl_cnt = std::prev(poly_curve_loops_map.end(),1)->first;
-    ps_cnt = std::prev(poly_plane_surfaces_map.end(),1)->first;
-    sl_cnt = std::prev(poly_surface_loops_map.end(),1)->first;
-    vol_cnt = std::prev(poly_volumes_map.end(),1)->first;
-    // std::string polyhedron_type = (is_positive==true)? ("P") : ("N");
-    // std::string polyhedron_name = "data/3DGen/"
-    // + std::to_string(layer_number) + "_" + polyhedron_type + "_"
-    // + std::to_string(unique_ID) + ".geo";
-    // std::cout << "Exporting " << polyhedron_name << std::endl; // TODO: Remove once stable
-    // polyhedron.export_geofile(polyhedron_name);
-    generated_geofile = polyhedron;
+    std::vector<int> floor_loops, roof_loops;
+    auto rings_end = rings.end();
+    for (auto ring_it = rings.begin(); ring_it != rings_end; ring_it++)
+    {
+        std::vector<std::vector<int>> level_points;
+        add_ring_walls(*ring_it, geometry, level_points, polyhedron_surface);
+        // The floor faces down, so it runs against the ring direction
+        std::vector<int> floor_points(level_points.front().rbegin(), level_points.front().rend());
+        floor_loops.push_back(geometry.add_curve_loop(floor_points));
+        roof_loops.push_back(geometry.add_curve_loop(level_points.back()));
+    }
+    polyhedron_surface.push_back(geometry.add_plane_surface(floor_loops));
+    polyhedron_surface.push_back(geometry.add_plane_surface(roof_loops));
+    volume_id = geometry.add_volume(geometry.add_surface_loop(polyhedron_surface));
     return EXIT_SUCCESS;
 }
 
-// Returns the theta angle to rotate contour by (in radians)
-double MODEL3D::three_dim_model::calculate_theta(const GEO::point &prev,
-                                                 const GEO::point &curr,
-                                                 const GEO::point &next )
-{
-    // Set up the vectors
-    euclid_vector a, b, c;
-    a.i = curr.x - prev.x;
-    a.j = curr.y - prev.y;
-    a.k = 0;
-    b.i = curr.x - next.x;
-    b.j = curr.y - next.y;
-    b.k = 0;
-    // Normalize them
-    double a_dist = std::sqrt( pow((double)a.i,2) + pow((double)a.j,2) );
-    double b_dist = std::sqrt( pow((double)b.i,2) + pow((double)b.j,2) );
-    a.i = a.i/a_dist;
-    a.j = a.j/a_dist;
-    b.i = b.i/b_dist;
-    b.j = b.j/b_dist;
-    // Calculate the outward directional vector
-    c.i = a.i + b.i;
-    c.j = a.j + b.j;
-    c.k = 0;
-    // Calculate the angle of rotation
-    double theta = atan2(c.j, c.i);
-    return theta;
-}
-
-/**
- *  @brief Rotates the specified vector of points
- *  @param cx x_offset
- *  @param cy y_offset
- *  @param angle angle to rotate vector by. Angle must be counter-clockwise from
- * x-axis and in degrees.
- */
-void MODEL3D::three_dim_model::rotate_vector(
-double cx, double cy, double angle,
-std::vector<GEO::point> &subject) // POINT &subject
-{
-  angle = (angle * PI) / ((double)180); // convert angle to radians
-  double s = sin(angle);
-  double c = cos(angle);
-  auto revert_point_to_origin = [&cx, &cy](GEO::point &n) {
-    n.x -= cx;
-    n.y -= cy;
-  };
-  auto rotate_point = [&c, &s](GEO::point &n) {
-    int n_x_orig = n.x;
-    n.x = n.x * c - n.y * s;
-    n.y = n_x_orig * s + n.y * c;
-  };
-  auto translate_back = [&cx, &cy](GEO::point &n) {
-    n.x = n.x + cx;
-    n.y = n.y + cy;
-  };
-  for_each(subject.begin(), subject.end(),
-           revert_point_to_origin); // translate points back to origins
-  for_each(subject.begin(), subject.end(), rotate_point); // rotate points
-  for_each(subject.begin(), subject.end(),
-           translate_back); // translate points back
-}
-
-void MODEL3D::three_dim_model::translate_vector
-( std::vector<GEO::point> &point_vec,
-const double &delta_x,
-const double &delta_y,
-const double &delta_z )
-{
-    auto translate_pt = [&delta_x, &delta_y, &delta_z](GEO::point &n) {
-    n.x = n.x + delta_x;
-    n.y = n.y + delta_y;
-    n.z = n.z + delta_z;};
-    for_each( point_vec.begin(), point_vec.end(),
-              translate_pt); // translate points back
-
-}
-
-bool MODEL3D::three_dim_model::is_elbow(
-const GEO::point &prev,
-const GEO::point &curr,
-const GEO::point &next)
-{
-    GEO::point elbow_test_prev = prev;
-    GEO::point elbow_test_current = curr;
-    GEO::point elbow_test_next = next;
-    // move all points to "origin" relative to curr
-    elbow_test_prev.x       = elbow_test_prev.x    - elbow_test_current.x;
-    elbow_test_prev.y       = elbow_test_prev.y    - elbow_test_current.y;
-    elbow_test_prev.z       = elbow_test_prev.z    - elbow_test_current.z;
-    elbow_test_next.x       = elbow_test_next.x    - elbow_test_current.x;
-    elbow_test_next.y       = elbow_test_next.y    - elbow_test_current.y;
-    elbow_test_next.z       = elbow_test_next.z    - elbow_test_current.z;
-    elbow_test_current.x    = elbow_test_current.x - elbow_test_current.x;
-    elbow_test_current.y    = elbow_test_current.y - elbow_test_current.y;
-    elbow_test_current.z    = elbow_test_current.z - elbow_test_current.z;
-    //elbow test prev and current are now vectors
-    auto dot = elbow_test_prev.x*elbow_test_next.x + elbow_test_prev.y*elbow_test_next.y;
-    auto det = elbow_test_prev.x*elbow_test_next.y - elbow_test_prev.y*elbow_test_next.x;
-    auto angle = atan2(det, dot)*180/PI;
-    angle = std::round(std::abs(angle));
-    if (angle==90)
-        return true;
-    else
-        return false;
-}
-
-void MODEL3D::three_dim_model::add_normal_plane(
-int &n, int &gain, int &depth,
-std::map<int, GEO::line> &lines_map,
-std::map<int, std::vector<int>> &curve_loops_map,
-std::map<int, int> &plane_surfaces_map,
-const int &base_points_count,
-int &panel_count,
-std::vector<int> &roof_line_vector,
-const int &prev_cl_count,
-const int &prev_pls_count,
-const int &prev_pnt_count)
-{
-    // Setting up the counter values ========================================
-    int line_count = std::prev(lines_map.end(),1)->first;
-    int curve_loop_count;
-    if (!curve_loops_map.empty())
-        curve_loop_count = std::prev(curve_loops_map.end(),1)->first;
-    else
-        curve_loop_count = prev_cl_count;
-    int plane_surfaces_count;
-    if(!plane_surfaces_map.empty())
-        plane_surfaces_count = std::prev(plane_surfaces_map.end(),1)->first;
-    else
-        plane_surfaces_count = prev_pls_count;
-    // Creating the ground-level plane surface ===============================
-    //c<--b
-    //v + ^                             <-- Loop to form plane surface
-    //d-->a
-    GEO::line a, b, c, d, diag;
-    a.start = n;                        // initial point of plane surface
-    if(n==base_points_count+prev_pnt_count)            // end of the line case
-    {
-        a.end       = base_points_count + 1 + prev_pnt_count + depth * panel_count; //7 points per 90deg bend
-        b.start     = a.end;
-        b.end       = 1 + prev_pnt_count + base_points_count;
-        c.start     = b.end;
-        c.end       = 1 + prev_pnt_count;
-        d.start     = c.end;
-        d.end       = a.start;
+// Places the ring points at every level and joins consecutive levels with
+// wall panels. Panels whose top and bottom edges stay parallel are planar
+// and added as one quad, anything else (clamped miters) is split in two.
+void MODEL3D::three_dim_model::add_ring_walls(
+const mesh_ring &ring,
+GEO::geo_builder &geometry,
+std::vector<std::vector<int>> &level_points,
+std::vector<int> &surfaces) const
+{
+    const ClipperLib::Path &path = ring.outline;
+    size_t n = path.size();
+    std::vector<double> miter_x, miter_y;
+    ring_miters(path, miter_x, miter_y);
+    std::vector<std::vector<double>> level_x, level_y;
+    auto levels_end = ring.levels.end();
+    for (auto level_it = ring.levels.begin(); level_it != levels_end; level_it++)
+    {
+        std::vector<int> ids;
+        std::vector<double> xs, ys;
+        for (size_t j = 0; j < n; j++)
+        {
+            xs.push_back(path[j].X + level_it->offset*miter_x[j]);
+            ys.push_back(path[j].Y + level_it->offset*miter_y[j]);
+            ids.push_back(geometry.add_point(xs.back(), ys.back(), level_it->z));
+        }
+        level_points.push_back(ids);
+        level_x.push_back(xs);
+        level_y.push_back(ys);
     }
-    else
+    for (size_t l = 0; l+1 < level_points.size(); l++)
     {
-        a.end       = base_points_count + 1 + prev_pnt_count + depth * panel_count;
-        b.start     = a.end;
-        b.end       = b.start + depth;
-        c.start     = b.end;
-        c.end       = n + 1;
-        d.start     = c.end;
-        d.end       = a.start;
-    }
-    diag.start      = b.end;
-    diag.end        = a.start;
-    lines_map.insert({++line_count, a});
-    lines_map.insert({++line_count, b});
-    lines_map.insert({++line_count, diag});
-    lines_map.insert({++line_count, c});
-    lines_map.insert({++line_count, d});
-    curve_loops_map.insert({++curve_loop_count, {line_count-4, line_count-3, line_count-2} } );
-    plane_surfaces_map.insert({++plane_surfaces_count, curve_loop_count});
-    curve_loops_map.insert({++curve_loop_count, {(-1*(line_count-2)), line_count-1, line_count} } );
-    plane_surfaces_map.insert({++plane_surfaces_count, curve_loop_count});
-    // Creating the higher plane surfaces ===============================
-    for ( int level_deep = 1; level_deep < depth; level_deep++)
-    {
-        a.start     = a.end;
-        a.end       = a.start + 1;
-        b.start     = a.end;
-        b.end       = (n==base_points_count+prev_pnt_count) ? (1+base_points_count+prev_pnt_count+level_deep) : (b.start + depth);
-        c.start     = b.end;
-        c.end       = c.start-1;
-        d.start     = c.end;
-        d.end       = a.start;
-        diag.start  = b.end;
-        diag.end    = a.start;
-        lines_map.insert({++line_count, a});
-        lines_map.insert({++line_count, b});
-        if(level_deep==(depth-1))
-            roof_line_vector.push_back(line_count);
-        lines_map.insert({++line_count, diag});
-        lines_map.insert({++line_count, c});
-        lines_map.insert({++line_count, d});
-        curve_loops_map.insert( {++curve_loop_count, {line_count-4, line_count-3, line_count-2} } );
-        plane_surfaces_map.insert({++plane_surfaces_count, curve_loop_count});
-        curve_loops_map.insert( {++curve_loop_count, {(-1*(line_count-2)), line_count-1, line_count} } );
-        plane_surfaces_map.insert({++plane_surfaces_count, curve_loop_count});
-    }
-    // Increment the panel counter
-    panel_count++;
-}
-
-void MODEL3D::three_dim_model::add_right_plane(
-int &n, int &gain, int &depth,
-std::map<int, GEO::line> &lines_map,
-std::map<int, std::vector<int>> &curve_loops_map,
-std::map<int, int> &plane_surfaces_map,
-const int &base_points_count,
-int &panel_count,
-std::vector<int> &roof_line_vector,
-const int &prev_cl_count,
-const int &prev_pls_count,
-const int &prev_pnt_count)
-{
-    // Setting up the counter values ========================================
-    int line_count = std::prev(lines_map.end(),1)->first;
-    int curve_loop_count;
-    if (!curve_loops_map.empty())
-        curve_loop_count = std::prev(curve_loops_map.end(),1)->first;
-    else
-        curve_loop_count = prev_cl_count;
-    int plane_surfaces_count;
-    if(!plane_surfaces_map.empty())
-        plane_surfaces_count = std::prev(plane_surfaces_map.end(),1)->first;
-    else
-        plane_surfaces_count = prev_pls_count;
-    // Loop through six panels
-    for ( int corner_cnt = 0; corner_cnt < 6; corner_cnt++)
-    {
-        // Creating the ground-level plane surface ===============================
-        //c<--b
-        //v + ^                             <-- Loop to form plane surface
-        //d-->a
-        GEO::line a, b, c, d, diag;
-        a.start = n;                        // initial point of plane surface
-        a.end   = base_points_count + 1 + prev_pnt_count + depth * panel_count;
-        b.start = a.end;
-        b.end   = b.start + depth;
-        c.start = b.end;
-        c.end   = a.start;
-        lines_map.insert({++line_count, a});
-        lines_map.insert({++line_count, b});
-        lines_map.insert({++line_count, c});
-        curve_loops_map.insert(
-        {++curve_loop_count,
-        {line_count-2, line_count-1,
-        line_count} } );
-        plane_surfaces_map.insert({++plane_surfaces_count, curve_loop_count});
-        // Creating the higher plane surfaces ===============================
-        for ( int level_deep = 1; level_deep < depth; level_deep++)
+        for (size_t j = 0; j < n; j++)
         {
-            a.start           = a.end;
-            a.end          = a.end + 1;
-            b.start           = a.end;
-            b.end          = b.start + depth;
-            c.start          = b.end;
-            c.end           = c.start - 1;
-            d.start          = c.end;
-            d.end           = a.start;
-            diag.start       = b.end;
-            diag.end        = a.start;
-            lines_map.insert({++line_count, a});
-            lines_map.insert({++line_count, b});
-            if(level_deep==(depth-1))
-                roof_line_vector.push_back(line_count);
-            lines_map.insert({++line_count, diag});
-            lines_map.insert({++line_count, c});
-            lines_map.insert({++line_count, d});
-            curve_loops_map.insert( {++curve_loop_count,
-                                    {(line_count-4), (line_count-3), (line_count-2)} } );
-            plane_surfaces_map.insert({++plane_surfaces_count, curve_loop_count});
-            curve_loops_map.insert( {++curve_loop_count,
-                                    {(-1*(line_count-2)), (line_count-1), (line_count)} } );
-            plane_surfaces_map.insert({++plane_surfaces_count, curve_loop_count});
+            size_t k = (j+1)%n;
+            double low_x = level_x[l][k] - level_x[l][j], low_y = level_y[l][k] - level_y[l][j];
+            double high_x = level_x[l+1][k] - level_x[l+1][j], high_y = level_y[l+1][k] - level_y[l+1][j];
+            double cross = low_x*high_y - low_y*high_x;
+            int a = level_points[l][j], b = level_points[l][k];
+            int a_up = level_points[l+1][j], b_up = level_points[l+1][k];
+            if(std::abs(cross) <= 1e-9*std::hypot(low_x, low_y)*std::hypot(high_x, high_y))
+                surfaces.push_back(geometry.add_plane_surface({geometry.add_curve_loop({a, b, b_up, a_up})}));
+            else
+            {
+                surfaces.push_back(geometry.add_plane_surface({geometry.add_curve_loop({a, b, b_up})}));
+                surfaces.push_back(geometry.add_plane_surface({geometry.add_curve_loop({a, b_up, a_up})}));
+            }
         }
-        panel_count++;
-    }
-    //treat the follow-up panel as a normal plane
-    add_normal_plane(   n, gain, depth,
-                        lines_map,
-                        curve_loops_map,
-                        plane_surfaces_map,
-                        base_points_count,
-                        panel_count,
-                        roof_line_vector,
-                        prev_cl_count,
-                        prev_pls_count,
-                        prev_pnt_count);
-}
-
-void MODEL3D::three_dim_model::build_layer_box(
- const int &layer_number,
-const ClipperLib::IntPoint &a,
-const ClipperLib::IntPoint &b,
-const ClipperLib::IntPoint &c,
-const ClipperLib::IntPoint &d,
-GEO::geofile &generated_geofile )
-{
-    int base_height = proc_info_map[layer_number].z_start;
-    int thickness = proc_info_map[layer_number].thickness;
-    GEO::geofile base_shape;
-    base_shape.switch_to_OpenCASCADE();
-    std::map<int, GEO::point> points_map;
-    std::map<int, GEO::line> lines_map;
-    std::map<int, std::vector<int>> curve_loops_map;
-    std::map<int, int> plane_surfaces_map;
-    std::map<int, std::vector<int>> surface_loops_map;
-    std::map<int, int> volumes_map;
-    GEO::point one, two, three, four, five, six, seven, eight;
-    int point_count = pnt_cnt;
-    int line_count = ln_cnt;
-    int plane_sur_count = ps_cnt;
-    int cur_loop_count = cl_cnt;
-    int sur_loop_count = sl_cnt;
-    int vol_count = vol_cnt;
-    //------- bottom --------
-    one.x   = a.X;
-    one.y   = a.Y;
-    one.z   = base_height;
-    one.char_len = model_default_char_length;
-    points_map.insert({++point_count, one});
-    two.x   = b.X;
-    two.y   = b.Y;
-    two.z   = base_height;
-    two.char_len = model_default_char_length;
-    points_map.insert({++point_count, two});
-    three.x = c.X;
-    three.y = c.Y;
-    three.z = base_height;
-    three.char_len = model_default_char_length;
-    points_map.insert({++point_count, three});
-    four.x  = d.X;
-    four.y  = d.Y;
-    four.z  = base_height;
-    four.char_len = model_default_char_length;
-    points_map.insert({++point_count, four});
-    GEO::line in_line;
-    in_line.start = point_count-3;
-    in_line.end = point_count-2;
-    lines_map.insert({++line_count, in_line});
-    in_line.start = point_count-2;
-    in_line.end = point_count-1;
-    lines_map.insert({++line_count, in_line});
-    in_line.start = point_count-1;
-    in_line.end = point_count;
-    lines_map.insert({++line_count, in_line});
-    in_line.start = point_count;
-    in_line.end = point_count-3;
-    lines_map.insert({++line_count, in_line});
-    curve_loops_map.insert({++cur_loop_count, {(point_count-3), (point_count-2), (point_count-1), point_count}});
-    plane_surfaces_map.insert({++plane_sur_count, plane_sur_count});
-    //-------- top ---------
-    five.x   = a.X;
-    five.y   = a.Y;
-    five.z   = base_height + thickness;
-    five.char_len = model_default_char_length;
-    points_map.insert({++point_count, five});
-    six.x    = b.X;
-    six.y    = b.Y;
-    six.z    = base_height + thickness;
-    six.char_len = model_default_char_length;
-    points_map.insert({++point_count, six});
-    seven.x  = c.X;
-    seven.y  = c.Y;
-    seven.z  = base_height + thickness;
-    seven.char_len = model_default_char_length;
-    points_map.insert({++point_count, seven});
-    eight.x  = d.X;
-    eight.y  = d.Y;
-    eight.z  = base_height + thickness;
-    eight.char_len = model_default_char_length;
-    points_map.insert({++point_count, eight});
-    in_line.start = point_count-3;
-    in_line.end = point_count-2;
-    lines_map.insert({++line_count, in_line});
-    in_line.start = point_count-2;
-    in_line.end = point_count-1;
-    lines_map.insert({++line_count, in_line});
-    in_line.start = point_count-1;
-    in_line.end = point_count;
-    lines_map.insert({++line_count, in_line});
-    in_line.start = point_count;
-    in_line.end = point_count-3;
-    lines_map.insert({++line_count, in_line});
-    curve_loops_map.insert({++cur_loop_count, {point_count-3,point_count-2,point_count-1,point_count}});
-    plane_surfaces_map.insert({++plane_sur_count, plane_sur_count});
-    // side 1;
-    in_line.start = point_count-7;
-    in_line.end = point_count-3;
-    lines_map.insert({++line_count, in_line});
-    in_line.start = point_count-6;
-    in_line.end = point_count-2;
-    lines_map.insert({++line_count, in_line});
-    curve_loops_map.insert({++cur_loop_count, {line_count-9,line_count,-(line_count-5),-(line_count-1)}});
-    plane_surfaces_map.insert({++plane_sur_count, plane_sur_count});
-    // side 2;
-    in_line.start = point_count-5;
-    in_line.end = point_count-1;
-    lines_map.insert({++line_count, in_line});
-    curve_loops_map.insert({++cur_loop_count, {line_count-1,line_count-5,-line_count,-(line_count-9)}});
-    plane_surfaces_map.insert({++plane_sur_count, plane_sur_count});
-    // side 3;
-    in_line.start = point_count-4;
-    in_line.end = point_count;
-    lines_map.insert({++line_count, in_line});
-    curve_loops_map.insert({++cur_loop_count, {line_count-1,line_count-5,-line_count,-(line_count-9)}});
-    plane_surfaces_map.insert({++plane_sur_count, plane_sur_count});
-    // side 4;
-    curve_loops_map.insert({++cur_loop_count, {line_count-8,line_count-3,-(line_count-4),-line_count}});
-    plane_surfaces_map.insert({++plane_sur_count, plane_sur_count});
-    // enclose
-    surface_loops_map.insert({++sur_loop_count, {plane_sur_count-5,plane_sur_count-4,
-                                                 plane_sur_count-3,plane_sur_count-2,
-                                                 plane_sur_count-1, plane_sur_count}});
-    volumes_map.insert({++vol_count, sur_loop_count});
-    base_shape.insert_points_map(points_map);
-    base_shape.insert_lines_map(lines_map);
-    base_shape.insert_curve_loops_map(curve_loops_map);
-    base_shape.insert_plane_surfaces_map(plane_surfaces_map);
-    base_shape.insert_surface_loops_map(surface_loops_map);
-    base_shape.insert_volumes_map(volumes_map);
-    base_shape.disable_char_len();
-    generated_geofile = base_shape;
-    pnt_cnt = point_count;
-    ln_cnt = line_count;
-    cl_cnt = cur_loop_count;
-    ps_cnt = plane_sur_count;
-    sl_cnt = sur_loop_count;
-    vol_cnt = vol_count;
-    // std::string output_path = "data/3DGen/" +
-    // std::to_string(layer_number) + "_P_0.geo";
-    // base_shape.export_geofile(output_path); //For debugging
-    // __asm("nop");
+    }
 }
 
 void MODEL3D::three_dim_model::initialize_python_script()
 {
-    py_script.clear();
     py_script.push_back("\"\"\"Python Circuit TCAD Script Generated with Katana\"\"\"");
     py_script.push_back("# Initialization ================================================");
     py_script.push_back("import FreeCAD, Part, time");
@@ -1542,34 +1018,27 @@ void MODEL3D::three_dim_model::initialize_python_script()
     py_script.push_back("");
     py_script.push_back("# Set up functions ==============================================");
     py_script.push_back("class Ingredient:");
-    py_script.push_back("    def __init__(self, gp, ct, ps, sb, of):");
+    py_script.push_back("    def __init__(self, gp, ct, ps, sb, of, rd=0):");
     py_script.push_back("        self.gp = gp                        # Ground Plane");
     py_script.push_back("        self.ct = ct                        # Contour");
     py_script.push_back("        self.ps = ps                        # Position");
     py_script.push_back("        self.sb = sb                        # Start Base (True/False");
     py_script.push_back("        self.of = of 				         # Overlap Factor");
+    py_script.push_back("        self.rd = rd                        # Radius of a circular ground plane (0 = use gp)");
     py_script.push_back("");
-    py_script.push_back("def create_pss(f_ingr):");
-    py_script.push_back("    #convert base and contour to freecad vector");
-    py_script.push_back("    ts = time.perf_counter()");
-    py_script.push_back("    fc_gp = [FreeCAD.Vector(i) for i in f_ingr.gp]");
-    py_script.push_back("    fc_ct = [FreeCAD.Vector(i) for i in f_ingr.ct]");
-    py_script.push_back("    fc_ps = FreeCAD.Vector(f_ingr.ps)");
-    py_script.push_back("    #create the shape");
-    py_script.push_back("    wire = Part.makePolygon(fc_gp)");
-    py_script.push_back("    gwire = Part.Wire(wire)");
+    py_script.push_back("def create_profile(fc_ct, sb, of):");
+    py_script.push_back("    #profile of the etched flank, placed at the origin of the ground path");
     py_script.push_back("    last_p = len(fc_ct)-1");
-    py_script.push_back("    last_p_z = fc_ct[last_p].z");
     py_script.push_back("    spline = Part.BSplineCurve(fc_ct)");
-    py_script.push_back("    if (f_ingr.sb==True): # not inverted");
-    py_script.push_back("        if ((f_ingr.of>1)and(f_ingr.of<=2)):#has overlap scale");
-    py_script.push_back("            offset_lower_pt = FreeCAD.Vector(-fc_ct[last_p].x*f_ingr.of, fc_ct[0].y, fc_ct[0].z)");
+    py_script.push_back("    if (sb==True): # not inverted");
+    py_script.push_back("        if ((of>1)and(of<=2)):#has overlap scale");
+    py_script.push_back("            offset_lower_pt = FreeCAD.Vector(-fc_ct[last_p].x*of, fc_ct[0].y, fc_ct[0].z)");
     py_script.push_back("            offset_upper_pt = FreeCAD.Vector(offset_lower_pt.x, fc_ct[last_p].y, fc_ct[last_p].z)");
     py_script.push_back("            offset_ln = Part.LineSegment(spline.StartPoint, offset_lower_pt)");
     py_script.push_back("            vert_ln = Part.LineSegment(offset_lower_pt, offset_upper_pt)");
     py_script.push_back("            horiz_ln = Part.LineSegment(offset_upper_pt, spline.EndPoint)");
     py_script.push_back("            profile = Part.Shape([offset_ln, vert_ln, horiz_ln, spline])");
-    py_script.push_back("        elif ( f_ingr.of == 1 ):#no overlap scale");
+    py_script.push_back("        elif ( of == 1 ):#no overlap scale");
     py_script.push_back("            upper_point = FreeCAD.Vector(spline.StartPoint.x, spline.StartPoint.y, spline.EndPoint.z)");
     py_script.push_back("            vertical_ln = Part.LineSegment(spline.StartPoint, upper_point)");
     py_script.push_back("            horiz_ln = Part.LineSegment(upper_point, spline.EndPoint)");
@@ -1580,15 +1049,15 @@ void MODEL3D::three_dim_model::initialize_python_script()
     py_script.push_back("        pl = FreeCAD.Placement(FreeCAD.Vector(0,0,0), FreeCAD.Rotation(FreeCAD.Vector(0,0,1), 180))");
     py_script.push_back("        profile_wire.Placement = pl");
     py_script.push_back("    else: # inverted");
-    py_script.push_back("        if ((f_ingr.of>1)and(f_ingr.of<=2)): #has overlap scale");
+    py_script.push_back("        if ((of>1)and(of<=2)): #has overlap scale");
     py_script.push_back("            spline_end = fc_ct[last_p]");
-    py_script.push_back("            offset_point = FreeCAD.Vector( (fc_ct[last_p].x*f_ingr.of), fc_ct[last_p].y, fc_ct[last_p].z )");
+    py_script.push_back("            offset_point = FreeCAD.Vector( (fc_ct[last_p].x*of), fc_ct[last_p].y, fc_ct[last_p].z )");
     py_script.push_back("            offset_upper = Part.LineSegment(spline_end, offset_point)");
     py_script.push_back("            base_point = FreeCAD.Vector(offset_point.x,0,0)");
     py_script.push_back("            vert_ln = Part.LineSegment(offset_point, base_point)");
     py_script.push_back("            horiz_ln = Part.LineSegment(base_point, spline.StartPoint)");
     py_script.push_back("            profile = Part.Shape([spline, offset_upper, vert_ln, horiz_ln])");
-    py_script.push_back("        elif (f_ingr.of==1):#no overlap scale");
+    py_script.push_back("        elif (of==1):#no overlap scale");
     py_script.push_back("            lower_point = FreeCAD.Vector(spline.EndPoint.x, spline.EndPoint.y, 0)");
     py_script.push_back("            vert_ln = Part.LineSegment(spline.EndPoint, lower_point)");
     py_script.push_back("            horiz_ln = Part.LineSegment(lower_point, spline.StartPoint)");
@@ -1598,6 +1067,22 @@ void MODEL3D::three_dim_model::initialize_python_script()
     py_script.push_back("        profile_wire = Part.Wire(profile.Edges)");
     py_script.push_back("        pl = FreeCAD.Placement(FreeCAD.Vector(-fc_ct[last_p].x,0,0), FreeCAD.Rotation(FreeCAD.Vector(0,0,1), 0))");
     py_script.push_back("        profile_wire.Placement = pl");
+    py_script.push_back("    return profile_wire");
+    py_script.push_back("");
+    py_script.push_back("def create_pss(f_ingr):");
+    py_script.push_back("    if f_ingr.rd > 0:");
+    py_script.push_back("        return create_revolved_pss(f_ingr)");
+    py_script.push_back("    #convert base and contour to freecad vector");
+    py_script.push_back("    ts = time.perf_counter()");
+    py_script.push_back("    fc_gp = [FreeCAD.Vector(i) for i in f_ingr.gp]");
+    py_script.push_back("    fc_ct = [FreeCAD.Vector(i) for i in f_ingr.ct]");
+    py_script.push_back("    fc_ps = FreeCAD.Vector(f_ingr.ps)");
+    py_script.push_back("    #create the shape");
+    py_script.push_back("    wire = Part.makePolygon(fc_gp)");
+    py_script.push_back("    gwire = Part.Wire(wire)");
+    py_script.push_back("    last_p = len(fc_ct)-1");
+    py_script.push_back("    last_p_z = fc_ct[last_p].z");
+    py_script.push_back("    profile_wire = create_profile(fc_ct, f_ingr.sb, f_ingr.of)");
     py_script.push_back("    makeSolid=True");
     py_script.push_back("    isFrenet=True");
     py_script.push_back("    TransitionMode=2#rounded edges");
@@ -1621,18 +1106,43 @@ void MODEL3D::three_dim_model::initialize_python_script()
     py_script.push_back("        print('PSS created in '+fmt+' seconds.')");
     py_script.push_back("    return final_pss");
     py_script.push_back("");
+    // Circles are built as a solid of revolution around a cylinder instead
+    // of sweeping the profile along a polygon.
+    py_script.push_back("def create_revolved_pss(f_ingr):");
+    py_script.push_back("    ts = time.perf_counter()");
+    py_script.push_back("    fc_ct = [FreeCAD.Vector(i) for i in f_ingr.ct]");
+    py_script.push_back("    fc_ps = FreeCAD.Vector(f_ingr.ps)");
+    py_script.push_back("    last_p = len(fc_ct)-1");
+    py_script.push_back("    last_p_z = fc_ct[last_p].z");
+    py_script.push_back("    profile_wire = create_profile(fc_ct, f_ingr.sb, f_ingr.of)");
+    py_script.push_back("    profile_wire.translate(FreeCAD.Vector(-f_ingr.rd,0,0))");
+    py_script.push_back("    flank = Part.Face(profile_wire).revolve(FreeCAD.Vector(0,0,0), FreeCAD.Vector(0,0,1), 360)");
+    py_script.push_back("    core = Part.makeCylinder(f_ingr.rd, last_p_z)");
+    py_script.push_back("    final_pss = flank.fuse(core)");
+    py_script.push_back("    if final_pss.isNull()==True:");
+    py_script.push_back("        raise Exception('Revolved Spline Sweep creation failed at merge.')");
+    py_script.push_back("    final_pss = final_pss.removeSplitter()");
+    py_script.push_back("    final_pss.Placement = FreeCAD.Placement(fc_ps, FreeCAD.Rotation(FreeCAD.Vector(0,0,1), 0))");
+    py_script.push_back("    te = time.perf_counter() - ts");
+    py_script.push_back("    fmt = format(te, '.2f')");
+    py_script.push_back("    print('Revolved PSS created in '+fmt+' seconds.')");
+    py_script.push_back("    return final_pss");
+    py_script.push_back("");
     // Prism for Al layers
     py_script.push_back("def create_prism(f_ingr):");
     py_script.push_back("    ts = time.perf_counter()");
     py_script.push_back("    fc_gp = [FreeCAD.Vector(i) for i in f_ingr.gp]");
     py_script.push_back("    fc_ct = [FreeCAD.Vector(i) for i in f_ingr.ct]");
     py_script.push_back("    fc_ps = FreeCAD.Vector(f_ingr.ps)");
-    py_script.push_back("    wire = Part.makePolygon(fc_gp)");
-    py_script.push_back("    gwire = Part.Wire(wire)");
-    py_script.push_back("    face = Part.Face(gwire)");
     py_script.push_back("    last_p = len(fc_ct)-1");
     py_script.push_back("    last_p_z = fc_ct[last_p].z");
-    py_script.push_back("    prism = face.extrude(FreeCAD.Vector(0,0,last_p_z))");
+    py_script.push_back("    if f_ingr.rd > 0:");
+    py_script.push_back("        prism = Part.makeCylinder(f_ingr.rd, last_p_z)");
+    py_script.push_back("    else:");
+    py_script.push_back("        wire = Part.makePolygon(fc_gp)");
+    py_script.push_back("        gwire = Part.Wire(wire)");
+    py_script.push_back("        face = Part.Face(gwire)");
+    py_script.push_back("        prism = face.extrude(FreeCAD.Vector(0,0,last_p_z))");
     py_script.push_back("    pl = FreeCAD.Placement(fc_ps, FreeCAD.Rotation(FreeCAD.Vector(0,0,1), 0))");
     py_script.push_back("    prism.Placement = pl");
     py_script.push_back("    if prism.isNull()==True:");
@@ -1642,10 +1152,69 @@ void MODEL3D::three_dim_model::initialize_python_script()
     py_script.push_back("        fmt = format(te, '.2f')");
     py_script.push_back("        print('Prism created in '+fmt+' seconds.')");
     py_script.push_back("    return prism");
+    if(enable_multiprocessing==true)
+    {
+        // Longest-job-first scheduling
+        py_script.push_back("");
+        py_script.push_back("def scheduled_map(pool, func, ingredients, costs):");
+        py_script.push_back("    #longest processing time first: the costliest ingredients are submitted");
+        py_script.push_back("    #first so that no worker is left with one long job at the end");
+        py_script.push_back("    order = sorted(range(len(ingredients)), key=lambda i: costs[i], reverse=True)");
+        py_script.push_back("    futures = {}");
+        py_script.push_back("    for i in order:");
+        py_script.push_back("        futures[i] = pool.submit(func, ingredients[i])");
+        py_script.push_back("    return [futures[i].result() for i in range(len(ingredients))]");
+    }
+    // Boolean plan: balanced fuse reduction within overlap groups
+    py_script.push_back("");
+    py_script.push_back("def fuse_pair(pair):");
+    py_script.push_back("    return pair[0].fuse(pair[1])");
+    py_script.push_back("");
+    py_script.push_back("def tree_fuse(shapes, group_of, costs, pool=None):");
+    py_script.push_back("    #shapes whose footprints overlap share a group. Each round fuses the");
+    py_script.push_back("    #costliest item of every group with its cheapest, so the pairs of a round");
+    py_script.push_back("    #take about equally long. A fused pair costs the sum of its parts. The");
+    py_script.push_back("    #pairs of all groups go to the pool together; disjoint groups are only");
+    py_script.push_back("    #collected into a compound.");
+    py_script.push_back("    fuse_all = map if pool is None else pool.map");
+    py_script.push_back("    grouped = {}");
+    py_script.push_back("    for i in range(len(shapes)):");
+    py_script.push_back("        grouped.setdefault(group_of[i], []).append((costs[i], shapes[i]))");
+    py_script.push_back("    groups = [sorted(items, key=lambda item: item[0], reverse=True) for items in grouped.values()]");
+    py_script.push_back("    while any(len(items) > 1 for items in groups):");
+    py_script.push_back("        pairs = [(items[i][1], items[-1-i][1]) for items in groups for i in range(len(items)//2)]");
+    py_script.push_back("        merged = iter(list(fuse_all(fuse_pair, pairs)))");
+    py_script.push_back("        for g in range(len(groups)):");
+    py_script.push_back("            items = groups[g]");
+    py_script.push_back("            half = len(items)//2");
+    py_script.push_back("            fused = [(items[i][0]+items[-1-i][0], next(merged)) for i in range(half)]");
+    py_script.push_back("            if len(items)%2 == 1:");
+    py_script.push_back("                fused.append(items[half])");
+    py_script.push_back("            groups[g] = sorted(fused, key=lambda item: item[0], reverse=True)");
+    py_script.push_back("    parts = [items[0][1] for items in groups]");
+    py_script.push_back("    if len(parts) == 1:");
+    py_script.push_back("        return parts[0]");
+    py_script.push_back("    return Part.makeCompound(parts)");
+    if(!cells.empty())
+    {
+        // Link array for the placements of a leaf cell solid
+        py_script.push_back("");
+        py_script.push_back("def create_instances(cell_name, placements):");
+        py_script.push_back("    #one link array holding every placement [x, y, angle] of a cell solid");
+        py_script.push_back("    cell_obj = My_doc.getObject(cell_name)");
+        py_script.push_back("    cell_obj.Visibility = False");
+        py_script.push_back("    lnk = My_doc.addObject(\"App::Link\", cell_name+\"_instances\")");
+        py_script.push_back("    lnk.setLink(cell_obj)");
+        py_script.push_back("    lnk.ElementCount = len(placements)");
+        py_script.push_back("    lnk.PlacementList = [FreeCAD.Placement(FreeCAD.Vector(p[0], p[1], 0), FreeCAD.Rotation(FreeCAD.Vector(0,0,1), p[2])) for p in placements]");
+        py_script.push_back("    return lnk");
+    }
     py_script.push_back("# Generated cell description ====================================");
     py_script.push_back("# Line for MS Windows compatibility");
     py_script.push_back("if __name__ == '__main__':");
     py_script.push_back("    time_start = time.perf_counter()");
+    if(enable_multiprocessing==true)
+        py_script.push_back("    pool = concurrent.futures.ProcessPoolExecutor()");
 }
 
 std::string to_freecad_vec(const double &x, const double &y, const double &z)
@@ -1680,8 +1249,7 @@ const int &layer_number)
     +std::to_string(layer_number)
     +"= additive_block_"
     +std::to_string(layer_number)
-    +".cut(subtractives_"
-    +std::to_string(layer_number)+")");
+    +".cut("+union_expression("subtractive", std::to_string(layer_number))+")");
     // if additive shapes exist
     // Create the list of additive shapes
     if(secondary.size()>0)
@@ -1695,17 +1263,13 @@ const int &layer_number)
             push_freecad_pss(*secondary_it, false, layer_number, true, island_overlap_factor);
         }
         // Generate the additive shapes
-        py_script.push_back("    additives_"
-        +std::to_string(layer_number)+
-        " = list(pool.map(create_pss, additive_ingredients_"
-        +std::to_string(layer_number)+"))");
+        build_additive_shapes(layer_number, true);
         // Execute the boolean fuse
         py_script.push_back("    layer_"
         +std::to_string(layer_number)
         +"=subtractive_cut_"
         +std::to_string(layer_number)
-        +".fuse(additives_"
-        +std::to_string(layer_number)+")");
+        +".fuse("+union_expression("additive", std::to_string(layer_number))+")");
     }
     else
     {
@@ -1724,19 +1288,20 @@ const int &layer_number)
 }
 
 //Creates the layer based on the supplied primary and secondary paths and mask type
+//Paths listed as circles are built from their centre and radius instead
 void MODEL3D::three_dim_model::generate_freecad_solid(
 const ClipperLib::Paths &primary,
 const ClipperLib::Paths &secondary,
+const std::vector<circle_primitive> &primary_circles,
+const std::vector<circle_primitive> &secondary_circles,
 const bool &has_holes,
 const int &layer_number,
 const int &mask_type)
 {
   // Create the list of additive shapes
     py_script.push_back("    additive_ingredients_"+std::to_string(layer_number)+" = []");
-    auto primary_end = primary.end();
-    for (auto primary_it = primary.begin();
-         primary_it != primary_end;
-         primary_it++)
+    auto circle_it = primary_circles.begin();
+    for (size_t i = 0; i < primary.size(); i++)
     {
         bool bot_strt = false;//type 0 and 3
         double o_f = additive_overlap_factor;
@@ -1748,33 +1313,31 @@ const int &mask_type)
         // // Layer 51 and 55 have circular shapes
         if((mask_type==3)/*||(layer_number==55)*/)
             o_f = 1;
-        push_freecad_pss(*primary_it, bot_strt, layer_number, true, o_f);
+        if( (circle_it!=primary_circles.end()) && (circle_it->path_index==i) )
+            push_freecad_circle_pss(*circle_it++, bot_strt, layer_number, true, o_f);
+        else
+            push_freecad_pss(primary[i], bot_strt, layer_number, true, o_f);
     }
     // Build them in python as a list
     build_additive_shapes(layer_number, true);
     // Execute the boolean fuse
-    py_script.push_back("    additive_fuse_"    //taking first element of the list
-    +std::to_string(layer_number)
-    +"= additives_"+std::to_string(layer_number)
-    +"[0]");
     py_script.push_back("    additive_fuse_"
     +std::to_string(layer_number)
-    +" = additive_fuse_"
-    +std::to_string(layer_number)
-    +".fuse(additives_"+std::to_string(layer_number)+")");
+    +" = "+union_expression("additive", std::to_string(layer_number)));
     // Create a list of subtractive shapes if they exist
     if(secondary.size()>0)
     {
         py_script.push_back("    subtractive_ingredients_"+std::to_string(layer_number)+" = []");
-        auto secondary_end = secondary.end();
-        for (auto secondary_it = secondary.begin();
-            secondary_it != secondary_end;
-            secondary_it++)
+        circle_it = secondary_circles.begin();
+        for (size_t i = 0; i < secondary.size(); i++)
         {
             bool bot_strt = true;// swapped around from above because placing back
             if(mask_type==1)// 0 = Standard /^##^\ , 1 = Inverted \_##_/
                 bot_strt = false;
-            push_freecad_pss(*secondary_it, bot_strt, layer_number, false, subtractive_overlap_factor);
+            if( (circle_it!=secondary_circles.end()) && (circle_it->path_index==i) )
+                push_freecad_circle_pss(*circle_it++, bot_strt, layer_number, false, subtractive_overlap_factor);
+            else
+                push_freecad_pss(secondary[i], bot_strt, layer_number, false, subtractive_overlap_factor);
         }
         // Build subtractive shapes in python as a list
         build_subtractive_shapes(layer_number);
@@ -1783,9 +1346,8 @@ const int &mask_type)
         +std::to_string(layer_number)
         +"= additive_fuse_"
         +std::to_string(layer_number)
-        +".cut(subtractives_"
-        +std::to_string(layer_number)+")");
-        py_script.push_back("layer_"
+        +".cut("+union_expression("subtractive", std::to_string(layer_number))+")");
+        py_script.push_back("    layer_"
         +std::to_string(layer_number)
         +" = subtractive_cut_"
         + std::to_string(layer_number));
@@ -1810,27 +1372,31 @@ const int &mask_type)
         // Create list of all Al shapes.
         std::string sub_layer = std::to_string(layer_number)+"_Al";
         py_script.push_back("    additive_ingredients_"+sub_layer+" = []");
-        auto primary_end = primary.end();
-        for (auto primary_it = primary.begin();
-            primary_it != primary_end;
-            primary_it++)
+        double offset_value = layer_contour(layer_number)->width();
+        circle_it = primary_circles.begin();
+        for (size_t i = 0; i < primary.size(); i++)
         {
             //offset the path in question by the contour-width to make flush with counter-electrode
+            if( (circle_it!=primary_circles.end()) && (circle_it->path_index==i) )
+            {
+                push_freecad_cylinder(circle_it->centre, circle_it->radius+offset_value, true,
+                                      (process_info.at(layer_number).z_start-9), 8, sub_layer);
+                circle_it++;
+                continue;
+            }
             ClipperLib::Paths adjusted_paths;
             ClipperLib::ClipperOffset co;
             co.Clear();
-            co.AddPath(*primary_it, ClipperLib::jtSquare, ClipperLib::etClosedPolygon);
-            double offset_value = std::prev(etch_contour_map[layer_number].end(),1)->x;
+            co.AddPath(primary[i], ClipperLib::jtSquare, ClipperLib::etClosedPolygon);
             co.Execute(adjusted_paths, offset_value);
             push_freecad_prism( adjusted_paths[0],
                                 true,
-                                (proc_info_map[layer_number].z_start-9), 8, sub_layer);
+                                (process_info.at(layer_number).z_start-9), 8, sub_layer);
         }
         // Generate all Al shapes
         build_additive_sub_layer(sub_layer);
         // Merge all AL shapes into sub-layer
-        py_script.push_back("    layer_"+std::to_string(layer_number)+"_Al = "+
-        "additives_"+sub_layer+"[0].fuse(additives_"+sub_layer+")");
+        py_script.push_back("    layer_"+sub_layer+" = "+union_expression("additive", sub_layer));
         // py_script.push_back("    Part.show(Layer_"+std::to_string(layer_number)+"_Al)");
         py_script.push_back("    lyr_"
         +std::to_string(layer_number)+"_Al = My_doc.addObject(\"Part::Feature\",\"layer_"
@@ -1840,25 +1406,29 @@ const int &mask_type)
         // Create list of all AlOX shapes
         sub_layer = std::to_string(layer_number)+"_AlOx";
         py_script.push_back("    additive_ingredients_"+sub_layer+" = []");
-        for (auto primary_it = primary.begin();
-            primary_it != primary_end;
-            primary_it++)
+        circle_it = primary_circles.begin();
+        for (size_t i = 0; i < primary.size(); i++)
         {
+            if( (circle_it!=primary_circles.end()) && (circle_it->path_index==i) )
+            {
+                push_freecad_cylinder(circle_it->centre, circle_it->radius+offset_value, true,
+                                      (process_info.at(layer_number).z_start-1), 1, sub_layer);
+                circle_it++;
+                continue;
+            }
             ClipperLib::Paths adjusted_paths;
             ClipperLib::ClipperOffset co;
             co.Clear();
-            co.AddPath(*primary_it, ClipperLib::jtSquare, ClipperLib::etClosedPolygon);
-            double offset_value = std::prev(etch_contour_map[layer_number].end(),1)->x;
+            co.AddPath(primary[i], ClipperLib::jtSquare, ClipperLib::etClosedPolygon);
             co.Execute(adjusted_paths, offset_value);
             push_freecad_prism( adjusted_paths[0],
                                 true,
-                                (proc_info_map[layer_number].z_start-1), 1, sub_layer);
+                                (process_info.at(layer_number).z_start-1), 1, sub_layer);
         }
         // Generate all AlOx shapes
         build_additive_sub_layer(sub_layer);
         // Merge AlOx shapes into sub-layer
-        py_script.push_back("    layer_"+sub_layer+" = additives_"
-        +sub_layer+"[0].fuse(additives_"+sub_layer+")");
+        py_script.push_back("    layer_"+sub_layer+" = "+union_expression("additive", sub_layer));
         //py_script.push_back("    Part.show(Layer_" + sub_layer + ")");
         py_script.push_back("    lyr_"
         +sub_layer+" = My_doc.addObject(\"Part::Feature\",\"layer_"
@@ -1944,15 +1514,37 @@ const std::string &sublayer_name)
         py_script.push_back(line_stream.str());
         std::string botstart = "    True, 1)";//not used for prism function
         py_script.push_back(botstart);
-        if(is_additive==false)
-            py_script.push_back("    subtractive_ingredients_"+sublayer_name+".append(curr_ingr)");
-        else
-            py_script.push_back("    additive_ingredients_"+sublayer_name+".append(curr_ingr)");
+        std::string list_name = ((is_additive==true) ? "additive_ingredients_" : "subtractive_ingredients_") + sublayer_name;
+        py_script.push_back("    "+list_name+".append(curr_ingr)");
+        record_ingredient(list_name, gp_last, kernel_bounds(shape_outline.data(), shape_outline.size()));
     }
     else
         std::cout<<"Error: \"Polygon\" with less than 2 vertices detected."<< std::endl;
 }
 
+// Pushes back a cylinder prism (ground plane given by centre and radius)
+// to the additive or subtractive list of a sub-layer.
+void MODEL3D::three_dim_model::push_freecad_cylinder(
+const ClipperLib::IntPoint &centre,
+const double &radius,
+const bool &is_additive,
+const int &z_start,
+const int &height,
+const std::string &sublayer_name)
+{
+    py_script.push_back("    curr_ingr = Ingredient( [");
+    py_script.push_back("    ], [[0, 0, 0],[0, 0, "+std::to_string(height)+"]");
+    py_script.push_back("    ], ["+std::to_string(centre.X)+", "
+    +std::to_string(centre.Y)+", "
+    +std::to_string(z_start)+"], ");
+    py_script.push_back("    True, 1, "+std::to_string(radius)+")");
+    std::string list_name = ((is_additive==true) ? "additive_ingredients_" : "subtractive_ingredients_") + sublayer_name;
+    py_script.push_back("    "+list_name+".append(curr_ingr)");
+    ClipperLib::cInt reach = (ClipperLib::cInt)std::ceil(radius);
+    record_ingredient(list_name, CIRCLE_SEGMENT_COST,
+                      {centre.X-reach, centre.Y-reach, centre.X+reach, centre.Y+reach});
+}
+
 // Pushes back PSS to additive or subtractive list for later creation
 void MODEL3D::three_dim_model::push_freecad_pss(
 const ClipperLib::Path &shape_outline,
@@ -1972,7 +1564,7 @@ const double           &overlap_factor)
         // if(bottom_start==false)
         //     path_to_gds(present_path);
         present_path.push_back(*present_path.begin());//repeat last element to close shape
-        double zs = (double)proc_info_map[layer_number].z_start;
+        double zs = (double)process_info.at(layer_number).z_start;
         // start with the ground path
         int gp_counter = 0;//minimum polygon size is a triangle
         std::ostringstream line_stream;
@@ -2015,43 +1607,10 @@ const double           &overlap_factor)
         //do final close off of the ground path. Move onto the contour
         line_stream.str("");
         line_stream.clear();
-        auto etch_it = etch_contour_map[layer_number].begin();
-        line_stream << "    ], [" ;
-        line_stream << "[" << std::to_string(etch_it->x) << ", ";
-        line_stream << std::to_string(etch_it->y) << ", ";
-        line_stream << std::to_string(etch_it->z) << "]";
-        etch_it++;
-        auto etch_it_end = etch_contour_map[layer_number].end();
-        while (etch_it != etch_it_end)
-        {
-            line_stream << "    , [" << std::to_string(etch_it->x) << ", ";
-            line_stream << std::to_string(etch_it->y) << ", ";
-            line_stream << std::to_string(etch_it->z) << "]";
-            etch_it++;
-            if (etch_it == etch_it_end)
-            {
-                py_script.push_back(line_stream.str());
-                break;
-            }
-            line_stream << ", [" << std::to_string(etch_it->x) << ", ";
-            line_stream << std::to_string(etch_it->y) << ", ";
-            line_stream << std::to_string(etch_it->z) << "]";
-            etch_it++;
-            if (etch_it == etch_it_end)
-            {
-                py_script.push_back(line_stream.str());
-                break;
-            }
-            line_stream << ", [" << std::to_string(etch_it->x) << ", ";
-            line_stream << std::to_string(etch_it->y) << ", ";
-            line_stream << std::to_string(etch_it->z) << "]";
-            py_script.push_back(line_stream.str());
-            etch_it++;
-            line_stream.str("");
-            line_stream.clear();
-        }
-        line_stream.str("");
-        line_stream.clear();
+        const std::vector<std::string> &contour_lines = layer_contour(layer_number)->script_lines;
+        auto contour_lines_end = contour_lines.end();
+        for (auto cl_it = contour_lines.begin(); cl_it != contour_lines_end; cl_it++)
+            py_script.push_back(*cl_it);
         line_stream << "    ], [" ;// end of contour, start of offset
         line_stream << std::to_string(offset[0]) << ", ";
         line_stream << std::to_string(offset[1]) << ", ";
@@ -2060,15 +1619,48 @@ const double           &overlap_factor)
         std::string botstart = (bottom_start==true)?("    True, "):("    False, ");
         py_script.push_back(botstart);
         py_script.push_back("    "+std::to_string(overlap_factor)+")");
-        if(is_additive==false)
-            py_script.push_back("    subtractive_ingredients_"+std::to_string(layer_number)+".append(curr_ingr)");
-        else
-            py_script.push_back("    additive_ingredients_"+std::to_string(layer_number)+".append(curr_ingr)");
+        std::string list_name = ((is_additive==true) ? "additive_ingredients_" : "subtractive_ingredients_") + std::to_string(layer_number);
+        py_script.push_back("    "+list_name+".append(curr_ingr)");
+        // The sweep spreads the outline by up to the overlapped contour width
+        ClipperLib::cInt reach = (ClipperLib::cInt)std::ceil(layer_contour(layer_number)->width()*std::max(overlap_factor, 1.0))+1;
+        point_bounds bounds = kernel_bounds(shape_outline.data(), shape_outline.size());
+        record_ingredient(list_name, (double)gp_last*layer_contour(layer_number)->points.size(),
+                          {bounds.min_x-reach, bounds.min_y-reach, bounds.max_x+reach, bounds.max_y+reach});
     }
     else
         std::cout<<"Error: \"Polygon\" with less than 2 vertices detected."<< std::endl;
 }
 
+// Pushes back a circular PSS to the additive or subtractive list. Only the
+// centre and radius are written; the script revolves the contour around a
+// cylinder instead of sweeping it along the outline.
+void MODEL3D::three_dim_model::push_freecad_circle_pss(
+const circle_primitive &circle,
+const bool             &bottom_start,
+const int              &layer_number,
+const bool             &is_additive,
+const double           &overlap_factor)
+{
+    double zs = (double)process_info.at(layer_number).z_start;
+    py_script.push_back("    curr_ingr = Ingredient( [");
+    const std::vector<std::string> &contour_lines = layer_contour(layer_number)->script_lines;
+    auto contour_lines_end = contour_lines.end();
+    for (auto cl_it = contour_lines.begin(); cl_it != contour_lines_end; cl_it++)
+        py_script.push_back(*cl_it);
+    py_script.push_back("    ], ["+std::to_string(circle.centre.X)+", "
+    +std::to_string(circle.centre.Y)+", "
+    +std::to_string(zs)+"], ");
+    std::string botstart = (bottom_start==true)?("    True, "):("    False, ");
+    py_script.push_back(botstart);
+    py_script.push_back("    "+std::to_string(overlap_factor)+", "+std::to_string(circle.radius)+")");
+    std::string list_name = ((is_additive==true) ? "additive_ingredients_" : "subtractive_ingredients_") + std::to_string(layer_number);
+    py_script.push_back("    "+list_name+".append(curr_ingr)");
+    ClipperLib::cInt reach = (ClipperLib::cInt)std::ceil(circle.radius
+                             + layer_contour(layer_number)->width()*std::max(overlap_factor, 1.0))+1;
+    record_ingredient(list_name, CIRCLE_SEGMENT_COST*layer_contour(layer_number)->points.size(),
+                      {circle.centre.X-reach, circle.centre.Y-reach, circle.centre.X+reach, circle.centre.Y+reach});
+}
+
 // Puts the path in correct orientation for FreeCAD.
 // The path is made to run clockwise around the positive Z-axis.
 // The shape is also returned to the origin, and therefore must be shifted
@@ -2122,89 +1714,112 @@ void MODEL3D::three_dim_model::arrange_path(ClipperLib::Path &to_arrange, std::v
     to_arrange = arranged;
 }
 
-void MODEL3D::three_dim_model::python_script_write(std::string output_path)
+// Writes out the remainder of the streamed script and closes the file.
+int MODEL3D::three_dim_model::python_script_write(const std::string &output_path)
 {
-    std::ofstream python_file;
-    python_file.open(output_path);
-    auto pyscript_end = py_script.end();
-    for (auto pyscript_it = py_script.begin();
-         pyscript_it != py_script.end();
-         pyscript_it++)
-        python_file << *pyscript_it << "\n";
-    python_file.close();
+    if(py_script.close()==EXIT_FAILURE)
+        return EXIT_FAILURE;
     std::cout << "File successfully saved as \""+output_path+"\" " << std::endl;
+    return EXIT_SUCCESS;
 }
 
 // Places the command that tells python to  create a list of results
 void MODEL3D::three_dim_model::build_subtractive_shapes(const int &layer_number)
 {
-    py_script.push_back("    # Create all pushed shapes.");
-    py_script.push_back("    t1 = time.perf_counter()");
-    if(enable_multiprocessing==true)
-    {
-        py_script.push_back("    pool = concurrent.futures.ProcessPoolExecutor()");
-        py_script.push_back("    subtractives_"+std::to_string(layer_number)+
-        " = list(pool.map(create_pss, subtractive_ingredients_"
-        +std::to_string(layer_number)+"))");
-    }
-    else
-    {
-        py_script.push_back("    subtractives_"+std::to_string(layer_number)+
-        " = list(map(create_pss, subtractive_ingredients_"
-        +std::to_string(layer_number)+"))");
-    }
-    py_script.push_back("    t2 = time.perf_counter() - t1");
-    py_script.push_back("    fmt = format(t2, '.2f')");
-    py_script.push_back("    print('Generating subtractive shapes took '+fmt+' seconds.')");
+    push_list_build("subtractive", std::to_string(layer_number), "create_pss");
 }
 
 // Places the command that tells python to  create a map of additive results
 // Shapes created are Prismatic Spline Sweeps
 void MODEL3D::three_dim_model::build_additive_shapes(const int &layer_number, const bool &is_pss)
 {
-    py_script.push_back("    # Create all pushed shapes.");
-    py_script.push_back("    t1 = time.perf_counter()");
     std::string shape_type = (is_pss==true)?("create_pss"):("create_prism");
-    if(enable_multiprocessing==true)
-    {
-        py_script.push_back("    pool = concurrent.futures.ProcessPoolExecutor()");
-        py_script.push_back("    additives_"+std::to_string(layer_number)+
-        " = list(pool.map("+shape_type+", additive_ingredients_"
-        +std::to_string(layer_number)+"))");
-    }
-    else
-    {
-        py_script.push_back("    additives_"+std::to_string(layer_number)+
-        " = list(map("+shape_type+", additive_ingredients_"
-        +std::to_string(layer_number)+"))");
-    }
-    py_script.push_back("    t2 = time.perf_counter() - t1");
-    py_script.push_back("    fmt = format(t2, '.2f')");
-    py_script.push_back("    print('Generating additive shapes took '+fmt+' seconds.')");
+    push_list_build("additive", std::to_string(layer_number), shape_type);
 }
 
 // Places the command that tells python to  create a map of additive sub_layer
 // Shapes created are prisms
 void MODEL3D::three_dim_model::build_additive_sub_layer(const std::string &sub_layer_name)
 {
+    push_list_build("additive", sub_layer_name, "create_prism");
+}
+
+// Builds the shapes of the list <kind>_ingredients_<suffix> into
+// <kind>s_<suffix>. The estimated cost of every ingredient is written out as
+// <kind>_costs_<suffix> and the index of its overlap group, the ingredients
+// whose footprints are connected by overlaps, as <kind>_groups_<suffix>.
+// With multiprocessing the shapes are scheduled longest job first.
+void MODEL3D::three_dim_model::push_list_build(
+const std::string &kind,
+const std::string &suffix,
+const std::string &shape_function)
+{
+    std::string list_name = kind+"_ingredients_"+suffix;
+    std::vector<ingredient_estimate> &estimates = ingredient_estimates[list_name];
+    std::vector<point_bounds> footprints;
+    for (auto estimate_it = estimates.begin(); estimate_it != estimates.end(); estimate_it++)
+        footprints.push_back(estimate_it->bounds);
+    std::vector<long long> costs;
+    std::vector<long long> group_of(estimates.size());
+    for (size_t i = 0; i < estimates.size(); i++)
+        costs.push_back((long long)std::ceil(estimates[i].cost));
+    std::vector<std::vector<size_t>> groups = overlap_groups(footprints);
+    for (size_t g = 0; g < groups.size(); g++)
+    {
+        for (auto member_it = groups[g].begin(); member_it != groups[g].end(); member_it++)
+            group_of[*member_it] = (long long)g;
+    }
+    ingredient_estimates.erase(list_name);
+    push_number_list(kind+"_costs_"+suffix, costs);
+    push_number_list(kind+"_groups_"+suffix, group_of);
     py_script.push_back("    # Create all pushed shapes.");
     py_script.push_back("    t1 = time.perf_counter()");
     if(enable_multiprocessing==true)
-    {
-        py_script.push_back("    pool = concurrent.futures.ProcessPoolExecutor()");
-        py_script.push_back("    additives_"+sub_layer_name+
-        " = list(pool.map(create_prism, additive_ingredients_"
-        +sub_layer_name+"))");
-    }
+        py_script.push_back("    "+kind+"s_"+suffix+" = scheduled_map(pool, "+shape_function+", "
+        +list_name+", "+kind+"_costs_"+suffix+")");
     else
-    {
-        py_script.push_back("    additives_"+sub_layer_name+
-        " = list(map(create_prism, additive_ingredients_"
-        +sub_layer_name+"))");
-    }
+        py_script.push_back("    "+kind+"s_"+suffix+" = list(map("+shape_function+", "
+        +list_name+"))");
     py_script.push_back("    t2 = time.perf_counter() - t1");
     py_script.push_back("    fmt = format(t2, '.2f')");
-    py_script.push_back("    print('Generating additive shapes took '+fmt+' seconds.')");
+    py_script.push_back("    print('Generating "+kind+" shapes took '+fmt+' seconds.')");
+}
+
+// Writes a python list of integers, 16 to a line.
+void MODEL3D::three_dim_model::push_number_list(const std::string &name, const std::vector<long long> &values)
+{
+    py_script.push_back("    "+name+" = [");
+    std::string line = "   ";
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        line += " " + std::to_string(values[i]);
+        if(i+1 < values.size())
+            line += ",";
+        if( ((i+1)%16==0) || (i+1==values.size()) )
+        {
+            py_script.push_back(line);
+            line = "   ";
+        }
+    }
+    py_script.push_back("    ]");
+}
+
+// Python expression for the union of the shapes built by push_list_build.
+// Overlapping shapes are fused in a balanced tree per group, on the pool
+// when multiprocessing, and the disjoint groups are joined as a compound.
+std::string MODEL3D::three_dim_model::union_expression(const std::string &kind, const std::string &suffix) const
+{
+    std::string pool_name = (enable_multiprocessing==true) ? "pool" : "None";
+    return "tree_fuse("+kind+"s_"+suffix+", "+kind+"_groups_"+suffix+", "
+    +kind+"_costs_"+suffix+", "+pool_name+")";
+}
+
+// Cost and footprint of an ingredient. Sweeps scale with the outline
+// vertices times the contour samples, revolutions and prisms with one of
+// the two.
+void MODEL3D::three_dim_model::record_ingredient(const std::string &list_name, const double &cost, const point_bounds &bounds)
+{
+    ingredient_estimates[list_name].push_back({cost, bounds});
 }
 
 void MODEL3D::three_dim_model::python_script_conclude()
@@ -2213,10 +1828,12 @@ void MODEL3D::three_dim_model::python_script_conclude()
     py_script.push_back("    time_end = time.perf_counter() - time_start");
     py_script.push_back("    fmt = format(time_end, '.2f')");
     py_script.push_back("    print(f'Layer generation took '+fmt+' seconds.')");
+    if(enable_multiprocessing==true)
+        py_script.push_back("    pool.shutdown()");
     py_script.push_back("    My_doc.saveAs(u\""+cell_name+".FCStd\")");
 }
 
-void MODEL3D::three_dim_model::tidy_paths(ClipperLib::Paths &input_paths)
+void MODEL3D::three_dim_model::tidy_paths(ClipperLib::Paths &input_paths) const
 {
     auto paths_end = input_paths.end();
     for(auto paths_it = input_paths.begin(); paths_it != paths_end; paths_it++)
@@ -2226,54 +1843,42 @@ void MODEL3D::three_dim_model::tidy_paths(ClipperLib::Paths &input_paths)
 }
 
 //Removes points from path if they lie within 1% of the perimeter's distance between each other
-void MODEL3D::three_dim_model::tidy_path(ClipperLib::Path &input_path)
+void MODEL3D::three_dim_model::tidy_path(ClipperLib::Path &input_path) const
 {
-    //determine perimeter of path
+    if(input_path.empty())
+        return;
+    //determine perimeter of path, ending with last to first
     double path_perimeter = 0;
-    auto perim_start = std::next(input_path.begin(),1);
-    auto path_end = input_path.end();
-    for (auto path_it = perim_start; path_it != path_end; path_it++)
-    {
-        ClipperLib::IntPoint prev_pt = *std::prev(path_it);
-        ClipperLib::IntPoint curr_pt = *path_it;
-        double delta_x_sqr = std::pow((curr_pt.X - prev_pt.X), 2);
-        double delta_y_sqr = std::pow((curr_pt.Y - prev_pt.Y), 2);
-        double dist = std::sqrt(delta_x_sqr+delta_y_sqr);
-        path_perimeter = path_perimeter + dist;
-    }
-    // last to first
-    double delta_x_sqr = std::pow((std::prev(input_path.end(),1)->X - input_path.begin()->X), 2);
-    double delta_y_sqr = std::pow((std::prev(input_path.end(),1)->Y - input_path.begin()->Y), 2);
-    double dist = std::sqrt(delta_x_sqr+delta_y_sqr);
-    path_perimeter = path_perimeter + dist;
+    size_t path_size = input_path.size();
+    for (size_t i = 1; i <= path_size; i++)
+    {
+        const ClipperLib::IntPoint &prev_pt = input_path[i-1];
+        const ClipperLib::IntPoint &curr_pt = input_path[i%path_size];
+        double delta_x = (double)(curr_pt.X - prev_pt.X);
+        double delta_y = (double)(curr_pt.Y - prev_pt.Y);
+        path_perimeter = path_perimeter + std::sqrt(delta_x*delta_x + delta_y*delta_y);
+    }
     double tolerance = std::ceil(0.01*PI*path_perimeter);//1% of perimeter tolerance
     if(tolerance>min_distance_between_points)
         tolerance = min_distance_between_points;
     //remove bunched points
-    for (auto path_it = perim_start; path_it != path_end; path_it++)
-    {
-        ClipperLib::IntPoint prev_pt = *std::prev(path_it);
-        ClipperLib::IntPoint curr_pt = *path_it;
-        double delta_x_sqr = std::pow((curr_pt.X - prev_pt.X), 2);
-        double delta_y_sqr = std::pow((curr_pt.Y - prev_pt.Y), 2);
-        double dist = std::sqrt(delta_x_sqr+delta_y_sqr);
-        if(dist<tolerance)
-        {
-            //delete value, then move one back because loop steps you forward again
-            path_it = std::prev(input_path.erase(path_it),1);
-            path_end = input_path.end();
-        }
-    }
+    decimate_path(input_path, tolerance, decimation);
 }
 
-void MODEL3D::three_dim_model::repair_circles(ClipperLib::Paths &target_paths)
+// Replaces paths that approximate circles with clean circles and records
+// the centre and radius of each, in path order.
+void MODEL3D::three_dim_model::repair_circles(ClipperLib::Paths &target_paths, std::vector<circle_primitive> &circles) const
 {
-    auto paths_end = target_paths.end();
-    for (auto path_it = target_paths.begin(); path_it!= paths_end; path_it++)
+    for (size_t i = 0; i < target_paths.size(); i++)
     {
-        if(circle_test(*path_it, 0.1)==true)
+        if(circle_test(target_paths[i], 0.1)==true)
         {
-            reconstruct_circle(*path_it);
+            circle_primitive circle;
+            circle.path_index = i;
+            circle.centre = calculate_centroid(target_paths[i]);
+            circle.radius = std::sqrt(std::abs(ClipperLib::Area(target_paths[i]))/PI);
+            circles.push_back(circle);
+            reconstruct_circle(target_paths[i]);
         }
     }
 }
@@ -2281,30 +1886,23 @@ void MODEL3D::three_dim_model::repair_circles(ClipperLib::Paths &target_paths)
 // Calculate average distance to centroid.
 // if shape falls outside <tolerance> of average distance return false
 // return true if all shapes pass the test.
-bool MODEL3D::three_dim_model::circle_test(ClipperLib::Path &target_path, const double &tolerance)
+bool MODEL3D::three_dim_model::circle_test(ClipperLib::Path &target_path, const double &tolerance) const
 {
-    ClipperLib::IntPoint centroid = calculate_centroid(target_path);
-    auto tp_end = target_path.end();
-    double sigma_distance = 0;
-    double avg_distance = 0;
-    double lower_bound = 0;
-    double upper_bound = 0;
-    for (auto tp_it = target_path.begin(); tp_it != tp_end; tp_it++)
-    {
-        sigma_distance = sigma_distance + calculate_distance(centroid, *tp_it);
-    }
-    avg_distance = sigma_distance/target_path.size();
-    lower_bound = avg_distance*(1-tolerance);
-    upper_bound = avg_distance*(1+tolerance);
-    for (auto tp_it = target_path.begin(); tp_it != tp_end; tp_it++)
-    {
-        double current_distance = calculate_distance(centroid, *tp_it);
-        if ( (current_distance < lower_bound) || (current_distance > upper_bound) )
-            return false;
-    }
+    if(target_path.size()<3)
+        return false;
+    polygon_moments moments = kernel_moments(target_path.data(), target_path.size());
+    if(moments.signed_area==0)
+        return false;
+    radial_spread spread = kernel_radial_spread(target_path.data(), target_path.size(),
+                                                std::round(moments.centroid_x),
+                                                std::round(moments.centroid_y));
+    double lower_bound = spread.mean*(1-tolerance);
+    double upper_bound = spread.mean*(1+tolerance);
+    if ( (spread.min < lower_bound) || (spread.max > upper_bound) )
+        return false;
     //passed tolerance check, now checking area
-    double polygon_area = ClipperLib::Area(target_path);
-    int circle_area = (int)(std::round( PI * std::pow(avg_distance,2) ) ); //Average distance is radius.
+    double polygon_area = moments.signed_area;
+    int circle_area = (int)(std::round( PI * spread.mean * spread.mean ) ); //Average distance is radius.
     lower_bound = circle_area*(1-tolerance);
     upper_bound = circle_area*(1+tolerance);
     if ( (polygon_area < lower_bound) || (polygon_area > upper_bound) )
@@ -2314,80 +1912,32 @@ bool MODEL3D::three_dim_model::circle_test(ClipperLib::Path &target_path, const
 
 void MODEL3D::three_dim_model::calc_bounding_box(const ClipperLib::Path &target_path, ClipperLib::Path &bounding_box)
 {
-    auto path_end = target_path.end();
-    ClipperLib::IntPoint bl = *target_path.begin();
-    ClipperLib::IntPoint tr = *target_path.begin();
-    for (auto path_it = target_path.begin(); path_it != path_end; path_it++)
-    {
-        if ( path_it->X < bl.X)
-            bl.X = path_it->X;
-        if ( path_it->Y < bl.Y)
-            bl.Y = path_it->Y;
-        if ( path_it->X > tr.X)
-            tr.X = path_it->X;
-        if ( path_it->Y > tr.Y)
-            tr.Y = path_it->Y;
-    }
     bounding_box.clear();
-    bounding_box.insert(bounding_box.end(), {bl,tr});
+    if(target_path.empty())
+        return;
+    point_bounds bounds = kernel_bounds(target_path.data(), target_path.size());
+    bounding_box.push_back(ClipperLib::IntPoint(bounds.min_x, bounds.min_y));
+    bounding_box.push_back(ClipperLib::IntPoint(bounds.max_x, bounds.max_y));
 }
 
-ClipperLib::IntPoint MODEL3D::three_dim_model::calculate_centroid(const ClipperLib::Path &target_polygon)
+ClipperLib::IntPoint MODEL3D::three_dim_model::calculate_centroid(const ClipperLib::Path &target_polygon) const
 {
-    int vertex_count = target_polygon.size();
-    double centroid[] = {0, 0};
     ClipperLib::IntPoint result;
-    double signed_area = 0.0;
-    double x_0 = 0.0; // Current vertex X
-    double y_0 = 0.0; // Current vertex Y
-    double x_1 = 0.0; // Next vertex X
-    double y_1 = 0.0; // Next vertex Y
-    double a = 0.0;  // Partial signed area
-
-    // For all vertices except last
-    int i=0;
-    for (i=0; i<vertex_count-1; ++i)
-    {
-        x_0 = target_polygon[i].X;
-        y_0 = target_polygon[i].Y;
-        x_1 = target_polygon[i+1].X;
-        y_1 = target_polygon[i+1].Y;
-        a = x_0*y_1 - x_1*y_0;
-        signed_area += a;
-        centroid[0] += (x_0 + x_1)*a;
-        centroid[1] += (y_0 + y_1)*a;
-    }
-    x_0 = target_polygon[i].X;
-    y_0 = target_polygon[i].Y;
-    x_1 = target_polygon[0].X;
-    y_1 = target_polygon[0].Y;
-    a = x_0*y_1 - x_1*y_0;
-    signed_area += a;
-    centroid[0] += (x_0 + x_1)*a;
-    centroid[1] += (y_0 + y_1)*a;
-    signed_area *= 0.5;
-    centroid[0] /= (6.0*signed_area);
-    centroid[1] /= (6.0*signed_area);
-    result.X = std::round(centroid[0]);
-    result.Y = std::round(centroid[1]);
+    if(target_polygon.empty())
+        return result;
+    polygon_moments moments = kernel_moments(target_polygon.data(), target_polygon.size());
+    result.X = std::round(moments.centroid_x);
+    result.Y = std::round(moments.centroid_y);
     return result;
 }
 
-double MODEL3D::three_dim_model::calculate_distance
-(const ClipperLib::IntPoint &a, const ClipperLib::IntPoint &b)
-{
-    double del_xp2 = std::pow(b.X-a.X,2);
-    double del_yp2 = std::pow(b.Y-a.Y,2);
-    double dist = std::round(sqrt(del_xp2+del_yp2));
-    return dist;
-}
-
 // Once a shape has been identified as a circle, replaces it with a clean
-// circle. Uses 32 points.
-void MODEL3D::three_dim_model::reconstruct_circle(ClipperLib::Path &circle)
+// circle. Uses 32 points and keeps the winding of the original path.
+void MODEL3D::three_dim_model::reconstruct_circle(ClipperLib::Path &circle) const
 {
+    bool counter_clockwise = ClipperLib::Orientation(circle);
     ClipperLib::IntPoint midpoint = calculate_centroid(circle);
-    double area = ClipperLib::Area(circle);
+    double area = std::abs(ClipperLib::Area(circle));
     double radius = std::sqrt(area/PI);
     double theta = -11.25; //360 degrees / 32 (sign for clockwise)
     ClipperLib::IntPoint start_point;
@@ -2401,11 +1951,13 @@ void MODEL3D::three_dim_model::reconstruct_circle(ClipperLib::Path &circle)
         ClipperLib::IntPoint current_point =  rotate_IntPoint(midpoint, start_point, angle);
         circle.push_back(current_point);
     }
+    if(counter_clockwise==true)
+        ClipperLib::ReversePath(circle);
 }
 
 ClipperLib::IntPoint MODEL3D::three_dim_model::rotate_IntPoint
 (const ClipperLib::IntPoint &origin, const ClipperLib::IntPoint &subject,
- const double &theta )
+ const double &theta ) const
 {
     ClipperLib::IntPoint p = subject;
     double t = theta * PI / 180; // convert angle to radians
@@ -2424,4 +1976,366 @@ ClipperLib::IntPoint MODEL3D::three_dim_model::rotate_IntPoint
     p.X = (xnew + origin.X);
     p.Y = (ynew + origin.Y);
     return p;
-}
\ No newline at end of file
+}
+// Meshes every layer directly and writes one file per layer, bypassing FreeCAD.
+// Layers are independent, so each is prepared, meshed and written on its own thread.
+int MODEL3D::three_dim_model::generate_mesh_layers(const std::string &output_path)
+{
+    std::string output_stem = strip_extension(output_path);
+    std::vector<std::future<int>> layer_jobs;
+    auto layer_end = polygons_map.end();
+    for (auto layer = polygons_map.begin(); layer != layer_end; layer++)
+    {
+        if(process_info.contains(layer->first))
+            layer_jobs.push_back(std::async(std::launch::async,
+                                            &three_dim_model::generate_mesh_layer,
+                                            this, layer->first, output_stem));
+    }
+    int status = EXIT_SUCCESS;
+    size_t total_layers = layer_jobs.size();
+    for (size_t i = 0; i < total_layers; i++)
+    {
+        std::cout << "Generating Layer " << i+1 << "/" << total_layers << "\t---> ";
+        if(layer_jobs[i].get()==EXIT_SUCCESS)
+            std::cout << "Done." << std::endl;
+        else
+        {
+            std::cout << "Failed." << std::endl;
+            status = EXIT_FAILURE;
+        }
+    }
+    return status;
+}
+
+// Builds the watertight surface of a single layer and writes it to
+// <output_stem>_layer_<number>.stl/.obj. Junction layers also write their
+// Al and AlOx sub-layers.
+int MODEL3D::three_dim_model::generate_mesh_layer(const int &layer_number, const std::string &output_stem) const
+{
+    // With incremental generation a layer's files are copied from the cache
+    // when its inputs are unchanged. The part list records which files exist.
+    std::string layer_hash, part_list;
+    if(fragment_cache.is_enabled()==true)
+    {
+        layer_hash = hash_layer(layer_number);
+        if(fragment_cache.fetch(layer_number, layer_hash+".parts", part_list)==true)
+        {
+            bool all_found = true;
+            std::istringstream part_stream(part_list);
+            std::string part_name;
+            while( (all_found==true) && std::getline(part_stream, part_name) )
+                all_found = fragment_cache.fetch_file(layer_number, layer_hash+"_"+part_name+mesh_extension(),
+                                                      output_stem+"_"+part_name+mesh_extension());
+            if(all_found==true)
+                return EXIT_SUCCESS;
+            part_list.clear();
+        }
+    }
+    std::vector<layer_part> parts;
+    if(collect_layer_parts(layer_number, parts)==EXIT_FAILURE)
+        return EXIT_FAILURE;
+    // Every solid is attempted so that all failures of the layer are reported.
+    bool meshed = true;
+    auto parts_end = parts.end();
+    for (auto part_it = parts.begin(); part_it != parts_end; part_it++)
+    {
+        triangle_mesh part_mesh;
+        for (size_t i = 0; i < part_it->solids.size(); i++)
+        {
+            if(part_mesh.add_solid(part_it->solids[i])==EXIT_FAILURE)
+            {
+                std::cout << "Error: Solid " << i+1 << " of " << part_it->name
+                          << " (layer " << layer_number << ") was not meshed." << std::endl;
+                meshed = false;
+            }
+        }
+        if(meshed==false)
+            continue;
+        if(write_mesh(part_mesh, output_stem+"_"+part_it->name, part_it->name)==EXIT_FAILURE)
+            return EXIT_FAILURE;
+        if( (fragment_cache.is_enabled()==true) && (part_mesh.empty()==false) )
+        {
+            fragment_cache.store_file(layer_number, layer_hash+"_"+part_it->name+mesh_extension(),
+                                      output_stem+"_"+part_it->name+mesh_extension());
+            part_list += part_it->name + "\n";
+        }
+    }
+    if(meshed==false)
+        return EXIT_FAILURE;
+    if(fragment_cache.is_enabled()==true)
+    {
+        fragment_cache.store(layer_number, layer_hash+".parts", part_list);
+        fragment_cache.prune(layer_number, layer_hash);
+    }
+    return EXIT_SUCCESS;
+}
+
+// Builds every layer into its own .geo model on a separate thread, then
+// concatenates the models in layer order and writes <output_stem>.geo.
+int MODEL3D::three_dim_model::generate_geo_model(const std::string &output_path)
+{
+    std::vector<int> layer_numbers;
+    auto layer_end = polygons_map.end();
+    for (auto layer = polygons_map.begin(); layer != layer_end; layer++)
+    {
+        if(process_info.contains(layer->first))
+            layer_numbers.push_back(layer->first);
+    }
+    std::vector<GEO::geo_builder> layer_models(layer_numbers.size());
+    std::vector<std::future<int>> layer_jobs;
+    for (size_t i = 0; i < layer_numbers.size(); i++)
+        layer_jobs.push_back(std::async(std::launch::async,
+                                        &three_dim_model::generate_geo_layer,
+                                        this, layer_numbers[i], std::ref(layer_models[i])));
+    int status = EXIT_SUCCESS;
+    GEO::geo_builder model;
+    size_t total_layers = layer_jobs.size();
+    for (size_t i = 0; i < total_layers; i++)
+    {
+        std::cout << "Generating Layer " << i+1 << "/" << total_layers << "\t---> ";
+        if(layer_jobs[i].get()==EXIT_SUCCESS)
+        {
+            model.append(layer_models[i]);
+            std::cout << "Done." << std::endl;
+        }
+        else
+        {
+            std::cout << "Failed." << std::endl;
+            status = EXIT_FAILURE;
+        }
+    }
+    if(status==EXIT_FAILURE)
+        return EXIT_FAILURE;
+    std::string geo_path = strip_extension(output_path) + ".geo";
+    if(model.export_geofile(geo_path)==EXIT_FAILURE)
+        return EXIT_FAILURE;
+    std::cout << "Gmsh model saved as \"" << geo_path << "\"" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+// Adds the polyhedra of one layer to a .geo model, with a physical volume
+// for the layer and for each junction sub-layer.
+int MODEL3D::three_dim_model::generate_geo_layer(const int &layer_number, GEO::geo_builder &geometry) const
+{
+    std::vector<layer_part> parts;
+    if(collect_layer_parts(layer_number, parts)==EXIT_FAILURE)
+        return EXIT_FAILURE;
+    // Every solid is attempted so that all failures of the layer are reported.
+    bool built = true;
+    auto parts_end = parts.end();
+    for (auto part_it = parts.begin(); part_it != parts_end; part_it++)
+    {
+        std::vector<int> part_volumes;
+        for (size_t i = 0; i < part_it->solids.size(); i++)
+        {
+            int volume_id;
+            if(build_polyhedron(part_it->solids[i], geometry, volume_id)==EXIT_SUCCESS)
+                part_volumes.push_back(volume_id);
+            else
+            {
+                std::cout << "Error: Solid " << i+1 << " of " << part_it->name
+                          << " (layer " << layer_number << ") was not built." << std::endl;
+                built = false;
+            }
+        }
+        geometry.add_physical_volume(part_it->name, part_volumes);
+    }
+    return (built==true) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Converts one layer into solids. The first part is the layer itself,
+// junction layers add Al and AlOx prisms flush with the counter-electrode.
+int MODEL3D::three_dim_model::collect_layer_parts(const int &layer_number, std::vector<layer_part> &parts) const
+{
+    const Layer_prop &layer_prop = process_info.at(layer_number);
+    const etch_contour *contour = layer_contour(layer_number);
+    if( (contour==nullptr) || (contour->points.empty()) )
+    {
+        std::cout << "Error. Contour for layer " << layer_number << " not found." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::string layer_name = "layer_" + std::to_string(layer_number);
+    std::vector<mesh_solid> solids;
+    ClipperLib::Paths primary_paths, secondary_paths;
+    if( (layer_prop.mask_type==0) || (layer_prop.mask_type==1) || (layer_prop.mask_type==3) )
+    {
+        bool has_holes = false;
+        std::vector<circle_primitive> primary_circles, secondary_circles; // Meshed as their polygons
+        prepare_non_fill_paths(layer_number, primary_paths, secondary_paths, primary_circles, secondary_circles, has_holes);
+        // 0 = Standard /^##^\ , 1 = Inverted \_##_/
+        bool bot_strt = (layer_prop.mask_type==1);
+        std::vector<profile_level> outer_levels, hole_levels;
+        build_mesh_levels(layer_number, bot_strt, true, outer_levels);
+        build_mesh_levels(layer_number, !bot_strt, false, hole_levels);
+        ClipperLib::Paths rings = primary_paths;
+        rings.insert(rings.end(), secondary_paths.begin(), secondary_paths.end());
+        group_mesh_solids(rings, outer_levels, hole_levels, solids);
+    }
+    else if(layer_prop.mask_type==2)
+    {
+        // The fill block is expanded past the layer bounds exactly as for FreeCAD
+        const std::vector<int> &bounds = layer_boundary_map.at(layer_number);
+        double b_e_factor = (use_window==true) ? 0 : contour->width()*block_expansion_factor;
+        ClipperLib::cInt x_low = std::ceil(bounds[0] - b_e_factor);
+        ClipperLib::cInt y_low = std::ceil(bounds[1] - b_e_factor);
+        ClipperLib::cInt x_high = x_low + std::ceil((bounds[2] - bounds[0]) + 2*b_e_factor);
+        ClipperLib::cInt y_high = y_low + std::ceil((bounds[3] - bounds[1]) + 2*b_e_factor);
+        ClipperLib::Path block = { ClipperLib::IntPoint(x_low, y_low),
+                                   ClipperLib::IntPoint(x_low, y_high),
+                                   ClipperLib::IntPoint(x_high, y_high),
+                                   ClipperLib::IntPoint(x_high, y_low) };
+        prepare_filled_paths(layer_number, block, primary_paths, secondary_paths);
+        std::vector<profile_level> outer_levels, hole_levels;
+        build_mesh_levels(layer_number, false, true, outer_levels);
+        build_mesh_levels(layer_number, true, false, hole_levels);
+        ClipperLib::Paths rings = primary_paths;
+        rings.insert(rings.end(), secondary_paths.begin(), secondary_paths.end());
+        group_mesh_solids(rings, outer_levels, hole_levels, solids);
+        // The block itself keeps vertical walls
+        double largest_area = 0;
+        auto largest = solids.end();
+        for (auto solid_it = solids.begin(); solid_it != solids.end(); solid_it++)
+        {
+            double area = std::abs(ClipperLib::Area(solid_it->outer.outline));
+            if(area > largest_area)
+            {
+                largest_area = area;
+                largest = solid_it;
+            }
+        }
+        if(largest != solids.end())
+        {
+            auto level_end = largest->outer.levels.end();
+            for (auto level_it = largest->outer.levels.begin(); level_it != level_end; level_it++)
+                level_it->offset = 0;
+        }
+    }
+    else
+        return EXIT_SUCCESS;// auxiliary layers are not modelled
+    parts.push_back({layer_name, solids});
+    // Junction layers carry Al and AlOx prisms flush with the counter-electrode
+    if(layer_prop.mask_type==3)
+    {
+        const std::vector<std::string> sub_layers = {"_Al", "_AlOx"};
+        const std::vector<int> sub_z_start = {layer_prop.z_start-9, layer_prop.z_start-1};
+        const std::vector<int> sub_height = {8, 1};
+        for (size_t s = 0; s < sub_layers.size(); s++)
+        {
+            layer_part sub_part;
+            sub_part.name = layer_name + sub_layers[s];
+            auto primary_end = primary_paths.end();
+            for (auto primary_it = primary_paths.begin(); primary_it != primary_end; primary_it++)
+            {
+                ClipperLib::Paths adjusted_paths;
+                ClipperLib::ClipperOffset co;
+                co.AddPath(*primary_it, ClipperLib::jtSquare, ClipperLib::etClosedPolygon);
+                co.Execute(adjusted_paths, contour->width());
+                if(adjusted_paths.empty())
+                    continue;
+                mesh_solid prism;
+                prism.outer.outline = adjusted_paths[0];
+                prism.outer.levels = { {(double)sub_z_start[s], 0},
+                                       {(double)(sub_z_start[s]+sub_height[s]), 0} };
+                sub_part.solids.push_back(prism);
+            }
+            parts.push_back(sub_part);
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+// Converts the etch contour of a layer into extrusion levels.
+// Mirrors create_pss: a bottom-start shape has its outline at the base and
+// widens along the contour, otherwise the outline is at the top and the
+// shape widens towards the base. Subtractive shapes shrink the material.
+void MODEL3D::three_dim_model::build_mesh_levels(
+const int &layer_number,
+const bool &bottom_start,
+const bool &is_additive,
+std::vector<profile_level> &levels) const
+{
+    const etch_contour &contour = *layer_contour(layer_number);
+    double z_start = process_info.at(layer_number).z_start;
+    double contour_width = contour.width();
+    double direction = (is_additive==true) ? 1 : -1;
+    levels.clear();
+    auto contour_end = contour.points.end();
+    for (auto cont_it = contour.points.begin(); cont_it != contour_end; cont_it++)
+    {
+        double spread = (bottom_start==true) ? cont_it->x : (contour_width - cont_it->x);
+        levels.push_back({z_start + cont_it->z, direction*spread});
+    }
+}
+
+// Counter-clockwise rings carry material; every clockwise ring becomes a hole
+// in the smallest solid that contains it.
+void MODEL3D::three_dim_model::group_mesh_solids(
+const ClipperLib::Paths &rings,
+const std::vector<profile_level> &outer_levels,
+const std::vector<profile_level> &hole_levels,
+std::vector<mesh_solid> &solids) const
+{
+    ClipperLib::Paths holes;
+    auto rings_end = rings.end();
+    for (auto ring_it = rings.begin(); ring_it != rings_end; ring_it++)
+    {
+        if(ring_it->size()<3)
+            continue;
+        if(ClipperLib::Orientation(*ring_it)==true)
+        {
+            mesh_solid solid;
+            solid.outer.outline = *ring_it;
+            solid.outer.levels = outer_levels;
+            solids.push_back(solid);
+        }
+        else
+            holes.push_back(*ring_it);
+    }
+    auto holes_end = holes.end();
+    for (auto hole_it = holes.begin(); hole_it != holes_end; hole_it++)
+    {
+        int owner = -1;
+        double owner_area = 0;
+        for (size_t i = 0; i < solids.size(); i++)
+        {
+            if(ClipperLib::PointInPolygon(hole_it->front(), solids[i].outer.outline)==0)
+                continue;
+            double area = ClipperLib::Area(solids[i].outer.outline);
+            if( (owner<0) || (area<owner_area) )
+            {
+                owner = i;
+                owner_area = area;
+            }
+        }
+        if(owner>=0)
+            solids[owner].holes.push_back({*hole_it, hole_levels});
+    }
+}
+
+// Removes the file extension (if any) from the last component of a path.
+std::string MODEL3D::three_dim_model::strip_extension(const std::string &path) const
+{
+    std::string stem = path;
+    size_t dot_pos = stem.find_last_of('.');
+    size_t slash_pos = stem.find_last_of("/\\");
+    if( (dot_pos!=std::string::npos) && ((slash_pos==std::string::npos)||(dot_pos>slash_pos)) )
+        stem.erase(dot_pos);
+    return stem;
+}
+
+int MODEL3D::three_dim_model::write_mesh(
+const triangle_mesh &mesh,
+const std::string &output_stem,
+const std::string &object_name) const
+{
+    if(mesh.empty())
+        return EXIT_SUCCESS;
+    if(output_format==eOBJ_mesh)
+        return mesh.write_obj(output_stem+mesh_extension(), object_name);
+    return mesh.write_stl(output_stem+mesh_extension());
+}
+
+std::string MODEL3D::three_dim_model::mesh_extension() const
+{
+    return (output_format==eOBJ_mesh) ? ".obj" : ".stl";
+}
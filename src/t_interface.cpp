@@ -5,11 +5,16 @@
  * license:     MIT
  * Description: Function definitions for user interface of Katana terminal edition
  */
+#include <cmath>
 #include <iostream>
 #include <ctime>
+#include <future>
 #include "drawing.hpp"
 #include "gdsCpp.hpp"
 #include "geofile_operations.hpp"
+#include "geofile_stacking.hpp"
+#include "geofile_tokenizer.hpp"
+#include "geofile_transform.hpp"
 #include "flooxs_gen.hpp"
 #include "ldf_process.hpp"
 #include "stitching.hpp"
@@ -24,6 +29,7 @@ namespace ARG_MODE
     enum string_code {
         eDefault,
         e3DModel,
+        eBenchmark,
         eHelp,
         eMeshops,
         eModeling,
@@ -33,6 +39,7 @@ namespace ARG_MODE
     string_code hashit (std::string const& inString) {
         if ((inString == "-3DModel")||(inString == "-3dmodel"))   return e3DModel;
         if ((inString == "-Help")||(inString == "-help"))   return eHelp;
+        if ((inString == "-Benchmark")||(inString == "-benchmark")) return eBenchmark;
         if ((inString == "-Meshops")||(inString == "-meshops")) return eMeshops;
         if ((inString == "-Slice")||(inString == "-slice")) return eSlice;
         if ((inString == "-Modeling")||(inString == "-modeling")) return eModeling;
@@ -67,6 +74,10 @@ void UI::argument_mode(int &argc, char *argv[])
     case ARG_MODE::eVersion:
         print_version();
         break;
+    case ARG_MODE::eBenchmark:
+        MODEL3D::run_kernel_benchmarks();
+        GEO::run_geofile_benchmarks();
+        break;
     default:
         print_ln("Unrecognized input argument. Try \"-help\" or interactive mode.");
         break;
@@ -139,7 +150,9 @@ enum quilt_code
     eSimple_append,
     eTranslate,
     eRotate,
-    eScale
+    eScale,
+    eStack,
+    ePipeline
 };
 quilt_code hash_quilt (std::string const& inString)
 {
@@ -148,33 +161,88 @@ quilt_code hash_quilt (std::string const& inString)
     if (inString == "-sa")    return eSimple_append;
     if (inString == "-t")     return eTranslate;
     if (inString == "-scale") return eScale;
+    if (inString == "-stack") return eStack;
+    if (inString == "-pipe")  return ePipeline;
     return eProblem;
 }
+namespace {
+    // Points closer than this are welded by the modeling commands, set with
+    // --weld. Zero merges identical points only.
+    double weld_tolerance = 0;
+    // With --stream, -t, -r and -scale rewrite the points of the input as
+    // it is read instead of importing it.
+    bool stream_points = false;
+
+    void stream_to_file(const std::string &input_path, const std::string &outfile_path,
+                        const GEO::affine_transform &transform)
+    {
+        if (GEO::stream_transform(input_path, outfile_path, transform)==EXIT_SUCCESS)
+            UI::print_ln("File exported as "+outfile_path);
+        else
+            UI::print_ln("Error: Streaming transform failed.");
+    }
+}
+
 void UI::gather_modeling_arg(int &argc, char *argv[])
 {
-    if (argc>3)
+    // Take "--weld <tolerance>" out of the arguments so that the commands
+    // see their usual argument count.
+    std::vector<char*> args;
+    for (int arg_index = 0; arg_index < argc; arg_index++)
+    {
+        std::string flag_string = argv[arg_index];
+        if (flag_string=="--weld")
+        {
+            double tolerance;
+            if( (arg_index+1 >= argc) ||
+                (GEO::parse_geo_real(argv[arg_index+1], tolerance)==false) ||
+                (std::isfinite(tolerance)==false) || (tolerance<0) )
+            {
+                print_ln("Error: --weld expects a non-negative tolerance.");
+                return;
+            }
+            weld_tolerance = tolerance;
+            arg_index++;
+            std::cout << "Welding points closer than " << weld_tolerance << "." << std::endl;
+        }
+        else if (flag_string=="--stream")
+            stream_points = true;
+        else
+            args.push_back(argv[arg_index]);
+    }
+    if ( (stream_points==true) && (weld_tolerance>0) )
+        print_ln("Note: --stream does not check coherence, so --weld is ignored.");
+    int arg_count = (int)args.size();
+    if (arg_count>3)
     {
-        quilt_code second_arg = hash_quilt(argv[2]);
+        quilt_code second_arg = hash_quilt(args[2]);
         switch (second_arg)
         {
             case eMerge_simple:
-                execute_simple_merge(argc, argv);
+                execute_simple_merge(arg_count, args.data());
                 break;
             case eRotate:
-                execute_rotate(argc,argv);
+                execute_rotate(arg_count, args.data());
                 break;
             case eSimple_append:
-                execute_simple_append(argc, argv);
+                execute_simple_append(arg_count, args.data());
                 break;
             case eTranslate:
-                execute_translate(argc, argv);
+                execute_translate(arg_count, args.data());
+                break;
             case eScale:
-                execute_scale(argc, argv);
+                execute_scale(arg_count, args.data());
+                break;
+            case eStack:
+                execute_stack(arg_count, args.data());
+                break;
+            case ePipeline:
+                execute_pipeline(arg_count, args.data());
                 break;
             default:
-                std::string problem_arg = argv[2];
+                std::string problem_arg = args[2];
                 print_ln("Error: Unrecognized command: <"+problem_arg+">.");
-                print_ln("Expected -m, -r, -t, -scale etc.");
+                print_ln("Expected -m, -r, -t, -scale, -stack, -pipe etc.");
                 break;
         }
     }
@@ -240,6 +308,10 @@ void UI::print_help()
     skip_ln();
     print_ln(" \"-version\":      Print the current version of Katana");
     skip_ln();
+    print_ln(" \"-benchmark\":    Time the polygon geometry kernels used by");
+    print_ln("                  -3dmodel and the .geo entity tables and reader used");
+    print_ln("                  by -modeling on generated data and print the results.");
+    skip_ln();
     print_ln(" \"-slice\":        Generate a 2D cross-sectional slice through the IC.");
     print_ln("                  The GDSII format layout file, as well as a layer");
     print_ln("                  definition file are required as input parameters.");
@@ -260,20 +332,22 @@ void UI::print_help()
     print_ln(" \"-modeling\"      Geometrical manipulations module. Extra arguments allow");
     print_ln("                  for direct file processing.");
     skip_ln();
-    print_ln(" ^ -m             Merges two specified geometry files in the following manner:");
-    print_ln("                    1: Imports both files into memory.");
-    print_ln("                    2: Performs coherence check on both file data sets.");
-    print_ln("                    3: Simplifies both file data sets.");
-    print_ln("                    4: Merges both data sets together.");
-    print_ln("                    5: Performs coherence check on the merged data.");
-    print_ln("                    6: Simplifies the merged data.");
-    print_ln("                    7: Writes merged data to specified output file.");
+    print_ln(" ^ -m             Merges two or more specified geometry files in the");
+    print_ln("                  following manner:");
+    print_ln("                    1: Imports all files into memory, concurrently.");
+    print_ln("                    2: Offsets the IDs of every file past those of the");
+    print_ln("                       files before it.");
+    print_ln("                    3: Joins the files pairwise in a tree, the joins of");
+    print_ln("                       each level running concurrently.");
+    print_ln("                    4: Performs coherence check on the merged data.");
+    print_ln("                    5: Simplifies the merged data.");
+    print_ln("                    6: Writes merged data to specified output file.");
     skip_ln();
     print_ln("                  Refer to manual for the Katana definition of coherence");
     print_ln("                  and simplification and why they are necessary.");
     skip_ln();
     print_ln("                  Format <Katana> <modeling> <merge command>");
-    print_ln("                  <first file> <second file> <specified output>");
+    print_ln("                  <first file> <second file> ... <specified output>");
     skip_ln();
     print_ln("                  e.g. ./katana -modeling -m data/left.geo data/right.geo");
     print_ln("                  -data/combined.geo");
@@ -320,6 +394,49 @@ void UI::print_help()
     print_ln("                  e.g. ./katana -modeling -scale data/shape.geo");
     print_ln("                  data/smaller_shape.geo 1e-2");
     skip_ln();
+    print_ln(" ^ -stack         Build a 3D model from 2D cross-sections written by");
+    print_ln("                  -slice. Slice i is placed at z = i * spacing and each");
+    print_ln("                  region is joined to the overlapping region of the same");
+    print_ln("                  material in the next slice. Regions without a partner");
+    print_ln("                  end halfway between the slices.");
+    skip_ln();
+    print_ln("                  Format <Katana> <modeling> <stack command> <spacing>");
+    print_ln("                  <first slice> <second slice> ... <output file>");
+    skip_ln();
+    print_ln("                  e.g. ./katana -modeling -stack 1e-6 y0.geo y1.geo");
+    print_ln("                  y2.geo data/stack.geo");
+    skip_ln();
+    print_ln(" ^ -pipe          Run a chain of -t, -r, -scale and -m steps in one call.");
+    print_ln("                  Each transform applies to the input and every file");
+    print_ln("                  merged before it. The transforms are combined and");
+    print_ln("                  applied in one pass; coherence check and");
+    print_ln("                  simplification run once at the end. The arguments");
+    print_ln("                  may instead be read from a pipeline file.");
+    skip_ln();
+    print_ln("                  Format <Katana> <modeling> <pipe command> <input file>");
+    print_ln("                  <output file> <step> <step> ...");
+    print_ln("                  or <Katana> <modeling> <pipe command> <pipeline file>");
+    skip_ln();
+    print_ln("                  e.g. ./katana -modeling -pipe shape.geo placed.geo");
+    print_ln("                  -t 1000 0 0 -r 0 0 0 0 0 90 -m frame.geo -scale 1e-3");
+    skip_ln();
+    print_ln(" ^ --weld <tol>   Option for -m, -t, -r, -scale, -stack and -pipe. The");
+    print_ln("                  coherence check merges points closer together than the");
+    print_ln("                  tolerance instead of identical points only. Use it to");
+    print_ln("                  stitch seams between files whose points differ by");
+    print_ln("                  rounding.");
+    skip_ln();
+    print_ln("                  e.g. ./katana -modeling -m left.geo right.geo");
+    print_ln("                  both.geo --weld 1e-6");
+    skip_ln();
+    print_ln(" ^ --stream       Option for -t, -r, -scale and -pipe without -m. Rewrites");
+    print_ln("                  the Point co-ordinates while reading and copies");
+    print_ln("                  everything else unchanged, in constant memory. Skips");
+    print_ln("                  the coherence check and simplification.");
+    skip_ln();
+    print_ln("                  e.g. ./katana -modeling -r big.geo big_r.geo");
+    print_ln("                  0 0 0 0 0 90 --stream");
+    skip_ln();
     print_ln(" \"-meshops\"       Meshfile manipulations module.");
     skip_ln();
     print_ln(" ^ -s {Legacy}    Convert FLOOXS exported 2D msh. to .geo contour.");
@@ -354,6 +471,32 @@ void UI::print_help()
     print_ln("                  e.g. ./katana -3dmodel data/JTL.gds data/mitll_sfq5ee.pf");
     print_ln("                  data/3DGen data/3DGen/JTLModelOutputScript.py");
     skip_ln();
+    print_ln("                  Optional flags may follow the output path:");
+    print_ln("                  --multi  Enable Python multiprocessing in the script.");
+    print_ln("                           Costliest shapes are built first and the");
+    print_ln("                           pairwise fuses of each round run in parallel.");
+    print_ln("                  --stl    Skip FreeCAD and write a watertight binary STL");
+    print_ln("                           per layer (<output>_layer_<number>.stl).");
+    print_ln("                  --obj    As --stl, but writes Wavefront OBJ files.");
+    print_ln("                  --geo    Skip FreeCAD and write one Gmsh .geo model with a");
+    print_ln("                           physical volume per layer (<output>.geo).");
+    print_ln("                  --contour-points <n>  Resample every etch contour to n");
+    print_ln("                           points spaced evenly in height.");
+    print_ln("                  --incremental  Cache each layer's output next to the");
+    print_ln("                           output (.katana_cache) and only regenerate");
+    print_ln("                           layers whose polygons, process info or");
+    print_ln("                           contour changed since the previous run.");
+    print_ln("                  --simplify <mode>  Outline point reduction: radial");
+    print_ln("                           (default), douglas-peucker or visvalingam.");
+    print_ln("                  --hierarchical  Build each leaf cell once and place");
+    print_ln("                           it with FreeCAD links. Only routing outside");
+    print_ln("                           leaf cells is flattened.");
+    print_ln("                  --window <x1> <y1> <x2> <y2>  Only model the rectangle");
+    print_ln("                           between these corners (database units).");
+    print_ln("                  --margin <m>  With --window, also read layout within m");
+    print_ln("                           of the window so edge offsets match the full");
+    print_ln("                           model. Default 0.");
+    skip_ln();
     print_ln("                  Rules for contour .geo:");
     print_ln("                  Use approximately 5 of the most relevant points in contour.");
     print_ln("                  Points must be listed x_low to x_high, z_low to z_high.");
@@ -720,25 +863,138 @@ void UI::gather_3D_arg(int &argc, char *argv[])
             std::string extension = *std::prev(split_str_vec.end(),1);
             if((extension=="pf")||(extension=="PF"))
             {
-            bool multi_flag = false;
-                if(argc==7)
+                bool multi_flag = false;
+                bool incremental_flag = false;
+                bool hierarchical_flag = false;
+                int contour_points = 0;
+                MODEL3D::decimation_mode decimation = MODEL3D::eRadial;
+                MODEL3D::output_type output_format = MODEL3D::eFreeCAD_script;
+                bool window_flag = false;
+                clip_window window;
+                int window_margin = 0;
+                for (int arg_index = 6; arg_index < argc; arg_index++)
                 {
-                    std::string mp_string = argv[6];
-                    if(mp_string=="--multi")
+                    std::string flag_string = argv[arg_index];
+                    if(flag_string=="--multi")
                     {
                         multi_flag = true;
                         print_ln("FreeCAD Multiprocessing enabled.");
                     }
+                    else if(flag_string=="--stl")
+                    {
+                        output_format = MODEL3D::eSTL_mesh;
+                        print_ln("Writing binary STL per layer instead of a FreeCAD script.");
+                    }
+                    else if(flag_string=="--obj")
+                    {
+                        output_format = MODEL3D::eOBJ_mesh;
+                        print_ln("Writing OBJ per layer instead of a FreeCAD script.");
+                    }
+                    else if(flag_string=="--geo")
+                    {
+                        output_format = MODEL3D::eGEO_model;
+                        print_ln("Writing a Gmsh .geo volume model instead of a FreeCAD script.");
+                    }
+                    else if( (flag_string=="--contour-points") && (arg_index+1 < argc) )
+                    {
+                        try
+                        {
+                            contour_points = std::stoi(argv[++arg_index]);
+                        }
+                        catch(const std::exception &e)
+                        {
+                            contour_points = -1;
+                        }
+                        if(contour_points<2)
+                        {
+                            print_ln("Warning: --contour-points needs a whole number of at least 2. Using contours as loaded.");
+                            contour_points = 0;
+                        }
+                        else
+                            print_ln("Resampling etch contours to "+std::to_string(contour_points)+" points.");
+                    }
+                    else if(flag_string=="--incremental")
+                    {
+                        incremental_flag = true;
+                        print_ln("Incremental generation enabled.");
+                    }
+                    else if(flag_string=="--hierarchical")
+                    {
+                        hierarchical_flag = true;
+                        print_ln("Building each leaf cell once and placing copies.");
+                    }
+                    else if( (flag_string=="--simplify") && (arg_index+1 < argc) )
+                    {
+                        std::string mode_name = argv[++arg_index];
+                        if(MODEL3D::parse_decimation_mode(mode_name, decimation)==true)
+                            print_ln("Simplifying outlines with "+mode_name+" decimation.");
+                        else
+                            print_ln("Warning: Unknown --simplify mode \""+mode_name+"\". Using radial.");
+                    }
+                    else if( (flag_string=="--window") && (arg_index+4 < argc) )
+                    {
+                        int corners[4];
+                        try
+                        {
+                            for (int i = 0; i < 4; i++)
+                                corners[i] = std::stoi(argv[++arg_index]);
+                        }
+                        catch(const std::exception &e)
+                        {
+                            print_ln("Error: --window needs four whole numbers x1 y1 x2 y2 in database units.");
+                            return;
+                        }
+                        window.min_x = std::min(corners[0], corners[2]);
+                        window.min_y = std::min(corners[1], corners[3]);
+                        window.max_x = std::max(corners[0], corners[2]);
+                        window.max_y = std::max(corners[1], corners[3]);
+                        if( (window.min_x==window.max_x) || (window.min_y==window.max_y) )
+                        {
+                            print_ln("Error: --window must enclose an area.");
+                            return;
+                        }
+                        window_flag = true;
+                    }
+                    else if( (flag_string=="--margin") && (arg_index+1 < argc) )
+                    {
+                        try
+                        {
+                            window_margin = std::stoi(argv[++arg_index]);
+                        }
+                        catch(const std::exception &e)
+                        {
+                            window_margin = -1;
+                        }
+                        if(window_margin<0)
+                        {
+                            print_ln("Warning: --margin needs a whole number of at least 0. Using 0.");
+                            window_margin = 0;
+                        }
+                    }
                     else
                     {
-                        print_ln("Warning: Fourth argument unrecognized. Disabling multiprocessing.");
+                        print_ln("Warning: Argument \""+flag_string+"\" unrecognized. Ignoring.");
                     }
                 }
                 MODEL3D::three_dim_model model_data;
+                if(window_flag==true)
+                {
+                    model_data.set_window(window, window_margin);
+                    print_ln("Modelling window ("+std::to_string(window.min_x)+", "+std::to_string(window.min_y)+") to ("
+                             +std::to_string(window.max_x)+", "+std::to_string(window.max_y)+") with a margin of "
+                             +std::to_string(window_margin)+".");
+                }
+                else if(window_margin>0)
+                    print_ln("Warning: --margin has no effect without --window. Ignoring.");
                 std::string cont_path = argv[4];
                 std::string py_path = argv[5];
+                model_data.set_output_format(output_format);
+                model_data.set_incremental(incremental_flag);
+                model_data.set_hierarchical(hierarchical_flag);
+                model_data.set_contour_resolution(contour_points);
+                model_data.set_decimation(decimation);
                 if(model_data.generate_model(gds_path, pif_path, py_path, cont_path, multi_flag)==EXIT_FAILURE)
-                    print_ln("Error: Cannot generate model without GDS.");
+                    print_ln("Error: Model generation failed.");
             }
             else
             {
@@ -884,45 +1140,147 @@ void UI::execute_simple_append(int &argc, char *argv[])
     }
 }
 
+// ./katana -modeling -m in_1.geo ... in_N.geo out.geo
+// The inputs are imported concurrently and merged in one pass.
 void UI::execute_simple_merge(int &argc, char *argv[])
 {
-    if ( argc == 6 )
+    if ( argc >= 6 )
     {
-        GEO::geofile primary_geofile, secondary_geofile;
-        if ( primary_geofile.import_geofile(argv[3]) == EXIT_SUCCESS )
+        std::vector<GEO::geofile> geofiles(argc-4);
+        std::vector<std::future<int>> imports;
+        for (size_t i = 0; i < geofiles.size(); i++)
         {
-            print_ln("Imported primary geometry file successfully.");
-            if(secondary_geofile.import_geofile(argv[4]) == EXIT_SUCCESS)
+            geofiles[i].set_weld_tolerance(weld_tolerance);
+            std::string import_path = argv[3+i];
+            imports.push_back(std::async(std::launch::async, [&geofiles, i, import_path]() {
+                return geofiles[i].import_geofile(import_path);
+            }));
+        }
+        bool imported = true;
+        for (size_t i = 0; i < imports.size(); i++)
+        {
+            if (imports[i].get()!=EXIT_SUCCESS)
             {
-                print_ln("Imported secondary geometry file successfully.");
-                if (primary_geofile.merge_with(secondary_geofile)==EXIT_SUCCESS)
-                {
-                    std::string export_path = argv[5];
-                    if(primary_geofile.export_geofile(export_path)==EXIT_SUCCESS)
-                        print_ln("Export returned success.");
-                    else
-                        print_ln("Export returned failure.");
-                }
+                print_ln("Error: Import of \""+std::string(argv[3+i])+"\" failed.");
+                imported = false;
+            }
+        }
+        if (imported==true)
+        {
+            std::cout << "Imported " << geofiles.size() << " geometry files successfully." << std::endl;
+            if (GEO::merge_geofiles(geofiles)==EXIT_SUCCESS)
+            {
+                std::string export_path = argv[argc-1];
+                if(geofiles[0].export_geofile(export_path)==EXIT_SUCCESS)
+                    print_ln("Export returned success.");
                 else
-                {
-                    print_ln("Error: Merge Operation Failed.");
-                }
+                    print_ln("Export returned failure.");
             }
             else
             {
-                print_ln("Error: Import of second file failed.");
+                print_ln("Error: Merge Operation Failed.");
             }
         }
-        else
+    }
+    else
+    {
+        std::cout << "Error: Expected at least 5 arguments, got " << argc << "." << std::endl;
+    }
+}
+
+// ./Katana -modeling -stack 1e-6 slice_1.geo slice_2.geo ... data/stack.geo
+void UI::execute_stack(int &argc, char *argv[])
+{
+    if ( argc >= 7 )
+    {
+        if (GEO::is_e_notation(argv[3])==false)
         {
-            print_ln("Error: Import of first file failed.");
+            print_ln("Error: Slice spacing unrecognized. Terminating.");
+            return;
+        }
+        double spacing = std::stod(argv[3]);
+        std::vector<GEO::geofile> slices(argc-5);
+        std::vector<std::future<int>> imports;
+        for (size_t i = 0; i < slices.size(); i++)
+        {
+            std::string import_path = argv[4+i];
+            imports.push_back(std::async(std::launch::async, [&slices, i, import_path]() {
+                return slices[i].import_geofile(import_path);
+            }));
+        }
+        bool imported = true;
+        for (size_t i = 0; i < imports.size(); i++)
+        {
+            if (imports[i].get()!=EXIT_SUCCESS)
+            {
+                print_ln("Error: Import of \""+std::string(argv[4+i])+"\" failed.");
+                imported = false;
+            }
+        }
+        if (imported==true)
+        {
+            GEO::geofile stacked;
+            stacked.set_weld_tolerance(weld_tolerance);
+            if (GEO::stack_slices(slices, spacing, stacked)==EXIT_SUCCESS)
+            {
+                stacked.make_coherent(true);
+                stacked.simplify_data();
+                std::string export_path = argv[argc-1];
+                if(stacked.export_geofile(export_path)==EXIT_SUCCESS)
+                    print_ln("Export returned success.");
+                else
+                    print_ln("Export returned failure.");
+            }
+            else
+            {
+                print_ln("Error: Stacking failed.");
+            }
         }
     }
     else
     {
-        std::cout << "Error: Expected 5 arguments, got " << argc << "." << std::endl;
+        std::cout << "Error: Expected at least 6 arguments, got " << argc << "." << std::endl;
     }
+}
 
+// ./Katana -modeling -pipe in.geo out.geo -t 1 0 0 -r 0 0 0 0 0 90 -m other.geo -scale 1e-3
+// ./Katana -modeling -pipe steps.txt
+void UI::execute_pipeline(int &argc, char *argv[])
+{
+    std::vector<std::string> arguments(argv+3, argv+argc);
+    if (arguments.size()==1)
+    {
+        std::string pipeline_path = arguments[0];
+        arguments.clear();
+        if (GEO::read_pipeline_file(pipeline_path, arguments)==EXIT_FAILURE)
+            return;
+    }
+    if (arguments.size()<2)
+    {
+        print_ln("Error: A pipeline needs an input and an output file.");
+        return;
+    }
+    std::vector<GEO::pipeline_step> steps;
+    if (GEO::parse_pipeline(std::vector<std::string>(arguments.begin()+2, arguments.end()), steps)==EXIT_FAILURE)
+        return;
+    if (stream_points==true)
+    {
+        GEO::affine_transform transform;
+        for (auto step_it = steps.begin(); step_it != steps.end(); step_it++)
+        {
+            if (step_it->merge_path.empty()==false)
+            {
+                print_ln("Error: --stream cannot be combined with -m steps.");
+                return;
+            }
+            transform = GEO::chain(transform, step_it->transform);
+        }
+        stream_to_file(arguments[0], arguments[1], transform);
+    }
+    else if (GEO::run_pipeline(arguments[0], steps, weld_tolerance, arguments[1])==EXIT_SUCCESS)
+        print_ln("File exported as "+arguments[1]);
+    else
+        print_ln("Error: Pipeline failed.");
 }
 
 //Silver linings -----------------------------------
@@ -1062,7 +1420,8 @@ void UI::execute_slice(std::string gds_path, std::string ldf_path, int x1, int y
     section_data my_section;
 
     gds_file.import(gds_path);
-    ldf_data.read_ldf(ldf_path);
+    if (ldf_data.read_ldf(ldf_path) == EXIT_FAILURE)
+      return;
     if (my_section.populate(x1, y1, x2, y2, gds_file) == EXIT_SUCCESS)
     {
       // my_section.polygon_to_gds(test_poly_outpath);commentout
@@ -1087,6 +1446,7 @@ void UI::execute_translate(int &argc, char *argv[])
         std::string input_path   = argv[3];
         std::string outfile_path = argv[4];
         GEO::geofile primary_geofile;
+        primary_geofile.set_weld_tolerance(weld_tolerance);
         if ((GEO::is_e_notation(argv[5]))&&
             (GEO::is_e_notation(argv[6]))&&
             (GEO::is_e_notation(argv[7])))
@@ -1094,7 +1454,9 @@ void UI::execute_translate(int &argc, char *argv[])
             double del_x = std::stod(argv[5]);
             double del_y = std::stod(argv[6]);
             double del_z = std::stod(argv[7]);
-            if(primary_geofile.import_geofile(input_path)==EXIT_SUCCESS)
+            if (stream_points==true)
+                stream_to_file(input_path, outfile_path, GEO::translation(del_x, del_y, del_z));
+            else if(primary_geofile.import_geofile(input_path)==EXIT_SUCCESS)
             {
                 primary_geofile.make_coherent(true);
                 primary_geofile.simplify_data();
@@ -1131,6 +1493,7 @@ void UI::execute_rotate(int &argc, char *argv[])
         std::string input_path   = argv[3];
         std::string outfile_path = argv[4];
         GEO::geofile primary_geofile;
+        primary_geofile.set_weld_tolerance(weld_tolerance);
         if ((GEO::is_e_notation(argv[5]))&&
             (GEO::is_e_notation(argv[6]))&&
             (GEO::is_e_notation(argv[7]))&&
@@ -1144,7 +1507,10 @@ void UI::execute_rotate(int &argc, char *argv[])
             double theta_x = std::stod(argv[8]);
             double theta_y = std::stod(argv[9]);
             double theta_z = std::stod(argv[10]);
-            if(primary_geofile.import_geofile(input_path)==EXIT_SUCCESS)
+            if (stream_points==true)
+                stream_to_file(input_path, outfile_path,
+                               GEO::rotation(ori_x, ori_y, ori_z, theta_x, theta_y, theta_z));
+            else if(primary_geofile.import_geofile(input_path)==EXIT_SUCCESS)
             {
                 if(primary_geofile.rotate_data( ori_x,   ori_y,   ori_z,
                                                 theta_x, theta_y, theta_z)==EXIT_SUCCESS)
@@ -1180,7 +1546,10 @@ void UI::execute_scale(int &argc, char *argv[])
         if (GEO::is_e_notation(factor))
         {
             GEO::geofile primary_geofile;
-            if (primary_geofile.import_geofile(geo_file_name)==EXIT_SUCCESS)
+            primary_geofile.set_weld_tolerance(weld_tolerance);
+            if (stream_points==true)
+                stream_to_file(geo_file_name, outfile_name, GEO::scaling(std::stod(factor)));
+            else if (primary_geofile.import_geofile(geo_file_name)==EXIT_SUCCESS)
             {
                 double fac=std::stod(factor);
                 if(primary_geofile.scale_data(fac)==EXIT_SUCCESS)